@@ -78,6 +78,27 @@ extern "C"
 	void ggkLogRegisterAlways(GGKLogReceiver receiver);
 	void ggkLogRegisterTrace(GGKLogReceiver receiver);
 
+	// Enables or disables asynchronous delivery of log messages
+	//
+	// Log receivers are normally called on whichever thread logs the message, including the server's own threads, so a slow
+	// receiver will slow down the server. With asynchronous delivery enabled, messages are queued and a background thread calls
+	// the receivers instead. Up to `capacity` messages can be waiting at once (0 selects the default of 1024); messages logged
+	// while the queue is full are dropped (see `ggkLogAsyncDroppedCount`.) Queued messages longer than 1023 characters are
+	// truncated.
+	//
+	// Disabling asynchronous delivery delivers any waiting messages before returning.
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkLogSetAsync(int enable, int capacity);
+
+	// Blocks until all waiting log messages have been delivered (this does nothing unless asynchronous delivery is enabled)
+	//
+	// This is called automatically by `ggkShutdownAndWait()`.
+	void ggkLogFlush();
+
+	// Returns the number of log messages that have been dropped because the asynchronous queue was full
+	int ggkLogAsyncDroppedCount();
+
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// SERVER DATA
 	// -----------------------------------------------------------------------------------------------------------------------------
@@ -92,6 +113,25 @@ extern "C"
 	// safely for an indefinite period of time.
 	typedef const void *(*GGKServerDataGetter)(const char *pName);
 
+	// A buffer of application-owned data that the data getter can return instead of the data itself
+	//
+	// For names that the server reads with `getDataBytes()` (see GattInterface.h), the data getter returns a pointer to one of
+	// these. The server sends `pData` as it is rather than copying it, so it must remain valid and unchanged until the server is
+	// done with it:
+	//
+	//   * If `release` is null, `pData` must remain valid for the life of the server (a static blob, for example)
+	//   * Otherwise, the server calls `release(pReleaseData)` once for each time the getter returned the buffer, when it is done
+	//     with the data. This may be called from any of the server's threads.
+	//
+	// The server reads the structure itself as soon as the getter returns.
+	struct GGKDataBuffer
+	{
+		const void *pData;
+		int size;
+		void (*release)(void *pReleaseData);
+		void *pReleaseData;
+	};
+
 	// Type definition for a delegate that the server will use when it needs to notify the host application that data has changed
 	//
 	// IMPORTANT:
@@ -128,6 +168,12 @@ extern "C"
 	// Adds a named update to the front of the queue. Generally, this routine should not be used directly. Instead, use the
 	// `ggkNofifyUpdatedCharacteristic()` instead.
 	//
+	// If coalescing is enabled (see `ggkUpdateQueueSetCoalescing`) and an update for the same object path and interface is already
+	// waiting in the queue, the new update is merged with the existing one and the queue is left unchanged.
+	//
+	// This method never blocks on the server thread, whether or not coalescing is enabled. If the queue is full, the configured
+	// policy is applied (see `ggkUpdateQueueConfigure`.)
+	//
 	// Returns non-zero value on success or 0 on failure.
 	int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName);
 
@@ -143,6 +189,8 @@ extern "C"
 	// If `keep` is set to non-zero, the entry is not removed and will be retrieved again on the next call. Otherwise, the element
 	// is removed.
 	//
+	// Updates for handles that no longer resolve to a characteristic (see `ggkResolveCharacteristic()`) are discarded along the way.
+	//
 	// Returns 1 on success, 0 if the queue is empty, -1 on error (such as the length too small to store the element)
 	int ggkPopUpdateQueue(char *pElement, int elementLen, int keep);
 
@@ -152,9 +200,421 @@ extern "C"
 	// Returns the number of entries waiting in the queue
 	int ggkUpdateQueueSize();
 
-	// Removes all entries from the queue
+	// Returns the largest number of entries that have been waiting in the queue at one time
+	int ggkUpdateQueueHighWaterMark();
+
+	// Removes all entries from the queue (this also resets the queue's high-water mark)
 	void ggkUpdateQueueClear();
 
+	// The policy applied when an update is pushed onto a full queue
+	//
+	//     EUpdateQueueDropNewest      - the new update is discarded and the push fails
+	//     EUpdateQueueOverwriteOldest - the oldest pending update is discarded to make room for the new one
+	//
+	// Either way, the discarded update is counted (see `ggkUpdateQueueDroppedCount`.)
+	enum GGKUpdateQueuePolicy
+	{
+		EUpdateQueueDropNewest,
+		EUpdateQueueOverwriteOldest
+	};
+
+	// Sets the capacity of the update queue and the policy to apply when it is full
+	//
+	// The queue is bounded so that pushing an update never allocates queue storage or blocks. By default, the queue holds 4096
+	// entries and uses `EUpdateQueueDropNewest`. The capacity is rounded up to the next power of two.
+	//
+	// This discards any pending updates, so it should be called before `ggkStart()`. It will fail if the server is running.
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkUpdateQueueConfigure(int capacity, enum GGKUpdateQueuePolicy policy);
+
+	// Enables (non-zero) or disables (0) coalescing of updates
+	//
+	// When enabled, the queue holds at most one pending entry for any (object path, interface) pair. Additional updates for an
+	// entry that is already waiting are merged into it, so a fast producer will generate at most one change notification per
+	// characteristic each time the server drains the queue. Coalescing is disabled by default.
+	//
+	// Up to 4096 distinct (object path, interface) pairs can be coalesced; updates for pairs beyond that are queued as they come.
+	void ggkUpdateQueueSetCoalescing(int enable);
+
+	// Returns the number of updates that have been merged into an already-pending entry since the server started
+	int ggkUpdateQueueCoalescedCount();
+
+	// Returns the number of updates that have been discarded because the queue was full
+	int ggkUpdateQueueDroppedCount();
+
+	// Resolves the characteristic at the given object path to a handle for use with `ggkNotifyHandle()`
+	//
+	// This performs the object lookup once, so it should be called after `ggkStart()` (typically once per characteristic at
+	// startup) and the handle kept for the life of the server.
+	//
+	// Handles are unique across servers, so the path may belong to any server that has been started.
+	//
+	// Returns a positive handle on success or 0 on failure (the server isn't started or the path is not a characteristic)
+	int ggkResolveCharacteristic(const char *pObjectPath);
+
+	// Adds an update for the characteristic identified by `handle` (see `ggkResolveCharacteristic()`)
+	//
+	// This is equivalent to `ggkNofifyUpdatedCharacteristic()`, except the update carries only the integer handle. It does not
+	// allocate memory, format strings, search the server description or take any locks (unless a trace is being recorded; see
+	// `ggkTraceStart()`.)
+	//
+	// Returns non-zero value on success or 0 on failure (an invalid handle or the queue is full.)
+	int ggkNotifyHandle(int handle);
+
+	// Returns 1 if anybody is subscribed to notifications from the characteristic at the given object path, otherwise 0
+	//
+	// Updates for a characteristic with the "notify" or "indicate" flag are dropped while nobody is subscribed, so a producer may
+	// use this to skip preparing data that wouldn't be sent. Characteristics without either flag are never subscribed.
+	int ggkIsCharacteristicSubscribed(const char *pObjectPath);
+
+	// Same as `ggkIsCharacteristicSubscribed()`, for the characteristic identified by `handle` (see `ggkResolveCharacteristic()`)
+	//
+	// This does not allocate memory or search the server description. It isn't strictly lock-free, though: finding the characteristic
+	// copies shared pointers with `std::atomic_load`, which libstdc++ guards with a small pool of internal locks. Those are only held
+	// for the copy and are never held by the server while it does other work.
+	int ggkIsHandleSubscribed(int handle);
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// SERVER DATA STORE
+	// -----------------------------------------------------------------------------------------------------------------------------
+	//
+	// Values stored here are served to the server directly, in place of calling the application's data getter
+	// (`GGKServerDataGetter`) for that name. This is optional; names that are not stored still go to the data getter.
+	//
+	// The store keeps its own copy of each value, so the data does not need to remain valid after the call. Storing a value does
+	// not notify anybody; call `ggkNofifyUpdatedCharacteristic()` (or `ggkNotifyHandle()`) afterwards as usual.
+
+	// Stores a copy of the `size` bytes at `pData` under the name `pName`, replacing any value already stored under that name
+	//
+	// Stored values are read back by the server with the same types they would have with the data getter. For non-pointer types
+	// (see `getDataValue()` in GattInterface.h) `size` must be the size of that type. For strings, include the null terminator
+	// (or use `ggkDataStoreSetString()`.)
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkDataStoreSet(const char *pName, const void *pData, int size);
+
+	// Stores a copy of the null-terminated string `pString` under the name `pName` (see `ggkDataStoreSet()`)
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkDataStoreSetString(const char *pName, const char *pString);
+
+	// Returns the key for the name `pName`, for use with `ggkDataStoreSetKey()`
+	//
+	// Keys remain valid for the life of the process, so this is typically called once per name at startup. Up to 4096 names can
+	// be interned.
+	//
+	// Returns a positive key on success or 0 on failure.
+	int ggkDataStoreIntern(const char *pName);
+
+	// Same as `ggkDataStoreSet()`, except the value is identified by a key from `ggkDataStoreIntern()`
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkDataStoreSetKey(int key, const void *pData, int size);
+
+	// Removes the value stored under the name `pName`, so the server goes back to the data getter for it
+	//
+	// Returns non-zero value if a value was removed or 0 if there was none.
+	int ggkDataStoreRemove(const char *pName);
+
+	// Removes all stored values
+	void ggkDataStoreClear();
+
+	// Returns the version of the value stored under the name `pName`, or 0 if there is none
+	//
+	// Every stored value (including values written to the store by the server on behalf of a client) gets a new version, larger
+	// than any version before it. A value has changed if its version has changed.
+	unsigned long long ggkDataStoreGetVersion(const char *pName);
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// STATISTICS
+	// -----------------------------------------------------------------------------------------------------------------------------
+	//
+	// The server can keep counters and latency histograms describing how it is performing. These are disabled by default, in which
+	// case they cost next to nothing; enable them with `ggkStatsEnable()`. Counters may be read at any time from any thread.
+
+	// The number of buckets in a `GGKStatsHistogram`
+	#define GGK_STATS_HISTOGRAM_BUCKETS 24
+
+	// A histogram of durations
+	//
+	// `buckets[0]` counts durations under 1 microsecond and `buckets[i]` counts durations from 2^(i-1) up to (but not including)
+	// 2^i microseconds. The last bucket also counts anything longer (about 8.4 seconds and up.)
+	struct GGKStatsHistogram
+	{
+		unsigned long long count;
+		unsigned long long totalMicroseconds;
+		unsigned long long buckets[GGK_STATS_HISTOGRAM_BUCKETS];
+	};
+
+	// The phases of server initialization, as timed in `GGKStats`
+	//
+	// Adapter configuration talks to the kernel directly, so it runs alongside the D-Bus phases rather than after them.
+	enum GGKInitPhase
+	{
+		EInitPhaseBusAcquire,
+		EInitPhaseOwnedNameAcquire,
+		EInitPhaseObjectManager,
+		EInitPhaseFindAdapter,
+		EInitPhaseConfigureAdapter,
+		EInitPhaseRegisterObjects,
+		EInitPhaseRegisterApplication,
+		EInitPhaseCount
+	};
+
+	// Counters for the server as a whole (see `ggkGetStats()`)
+	struct GGKStats
+	{
+		// Updates pushed onto the update queue (including coalesced updates) and entries popped from it
+		unsigned long long updateQueuePushes;
+		unsigned long long updateQueuePops;
+
+		// The largest number of entries that have been waiting in the update queue at one time (see `ggkUpdateQueueHighWaterMark()`)
+		unsigned long long updateQueueHighWaterMark;
+
+		// HCI management commands that received a response, the time from sending each to receiving its response, and commands
+		// that timed out waiting for a response
+		unsigned long long hciCommands;
+		unsigned long long hciCommandTimeouts;
+		struct GGKStatsHistogram hciCommandLatency;
+
+		// HCI events that were malformed and skipped
+		//
+		// These are counted whether or not statistics are enabled.
+		unsigned long long hciMalformedEvents;
+
+		// Failed initialization steps that were scheduled to be retried
+		unsigned long long retries;
+
+		// The time each initialization phase took the last time it completed (0 if it hasn't), from the start of the attempt that
+		// succeeded. With more than one server, this is the last server to complete the phase.
+		//
+		// Startup timings are recorded whether or not statistics are enabled.
+		unsigned long long initPhaseMicroseconds[EInitPhaseCount];
+
+		// The time from the start of the server thread until the server was running (including any retries), or 0 if it hasn't
+		// reached the running state
+		unsigned long long initMicroseconds;
+	};
+
+	// Counters for a single characteristic or descriptor (see `ggkGetCharacteristicStats()`)
+	struct GGKCharacteristicStats
+	{
+		// D-Bus method calls (ReadValue, WriteValue, etc.) and the time taken to dispatch each one
+		//
+		// For handlers that run on the worker pool (see `onReadValueAsync()`) the time covers handing the call to a worker.
+		unsigned long long methodCalls;
+		struct GGKStatsHistogram methodLatency;
+
+		// D-Bus property requests
+		unsigned long long getPropertyCalls;
+		unsigned long long setPropertyCalls;
+
+		// Change notifications sent to subscribers
+		unsigned long long notifications;
+	};
+
+	// Convert a `GGKInitPhase` into a human-readable string
+	const char *ggkGetInitPhaseString(enum GGKInitPhase phase);
+
+	// Enables (non-zero) or disables (0) recording of statistics
+	//
+	// Disabling statistics stops recording but leaves the counters as they are.
+	void ggkStatsEnable(int enable);
+
+	// Copies the server-wide counters into `pStats`
+	//
+	// Returns non-zero value on success or 0 on failure (`pStats` is null.)
+	int ggkGetStats(struct GGKStats *pStats);
+
+	// Copies the counters for the characteristic (or descriptor) at the given object path into `pStats`
+	//
+	// Returns non-zero value on success or 0 on failure (the server isn't started or the path is not a characteristic or
+	// descriptor.)
+	int ggkGetCharacteristicStats(const char *pObjectPath, struct GGKCharacteristicStats *pStats);
+
+	// Resets all counters (server-wide and per-characteristic) to zero
+	void ggkStatsReset();
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// CONNECTIONS
+	// -----------------------------------------------------------------------------------------------------------------------------
+	//
+	// Centrals choose the connection interval when they connect, often 30 to 50ms. A connection policy asks for something else: a
+	// shorter interval for latency-sensitive characteristics, for instance, or the LE 2M PHY for throughput. The kernel asks each
+	// central that connects to update its connection to the policy's parameters, but the central has the final word.
+	//
+	// Data length extension needs no policy; the kernel negotiates the largest data length the controller supports by itself.
+
+	// PHY bits for `GGKConnectionPolicy` and `GGKConnectionStats` (these are the bits used by the Bluetooth Management API)
+	#define GGK_PHY_LE_1M_TX     (1 << 9)
+	#define GGK_PHY_LE_1M_RX     (1 << 10)
+	#define GGK_PHY_LE_2M_TX     (1 << 11)
+	#define GGK_PHY_LE_2M_RX     (1 << 12)
+	#define GGK_PHY_LE_CODED_TX  (1 << 13)
+	#define GGK_PHY_LE_CODED_RX  (1 << 14)
+
+	// How connections to a controller should be set up
+	struct GGKConnectionPolicy
+	{
+		// The connection interval range to ask centrals for, in units of 1.25ms (6 to 3200), or 0 for both to leave the connection
+		// parameters alone
+		unsigned short minInterval;
+		unsigned short maxInterval;
+
+		// The number of connection events the peripheral may skip (0 to 499) and the supervision timeout, in units of 10ms (10 to
+		// 3200.) The timeout must outlast the skipped connection events.
+		unsigned short latency;
+		unsigned short supervisionTimeout;
+
+		// PHYs (GGK_PHY_*) to enable on the controller in addition to those already enabled, or 0 to leave the PHYs alone
+		//
+		// PHYs are selected for the controller as a whole. Those it doesn't support are ignored.
+		unsigned int phys;
+	};
+
+	// Sets the connection policy for the controller at `controllerIndex` (the zero-based index, as in 'hci0'), or clears it if
+	// `pPolicy` is null
+	//
+	// The policy may be set before the controller's server is started, in which case it is applied while the controller is
+	// configured, or at any time after, in which case it is applied right away. Its connection parameters are loaded for each
+	// device as it connects. Clearing a policy only stops it from being applied from then on.
+	//
+	// Returns non-zero value on success or 0 on failure (the policy's connection parameters are invalid, or it could not be
+	// applied to a running server's controller.)
+	int ggkSetConnectionPolicy(int controllerIndex, const struct GGKConnectionPolicy *pPolicy);
+
+	// What is known about a connected device
+	struct GGKConnectionStats
+	{
+		// The device's address, most significant octet first (as written 12:34:56:78:9A:BC), and type (0 = BR/EDR, 1 = LE public,
+		// 2 = LE random)
+		unsigned char address[6];
+		unsigned char addressType;
+
+		// The ATT MTU BlueZ reported with the device's last request, or 0 if not yet known
+		//
+		// This is only recorded while statistics are enabled (see `ggkStatsEnable()`), and only by versions of BlueZ that report
+		// it (5.62 and later.)
+		unsigned short mtu;
+
+		// The connection parameters the kernel last reported for the connection, or 0 if it hasn't reported any (intervals are in
+		// units of 1.25ms and the supervision timeout is in units of 10ms)
+		unsigned short minInterval;
+		unsigned short maxInterval;
+		unsigned short latency;
+		unsigned short supervisionTimeout;
+
+		// The PHYs (GGK_PHY_* and others) selected on the controller, or 0 if not known
+		//
+		// The kernel doesn't report the PHY of individual connections, so this is the controller's selection.
+		unsigned int selectedPhys;
+
+		// How long the device has been connected
+		unsigned long long connectedMicroseconds;
+	};
+
+	// Copies what is known about up to `maxConnections` devices connected to the controller at `controllerIndex` into
+	// `pConnections`
+	//
+	// Returns the number of connected devices, which may be more than `maxConnections`
+	int ggkGetConnectionStats(int controllerIndex, struct GGKConnectionStats *pConnections, int maxConnections);
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// ADAPTER EVENTS
+	// -----------------------------------------------------------------------------------------------------------------------------
+	//
+	// Rather than polling, the application can be told as devices connect to and disconnect from each controller and as a
+	// controller's settings change. Callbacks are called from the HCI event thread as each event arrives. They should return
+	// quickly and must not call anything that waits on the adapter, such as `ggkStart()` or `ggkSetConnectionPolicy()`.
+
+	// Adapter event types, which are also the bits of the `eventTypes` mask given to `ggkAdapterSubscribe()`
+	enum GGKAdapterEventType
+	{
+		EAdapterEventConnected = (1 << 0),
+		EAdapterEventDisconnected = (1 << 1),
+		EAdapterEventSettingsChanged = (1 << 2)
+	};
+
+	// Controller setting bits for `GGKAdapterEvent` (these are the bits used by the Bluetooth Management API)
+	#define GGK_SETTING_POWERED             (1 << 0)
+	#define GGK_SETTING_CONNECTABLE         (1 << 1)
+	#define GGK_SETTING_DISCOVERABLE        (1 << 3)
+	#define GGK_SETTING_BONDABLE            (1 << 4)
+	#define GGK_SETTING_BREDR               (1 << 7)
+	#define GGK_SETTING_LE                  (1 << 9)
+	#define GGK_SETTING_ADVERTISING         (1 << 10)
+	#define GGK_SETTING_SECURE_CONNECTIONS  (1 << 11)
+
+	struct GGKAdapterEvent
+	{
+		enum GGKAdapterEventType type;
+
+		// The zero-based index of the controller, as in 'hci0'
+		int controllerIndex;
+
+		// For connections and disconnections, the device's address, most significant octet first (as written 12:34:56:78:9A:BC),
+		// and type (0 = BR/EDR, 1 = LE public, 2 = LE random)
+		unsigned char address[6];
+		unsigned char addressType;
+
+		// For disconnections, the reason (0 = unspecified, 1 = timeout, 2 = by this host, 3 = by the device, 4 = authentication
+		// failure)
+		unsigned char reason;
+
+		// For settings changes, the controller's new settings (GGK_SETTING_* and others)
+		unsigned int settings;
+	};
+
+	// Called from the HCI event thread with each event a subscriber asked for (see `ggkAdapterSubscribe()`)
+	//
+	// The event is only valid for the duration of the call.
+	typedef void (*GGKAdapterEventCallback)(const struct GGKAdapterEvent *pEvent, void *pUserData);
+
+	// Calls `callback` (passing `pUserData` along) for every adapter event whose type is in `eventTypes` (a combination of
+	// `GGKAdapterEventType` bits)
+	//
+	// Subscriptions may be made before the server starts; events arrive once it has.
+	//
+	// Returns an id for `ggkAdapterUnsubscribe()`, or 0 on failure (`callback` is null or `eventTypes` holds no known types)
+	int ggkAdapterSubscribe(unsigned int eventTypes, GGKAdapterEventCallback callback, void *pUserData);
+
+	// Stops calling the callback subscribed under `subscription`
+	//
+	// The callback may still be running on the HCI event thread when this returns.
+	void ggkAdapterUnsubscribe(int subscription);
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// TRAFFIC TRACES
+	// -----------------------------------------------------------------------------------------------------------------------------
+	//
+	// The server can record the D-Bus requests it receives (method calls and property gets and sets) along with the updates pushed
+	// with `ggkPushUpdateQueue()` to a trace file. The `replay` program (see src/replay.cpp) plays a trace back into a server, so a
+	// load profile captured in the field can be reproduced for testing and benchmarking. Recording never blocks the server; once
+	// the file is full, further records are dropped and counted.
+	//
+	// Tracing is off by default, in which case it costs next to nothing. A trace still being recorded when the server stops is
+	// stopped along with it.
+
+	// Starts recording D-Bus GATT traffic to a new trace file at `pFilename`
+	//
+	// `maxBytes` is the largest the trace file may grow, or 0 for the default (64 MiB.) Any trace already being recorded is stopped
+	// first.
+	//
+	// Returns non-zero value on success or 0 on failure (the file could not be created.)
+	int ggkTraceStart(const char *pFilename, unsigned long long maxBytes);
+
+	// Stops recording and closes the trace file, trimmed to the records written
+	//
+	// Does nothing if no trace is being recorded.
+	void ggkTraceStop();
+
+	// Returns the number of records written to the current (or most recent) trace
+	unsigned long long ggkTraceGetRecordCount();
+
+	// Returns the number of records dropped from the current (or most recent) trace because the trace file was full
+	unsigned long long ggkTraceGetDroppedCount();
+
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// SERVER CONTROL
 	// -----------------------------------------------------------------------------------------------------------------------------
@@ -213,6 +673,24 @@ extern "C"
 	int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char *pAdvertisingShortName, 
 		GGKServerDataGetter getter, GGKServerDataSetter setter, int maxAsyncInitTimeoutMS);
 
+	// Same as `ggkStart()`, but the server runs on the Bluetooth controller with the given zero-based index (hci0, hci1, ...)
+	//
+	// `ggkStart()` is the same as calling this method with a `controllerIndex` of 0.
+	//
+	// To serve more than one controller from a single process, call this method once for each controller. The first call starts
+	// the server just like `ggkStart()`. Each later call (made while the server is running) adds an independent server for
+	// another controller and blocks for up to maxAsyncInitTimeoutMS milliseconds until BlueZ has accepted its GATT application.
+	//
+	// Every server needs its own controller and its own service name, and so its own D-Bus owned name (which must be allowed in
+	// the D-Bus permissions.) Object paths include the service name, so updates and handles (see `ggkResolveCharacteristic()`)
+	// find their way to the right server. The servers share the server thread, the update queue and the data store, and they are
+	// all stopped together (see `ggkTriggerShutdown()`.)
+	//
+	// Returns a non-zero value on success. If a later call fails, it returns 0 without affecting the servers that are already
+	// running (a server that timed out keeps retrying its initialization in the background.)
+	int ggkStartOnController(int controllerIndex, const char *pServiceName, const char *pAdvertisingName,
+		const char *pAdvertisingShortName, GGKServerDataGetter getter, GGKServerDataSetter setter, int maxAsyncInitTimeoutMS);
+
 	// Blocks for up to maxAsyncInitTimeoutMS milliseconds until the server shuts down.
 	//
 	// If shutdown is successful, this method will return a non-zero value. Otherwise, it will return 0.
@@ -0,0 +1,98 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A growable store of objects, allocated in large contiguous chunks, whose elements never move
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The server description is a tree of `DBusObject`s that is built once and then only read. The objects refer to each other (and
+// their interfaces refer back to them) so they can't move once created, which rules out a plain `std::vector`. A `std::list`
+// gives us that, but at the cost of a separate heap allocation for every node, scattered wherever the allocator put them.
+//
+// An `Arena` keeps the stability while storing its elements side by side, `kChunkSize` at a time. Elements are referred to by
+// their index, which is smaller than a pointer and stays meaningful when the arena is copied around as part of its owner.
+//
+// Elements are only ever added, never removed; they are destroyed along with the arena.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+namespace ggk {
+
+template<typename T, size_t kChunkSize = 64>
+struct Arena
+{
+	Arena() : count(0) {}
+
+	~Arena()
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			(*this)[i].~T();
+		}
+	}
+
+	// Constructs a new element at the end of the arena and returns its index
+	template<typename... Args>
+	uint32_t emplace_back(Args&&... args)
+	{
+		if (count == chunks.size() * kChunkSize)
+		{
+			chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+		}
+
+		new (&chunks.back()->slots[count % kChunkSize]) T(std::forward<Args>(args)...);
+		return static_cast<uint32_t>(count++);
+	}
+
+	// Returns the element at `index`
+	T &operator [](size_t index)
+	{
+		return *reinterpret_cast<T *>(&chunks[index / kChunkSize]->slots[index % kChunkSize]);
+	}
+
+	const T &operator [](size_t index) const
+	{
+		return *reinterpret_cast<const T *>(&chunks[index / kChunkSize]->slots[index % kChunkSize]);
+	}
+
+	// Returns the number of elements in the arena
+	size_t size() const { return count; }
+
+private:
+
+	// Don't allow copying
+	Arena(const Arena &) = delete;
+	Arena &operator =(const Arena &) = delete;
+
+	// Uninitialized storage for `kChunkSize` elements
+	struct Chunk
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[kChunkSize];
+	};
+
+	std::vector<std::unique_ptr<Chunk>> chunks;
+	size_t count;
+};
+
+}; // namespace ggk
@@ -47,6 +47,7 @@
 #include "GattProperty.h"
 #include "DBusObject.h"
 #include "Logger.h"
+#include "StringPool.h"
 
 namespace ggk {
 
@@ -54,8 +55,11 @@ namespace ggk {
 // Construction
 //
 
-DBusInterface::DBusInterface(DBusObject &owner, const std::string &name)
-: owner(owner), name(name)
+// Standard constructor
+//
+// Subclasses pass their own `kind`
+DBusInterface::DBusInterface(DBusObject &owner, const std::string &name, InterfaceKind kind)
+: owner(owner), pName(&StringPool::intern(name)), kind(kind)
 {
 }
 
@@ -63,6 +67,18 @@ DBusInterface::~DBusInterface()
 {
 }
 
+// Returns a string identifying the type of interface
+const char *DBusInterface::getInterfaceType() const
+{
+	switch(kind)
+	{
+		case EGattService: return "GattService";
+		case EGattCharacteristic: return "GattCharacteristic";
+		case EGattDescriptor: return "GattDescriptor";
+		default: return "DBusInterface";
+	}
+}
+
 //
 // Interface name
 //
@@ -70,13 +86,13 @@ DBusInterface::~DBusInterface()
 // Returns the name of this interface (ex: "org.freedesktop.DBus.Properties")
 const std::string &DBusInterface::getName() const
 {
-	return name;
+	return *pName;
 }
 
 // Sets the name of the interface (ex: "org.freedesktop.DBus.Properties")
 DBusInterface &DBusInterface::setName(const std::string &name)
 {
-	this->name = name;
+	pName = &StringPool::intern(name);
 	return *this;
 }
 
@@ -97,7 +113,7 @@ DBusObjectPath DBusInterface::getPathNode() const
 }
 
 // Returns the full path of this interface's owner
-DBusObjectPath DBusInterface::getPath() const
+const DBusObjectPath &DBusInterface::getPath() const
 {
 	return owner.getPath();
 }
@@ -138,7 +154,7 @@ bool DBusInterface::callMethod(const std::string &methodName, GDBusConnection *p
 
 // Add an event to this interface
 //
-// For details on events, see TickEvent.cpp.
+// For details on events, see TickEvent.h.
 //
 // This method returns a reference to `this` in order to enable chaining inside the server description.
 //
@@ -147,50 +163,60 @@ bool DBusInterface::callMethod(const std::string &methodName, GDBusConnection *p
 // calls to chain.
 DBusInterface &DBusInterface::onEvent(int tickFrequency, void *pUserData, TickEvent::Callback callback)
 {
-	events.push_back(TickEvent(this, tickFrequency, callback, pUserData));
+	return onEventMS(tickFrequency * TickEvent::kTickPeriodMS, pUserData, callback);
+}
+
+// Same as `onEvent()`, but with the period specified in milliseconds
+DBusInterface &DBusInterface::onEventMS(int periodMS, void *pUserData, TickEvent::Callback callback)
+{
+	events.push_back(TickEvent(this, periodMS, callback, pUserData));
 	return *this;
 }
 
-// Ticks each event within this interface
+// Internal method used to build the description of this interface used when registering our objects with D-Bus
 //
-// For details on events, see TickEvent.cpp.
-//
-// NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
-// their subclass type.
-void DBusInterface::tickEvents(GDBusConnection *pConnection, void *pUserData) const
+// The caller owns the returned reference
+GDBusInterfaceInfo *DBusInterface::generateInterfaceInfo() const
 {
-	for (const TickEvent &event : events)
+	GDBusInterfaceInfo *pInterface = g_new0(GDBusInterfaceInfo, 1);
+	pInterface->ref_count = 1;
+	pInterface->name = g_strdup(getName().c_str());
+
+	pInterface->methods = g_new0(GDBusMethodInfo *, methods.size() + 1);
+	size_t index = 0;
+	for (const DBusMethod &method : methods)
 	{
-		event.tick<DBusInterface>(getPath(), pConnection, pUserData);
+		pInterface->methods[index++] = method.generateMethodInfo();
 	}
+
+	pInterface->signals = g_new0(GDBusSignalInfo *, 1);
+	pInterface->properties = g_new0(GDBusPropertyInfo *, 1);
+	return pInterface;
 }
 
 // Internal method used to generate introspection XML used to describe our services on D-Bus
-std::string DBusInterface::generateIntrospectionXML(int depth) const
+//
+// The XML is appended to `xml`
+void DBusInterface::generateIntrospectionXML(std::string &xml, int depth) const
 {
-	std::string prefix;
-	prefix.insert(0, depth * 2, ' ');
-
-	std::string xml = std::string();
+	const std::string prefix(depth * 2, ' ');
 
 	if (methods.empty())
 	{
-		xml += prefix + "<interface name='" + getName() + "' />\n";
+		xml.append(prefix).append("<interface name='").append(getName()).append("' />\n");
 	}
 	else
 	{
-		xml += prefix + "<interface name='" + getName() + "'>\n";
+		xml.append(prefix).append("<interface name='").append(getName()).append("'>\n");
 
 		// Describe our methods
 		for (const DBusMethod &method : methods)
 		{
-			xml += method.generateIntrospectionXML(depth + 1);
+			method.generateIntrospectionXML(xml, depth + 1);
 		}
 
-		xml += prefix + "</interface>\n";
+		xml.append(prefix).append("</interface>\n");
 	}
-
-	return xml;
 }
 
 }; // namespace ggk
\ No newline at end of file
@@ -24,7 +24,7 @@
 
 #include <gio/gio.h>
 #include <string>
-#include <list>
+#include <vector>
 
 #include "TickEvent.h"
 #include "DBusMethod.h"
@@ -55,12 +55,12 @@ struct DBusObjectPath;
 )
 
 #define TRY_GET_INTERFACE_OF_TYPE(pInterface, type) \
-	(pInterface->getInterfaceType() == type::kInterfaceType ? \
+	(pInterface->getInterfaceKind() == type::kInterfaceKind ? \
 		std::static_pointer_cast<type>(pInterface) : \
 		nullptr)
 
 #define TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, type) \
-	(pInterface->getInterfaceType() == type::kInterfaceType ? \
+	(pInterface->getInterfaceKind() == type::kInterfaceKind ? \
 		std::static_pointer_cast<const type>(pInterface) : \
 		nullptr)
 
@@ -70,18 +70,36 @@ struct DBusObjectPath;
 
 struct DBusInterface
 {
-	// Our interface type
-	static constexpr const char *kInterfaceType = "DBusInterface";
+	// The kinds of interface we have, so that we can identify an interface's type with a simple compare (see
+	// `TRY_GET_INTERFACE_OF_TYPE`)
+	enum InterfaceKind
+	{
+		EDBusInterface,
+		EGattService,
+		EGattCharacteristic,
+		EGattDescriptor
+	};
+
+	// Our interface kind
+	static const InterfaceKind kInterfaceKind = EDBusInterface;
 
 	typedef void (*MethodCallback)(const DBusInterface &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
 	typedef void (*EventCallback)(const DBusInterface &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 
 	// Standard constructor
-	DBusInterface(DBusObject &owner, const std::string &name);
+	//
+	// Subclasses pass their own `kind`
+	DBusInterface(DBusObject &owner, const std::string &name, InterfaceKind kind = EDBusInterface);
 	virtual ~DBusInterface();
 
+	// Returns the kind of interface
+	InterfaceKind getInterfaceKind() const { return kind; }
+
+	// Returns true if this interface is a `GattInterface` (a service, characteristic or descriptor)
+	bool isGattInterface() const { return kind != EDBusInterface; }
+
 	// Returns a string identifying the type of interface
-	virtual const std::string getInterfaceType() const { return DBusInterface::kInterfaceType; }
+	const char *getInterfaceType() const;
 
 	//
 	// Interface name (ex: "org.freedesktop.DBus.Properties")
@@ -96,7 +114,7 @@ struct DBusInterface
 
 	DBusObject &getOwner() const;
 	DBusObjectPath getPathNode() const;
-	DBusObjectPath getPath() const;
+	const DBusObjectPath &getPath() const;
 
 	//
 	// D-Bus interface methods
@@ -117,18 +135,31 @@ struct DBusInterface
 	// calls to chain.
 	DBusInterface &onEvent(int tickFrequency, void *pUserData, TickEvent::Callback callback);
 
-	// NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
-	// their subclass type.
-	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
+	// Same as `onEvent()`, but with the period specified in milliseconds
+	DBusInterface &onEventMS(int periodMS, void *pUserData, TickEvent::Callback callback);
+
+	// Returns the list of events for this interface (see `onEvent()`)
+	const std::vector<TickEvent> &getEvents() const { return events; }
 
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
-	virtual std::string generateIntrospectionXML(int depth) const;
+	//
+	// The XML is appended to `xml`
+	virtual void generateIntrospectionXML(std::string &xml, int depth) const;
+
+	// Internal method used to build the description of this interface used when registering our objects with D-Bus
+	//
+	// The caller owns the returned reference
+	virtual GDBusInterfaceInfo *generateInterfaceInfo() const;
 
 protected:
 	DBusObject &owner;
-	std::string name;
-	std::list<DBusMethod> methods;
-	std::list<TickEvent> events;
+
+	// Our name, held by the `StringPool` (every object of a given type carries the same handful of interface names)
+	const std::string *pName;
+
+	InterfaceKind kind;
+	std::vector<DBusMethod> methods;
+	std::vector<TickEvent> events;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -33,7 +33,8 @@ namespace ggk {
 
 // Instantiate a named method on a given interface (pOwner) with a given set of arguments and a callback delegate
 DBusMethod::DBusMethod(const DBusInterface *pOwner, const std::string &name, const char *pInArgs[], const char *pOutArgs, Callback callback)
-: pOwner(pOwner), name(name), callback(callback)
+: pOwner(pOwner), pName(&StringPool::intern(name)), pOutArgs(&StringPool::intern(nullptr != pOutArgs ? pOutArgs : "")),
+  callback(callback), bRunOnWorker(false)
 {
 	const char **ppInArg = pInArgs;
 	while(*ppInArg)
@@ -41,42 +42,94 @@ DBusMethod::DBusMethod(const DBusInterface *pOwner, const std::string &name, con
 		this->inArgs.push_back(std::string(*ppInArg));
 		ppInArg++;
 	}
+}
+
+// Internal method used to build a D-Bus argument description with the given type signature
+static GDBusArgInfo *generateArgInfo(const std::string &signature)
+{
+	GDBusArgInfo *pArg = g_new0(GDBusArgInfo, 1);
+	pArg->ref_count = 1;
+	pArg->signature = g_strdup(signature.c_str());
+	return pArg;
+}
 
-	if (nullptr != pOutArgs)
+// Internal method used to split a type signature into its complete types
+//
+// Methods with more than one output argument (such as AcquireNotify's "hq") describe them as a single signature string, but
+// D-Bus describes each argument separately.
+static std::vector<std::string> splitSignature(const std::string &signature)
+{
+	std::vector<std::string> types;
+	const gchar *pStart = signature.c_str();
+	const gchar *pEnd = pStart + signature.length();
+	while (pStart < pEnd)
 	{
-		this->outArgs = pOutArgs;
+		const gchar *pNext = nullptr;
+		if (!g_variant_type_string_scan(pStart, pEnd, &pNext))
+		{
+			types.push_back(std::string(pStart, pEnd));
+			break;
+		}
+
+		types.push_back(std::string(pStart, pNext));
+		pStart = pNext;
 	}
+
+	return types;
 }
 
-// Internal method used to generate introspection XML used to describe our services on D-Bus
-std::string DBusMethod::generateIntrospectionXML(int depth) const
+// Internal method used to build the description of this method used when registering our objects with D-Bus
+//
+// The caller owns the returned reference
+GDBusMethodInfo *DBusMethod::generateMethodInfo() const
 {
-	std::string prefix;
-	prefix.insert(0, depth * 2, ' ');
+	GDBusMethodInfo *pMethod = g_new0(GDBusMethodInfo, 1);
+	pMethod->ref_count = 1;
+	pMethod->name = g_strdup(getName().c_str());
+
+	const std::vector<std::string> &inArgs = getInArgs();
+	pMethod->in_args = g_new0(GDBusArgInfo *, inArgs.size() + 1);
+	for (size_t i = 0; i < inArgs.size(); ++i)
+	{
+		pMethod->in_args[i] = generateArgInfo(inArgs[i]);
+	}
 
-	std::string xml = std::string();
+	std::vector<std::string> outArgs = splitSignature(getOutArgs());
+	pMethod->out_args = g_new0(GDBusArgInfo *, outArgs.size() + 1);
+	for (size_t i = 0; i < outArgs.size(); ++i)
+	{
+		pMethod->out_args[i] = generateArgInfo(outArgs[i]);
+	}
 
-	xml += prefix + "<method name='" + getName() + "'>\n";
+	return pMethod;
+}
+
+// Internal method used to generate introspection XML used to describe our services on D-Bus
+//
+// The XML is appended to `xml`
+void DBusMethod::generateIntrospectionXML(std::string &xml, int depth) const
+{
+	const std::string prefix(depth * 2, ' ');
+
+	xml.append(prefix).append("<method name='").append(getName()).append("'>\n");
 
 	// Add our input arguments
 	for (const std::string &inArg : getInArgs())
 	{
-		xml += prefix + "  <arg type='" + inArg + "' direction='in'>\n";
-		xml += prefix + "    <annotation name='org.gtk.GDBus.C.ForceGVariant' value='true' />\n";
-		xml += prefix + "  </arg>\n";
+		xml.append(prefix).append("  <arg type='").append(inArg).append("' direction='in'>\n");
+		xml.append(prefix).append("    <annotation name='org.gtk.GDBus.C.ForceGVariant' value='true' />\n");
+		xml.append(prefix).append("  </arg>\n");
 	}
 
-	const std::string &outArgs = getOutArgs();
-	if (!outArgs.empty())
+	// Add our output arguments
+	for (const std::string &outArg : splitSignature(getOutArgs()))
 	{
-		xml += prefix + "  <arg type='" + outArgs + "' direction='out'>\n";
-		xml += prefix + "    <annotation name='org.gtk.GDBus.C.ForceGVariant' value='true' />\n";
-		xml += prefix + "  </arg>\n";
+		xml.append(prefix).append("  <arg type='").append(outArg).append("' direction='out'>\n");
+		xml.append(prefix).append("    <annotation name='org.gtk.GDBus.C.ForceGVariant' value='true' />\n");
+		xml.append(prefix).append("  </arg>\n");
 	}
 
-	xml += prefix + "</method>\n";
-
-	return xml;
+	xml.append(prefix).append("</method>\n");
 }
 
 }; // namespace ggk
\ No newline at end of file
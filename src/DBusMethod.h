@@ -36,6 +36,8 @@
 #include "DBusObjectPath.h"
 #include "Logger.h"
 #include "Server.h"
+#include "WorkerPool.h"
+#include "StringPool.h"
 
 namespace ggk {
 
@@ -54,18 +56,18 @@ struct DBusMethod
 	//
 
 	// Returns the name of the method
-	const std::string &getName() const { return name; }
+	const std::string &getName() const { return *pName; }
 
 	// Sets the name of the method
 	//
 	// This method should generally not be called directly. Rather, the name should be set by the constructor
-	DBusMethod &setName(const std::string &name) { this->name = name; return *this; }
+	DBusMethod &setName(const std::string &name) { pName = &StringPool::intern(name); return *this; }
 
 	// Get the input argument type string (a GVariant type string format)
 	const std::vector<std::string> &getInArgs() const { return inArgs; }
 
 	// Get the output argument type string (a GVariant type string format)
-	const std::string &getOutArgs() const { return outArgs; }
+	const std::string &getOutArgs() const { return *pOutArgs; }
 
 	// Set the argument types for this method
 	//
@@ -73,10 +75,18 @@ struct DBusMethod
 	DBusMethod &setArgs(const std::vector<std::string> &inArgs, const std::string &outArgs)
 	{
 		this->inArgs = inArgs;
-		this->outArgs = outArgs;
+		pOutArgs = &StringPool::intern(outArgs);
 		return *this;
 	}
 
+	// Returns true if calls to this method are handed to the worker pool rather than run on the main loop's thread
+	bool getRunOnWorker() const { return bRunOnWorker; }
+
+	// Sets whether calls to this method are handed to the worker pool (see WorkerPool.cpp)
+	//
+	// A method that runs on a worker must still reply to its invocation, which it may do from the worker thread.
+	DBusMethod &setRunOnWorker(bool runOnWorker) { this->bRunOnWorker = runOnWorker; return *this; }
+
 	//
 	// Call the method
 	//
@@ -84,30 +94,69 @@ struct DBusMethod
 	// Calls the method
 	//
 	// If a callback delegate has been set, then this method will call that delegate, otherwise this method will do nothing
+	//
+	// If the method runs on a worker (see `setRunOnWorker()`) the delegate is queued to the worker pool and this returns right
+	// away. The connection and parameters are held until the delegate has run. If the pool is full, the call is answered with an
+	// error instead.
 	template<typename T>
 	void call(GDBusConnection *pConnection, const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData) const
 	{
 		// This should never happen, but technically possible if instantiated with a nullptr for `callback`
 		if (!callback)
 		{
-			Logger::error(SSTR << "DBusMethod contains no callback: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
+			GGK_LOG_ERROR(SSTR << "DBusMethod contains no callback: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
 			g_dbus_method_invocation_return_dbus_error(pInvocation, kErrorNotImplemented.c_str(), "This method is not implemented");
 			return;
 		}
 
-		Logger::info(SSTR << "Calling method: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
-		callback(*static_cast<const T *>(pOwner), pConnection, methodName, pParameters, pInvocation, pUserData);
+		GGK_LOG_INFO(SSTR << "Calling method: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
+
+		if (!bRunOnWorker)
+		{
+			callback(*static_cast<const T *>(pOwner), pConnection, methodName, pParameters, pInvocation, pUserData);
+			return;
+		}
+
+		const T *pSelf = static_cast<const T *>(pOwner);
+		Callback workerCallback = callback;
+		g_object_ref(pConnection);
+		g_variant_ref(pParameters);
+
+		bool queued = WorkerPool::getInstance().submit([=]()
+		{
+			workerCallback(*pSelf, pConnection, methodName, pParameters, pInvocation, pUserData);
+			g_variant_unref(pParameters);
+			g_object_unref(pConnection);
+		});
+
+		if (!queued)
+		{
+			GGK_LOG_WARN(SSTR << "Worker pool is full; rejecting method: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
+			g_variant_unref(pParameters);
+			g_object_unref(pConnection);
+			g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InProgress", "Too many requests in progress");
+		}
 	}
 
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
-	std::string generateIntrospectionXML(int depth) const;
+	//
+	// The XML is appended to `xml`
+	void generateIntrospectionXML(std::string &xml, int depth) const;
+
+	// Internal method used to build the description of this method used when registering our objects with D-Bus
+	//
+	// The caller owns the returned reference
+	GDBusMethodInfo *generateMethodInfo() const;
 
 private:
 	const DBusInterface *pOwner;
-	std::string name;
+
+	// The name and output signature are held by the `StringPool`, since most methods share them with many others
+	const std::string *pName;
 	std::vector<std::string> inArgs;
-	std::string outArgs;
+	const std::string *pOutArgs;
 	Callback callback;
+	bool bRunOnWorker;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -41,26 +41,33 @@
 #include "GattProperty.h"
 #include "DBusInterface.h"
 #include "GattService.h"
+#include "GattTable.h"
 #include "DBusObject.h"
 #include "Utils.h"
 #include "GattUuid.h"
 #include "Logger.h"
+#include "Server.h"
 
 namespace ggk {
 
+// The initial size of the buffer used to generate introspection XML (it will grow from here for larger server descriptions)
+static const size_t kIntrospectionXMLReserve = 16 * 1024;
+
 // Construct a root object with no parent
 //
-// We'll include a publish flag since only root objects can be published
-DBusObject::DBusObject(const DBusObjectPath &path, bool publish)
-: publish(publish), path(path), pParent(nullptr)
+// We'll include a publish flag since only root objects can be published. `pServer` is the server whose description this object
+// belongs to (see `getServer()`.)
+DBusObject::DBusObject(const DBusObjectPath &path, bool publish, const Server *pServer)
+: publish(publish), path(path), fullPath(path), pParent(nullptr), pServer(pServer), pArena(nullptr)
 {
 }
 
 // Construct a node object
 //
-// Nodes inherit their parent's publish path
+// Nodes inherit their parent's publish path and server
 DBusObject::DBusObject(DBusObject *pParent, const DBusObjectPath &pathElement)
-: publish(pParent->publish), path(pathElement), pParent(pParent)
+: publish(pParent->publish), path(pathElement), fullPath(pParent->getPath() + pathElement), pParent(pParent),
+  pServer(pParent->pServer), pArena(pParent->pArena)
 {
 }
 
@@ -85,19 +92,11 @@ const DBusObjectPath &DBusObject::getPathNode() const
 // Returns the full path for this object within the hierarchy
 //
 // This method returns the full path. To get the current node, use `getPathNode()`
-DBusObjectPath DBusObject::getPath() const
+//
+// The full path is built once, when the object is constructed, so this is cheap enough to call from hot paths
+const DBusObjectPath &DBusObject::getPath() const
 {
-	DBusObjectPath path = getPathNode();
-	const DBusObject *pCurrent = pParent;
-
-	// Traverse up my chain, adding nodes to the path until we have the full thing
-	while(nullptr != pCurrent)
-	{
-		path = pCurrent->getPathNode() + path;
-		pCurrent = pCurrent->pParent;
-	}
-
-	return path;
+	return fullPath;
 }
 
 // Returns the parent object in the hierarchy
@@ -106,17 +105,34 @@ DBusObject &DBusObject::getParent()
 	return *pParent;
 }
 
+// Returns the server whose description this object belongs to
+//
+// Objects built without a server (which only happens outside of a `Server` constructor) report `TheServer`
+const Server &DBusObject::getServer() const
+{
+	return nullptr != pServer ? *pServer : *TheServer;
+}
+
 // Returns the list of children objects
-const std::list<DBusObject> &DBusObject::getChildren() const
+DBusObject::ChildList DBusObject::getChildren() const
 {
-	return children;
+	return ChildList{pArena, &children};
 }
 
 // Add a child to this object
+//
+// The child is constructed in place in the root's arena, so it (and its interfaces' references to it) never move.
 DBusObject &DBusObject::addChild(const DBusObjectPath &pathElement)
 {
-	children.push_back(DBusObject(this, pathElement));
-	return children.back();
+	if (nullptr == pArena)
+	{
+		pArenaOwner = std::make_shared<ObjectArena>();
+		pArena = pArenaOwner.get();
+	}
+
+	uint32_t index = pArena->emplace_back(this, pathElement);
+	children.push_back(index);
+	return (*pArena)[index];
 }
 
 // Returns a list of interfaces for this object
@@ -137,6 +153,14 @@ GattService &DBusObject::gattServiceBegin(const std::string &pathElement, const
 	return service;
 }
 
+// Adds the services described by a static table (see GattTable.cpp) and returns a reference to this object, so a table can be
+// mixed freely with services described by `gattServiceBegin()`
+DBusObject &DBusObject::gattTable(const GattTable &table)
+{
+	table.build(*this);
+	return *this;
+}
+
 //
 // Helpful routines for searching objects
 //
@@ -195,60 +219,47 @@ bool DBusObject::callMethod(const DBusObjectPath &path, const std::string &inter
 	return false;
 }
 
-// Periodic timer tick propagation
-void DBusObject::tickEvents(GDBusConnection *pConnection, void *pUserData) const
-{
-	for (std::shared_ptr<const DBusInterface> interface : interfaces)
-	{
-		interface->tickEvents(pConnection, pUserData);
-	}
-
-	for (const DBusObject &child : getChildren())
-	{
-		child.tickEvents(pConnection, pUserData);
-	}
-}
-
 // ---------------------------------------------------------------------------------------------------------------------------------
 // XML generation for a D-Bus introspection
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 // Internal method used to generate introspection XML used to describe our services on D-Bus
-std::string DBusObject::generateIntrospectionXML(int depth) const
+std::string DBusObject::generateIntrospectionXML() const
 {
-	std::string prefix;
-	prefix.insert(0, depth * 2, ' ');
+	std::string xml;
+	xml.reserve(kIntrospectionXMLReserve);
 
-	std::string xml = std::string();
+	xml += "<?xml version='1.0'?>\n";
+	xml += "<!DOCTYPE node PUBLIC '-//freedesktop//DTD D-BUS Object Introspection 1.0//EN' 'http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd'>\n";
+	generateIntrospectionXML(xml, 0);
 
-	if (depth == 0)
-	{
-		xml += "<?xml version='1.0'?>\n";
-		xml += "<!DOCTYPE node PUBLIC '-//freedesktop//DTD D-BUS Object Introspection 1.0//EN' 'http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd'>\n";
-	}
+	GGK_LOG_DEBUG("Generated XML:");
+	GGK_LOG_DEBUG(xml);
 
-	xml += prefix + "<node name='" + getPathNode().toString() + "'>\n";
-	xml += prefix + "  <annotation name='" + TheServer->getServiceName() + ".DBusObject.path' value='" + getPath().toString() + "' />\n";
+	return xml;
+}
 
-	for (std::shared_ptr<const DBusInterface> interface : interfaces)
-	{
-		xml += interface->generateIntrospectionXML(depth + 1);
-	}
+// Internal method used to generate introspection XML used to describe our services on D-Bus
+//
+// The XML for this object and all of its descendants is appended to `xml`
+void DBusObject::generateIntrospectionXML(std::string &xml, int depth) const
+{
+	const std::string prefix(depth * 2, ' ');
 
-	for (DBusObject child : getChildren())
+	xml.append(prefix).append("<node name='").append(getPathNode().toString()).append("'>\n");
+	xml.append(prefix).append("  <annotation name='").append(getServer().getServiceName()).append(".DBusObject.path' value='").append(getPath().toString()).append("' />\n");
+
+	for (const std::shared_ptr<DBusInterface> &interface : interfaces)
 	{
-		xml += child.generateIntrospectionXML(depth + 1);
+		interface->generateIntrospectionXML(xml, depth + 1);
 	}
 
-	xml += prefix + "</node>\n";
-
-	if (depth == 0)
+	for (const DBusObject &child : getChildren())
 	{
-		Logger::debug("Generated XML:");
-		Logger::debug(xml);
+		child.generateIntrospectionXML(xml, depth + 1);
 	}
 
-	return xml;
+	xml.append(prefix).append("</node>\n");
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -272,9 +283,97 @@ void DBusObject::emitSignal(GDBusConnection *pBusConnection, const std::string &
 
 	if (0 == result)
 	{
-		Logger::error(SSTR << "Failed to emit signal named '" << signalName << "': " << (nullptr == pError ? "Unknown" : pError->message));
+		GGK_LOG_ERROR(SSTR << "Failed to emit signal named '" << signalName << "': " << (nullptr == pError ? "Unknown" : pError->message));
 	}
 }
 
+// Creates a signal message from this object's path, to use as a template for `emitSignal()`
+//
+// The caller owns the returned message (release it with `g_object_unref()`)
+GDBusMessage *DBusObject::newSignalTemplate(const std::string &interfaceName, const std::string &signalName) const
+{
+	return g_dbus_message_new_signal(getPath().c_str(), interfaceName.c_str(), signalName.c_str());
+}
+
+// Emits a copy of the signal message `pTemplate` (see `newSignalTemplate()`) with `pParameters` as its body
+//
+// The header is copied from the template, so only the body is built for each signal. If a `DBusSignalBatch` is open on the
+// calling thread, the signal is held until the batch ends.
+void DBusObject::emitSignal(GDBusConnection *pBusConnection, GDBusMessage *pTemplate, GVariant *pParameters)
+{
+	GError *pError = nullptr;
+	GDBusMessage *pMessage = g_dbus_message_copy(pTemplate, &pError);
+	if (nullptr == pMessage)
+	{
+		GGK_LOG_ERROR(SSTR << "Failed to copy signal named '" << g_dbus_message_get_member(pTemplate) << "': " << (nullptr == pError ? "Unknown" : pError->message));
+		g_clear_error(&pError);
+		g_variant_unref(g_variant_ref_sink(pParameters));
+		return;
+	}
+
+	g_dbus_message_set_body(pMessage, pParameters);
+
+	if (DBusSignalBatch::isOpen())
+	{
+		DBusSignalBatch::hold(pBusConnection, pMessage);
+	}
+	else
+	{
+		DBusSignalBatch::send(pBusConnection, pMessage);
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Signal batches
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+thread_local int DBusSignalBatch::depth = 0;
+thread_local std::vector<std::pair<GDBusConnection *, GDBusMessage *>> DBusSignalBatch::held;
+
+DBusSignalBatch::DBusSignalBatch()
+{
+	depth += 1;
+}
+
+DBusSignalBatch::~DBusSignalBatch()
+{
+	depth -= 1;
+	if (0 != depth)
+	{
+		return;
+	}
+
+	for (const std::pair<GDBusConnection *, GDBusMessage *> &signal : held)
+	{
+		send(signal.first, signal.second);
+	}
+	held.clear();
+}
+
+// Returns true if a batch is open on the calling thread
+bool DBusSignalBatch::isOpen()
+{
+	return depth > 0;
+}
+
+// Holds `pMessage` (taking ownership) to be sent on `pBusConnection` when the batch ends
+void DBusSignalBatch::hold(GDBusConnection *pBusConnection, GDBusMessage *pMessage)
+{
+	held.push_back(std::make_pair(pBusConnection, pMessage));
+}
+
+// Sends `pMessage` (taking ownership) on `pBusConnection` right away
+void DBusSignalBatch::send(GDBusConnection *pBusConnection, GDBusMessage *pMessage)
+{
+	GError *pError = nullptr;
+	if (!g_dbus_connection_send_message(pBusConnection, pMessage, G_DBUS_SEND_MESSAGE_FLAGS_NONE, nullptr, &pError))
+	{
+		GGK_LOG_ERROR(SSTR << "Failed to emit signal named '" << g_dbus_message_get_member(pMessage) << "': " << (nullptr == pError ? "Unknown" : pError->message));
+		g_clear_error(&pError);
+	}
+
+	g_object_unref(pMessage);
+}
+
 
 }; // namespace ggk
\ No newline at end of file
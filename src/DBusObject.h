@@ -24,31 +24,63 @@
 
 #include <gio/gio.h>
 #include <string>
-#include <list>
 #include <memory>
+#include <vector>
+#include <utility>
 
 #include "DBusObjectPath.h"
+#include "Arena.h"
 
 namespace ggk {
 
 struct GattProperty;
 struct GattService;
+struct Server;
+struct GattTable;
 struct GattUuid;
 struct DBusInterface;
 
 struct DBusObject
 {
 	// A convenience typedef for describing our list of interface
-	typedef std::list<std::shared_ptr<DBusInterface> > InterfaceList;
+	typedef std::vector<std::shared_ptr<DBusInterface> > InterfaceList;
+
+	// Every object below a root object is stored in the root's arena, and refers to its children by their index there
+	typedef Arena<DBusObject> ObjectArena;
+
+	// The children of an object (see `getChildren()`), which can be iterated like a container of `DBusObject`s
+	struct ChildList
+	{
+		struct const_iterator
+		{
+			const DBusObject &operator *() const { return (*pArena)[*it]; }
+			const DBusObject *operator ->() const { return &(*pArena)[*it]; }
+			const_iterator &operator ++() { ++it; return *this; }
+			bool operator ==(const const_iterator &rhs) const { return it == rhs.it; }
+			bool operator !=(const const_iterator &rhs) const { return it != rhs.it; }
+
+			const ObjectArena *pArena;
+			std::vector<uint32_t>::const_iterator it;
+		};
+
+		const_iterator begin() const { return const_iterator{pArena, pIndices->begin()}; }
+		const_iterator end() const { return const_iterator{pArena, pIndices->end()}; }
+		size_t size() const { return pIndices->size(); }
+		bool empty() const { return pIndices->empty(); }
+
+		const ObjectArena *pArena;
+		const std::vector<uint32_t> *pIndices;
+	};
 
 	// Construct a root object with no parent
 	//
-	// We'll include a publish flag since only root objects can be published
-	DBusObject(const DBusObjectPath &path, bool publish = true);
+	// We'll include a publish flag since only root objects can be published. `pServer` is the server whose description this object
+	// belongs to (see `getServer()`.)
+	DBusObject(const DBusObjectPath &path, bool publish = true, const Server *pServer = nullptr);
 
 	// Construct a node object
 	//
-	// Nodes inherit their parent's publish path
+	// Nodes inherit their parent's publish path and server
 	DBusObject(DBusObject *pParent, const DBusObjectPath &pathElement);
 
 	//
@@ -66,13 +98,20 @@ struct DBusObject
 	// Returns the full path for this object within the hierarchy
 	//
 	// This method returns the full path. To get the current node, use `getPathNode()`
-	DBusObjectPath getPath() const;
+	//
+	// The full path is built once, when the object is constructed, so this is cheap enough to call from hot paths
+	const DBusObjectPath &getPath() const;
 
 	// Returns the parent object in the hierarchy
 	DBusObject &getParent();
 
+	// Returns the server whose description this object belongs to
+	//
+	// Objects built without a server (which only happens outside of a `Server` constructor) report `TheServer`
+	const Server &getServer() const;
+
 	// Returns the list of children objects
-	const std::list<DBusObject> &getChildren() const;
+	ChildList getChildren() const;
 
 	// Add a child to this object
 	DBusObject &addChild(const DBusObjectPath &pathElement);
@@ -89,7 +128,12 @@ struct DBusObject
 	}
 
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
-	std::string generateIntrospectionXML(int depth = 0) const;
+	std::string generateIntrospectionXML() const;
+
+	// Internal method used to generate introspection XML used to describe our services on D-Bus
+	//
+	// The XML for this object and all of its descendants is appended to `xml`
+	void generateIntrospectionXML(std::string &xml, int depth) const;
 
 	// Convenience functions to add a GATT service to the hierarchy
 	//
@@ -98,6 +142,10 @@ struct DBusObject
 	// To end a service, call `gattServiceEnd()`
 	GattService &gattServiceBegin(const std::string &pathElement, const GattUuid &uuid);
 
+	// Adds the services described by a static table (see GattTable.cpp) and returns a reference to this object, so a table can
+	// be mixed freely with services described by `gattServiceBegin()`
+	DBusObject &gattTable(const GattTable &table);
+
 	//
 	// Helpful routines for searching objects
 	//
@@ -108,9 +156,6 @@ struct DBusObject
 	// Finds a BlueZ method by name within the specified D-Bus interface
 	bool callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData, const DBusObjectPath &basePath = DBusObjectPath()) const;
 
-	// Periodic timer tick propagation
-	void tickEvents(GDBusConnection *pConnection, void *pUserData = nullptr) const;
-
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// D-Bus signals
 	// -----------------------------------------------------------------------------------------------------------------------------
@@ -118,12 +163,63 @@ struct DBusObject
 	// Emits a signal on the bus from the given path, interface name and signal name, containing a GVariant set of parameters
 	void emitSignal(GDBusConnection *pBusConnection, const std::string &interfaceName, const std::string &signalName, GVariant *pParameters);
 
+	// Creates a signal message from this object's path, to use as a template for `emitSignal()`
+	//
+	// The caller owns the returned message (release it with `g_object_unref()`)
+	GDBusMessage *newSignalTemplate(const std::string &interfaceName, const std::string &signalName) const;
+
+	// Emits a copy of the signal message `pTemplate` (see `newSignalTemplate()`) with `pParameters` as its body
+	//
+	// The header is copied from the template, so only the body is built for each signal. If a `DBusSignalBatch` is open on the
+	// calling thread, the signal is held until the batch ends.
+	static void emitSignal(GDBusConnection *pBusConnection, GDBusMessage *pTemplate, GVariant *pParameters);
+
 private:
 	bool publish;
 	DBusObjectPath path;
+	DBusObjectPath fullPath;
 	InterfaceList interfaces;
-	std::list<DBusObject> children;
 	DBusObject *pParent;
+	const Server *pServer;
+
+	// Our children, as indices into `pArena`
+	std::vector<uint32_t> children;
+
+	// The arena that holds this object's descendants
+	//
+	// A root object owns its arena (it's created along with the first child) and descendants share their root's.
+	std::shared_ptr<ObjectArena> pArenaOwner;
+	ObjectArena *pArena;
+};
+
+// Holds the signals emitted on the calling thread (see `DBusObject::emitSignal()`) while it is in scope, then sends them all at once
+//
+// GDBus writes messages from its own worker thread. Sending a burst of signals back to back hands them to that thread together,
+// rather than waking it once for each signal as they trickle out between other work. Batches may be nested; the signals are sent
+// when the outermost batch ends.
+struct DBusSignalBatch
+{
+	DBusSignalBatch();
+	~DBusSignalBatch();
+
+	// Returns true if a batch is open on the calling thread
+	static bool isOpen();
+
+	// Holds `pMessage` (taking ownership) to be sent on `pBusConnection` when the batch ends
+	static void hold(GDBusConnection *pBusConnection, GDBusMessage *pMessage);
+
+	// Sends `pMessage` (taking ownership) on `pBusConnection` right away
+	static void send(GDBusConnection *pBusConnection, GDBusMessage *pMessage);
+
+private:
+
+	// Don't allow copying
+	DBusSignalBatch(const DBusSignalBatch &) = delete;
+	DBusSignalBatch &operator =(const DBusSignalBatch &) = delete;
+
+	// The open batches on this thread, and the signals they hold
+	static thread_local int depth;
+	static thread_local std::vector<std::pair<GDBusConnection *, GDBusMessage *>> held;
 };
 
 }; // namespace ggk
\ No newline at end of file
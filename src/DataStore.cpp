@@ -0,0 +1,367 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// An optional server-side store of named data values, consulted before the application's data getter
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Normally, every read of a named value (see `GattInterface::getDataValue` and `getDataPointer`) calls the application's data
+// getter. That's a call into application code, which likely takes its own locks and compares the name against every value it
+// knows about. For values that are read often (a battery level read at 50Hz, for example) that adds up.
+//
+// Instead, the application can push values into this store (see `ggkDataStoreSet`) whenever they change. Reads are then served
+// straight from the store and the application's getter is only called for names that aren't stored. The store is entirely
+// optional: until something is stored, reads check an atomic counter and go straight to the getter.
+//
+// Names are interned to integer keys. Writers that update a value often can resolve the key once (`ggkDataStoreIntern`) and
+// store by key (`ggkDataStoreSetKey`) to avoid hashing the name on every update.
+//
+// Stored values are immutable blobs held by shared pointers. Storing a value replaces the blob, so a reader that has a blob can
+// keep using it while the application stores newer ones. Every store stamps the entry with a new, globally increasing, version
+// so readers (and the application) can tell whether a value has changed.
+//
+// Reads happen on the server thread for every GATT read of a stored name, so they stay off the writers' lock. Entries live in a
+// fixed table that is allocated up front and only ever grows, and names are found through an open-addressed hash table of keys
+// that is probed straight from the C string, without building a `std::string`. Each entry's value is a single shared pointer
+// (holding both the data and its version) read with `std::atomic_load`. Note that libstdc++ implements that with a small pool of
+// address-hashed locks of its own, so a read and a write of the same entry can briefly meet there; they never wait on the
+// store's lock, or on reads and writes of other names that hash elsewhere. Pointer reads pin the blob in a per-thread table
+// indexed by key, which only allocates the first time a thread pins a key higher than any it has pinned before.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <string.h>
+
+#include "DataStore.h"
+
+namespace ggk {
+
+// Returns the FNV-1a hash of the null-terminated string `pName`
+static uint32_t hashName(const char *pName)
+{
+	uint32_t hash = 2166136261u;
+	for (; *pName != 0; ++pName)
+	{
+		hash ^= static_cast<uint8_t>(*pName);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// Construct an empty store
+DataStore::DataStore()
+: pEntries(new std::atomic<Entry *>[kMaxKeys + 1]),
+  entryCount(0),
+  pNameSlots(new std::atomic<int>[kNameSlots]),
+  storedCount(0),
+  lastVersion(0)
+{
+	for (int i = 0; i <= kMaxKeys; ++i)
+	{
+		pEntries[i] = nullptr;
+	}
+
+	for (int i = 0; i < kNameSlots; ++i)
+	{
+		pNameSlots[i] = 0;
+	}
+}
+
+// Free the entries
+DataStore::~DataStore()
+{
+	for (int i = 0; i <= kMaxKeys; ++i)
+	{
+		delete pEntries[i].load();
+	}
+}
+
+// Returns the key for `pName`, creating one if needed
+//
+// Keys are positive and remain valid for the life of the process. Returns 0 if `pName` is null or `kMaxKeys` names have
+// already been interned.
+int DataStore::intern(const char *pName)
+{
+	if (nullptr == pName)
+	{
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	int key = find(pName);
+	if (key != 0 || entryCount == kMaxKeys)
+	{
+		return key;
+	}
+
+	// Publish the entry before its name slot, so a reader that finds the key always finds the entry
+	key = ++entryCount;
+	pEntries[key].store(new Entry(pName), std::memory_order_release);
+
+	uint32_t slot = hashName(pName);
+	for (;;)
+	{
+		slot &= kNameSlots - 1;
+		if (pNameSlots[slot].load(std::memory_order_relaxed) == 0)
+		{
+			pNameSlots[slot].store(key, std::memory_order_release);
+			return key;
+		}
+
+		slot += 1;
+	}
+}
+
+// Returns the key for `pName`, or 0 if it has never been interned
+//
+// This takes no locks and does not allocate, so readers can call it on every read.
+int DataStore::find(const char *pName) const
+{
+	if (nullptr == pName)
+	{
+		return 0;
+	}
+
+	// Slots are never cleared, so an empty slot ends the probe sequence
+	uint32_t slot = hashName(pName);
+	for (int probe = 0; probe < kNameSlots; ++probe, ++slot)
+	{
+		int key = pNameSlots[slot & (kNameSlots - 1)].load(std::memory_order_acquire);
+		if (key == 0)
+		{
+			break;
+		}
+
+		if (strcmp(pEntries[key].load(std::memory_order_acquire)->name.c_str(), pName) == 0)
+		{
+			return key;
+		}
+	}
+
+	return 0;
+}
+
+// Stores a copy of `size` bytes at `pData` under `key` (see `intern()`)
+//
+// Returns the new version of the value, or 0 if the key is invalid
+uint64_t DataStore::set(int key, const void *pData, size_t size)
+{
+	if (nullptr == pData && size != 0)
+	{
+		return 0;
+	}
+
+	// Build the value before taking the lock
+	const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+	std::shared_ptr<Value> pValue = std::make_shared<Value>();
+	pValue->data.assign(pBytes, pBytes + size);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (nullptr == getEntry(key))
+	{
+		return 0;
+	}
+
+	return store(key, pValue);
+}
+
+// Stores a copy of `size` bytes at `pData` under `pName`, if `pName` already has a stored value
+//
+// This is used to keep the store in sync with values that the server writes back to the application (see
+// `GattInterface::setDataValue()`.)
+void DataStore::update(const char *pName, const void *pData, size_t size)
+{
+	if (empty() || (nullptr == pData && size != 0))
+	{
+		return;
+	}
+
+	int key = find(pName);
+	if (key == 0)
+	{
+		return;
+	}
+
+	const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+	std::shared_ptr<Value> pValue = std::make_shared<Value>();
+	pValue->data.assign(pBytes, pBytes + size);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (nullptr != std::atomic_load(&getEntry(key)->pValue))
+	{
+		store(key, pValue);
+	}
+}
+
+// Removes the value stored under `pName`, so reads go back to the application's data getter
+//
+// Returns true if a value was removed
+bool DataStore::remove(const char *pName)
+{
+	int key = find(pName);
+	if (key == 0)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Entry *pEntry = pEntries[key].load(std::memory_order_relaxed);
+	if (nullptr == std::atomic_exchange(&pEntry->pValue, std::shared_ptr<const Value>()))
+	{
+		return false;
+	}
+
+	storedCount -= 1;
+	return true;
+}
+
+// Removes all stored values
+void DataStore::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int key = 1; key <= entryCount; ++key)
+	{
+		std::atomic_store(&pEntries[key].load(std::memory_order_relaxed)->pValue, std::shared_ptr<const Value>());
+	}
+
+	storedCount = 0;
+}
+
+// Retrieves the value stored under `key` into `blob` (and its version into `version`)
+//
+// Returns true if there was a stored value, otherwise false
+bool DataStore::get(int key, Blob &blob, uint64_t &version) const
+{
+	const Entry *pEntry = getEntry(key);
+	if (nullptr == pEntry)
+	{
+		return false;
+	}
+
+	std::shared_ptr<const Value> pValue = std::atomic_load(&pEntry->pValue);
+	if (nullptr == pValue)
+	{
+		return false;
+	}
+
+	// The blob shares ownership of the whole value, so this doesn't allocate
+	blob = Blob(pValue, &pValue->data);
+	version = pValue->version;
+	return true;
+}
+
+// Retrieves the value stored under `pName` into `blob` (and its version into `version`)
+//
+// Returns true if there was a stored value, otherwise false
+bool DataStore::get(const char *pName, Blob &blob, uint64_t &version) const
+{
+	return !empty() && get(find(pName), blob, version);
+}
+
+// Copies the value stored under `key` into `pValue`, if it is exactly `size` bytes
+//
+// Returns true if the value was copied, otherwise false
+bool DataStore::copy(int key, void *pValue, size_t size) const
+{
+	Blob blob;
+	uint64_t version = 0;
+	if (!get(key, blob, version) || blob->size() != size)
+	{
+		return false;
+	}
+
+	memcpy(pValue, blob->data(), size);
+	return true;
+}
+
+// Copies the value stored under `pName` into `pValue`, if it is exactly `size` bytes
+//
+// Returns true if the value was copied, otherwise false
+bool DataStore::copy(const char *pName, void *pValue, size_t size) const
+{
+	return !empty() && copy(find(pName), pValue, size);
+}
+
+// Returns a pointer to the data stored under `key`, or nullptr if there is none
+//
+// The value is pinned for the calling thread, so the pointer remains valid until this thread calls `pin()` for the same key
+// again, even if the application replaces the value in the meantime.
+const void *DataStore::pin(int key) const
+{
+	Blob blob;
+	uint64_t version = 0;
+	if (!get(key, blob, version))
+	{
+		return nullptr;
+	}
+
+	// Pinned blobs are indexed by key, so this only grows (and allocates) the first time a thread sees a new highest key
+	static thread_local std::vector<Blob> pinned;
+	if (pinned.size() <= static_cast<size_t>(key))
+	{
+		pinned.resize(key + 1);
+	}
+
+	pinned[key] = std::move(blob);
+	return pinned[key]->data();
+}
+
+// Returns a pointer to the data stored under `pName`, or nullptr if there is none (see `pin(int)`)
+const void *DataStore::pin(const char *pName) const
+{
+	return empty() ? nullptr : pin(find(pName));
+}
+
+// Returns the version of the value stored under `pName`, or 0 if there is none
+//
+// Versions increase every time any value is stored, so a value has changed if its version has changed.
+uint64_t DataStore::getVersion(const char *pName) const
+{
+	Blob blob;
+	uint64_t version = 0;
+	get(pName, blob, version);
+	return version;
+}
+
+// Returns the entry for `key`, or nullptr if the key is invalid
+const DataStore::Entry *DataStore::getEntry(int key) const
+{
+	if (key <= 0 || key > kMaxKeys)
+	{
+		return nullptr;
+	}
+
+	return pEntries[key].load(std::memory_order_acquire);
+}
+
+// Stores `pValue` under `key`, returning its new version
+//
+// The caller must hold `mutex`
+uint64_t DataStore::store(int key, std::shared_ptr<Value> pValue)
+{
+	Entry *pEntry = pEntries[key].load(std::memory_order_relaxed);
+	pValue->version = ++lastVersion;
+
+	std::shared_ptr<const Value> pOld = std::atomic_exchange(&pEntry->pValue, std::shared_ptr<const Value>(std::move(pValue)));
+	if (nullptr == pOld)
+	{
+		storedCount += 1;
+	}
+
+	return lastVersion;
+}
+
+}; // namespace ggk
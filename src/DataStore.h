@@ -0,0 +1,198 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// An optional server-side store of named data values, consulted before the application's data getter
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of DataStore.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace ggk {
+
+struct DataStore
+{
+	//
+	// Types
+	//
+
+	// A stored value
+	//
+	// Values are immutable once stored; setting a new value replaces the blob rather than modifying it. This way, a reader can
+	// hold onto a value while the application replaces it.
+	typedef std::shared_ptr<const std::vector<uint8_t>> Blob;
+
+	// The most names that can be interned
+	static const int kMaxKeys = 4096;
+
+	//
+	// Singleton
+	//
+
+	// Returns the one and only instance of the data store
+	static DataStore &getInstance()
+	{
+		static DataStore instance;
+		return instance;
+	}
+
+	//
+	// Keys
+	//
+
+	// Returns the key for `pName`, creating one if needed
+	//
+	// Keys are positive and remain valid for the life of the process. Returns 0 if `pName` is null or `kMaxKeys` names have
+	// already been interned.
+	int intern(const char *pName);
+
+	// Returns the key for `pName`, or 0 if it has never been interned
+	//
+	// This takes no locks and does not allocate, so readers can call it on every read.
+	int find(const char *pName) const;
+
+	//
+	// Writers (any thread)
+	//
+
+	// Stores a copy of `size` bytes at `pData` under `key` (see `intern()`)
+	//
+	// Returns the new version of the value, or 0 if the key is invalid
+	uint64_t set(int key, const void *pData, size_t size);
+
+	// Stores a copy of `size` bytes at `pData` under `pName`, if `pName` already has a stored value
+	//
+	// This is used to keep the store in sync with values that the server writes back to the application (see
+	// `GattInterface::setDataValue()`.)
+	void update(const char *pName, const void *pData, size_t size);
+
+	// Removes the value stored under `pName`, so reads go back to the application's data getter
+	//
+	// Returns true if a value was removed
+	bool remove(const char *pName);
+
+	// Removes all stored values
+	void clear();
+
+	//
+	// Readers (any thread)
+	//
+	// Readers don't take the store's lock and don't allocate (see the discussion at the top of DataStore.cpp.) Each has a version
+	// that takes a key from `intern()` or `find()`, for callers that look the name up once.
+	//
+
+	// Returns true if no values are stored
+	//
+	// This takes no locks, so callers can skip the store entirely when the application doesn't use it
+	bool empty() const { return storedCount == 0; }
+
+	// Retrieves the value stored under `key` into `blob` (and its version into `version`)
+	//
+	// Returns true if there was a stored value, otherwise false
+	bool get(int key, Blob &blob, uint64_t &version) const;
+
+	// Retrieves the value stored under `pName` into `blob` (and its version into `version`)
+	//
+	// Returns true if there was a stored value, otherwise false
+	bool get(const char *pName, Blob &blob, uint64_t &version) const;
+
+	// Copies the value stored under `key` into `pValue`, if it is exactly `size` bytes
+	//
+	// Returns true if the value was copied, otherwise false
+	bool copy(int key, void *pValue, size_t size) const;
+
+	// Copies the value stored under `pName` into `pValue`, if it is exactly `size` bytes
+	//
+	// Returns true if the value was copied, otherwise false
+	bool copy(const char *pName, void *pValue, size_t size) const;
+
+	// Returns a pointer to the data stored under `key`, or nullptr if there is none
+	//
+	// The value is pinned for the calling thread, so the pointer remains valid until this thread calls `pin()` for the same key
+	// again, even if the application replaces the value in the meantime.
+	const void *pin(int key) const;
+
+	// Returns a pointer to the data stored under `pName`, or nullptr if there is none (see `pin(int)`)
+	const void *pin(const char *pName) const;
+
+	// Returns the version of the value stored under `pName`, or 0 if there is none
+	//
+	// Versions increase every time any value is stored, so a value has changed if its version has changed.
+	uint64_t getVersion(const char *pName) const;
+
+private:
+
+	// A value along with its version, replaced as a whole whenever the value is stored
+	struct Value
+	{
+		std::vector<uint8_t> data;
+		uint64_t version = 0;
+	};
+
+	// A single named entry in the store
+	//
+	// Entries are created by `intern()` and never destroyed (until the store is), so readers can use them without a lock. The
+	// value is read and replaced with `std::atomic_load` and `std::atomic_store`.
+	struct Entry
+	{
+		explicit Entry(const char *pName) : name(pName) {}
+
+		const std::string name;
+		std::shared_ptr<const Value> pValue;
+	};
+
+	// The number of slots in the name table (twice `kMaxKeys`, so that probe sequences stay short)
+	static const int kNameSlots = kMaxKeys * 2;
+
+	DataStore();
+	~DataStore();
+
+	// Don't allow copying
+	DataStore(const DataStore &) = delete;
+	DataStore &operator =(const DataStore &) = delete;
+
+	// Returns the entry for `key`, or nullptr if the key is invalid
+	const Entry *getEntry(int key) const;
+
+	// Stores `pValue` under `key`, returning its new version
+	//
+	// The caller must hold `mutex`
+	uint64_t store(int key, std::shared_ptr<Value> pValue);
+
+	// Serializes writers
+	std::mutex mutex;
+
+	// Entries, indexed by key (key 0 is unused)
+	std::unique_ptr<std::atomic<Entry *>[]> pEntries;
+	int entryCount;
+
+	// An open-addressed hash table of keys, hashed by name (0 marks an empty slot)
+	std::unique_ptr<std::atomic<int>[]> pNameSlots;
+
+	std::atomic<size_t> storedCount;
+	uint64_t lastVersion;
+};
+
+}; // namespace ggk
@@ -20,8 +20,22 @@
 // A GATT characteristic is the component within the Bluetooth LE standard that holds and serves data over Bluetooth. This class
 // is intended to be used within the server description. For an explanation of how this class is used, see the detailed discussion
 // in Server.cpp.
+//
+// Change notifications are normally sent as PropertiesChanged signals, which travel through the D-Bus daemon to BlueZ. For
+// characteristics that notify frequently, `enableAcquireNotify()` lets BlueZ acquire a socket from us instead (AcquireNotify) so
+// each notification is a single write to that socket.
+//
+// Similarly, every write normally arrives as a WriteValue method call. For characteristics that receive a high rate of
+// write-without-response requests, `onWriteStream()` lets BlueZ acquire a socket (AcquireWrite) that it writes each request to.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+#include <glib-unix.h>
+#include <gio/gunixfdlist.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
 #include "GattCharacteristic.h"
 #include "GattDescriptor.h"
 #include "GattProperty.h"
@@ -33,6 +47,12 @@
 
 namespace ggk {
 
+// The MTU to assume if BlueZ doesn't give us one with AcquireNotify or AcquireWrite (the ATT default)
+static const uint16_t kDefaultMtu = 23;
+
+// The size of the ATT header (opcode and handle) that precedes a notification's value
+static const uint16_t kNotifyHeaderSize = 3;
+
 //
 // Standard constructor
 //
@@ -42,8 +62,20 @@ namespace ggk {
 // Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
 // in `GattService`.
 GattCharacteristic::GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name)
-: GattInterface(owner, name), service(service), pOnUpdatedValueFunc(nullptr)
+: GattInterface(owner, name, EGattCharacteristic), service(service), pOnUpdatedValueFunc(nullptr), pOnWriteSpanFunc(nullptr),
+  bNotifyEnabled(false),
+  subscriberCount(0), notifyFd(-1),
+  notifyMtu(kDefaultMtu), notifyWatchId(0), pOnWriteStreamFunc(nullptr), writeFd(-1), writeWatchId(0),
+  pWriteConnection(nullptr), pWriteUserData(nullptr),
+  pPropertiesChangedTemplate(owner.newSignalTemplate("org.freedesktop.DBus.Properties", "PropertiesChanged"))
+{
+}
+
+GattCharacteristic::~GattCharacteristic()
 {
+	releaseNotify();
+	releaseWrite();
+	g_object_unref(pPropertiesChangedTemplate);
 }
 
 // Returning the owner pops us one level up the hierarchy
@@ -61,6 +93,12 @@ bool GattCharacteristic::callMethod(const std::string &methodName, GDBusConnecti
 	{
 		if (methodName == method.getName())
 		{
+			// The rest of a long read is answered from the snapshot taken when it started
+			if (methodName == "ReadValue" && replyFromReadSnapshot(pParameters, pInvocation))
+			{
+				return true;
+			}
+
 			method.call<GattCharacteristic>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
 			return true;
 		}
@@ -75,19 +113,14 @@ bool GattCharacteristic::callMethod(const std::string &methodName, GDBusConnecti
 // TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
 GattCharacteristic &GattCharacteristic::onEvent(int tickFrequency, void *pUserData, EventCallback callback)
 {
-	events.push_back(TickEvent(this, tickFrequency, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
-	return *this;
+	return onEventMS(tickFrequency * TickEvent::kTickPeriodMS, pUserData, callback);
 }
 
-// Ticks events within this characteristic
-//
-// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-void GattCharacteristic::tickEvents(GDBusConnection *pConnection, void *pUserData) const
+// Same as `onEvent()`, but with the period specified in milliseconds
+GattCharacteristic &GattCharacteristic::onEventMS(int periodMS, void *pUserData, EventCallback callback)
 {
-	for (const TickEvent &event : events)
-	{
-		event.tick<GattCharacteristic>(getPath(), pConnection, pUserData);
-	}
+	events.push_back(TickEvent(this, periodMS, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
+	return *this;
 }
 
 // Specialized support for ReadlValue method
@@ -122,6 +155,48 @@ GattCharacteristic &GattCharacteristic::onWriteValue(MethodCallback callback)
 	return *this;
 }
 
+// Same as `onWriteValue()`, but the callback is handed the written bytes directly rather than the method's parameters
+//
+// `pData` and `size` refer to the value in place, so nothing is copied to get at it. They are only valid for the duration of
+// the call. `options` holds the write's offset, MTU, type and device.
+//
+// The pieces of a long (prepared) write are put together in a buffer kept by the characteristic, and the callback is called
+// for each piece with the value written so far, from its start (`options.offset` is where the new piece begins.) The buffer
+// is reused, so reassembly doesn't allocate once it has grown to the size of the value.
+//
+// The callback returns true if the write succeeded, and the method call is answered accordingly. The callback always runs on
+// the main loop's thread.
+GattCharacteristic &GattCharacteristic::onWriteSpan(WriteSpanCallback callback)
+{
+	static const char *inArgs[] = {"ay", "a{sv}", nullptr};
+	addMethod("WriteValue", inArgs, nullptr, onWriteSpanValue);
+	pOnWriteSpanFunc = callback;
+	return *this;
+}
+
+// Same as `onReadValue()`, but the callback runs on a worker thread rather than the main loop's thread (see WorkerPool.cpp)
+//
+// Use this for handlers that are slow to produce a value, such as those that read from hardware. The callback replies to
+// `pInvocation` as usual (`methodReturnValue()` and friends may be called from the worker) but must not touch state that is
+// owned by the main loop. To send change notifications, use `ggkNofifyUpdatedCharacteristic()`, which is thread-safe.
+//
+// Several async callbacks may run at once, so the server's data getter and setter must be thread-safe.
+GattCharacteristic &GattCharacteristic::onReadValueAsync(MethodCallback callback)
+{
+	onReadValue(callback);
+	methods.back().setRunOnWorker(true);
+	return *this;
+}
+
+// Same as `onWriteValue()`, but the callback runs on a worker thread rather than the main loop's thread (see
+// `onReadValueAsync()` for the rules that apply to the callback)
+GattCharacteristic &GattCharacteristic::onWriteValueAsync(MethodCallback callback)
+{
+	onWriteValue(callback);
+	methods.back().setRunOnWorker(true);
+	return *this;
+}
+
 // Custom support for handling updates to our characteristic's value
 //
 // Defined as: (NOT defined by Bluetooth or BlueZ - this method is internal only)
@@ -138,6 +213,90 @@ GattCharacteristic &GattCharacteristic::onUpdatedValue(UpdatedValueCallback call
 	return *this;
 }
 
+// Specialized support for Characteristic AcquireNotify method
+//
+// Defined as: (fd, uint16) AcquireNotify(dict options)
+//
+// D-Bus breakdown:
+//
+//     Input args:  options - "a{sv}"
+//     Output args: fd      - "h"
+//                  mtu     - "q"
+//
+// This adds the `NotifyAcquired` property, which tells BlueZ that it can ask us for a socket rather than calling StartNotify.
+// Once BlueZ has acquired the socket, change notifications (see `sendChangeNotificationVariant()`) are written directly to it
+// rather than being sent as PropertiesChanged signals over D-Bus. When BlueZ closes the socket (the last client unsubscribed)
+// we go back to using signals.
+//
+// The characteristic should also have the "notify" or "indicate" flag.
+GattCharacteristic &GattCharacteristic::enableAcquireNotify()
+{
+	static const char *inArgs[] = {"a{sv}", nullptr};
+	addMethod("AcquireNotify", inArgs, "hq", onAcquireNotify);
+
+	// BlueZ only looks for the presence of this property
+	addProperty<GattCharacteristic>("NotifyAcquired", false);
+	return *this;
+}
+
+// Specialized support for Characteristic StartNotify and StopNotify methods
+//
+// Defined as: void StartNotify()
+//             void StopNotify()
+//
+// This is called by `GattService::gattCharacteristicBegin()` for characteristics with the "notify" or "indicate" flag. BlueZ
+// calls StartNotify when the first client subscribes to the characteristic and StopNotify when the last one unsubscribes (an
+// acquired notification socket counts as a subscription as well.) While nobody is subscribed, updates from the update queue
+// and tick events for the characteristic are dropped before any work is done (see `isUnobserved()`.)
+GattCharacteristic &GattCharacteristic::enableNotify()
+{
+	if (bNotifyEnabled)
+	{
+		return *this;
+	}
+
+	static const char *inArgs[] = {nullptr};
+	addMethod("StartNotify", inArgs, nullptr, onStartNotify);
+	addMethod("StopNotify", inArgs, nullptr, onStopNotify);
+	bNotifyEnabled = true;
+	return *this;
+}
+
+// Forgets all subscriptions, for when BlueZ has gone away without unsubscribing
+void GattCharacteristic::resetSubscriptions() const
+{
+	releaseNotify();
+	subscriberCount = 0;
+}
+
+// Specialized support for Characteristic AcquireWrite method
+//
+// Defined as: (fd, uint16) AcquireWrite(dict options)
+//
+// D-Bus breakdown:
+//
+//     Input args:  options - "a{sv}"
+//     Output args: fd      - "h"
+//                  mtu     - "q"
+//
+// This adds the `WriteAcquired` property, which tells BlueZ that it can ask us for a socket to deliver write-without-response
+// requests through, rather than calling WriteValue for each one. Each write received on the socket is passed to `callback`
+// with a pointer into our receive buffer; the data is only valid for the duration of the call.
+//
+// The characteristic should also have the "write-without-response" flag. Writes with response still arrive through
+// `onWriteValue()`.
+GattCharacteristic &GattCharacteristic::onWriteStream(WriteStreamCallback callback)
+{
+	static const char *inArgs[] = {"a{sv}", nullptr};
+	addMethod("AcquireWrite", inArgs, "hq", onAcquireWrite);
+
+	// BlueZ only looks for the presence of this property
+	addProperty<GattCharacteristic>("WriteAcquired", false);
+
+	pOnWriteStreamFunc = callback;
+	return *this;
+}
+
 // Calls the onUpdatedValue method, if one was set.
 //
 // Returns false if there was no method set, otherwise, returns the boolean result of the method call.
@@ -162,7 +321,7 @@ bool GattCharacteristic::callOnUpdatedValue(GDBusConnection *pConnection, void *
 		return false;
 	}
 
-	Logger::debug(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
+	GGK_LOG_DEBUG(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
 	return pOnUpdatedValueFunc(*this, pConnection, pUserData);
 }
 
@@ -204,11 +363,287 @@ GattDescriptor &GattCharacteristic::gattDescriptorBegin(const std::string &pathE
 // active connections before sending a change notification.
 void GattCharacteristic::sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const
 {
-	g_auto(GVariantBuilder) builder;
-	g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
-	g_variant_builder_add(&builder, "{sv}", "Value", pNewValue);
-	GVariant *pSasv = g_variant_new("(sa{sv})", "org.bluez.GattCharacteristic1", &builder);
-	owner.emitSignal(pBusConnection, "org.freedesktop.DBus.Properties", "PropertiesChanged", pSasv);
+	if (Stats::isEnabled())
+	{
+		getStats().recordNotification();
+	}
+
+	// Take ownership of the (likely floating) value so we can look at it without it being consumed
+	g_variant_ref_sink(pNewValue);
+
+	if (!writeNotification(pNewValue))
+	{
+		// The interface name and "Value" key are the same for every notification, so they're built once and shared
+		static GVariant *pInterfaceName = g_variant_ref_sink(g_variant_new_string("org.bluez.GattCharacteristic1"));
+		static GVariant *pValueKey = g_variant_ref_sink(g_variant_new_string("Value"));
+
+		// Assemble the (sa{sv}) body directly rather than going through a builder
+		GVariant *pEntry = g_variant_new_dict_entry(pValueKey, g_variant_new_variant(pNewValue));
+		GVariant *children[] = { pInterfaceName, g_variant_new_array(G_VARIANT_TYPE("{sv}"), &pEntry, 1) };
+		DBusObject::emitSignal(pBusConnection, pPropertiesChangedTemplate, g_variant_new_tuple(children, 2));
+	}
+
+	g_variant_unref(pNewValue);
+}
+
+// Creates a socket pair for AcquireNotify or AcquireWrite and returns BlueZ's end (along with the MTU) as the method's response
+//
+// The MTU is taken from the "mtu" option in `pParameters`. Returns our end of the socket, or -1 on failure (in which case an error
+// has already been returned to the caller.)
+static int acquireSocket(const DBusObjectPath &path, GVariant *pParameters, GDBusMethodInvocation *pInvocation, uint16_t &mtu)
+{
+	mtu = kDefaultMtu;
+	GVariant *pOptions = g_variant_get_child_value(pParameters, 0);
+	g_variant_lookup(pOptions, "mtu", "q", &mtu);
+	g_variant_unref(pOptions);
+
+	// BlueZ expects a seqpacket socket, so each notification or write is a single packet
+	int fds[2];
+	if (socketpair(AF_LOCAL, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to create socket for '" << path << "': " << strerror(errno));
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.Failed", "Unable to create socket");
+		return -1;
+	}
+
+	// The FD list holds its own duplicate of BlueZ's end
+	GError *pError = nullptr;
+	GUnixFDList *pFdList = g_unix_fd_list_new();
+	int index = g_unix_fd_list_append(pFdList, fds[1], &pError);
+	close(fds[1]);
+
+	if (index < 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to pass socket for '" << path << "': " << (pError ? pError->message : "unknown error"));
+		g_clear_error(&pError);
+		g_object_unref(pFdList);
+		close(fds[0]);
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.Failed", "Unable to pass socket");
+		return -1;
+	}
+
+	g_dbus_method_invocation_return_value_with_unix_fd_list(pInvocation, g_variant_new("(hq)", index, mtu), pFdList);
+	g_object_unref(pFdList);
+	return fds[0];
+}
+
+// Handles BlueZ's WriteValue method call for a span write callback (see `onWriteSpan()`)
+void GattCharacteristic::onWriteSpanValue(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData)
+{
+	const GattCharacteristic &self = static_cast<const GattCharacteristic &>(dbusInterface);
+
+	PendingWrite write;
+	if (!self.beginWrite(pParameters, pInvocation, write))
+	{
+		return;
+	}
+
+	bool result = self.pOnWriteSpanFunc(self, pConnection, write.pData, write.size, write.options, pUserData);
+	self.endWrite(pInvocation, write, result);
+}
+
+// Handles BlueZ's StartNotify method call (see `enableNotify()`)
+void GattCharacteristic::onStartNotify(const DBusInterface &dbusInterface, GDBusConnection *, const std::string &, GVariant *, GDBusMethodInvocation *pInvocation, void *)
+{
+	const GattCharacteristic &self = static_cast<const GattCharacteristic &>(dbusInterface);
+
+	int count = self.subscriberCount.fetch_add(1, std::memory_order_relaxed) + 1;
+	GGK_LOG_DEBUG(SSTR << "Notifications started for '" << self.getPath() << "' (" << count << " subscribed)");
+	g_dbus_method_invocation_return_value(pInvocation, nullptr);
+}
+
+// Handles BlueZ's StopNotify method call (see `enableNotify()`)
+//
+// An unmatched StopNotify (from a client that subscribed before a BlueZ restart, for example) leaves the count at zero.
+void GattCharacteristic::onStopNotify(const DBusInterface &dbusInterface, GDBusConnection *, const std::string &, GVariant *, GDBusMethodInvocation *pInvocation, void *)
+{
+	const GattCharacteristic &self = static_cast<const GattCharacteristic &>(dbusInterface);
+
+	int count = self.removeSubscriber();
+	GGK_LOG_DEBUG(SSTR << "Notifications stopped for '" << self.getPath() << "' (" << count << " subscribed)");
+	g_dbus_method_invocation_return_value(pInvocation, nullptr);
+}
+
+// Handles BlueZ's AcquireNotify method call (see `enableAcquireNotify()`)
+void GattCharacteristic::onAcquireNotify(const DBusInterface &dbusInterface, GDBusConnection *, const std::string &, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *)
+{
+	const GattCharacteristic &self = static_cast<const GattCharacteristic &>(dbusInterface);
+
+	uint16_t mtu = kDefaultMtu;
+	int fd = acquireSocket(self.getPath(), pParameters, pInvocation, mtu);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	// BlueZ only acquires once, but if it asks again, the new socket replaces the old
+	self.releaseNotify();
+	self.notifyFd = fd;
+	self.notifyMtu = mtu;
+	self.subscriberCount.fetch_add(1, std::memory_order_relaxed);
+	self.notifyWatchId = g_unix_fd_add(fd, static_cast<GIOCondition>(G_IO_HUP | G_IO_ERR), onNotifyHangup, const_cast<GattCharacteristic *>(&self));
+
+	GGK_LOG_DEBUG(SSTR << "Notification socket acquired for '" << self.getPath() << "' (MTU " << mtu << ")");
+}
+
+// Called from the main loop when BlueZ closes its end of our notification socket
+gboolean GattCharacteristic::onNotifyHangup(gint, GIOCondition, gpointer pUserData)
+{
+	const GattCharacteristic *pSelf = static_cast<const GattCharacteristic *>(pUserData);
+	GGK_LOG_DEBUG(SSTR << "Notification socket released for '" << pSelf->getPath() << "'");
+
+	// Returning G_SOURCE_REMOVE removes the watch, so make sure `releaseNotify()` doesn't try to
+	pSelf->notifyWatchId = 0;
+	pSelf->releaseNotify();
+	return G_SOURCE_REMOVE;
+}
+
+// Handles BlueZ's AcquireWrite method call (see `onWriteStream()`)
+void GattCharacteristic::onAcquireWrite(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData)
+{
+	const GattCharacteristic &self = static_cast<const GattCharacteristic &>(dbusInterface);
+
+	uint16_t mtu = kDefaultMtu;
+	int fd = acquireSocket(self.getPath(), pParameters, pInvocation, mtu);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	self.releaseWrite();
+	self.writeFd = fd;
+	self.pWriteConnection = pConnection;
+	self.pWriteUserData = pUserData;
+
+	// A write's value is at most the MTU less the ATT header, so a buffer of the full MTU always has room
+	self.writeBuffer.resize(mtu);
+	self.writeWatchId = g_unix_fd_add(fd, static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR), onWriteReady, const_cast<GattCharacteristic *>(&self));
+
+	GGK_LOG_DEBUG(SSTR << "Write socket acquired for '" << self.getPath() << "' (MTU " << mtu << ")");
+}
+
+// Called from the main loop when our write socket is readable or BlueZ has closed its end
+gboolean GattCharacteristic::onWriteReady(gint fd, GIOCondition, gpointer pUserData)
+{
+	const GattCharacteristic *pSelf = static_cast<const GattCharacteristic *>(pUserData);
+
+	// Drain every pending write before returning to the main loop
+	for (;;)
+	{
+		ssize_t result = recv(fd, pSelf->writeBuffer.data(), pSelf->writeBuffer.size(), MSG_DONTWAIT);
+		if (result > 0)
+		{
+			pSelf->pOnWriteStreamFunc(*pSelf, pSelf->pWriteConnection, pSelf->writeBuffer.data(), static_cast<size_t>(result), pSelf->pWriteUserData);
+			continue;
+		}
+
+		if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return G_SOURCE_CONTINUE;
+		}
+
+		if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		break;
+	}
+
+	// Either BlueZ closed its end (a zero-length read) or the socket failed
+	GGK_LOG_DEBUG(SSTR << "Write socket released for '" << pSelf->getPath() << "'");
+
+	// Returning G_SOURCE_REMOVE removes the watch, so make sure `releaseWrite()` doesn't try to
+	pSelf->writeWatchId = 0;
+	pSelf->releaseWrite();
+	return G_SOURCE_REMOVE;
+}
+
+// Writes `pValue` to the acquired notification socket
+//
+// Returns true if the notification was written, or false if it should be sent as a signal instead
+bool GattCharacteristic::writeNotification(GVariant *pValue) const
+{
+	if (notifyFd < 0 || !g_variant_is_of_type(pValue, G_VARIANT_TYPE_BYTESTRING))
+	{
+		return false;
+	}
+
+	gsize size = 0;
+	const void *pData = g_variant_get_fixed_array(pValue, &size, 1);
+
+	// A value too large for a single notification goes out as a signal, and BlueZ deals with it as it would any other
+	if (size + kNotifyHeaderSize > notifyMtu)
+	{
+		return false;
+	}
+
+	ssize_t result = send(notifyFd, pData, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (result == static_cast<ssize_t>(size))
+	{
+		return true;
+	}
+
+	// If the socket is just full, fall back to a signal for this one, otherwise the socket is no longer usable
+	if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		GGK_LOG_WARN(SSTR << "Notification socket for '" << getPath() << "' is full; sending notification as a signal");
+	}
+	else
+	{
+		GGK_LOG_WARN(SSTR << "Unable to write to notification socket for '" << getPath() << "': " << strerror(errno));
+		releaseNotify();
+	}
+
+	return false;
+}
+
+// Closes our notification socket (if any) so notifications go back to being sent as signals
+void GattCharacteristic::releaseNotify() const
+{
+	if (notifyWatchId != 0)
+	{
+		g_source_remove(notifyWatchId);
+		notifyWatchId = 0;
+	}
+
+	if (notifyFd >= 0)
+	{
+		close(notifyFd);
+		notifyFd = -1;
+		removeSubscriber();
+	}
+}
+
+// Removes one subscription, never taking the count below zero, and returns the new count
+//
+// Subscriptions only change on the main loop's thread, so there's no need for an atomic read-modify-write here.
+int GattCharacteristic::removeSubscriber() const
+{
+	int count = subscriberCount.load(std::memory_order_relaxed);
+	if (count > 0)
+	{
+		count -= 1;
+		subscriberCount.store(count, std::memory_order_relaxed);
+	}
+
+	return count;
+}
+
+// Closes our write socket (if any) so writes go back to arriving through WriteValue
+void GattCharacteristic::releaseWrite() const
+{
+	if (writeWatchId != 0)
+	{
+		g_source_remove(writeWatchId);
+		writeWatchId = 0;
+	}
+
+	if (writeFd >= 0)
+	{
+		close(writeFd);
+		writeFd = -1;
+	}
 }
 
 }; // namespace ggk
\ No newline at end of file
@@ -24,8 +24,10 @@
 
 #include <glib.h>
 #include <gio/gio.h>
+#include <atomic>
 #include <string>
 #include <list>
+#include <vector>
 
 #include "Utils.h"
 #include "TickEvent.h"
@@ -74,28 +76,46 @@ struct DBusObject;
        void *pUserData \
 )
 
+#define CHARACTERISTIC_WRITE_SPAN_CALLBACK_LAMBDA [] \
+( \
+	const GattCharacteristic &self, \
+	GDBusConnection *pConnection, \
+	const uint8_t *pData, \
+	size_t size, \
+	const GattWriteOptions &options, \
+	void *pUserData \
+) -> bool
+
+#define CHARACTERISTIC_WRITE_STREAM_CALLBACK_LAMBDA [] \
+( \
+	const GattCharacteristic &self, \
+	GDBusConnection *pConnection, \
+	const uint8_t *pData, \
+	size_t size, \
+	void *pUserData \
+)
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Representation of a Bluetooth GATT Characteristic
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 struct GattCharacteristic : GattInterface
 {
-	// Our interface type
-	static constexpr const char *kInterfaceType = "GattCharacteristic";
+	// Our interface kind
+	static const InterfaceKind kInterfaceKind = EGattCharacteristic;
 
 	typedef void (*MethodCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
 	typedef void (*EventCallback)(const GattCharacteristic &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 	typedef bool (*UpdatedValueCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, void *pUserData);
+	typedef void (*WriteStreamCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, const uint8_t *pData, size_t size, void *pUserData);
+	typedef bool (*WriteSpanCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, const uint8_t *pData, size_t size, const GattWriteOptions &options, void *pUserData);
 
 	// Construct a GattCharacteristic
 	//
 	// Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
 	// in `GattService`.
 	GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name);
-	virtual ~GattCharacteristic() {}
-
-	// Returns a string identifying the type of interface
-	virtual const std::string getInterfaceType() const { return GattCharacteristic::kInterfaceType; }
+	virtual ~GattCharacteristic();
 
 	// Returning the owner pops us one level up the hierarchy
 	//
@@ -111,10 +131,8 @@ struct GattCharacteristic : GattInterface
 	// TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
 	GattCharacteristic &onEvent(int tickFrequency, void *pUserData, EventCallback callback);
 
-	// Ticks events within this characteristic
-	//
-	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
+	// Same as `onEvent()`, but with the period specified in milliseconds
+	GattCharacteristic &onEventMS(int periodMS, void *pUserData, EventCallback callback);
 
 	// Specialized support for Characteristic ReadlValue method
 	//
@@ -137,6 +155,32 @@ struct GattCharacteristic : GattInterface
 	//     Output args: void
 	GattCharacteristic &onWriteValue(MethodCallback callback);
 
+	// Same as `onWriteValue()`, but the callback is handed the written bytes directly rather than the method's parameters
+	//
+	// `pData` and `size` refer to the value in place, so nothing is copied to get at it. They are only valid for the duration of
+	// the call. `options` holds the write's offset, MTU, type and device.
+	//
+	// The pieces of a long (prepared) write are put together in a buffer kept by the characteristic, and the callback is called
+	// for each piece with the value written so far, from its start (`options.offset` is where the new piece begins.) The buffer
+	// is reused, so reassembly doesn't allocate once it has grown to the size of the value.
+	//
+	// The callback returns true if the write succeeded, and the method call is answered accordingly. The callback always runs on
+	// the main loop's thread.
+	GattCharacteristic &onWriteSpan(WriteSpanCallback callback);
+
+	// Same as `onReadValue()`, but the callback runs on a worker thread rather than the main loop's thread (see WorkerPool.cpp)
+	//
+	// Use this for handlers that are slow to produce a value, such as those that read from hardware. The callback replies to
+	// `pInvocation` as usual (`methodReturnValue()` and friends may be called from the worker) but must not touch state that is
+	// owned by the main loop. To send change notifications, use `ggkNofifyUpdatedCharacteristic()`, which is thread-safe.
+	//
+	// Several async callbacks may run at once, so the server's data getter and setter must be thread-safe.
+	GattCharacteristic &onReadValueAsync(MethodCallback callback);
+
+	// Same as `onWriteValue()`, but the callback runs on a worker thread rather than the main loop's thread (see
+	// `onReadValueAsync()` for the rules that apply to the callback)
+	GattCharacteristic &onWriteValueAsync(MethodCallback callback);
+
 	// Custom support for handling updates to our characteristic's value
 	//
 	// Defined as: (NOT defined by Bluetooth or BlueZ - this method is internal only)
@@ -149,6 +193,74 @@ struct GattCharacteristic : GattInterface
 	// `callOnUpdatedValue` for more information.
 	GattCharacteristic &onUpdatedValue(UpdatedValueCallback callback);
 
+	// Specialized support for Characteristic AcquireNotify method
+	//
+	// Defined as: (fd, uint16) AcquireNotify(dict options)
+	//
+	// D-Bus breakdown:
+	//
+	//     Input args:  options - "a{sv}"
+	//     Output args: fd      - "h"
+	//                  mtu     - "q"
+	//
+	// This adds the `NotifyAcquired` property, which tells BlueZ that it can ask us for a socket rather than calling StartNotify.
+	// Once BlueZ has acquired the socket, change notifications (see `sendChangeNotificationVariant()`) are written directly to it
+	// rather than being sent as PropertiesChanged signals over D-Bus. When BlueZ closes the socket (the last client unsubscribed)
+	// we go back to using signals.
+	//
+	// The characteristic should also have the "notify" or "indicate" flag.
+	GattCharacteristic &enableAcquireNotify();
+
+	// Returns true if BlueZ currently holds a notification socket for this characteristic (see `enableAcquireNotify()`)
+	bool isNotifyAcquired() const { return notifyFd >= 0; }
+
+	// Specialized support for Characteristic StartNotify and StopNotify methods
+	//
+	// Defined as: void StartNotify()
+	//             void StopNotify()
+	//
+	// This is called by `GattService::gattCharacteristicBegin()` for characteristics with the "notify" or "indicate" flag. BlueZ
+	// calls StartNotify when the first client subscribes to the characteristic and StopNotify when the last one unsubscribes (an
+	// acquired notification socket counts as a subscription as well.) While nobody is subscribed, updates from the update queue
+	// and tick events for the characteristic are dropped before any work is done (see `isUnobserved()`.)
+	GattCharacteristic &enableNotify();
+
+	// Returns the number of current subscriptions to this characteristic
+	//
+	// BlueZ subscribes once on behalf of all of its clients, so this is normally 0 or 1. It is safe to call from any thread.
+	int getSubscriberCount() const { return subscriberCount.load(std::memory_order_relaxed); }
+
+	// Returns true if anybody is subscribed to change notifications from this characteristic
+	bool isSubscribed() const { return getSubscriberCount() > 0; }
+
+	// Returns true if this characteristic tracks subscriptions (see `enableNotify()`) and nobody is subscribed, in which case
+	// there's nobody to send a change notification to
+	bool isUnobserved() const { return bNotifyEnabled && !isSubscribed(); }
+
+	// Forgets all subscriptions, for when BlueZ has gone away without unsubscribing
+	void resetSubscriptions() const;
+
+	// Specialized support for Characteristic AcquireWrite method
+	//
+	// Defined as: (fd, uint16) AcquireWrite(dict options)
+	//
+	// D-Bus breakdown:
+	//
+	//     Input args:  options - "a{sv}"
+	//     Output args: fd      - "h"
+	//                  mtu     - "q"
+	//
+	// This adds the `WriteAcquired` property, which tells BlueZ that it can ask us for a socket to deliver write-without-response
+	// requests through, rather than calling WriteValue for each one. Each write received on the socket is passed to `callback`
+	// with a pointer into our receive buffer; the data is only valid for the duration of the call.
+	//
+	// The characteristic should also have the "write-without-response" flag. Writes with response still arrive through
+	// `onWriteValue()`.
+	GattCharacteristic &onWriteStream(WriteStreamCallback callback);
+
+	// Returns true if BlueZ currently holds a write socket for this characteristic (see `onWriteStream()`)
+	bool isWriteAcquired() const { return writeFd >= 0; }
+
 	// Calls the onUpdatedValue method, if one was set.
 	//
 	// Returns false if there was no method set, otherwise, returns the boolean result of the method call.
@@ -193,6 +305,11 @@ struct GattCharacteristic : GattInterface
 	// This is a generalized method that accepts a `GVariant *`. A templated version is available that supports common types called
 	// `sendChangeNotificationValue()`.
 	//
+	// If BlueZ has acquired a notification socket (see `enableAcquireNotify()`) and the value is a byte array that fits in a single
+	// notification, it is written directly to the socket. Otherwise, it is sent as a PropertiesChanged signal, copied from a
+	// template built when the characteristic was created. Notifications sent while a `DBusSignalBatch` is open are sent together
+	// when the batch ends.
+	//
 	// The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
 	// active connections before sending a change notification.
 	void sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const;
@@ -213,8 +330,72 @@ struct GattCharacteristic : GattInterface
 
 protected:
 
+	// Handles BlueZ's WriteValue method call for a span write callback (see `onWriteSpan()`)
+	static void onWriteSpanValue(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+
+	// Handles BlueZ's StartNotify and StopNotify method calls (see `enableNotify()`)
+	static void onStartNotify(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+	static void onStopNotify(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+
+	// Handles BlueZ's AcquireNotify method call (see `enableAcquireNotify()`)
+	static void onAcquireNotify(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+
+	// Called from the main loop when BlueZ closes its end of our notification socket
+	static gboolean onNotifyHangup(gint fd, GIOCondition condition, gpointer pUserData);
+
+	// Handles BlueZ's AcquireWrite method call (see `onWriteStream()`)
+	static void onAcquireWrite(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+
+	// Called from the main loop when our write socket is readable or BlueZ has closed its end
+	static gboolean onWriteReady(gint fd, GIOCondition condition, gpointer pUserData);
+
+	// Writes `pValue` to the acquired notification socket
+	//
+	// Returns true if the notification was written, or false if it should be sent as a signal instead
+	bool writeNotification(GVariant *pValue) const;
+
+	// Closes our notification socket (if any) so notifications go back to being sent as signals
+	void releaseNotify() const;
+
+	// Removes one subscription, never taking the count below zero, and returns the new count
+	int removeSubscriber() const;
+
+	// Closes our write socket (if any) so writes go back to arriving through WriteValue
+	void releaseWrite() const;
+
 	GattService &service;
 	UpdatedValueCallback pOnUpdatedValueFunc;
+	WriteSpanCallback pOnWriteSpanFunc;
+
+	// Whether we track subscriptions (see `enableNotify()`) and how many there currently are
+	//
+	// The count is changed on the main loop's thread, but may be read from any thread (see `ggkIsCharacteristicSubscribed()`.)
+	bool bNotifyEnabled;
+	mutable std::atomic<int> subscriberCount;
+
+	// Our end of the socket handed to BlueZ through AcquireNotify (or -1) and the MTU BlueZ gave us with it
+	//
+	// These are only accessed from the main loop's thread, which is where method calls and updates are processed.
+	mutable int notifyFd;
+	mutable uint16_t notifyMtu;
+	mutable guint notifyWatchId;
+
+	// Our end of the socket handed to BlueZ through AcquireWrite (or -1), along with the connection and user data from that call
+	// (which are passed to `pOnWriteStreamFunc`) and the buffer that writes are received into
+	//
+	// As with the notification socket, these are only accessed from the main loop's thread.
+	WriteStreamCallback pOnWriteStreamFunc;
+	mutable int writeFd;
+	mutable guint writeWatchId;
+	mutable GDBusConnection *pWriteConnection;
+	mutable void *pWriteUserData;
+	mutable std::vector<uint8_t> writeBuffer;
+
+	// The PropertiesChanged signal for this characteristic, less its body (see `sendChangeNotificationVariant()`)
+	//
+	// Built once, so each notification only has to build the changed value. The template itself is never sent or modified, so
+	// it can be copied from any thread.
+	GDBusMessage *pPropertiesChangedTemplate;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -39,7 +39,8 @@ namespace ggk {
 // Genreally speaking, these objects should not be constructed directly. Rather, use the `gattDescriptorBegin()` method
 // in `GattCharacteristic`.
 GattDescriptor::GattDescriptor(DBusObject &owner, GattCharacteristic &characteristic, const std::string &name)
-: GattInterface(owner, name), characteristic(characteristic), pOnUpdatedValueFunc(nullptr)
+: GattInterface(owner, name, EGattDescriptor), characteristic(characteristic), pOnUpdatedValueFunc(nullptr),
+  pOnWriteSpanFunc(nullptr)
 {
 }
 
@@ -62,6 +63,12 @@ bool GattDescriptor::callMethod(const std::string &methodName, GDBusConnection *
 	{
 		if (methodName == method.getName())
 		{
+			// The rest of a long read is answered from the snapshot taken when it started
+			if (methodName == "ReadValue" && replyFromReadSnapshot(pParameters, pInvocation))
+			{
+				return true;
+			}
+
 			method.call<GattDescriptor>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
 			return true;
 		}
@@ -76,19 +83,14 @@ bool GattDescriptor::callMethod(const std::string &methodName, GDBusConnection *
 // TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
 GattDescriptor &GattDescriptor::onEvent(int tickFrequency, void *pUserData, EventCallback callback)
 {
-	events.push_back(TickEvent(this, tickFrequency, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
-	return *this;
+	return onEventMS(tickFrequency * TickEvent::kTickPeriodMS, pUserData, callback);
 }
 
-// Ticks events within this descriptor
-//
-// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-void GattDescriptor::tickEvents(GDBusConnection *pConnection, void *pUserData) const
+// Same as `onEvent()`, but with the period specified in milliseconds
+GattDescriptor &GattDescriptor::onEventMS(int periodMS, void *pUserData, EventCallback callback)
 {
-	for (const TickEvent &event : events)
-	{
-		event.tick<GattDescriptor>(getPath(), pConnection, pUserData);
-	}
+	events.push_back(TickEvent(this, periodMS, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
+	return *this;
 }
 
 // Specialized support for ReadlValue method
@@ -123,6 +125,32 @@ GattDescriptor &GattDescriptor::onWriteValue(MethodCallback callback)
 	return *this;
 }
 
+// Same as `onWriteValue()`, but the callback is handed the written bytes directly rather than the method's parameters
+//
+// This works the same way as `GattCharacteristic::onWriteSpan()`, including the reassembly of long writes.
+GattDescriptor &GattDescriptor::onWriteSpan(WriteSpanCallback callback)
+{
+	static const char *inArgs[] = {"ay", "a{sv}", nullptr};
+	addMethod("WriteValue", inArgs, nullptr, onWriteSpanValue);
+	pOnWriteSpanFunc = callback;
+	return *this;
+}
+
+// Handles BlueZ's WriteValue method call for a span write callback (see `onWriteSpan()`)
+void GattDescriptor::onWriteSpanValue(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData)
+{
+	const GattDescriptor &self = static_cast<const GattDescriptor &>(dbusInterface);
+
+	PendingWrite write;
+	if (!self.beginWrite(pParameters, pInvocation, write))
+	{
+		return;
+	}
+
+	bool result = self.pOnWriteSpanFunc(self, pConnection, write.pData, write.size, write.options, pUserData);
+	self.endWrite(pInvocation, write, result);
+}
+
 // Custom support for handling updates to our descriptor's value
 //
 // Defined as: (NOT defined by Bluetooth or BlueZ - this method is internal only)
@@ -163,7 +191,7 @@ bool GattDescriptor::callOnUpdatedValue(GDBusConnection *pConnection, void *pUse
 		return false;
 	}
 
-	Logger::debug(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
+	GGK_LOG_DEBUG(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
 	return pOnUpdatedValueFunc(*this, pConnection, pUserData);
 }
 
@@ -60,6 +60,16 @@ struct DBusObject;
 	void *pUserData \
 )
 
+#define DESCRIPTOR_WRITE_SPAN_CALLBACK_LAMBDA [] \
+( \
+	const GattDescriptor &self, \
+	GDBusConnection *pConnection, \
+	const uint8_t *pData, \
+	size_t size, \
+	const GattWriteOptions &options, \
+	void *pUserData \
+) -> bool
+
 #define DESCRIPTOR_METHOD_CALLBACK_LAMBDA [] \
 ( \
        const GattDescriptor &self, \
@@ -76,12 +86,13 @@ struct DBusObject;
 
 struct GattDescriptor : GattInterface
 {
-	// Our interface type
-	static constexpr const char *kInterfaceType = "GattDescriptor";
+	// Our interface kind
+	static const InterfaceKind kInterfaceKind = EGattDescriptor;
 
 	typedef void (*MethodCallback)(const GattDescriptor &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
 	typedef void (*EventCallback)(const GattDescriptor &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 	typedef bool (*UpdatedValueCallback)(const GattDescriptor &self, GDBusConnection *pConnection, void *pUserData);
+	typedef bool (*WriteSpanCallback)(const GattDescriptor &self, GDBusConnection *pConnection, const uint8_t *pData, size_t size, const GattWriteOptions &options, void *pUserData);
 
 	//
 	// Standard constructor
@@ -94,9 +105,6 @@ struct GattDescriptor : GattInterface
 	GattDescriptor(DBusObject &owner, GattCharacteristic &characteristic, const std::string &name);
 	virtual ~GattDescriptor() {}
 
-	// Returns a string identifying the type of interface
-	virtual const std::string getInterfaceType() const { return GattDescriptor::kInterfaceType; }
-
 	// Returning the owner pops us one level up the hierarchy
 	//
 	// This method compliments `GattCharacteristic::gattDescriptorBegin()`
@@ -111,10 +119,8 @@ struct GattDescriptor : GattInterface
 	// TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
 	GattDescriptor &onEvent(int tickFrequency, void *pUserData, EventCallback callback);
 
-	// Ticks events within this descriptor
-	//
-	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
+	// Same as `onEvent()`, but with the period specified in milliseconds
+	GattDescriptor &onEventMS(int periodMS, void *pUserData, EventCallback callback);
 
 	// Specialized support for Descriptor ReadlValue method
 	//
@@ -137,6 +143,11 @@ struct GattDescriptor : GattInterface
 	//     Output args: void
 	GattDescriptor &onWriteValue(MethodCallback callback);
 
+	// Same as `onWriteValue()`, but the callback is handed the written bytes directly rather than the method's parameters
+	//
+	// This works the same way as `GattCharacteristic::onWriteSpan()`, including the reassembly of long writes.
+	GattDescriptor &onWriteSpan(WriteSpanCallback callback);
+
 	// Custom support for handling updates to our descriptor's value
 	//
 	// Defined as: (NOT defined by Bluetooth or BlueZ - this method is internal only)
@@ -170,8 +181,12 @@ struct GattDescriptor : GattInterface
 
 protected:
 
+	// Handles BlueZ's WriteValue method call for a span write callback (see `onWriteSpan()`)
+	static void onWriteSpanValue(const DBusInterface &dbusInterface, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+
 	GattCharacteristic &characteristic;
 	UpdatedValueCallback pOnUpdatedValueFunc;
+	WriteSpanCallback pOnWriteSpanFunc;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -28,11 +28,47 @@
 
 namespace ggk {
 
+// How long a snapshot of a long value is kept for the rest of its read (the ATT transaction timeout)
+static const int kReadSnapshotTimeoutMS = 30000;
+
+// The longest value an attribute may have (see the Bluetooth Core Specification, Vol 3, Part F, 3.2.9)
+static const size_t kMaxAttributeLength = 512;
+
+// Releases a data store value held by a `GBytes` (see `getDataBytes()`)
+static void releaseBlob(gpointer pData)
+{
+	delete static_cast<DataStore::Blob *>(pData);
+}
+
+// Retrieves the "offset", "mtu" and "device" options from the parameters of a ReadValue method call
+//
+// Values that aren't present are left unchanged. Returns false if `pParameters` isn't in the form of ReadValue's parameters.
+static bool getReadOptions(GVariant *pParameters, uint16_t &offset, uint16_t &mtu, std::string &device)
+{
+	if (nullptr == pParameters || !g_variant_is_of_type(pParameters, G_VARIANT_TYPE("(a{sv})")))
+	{
+		return false;
+	}
+
+	GVariant *pOptions = g_variant_get_child_value(pParameters, 0);
+	g_variant_lookup(pOptions, "offset", "q", &offset);
+	g_variant_lookup(pOptions, "mtu", "q", &mtu);
+
+	const gchar *pDevice = nullptr;
+	if (g_variant_lookup(pOptions, "device", "&o", &pDevice))
+	{
+		device = pDevice;
+	}
+
+	g_variant_unref(pOptions);
+	return true;
+}
+
 //
 // Standard constructor
 //
-GattInterface::GattInterface(DBusObject &owner, const std::string &name)
-: DBusInterface(owner, name)
+GattInterface::GattInterface(DBusObject &owner, const std::string &name, InterfaceKind kind)
+: DBusInterface(owner, name, kind)
 {
 }
 
@@ -45,18 +81,110 @@ GattInterface::~GattInterface()
 //
 
 // Returns the list of GATT properties
-const std::list<GattProperty> &GattInterface::getProperties() const
+const std::vector<GattProperty> &GattInterface::getProperties() const
 {
 	return properties;
 }
 
+// Return a data buffer from the server's registered data getter (GGKServerDataGetter) without copying it
+//
+// For names read this way, the data getter returns a pointer to a `GGKDataBuffer` (see Gobbledegook.h) describing memory
+// owned by the application. Values stored in the server's data store are likewise returned without a copy.
+//
+// This method is intended to be used in the server description. An example usage would be:
+//
+//     GBytes *pBlob = self.getDataBytes("config/blob");
+//     self.methodReturnBytes(pInvocation, pBlob);
+//     g_bytes_unref(pBlob);
+//
+// The caller owns the returned reference. Returns nullptr if there is no value.
+GBytes *GattInterface::getDataBytes(const char *pName) const
+{
+	// The GBytes holds a reference to the stored blob, which keeps it alive even if the application replaces it
+	DataStore::Blob blob;
+	uint64_t version = 0;
+	if (DataStore::getInstance().get(pName, blob, version))
+	{
+		return g_bytes_new_with_free_func(blob->data(), blob->size(), releaseBlob, new DataStore::Blob(blob));
+	}
+
+	const GGKDataBuffer *pBuffer = static_cast<const GGKDataBuffer *>(getOwner().getServer().getDataGetter()(pName));
+	if (nullptr == pBuffer)
+	{
+		return nullptr;
+	}
+
+	if (pBuffer->size < 0 || (nullptr == pBuffer->pData && pBuffer->size != 0))
+	{
+		GGK_LOG_ERROR(SSTR << "Data getter returned an invalid buffer for '" << pName << "'");
+		if (nullptr != pBuffer->release)
+		{
+			pBuffer->release(pBuffer->pReleaseData);
+		}
+
+		return nullptr;
+	}
+
+	if (nullptr == pBuffer->release)
+	{
+		return g_bytes_new_static(pBuffer->pData, pBuffer->size);
+	}
+
+	return g_bytes_new_with_free_func(pBuffer->pData, pBuffer->size, pBuffer->release, pBuffer->pReleaseData);
+}
+
 // When responding to a method, we need to return a GVariant value wrapped in a tuple. This method will simplify this slightly by
 // wrapping a GVariant of the type "ay" and wrapping it in a tuple before sending it off as the method response.
 //
 // This is the generalized form that accepts a GVariant *. There is a templated helper method (`methodReturnValue()`) that accepts
 // common types.
+//
+// When replying to ReadValue with a byte array, only the part of the value requested by the "offset" and "mtu" options is
+// sent. If the value is too long for a single response, a snapshot of it is kept so the rest of the long read can be answered
+// without calling the ReadValue callback again (see `replyFromReadSnapshot()`.)
 void GattInterface::methodReturnVariant(GDBusMethodInvocation *pInvocation, GVariant *pVariant, bool wrapInTuple) const
 {
+	// Calls replayed from a trace (see replay.cpp) have no invocation to reply to, so their replies are discarded
+	if (nullptr == pInvocation)
+	{
+		if (nullptr != pVariant)
+		{
+			g_variant_unref(g_variant_ref_sink(pVariant));
+		}
+		return;
+	}
+
+	const GVariantType *pReadValueType = wrapInTuple ? G_VARIANT_TYPE_BYTESTRING : G_VARIANT_TYPE("(ay)");
+	if (nullptr != pVariant && g_variant_is_of_type(pVariant, pReadValueType) &&
+		g_strcmp0(g_dbus_method_invocation_get_method_name(pInvocation), "ReadValue") == 0)
+	{
+		uint16_t offset = 0;
+		uint16_t mtu = 0;
+		std::string device;
+		getReadOptions(g_dbus_method_invocation_get_parameters(pInvocation), offset, mtu, device);
+
+		// The serialized form of a byte array is just its bytes
+		g_variant_ref_sink(pVariant);
+		GVariant *pValue = wrapInTuple ? g_variant_ref(pVariant) : g_variant_get_child_value(pVariant, 0);
+		GBytes *pBytes = g_variant_get_data_as_bytes(pValue);
+		g_variant_unref(pValue);
+		g_variant_unref(pVariant);
+
+		// A value that doesn't fit in one response will be read in pieces; hold onto it until the read is complete. Without an MTU
+		// (older versions of BlueZ) the whole value is sent at once, so there's nothing to hold onto.
+		if (offset == 0 && mtu != 0 && g_bytes_get_size(pBytes) > static_cast<size_t>(mtu - 1))
+		{
+			std::lock_guard<std::mutex> lock(readSnapshotsMutex);
+			ReadSnapshot &snapshot = readSnapshots[device];
+			snapshot.bytes = std::shared_ptr<GBytes>(g_bytes_ref(pBytes), g_bytes_unref);
+			snapshot.expiry = std::chrono::steady_clock::now() + std::chrono::milliseconds(kReadSnapshotTimeoutMS);
+		}
+
+		replyWithReadSlice(pInvocation, pBytes, offset, mtu);
+		g_bytes_unref(pBytes);
+		return;
+	}
+
 	if (wrapInTuple)
 	{
 		pVariant = g_variant_new_tuple(&pVariant, 1);
@@ -64,6 +192,15 @@ void GattInterface::methodReturnVariant(GDBusMethodInvocation *pInvocation, GVar
 	g_dbus_method_invocation_return_value(pInvocation, pVariant);
 }
 
+// Responds to a method call (such as ReadValue) with the contents of `pBytes` as an array of bytes ("ay") wrapped in a tuple
+//
+// The bytes are sent as they are, without being copied (see `getDataBytes()`.) If `pBytes` is nullptr, an empty array is sent.
+// The caller keeps its reference to `pBytes`.
+void GattInterface::methodReturnBytes(GDBusMethodInvocation *pInvocation, GBytes *pBytes) const
+{
+	methodReturnVariant(pInvocation, Utils::gvariantFromBytes(pBytes), true);
+}
+
 // Locates a `GattProperty` within the interface
 //
 // This method returns a pointer to the property or nullptr if not found
@@ -80,38 +217,220 @@ const GattProperty *GattInterface::findProperty(const std::string &name) const
 	return nullptr;
 }
 
-// Internal method used to generate introspection XML used to describe our services on D-Bus
-std::string GattInterface::generateIntrospectionXML(int depth) const
+// Answers a ReadValue method call with a non-zero offset from the snapshot of a long value (see `methodReturnVariant()`)
+//
+// Returns true if the call was answered, otherwise false, in which case the ReadValue callback should be called as usual.
+bool GattInterface::replyFromReadSnapshot(GVariant *pParameters, GDBusMethodInvocation *pInvocation) const
+{
+	uint16_t offset = 0;
+	uint16_t mtu = 0;
+	std::string device;
+	std::unique_lock<std::mutex> lock(readSnapshotsMutex);
+	if (readSnapshots.empty() || !getReadOptions(pParameters, offset, mtu, device))
+	{
+		return false;
+	}
+
+	auto it = readSnapshots.find(device);
+	if (it == readSnapshots.end())
+	{
+		return false;
+	}
+
+	// A read from the start is a new read, so it needs a fresh value
+	if (offset == 0 || std::chrono::steady_clock::now() > it->second.expiry)
+	{
+		readSnapshots.erase(it);
+		return false;
+	}
+
+	std::shared_ptr<GBytes> bytes = it->second.bytes;
+
+	// If this is the last piece (and without an MTU, the rest of the value is sent at once) we're done with the snapshot
+	if (mtu == 0 || static_cast<size_t>(offset) + mtu - 1 >= g_bytes_get_size(bytes.get()))
+	{
+		readSnapshots.erase(it);
+	}
+	lock.unlock();
+
+	replyWithReadSlice(pInvocation, bytes.get(), offset, mtu);
+	return true;
+}
+
+// Unpacks the value and options of a WriteValue method call for a span write callback
+//
+// `write.pData` and `write.size` describe the whole value as written so far. A simple write refers directly to the bytes in
+// `pParameters`. The pieces of a long (prepared) write are put together in `writeAssembly` so the callback sees the value from its
+// start each time. Returns false if the write was rejected, in which case an error has already been returned to the caller.
+bool GattInterface::beginWrite(GVariant *pParameters, GDBusMethodInvocation *pInvocation, PendingWrite &write) const
 {
-	std::string prefix;
-	prefix.insert(0, depth * 2, ' ');
+	if (nullptr == pParameters || !g_variant_is_of_type(pParameters, G_VARIANT_TYPE("(aya{sv})")))
+	{
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InvalidArguments", "Invalid arguments");
+		return false;
+	}
+
+	// The value and any strings in the options are used in place, so hold onto them until `endWrite()`
+	write.pValue = g_variant_get_child_value(pParameters, 0);
+	write.pOptions = g_variant_get_child_value(pParameters, 1);
 
-	std::string xml = std::string();
+	gsize size = 0;
+	write.pData = static_cast<const uint8_t *>(g_variant_get_fixed_array(write.pValue, &size, 1));
+	write.size = size;
+
+	GattWriteOptions &options = write.options;
+	options.offset = 0;
+	options.mtu = 0;
+	options.pType = "";
+	options.pDevice = "";
+	gboolean prepareAuthorize = FALSE;
+	g_variant_lookup(write.pOptions, "offset", "q", &options.offset);
+	g_variant_lookup(write.pOptions, "mtu", "q", &options.mtu);
+	g_variant_lookup(write.pOptions, "type", "&s", &options.pType);
+	g_variant_lookup(write.pOptions, "device", "&o", &options.pDevice);
+	g_variant_lookup(write.pOptions, "prepare-authorize", "b", &prepareAuthorize);
+	options.bPrepareAuthorize = prepareAuthorize != FALSE;
+
+	size_t end = static_cast<size_t>(options.offset) + write.size;
+	if (end > kMaxAttributeLength)
+	{
+		endWrite(nullptr, write, false);
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InvalidValueLength", "Invalid value length");
+		return false;
+	}
+
+	// An authorization request carries the piece that will be written, but nothing has been written yet
+	if (options.bPrepareAuthorize)
+	{
+		return true;
+	}
+
+	// A plain write from the start of the value is the whole value, so the callback can use it where it lies. Anything else may
+	// be one piece of a long write (older versions of BlueZ don't give us the type, so we can't tell.)
+	bool bSimpleWrite = options.offset == 0 && (0 == strcmp(options.pType, "request") || 0 == strcmp(options.pType, "command"));
+	if (bSimpleWrite)
+	{
+		return true;
+	}
+
+	if (options.offset == 0)
+	{
+		writeAssembly.clear();
+		writeAssemblyDevice.assign(options.pDevice);
+	}
+	else if (options.offset > writeAssembly.size() || writeAssemblyDevice != options.pDevice)
+	{
+		endWrite(nullptr, write, false);
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InvalidOffset", "Invalid offset");
+		return false;
+	}
+
+	// Each piece replaces everything from its offset onward
+	writeAssembly.resize(options.offset);
+	writeAssembly.insert(writeAssembly.end(), write.pData, write.pData + write.size);
+
+	write.pData = writeAssembly.data();
+	write.size = writeAssembly.size();
+	return true;
+}
+
+// Replies to the WriteValue method call with success or failure, according to `result`, and releases `write`
+//
+// If `pInvocation` is nullptr, `write` is only released.
+void GattInterface::endWrite(GDBusMethodInvocation *pInvocation, PendingWrite &write, bool result) const
+{
+	if (nullptr != pInvocation)
+	{
+		if (result)
+		{
+			g_dbus_method_invocation_return_value(pInvocation, nullptr);
+		}
+		else
+		{
+			g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.Failed", "Write failed");
+		}
+	}
+
+	g_variant_unref(write.pValue);
+	g_variant_unref(write.pOptions);
+	write.pValue = nullptr;
+	write.pOptions = nullptr;
+}
+
+// Replies to a ReadValue method call with the part of `pBytes` requested by `offset` and `mtu` (0 if unknown)
+void GattInterface::replyWithReadSlice(GDBusMethodInvocation *pInvocation, GBytes *pBytes, uint16_t offset, uint16_t mtu) const
+{
+	gsize size = g_bytes_get_size(pBytes);
+	if (offset > size)
+	{
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InvalidOffset", "Invalid offset");
+		return;
+	}
+
+	// A response carries at most MTU - 1 bytes of the value, so there's no point in sending more than that
+	gsize length = size - offset;
+	if (mtu > 1 && length > static_cast<gsize>(mtu - 1))
+	{
+		length = mtu - 1;
+	}
+
+	// The slice shares the value's bytes rather than copying them
+	GBytes *pSlice = g_bytes_new_from_bytes(pBytes, offset, length);
+	GVariant *pValue = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pSlice, TRUE);
+	g_bytes_unref(pSlice);
+
+	g_dbus_method_invocation_return_value(pInvocation, g_variant_new_tuple(&pValue, 1));
+}
+
+// Internal method used to build the description of this interface used when registering our objects with D-Bus
+//
+// The caller owns the returned reference
+GDBusInterfaceInfo *GattInterface::generateInterfaceInfo() const
+{
+	// Start with our methods
+	GDBusInterfaceInfo *pInterface = DBusInterface::generateInterfaceInfo();
+
+	// Describe our properties
+	g_free(pInterface->properties);
+	pInterface->properties = g_new0(GDBusPropertyInfo *, getProperties().size() + 1);
+	size_t index = 0;
+	for (const GattProperty &property : getProperties())
+	{
+		pInterface->properties[index++] = property.generatePropertyInfo();
+	}
+
+	return pInterface;
+}
+
+// Internal method used to generate introspection XML used to describe our services on D-Bus
+//
+// The XML is appended to `xml`
+void GattInterface::generateIntrospectionXML(std::string &xml, int depth) const
+{
+	const std::string prefix(depth * 2, ' ');
 
 	if (methods.size() && getProperties().empty())
 	{
-		xml += prefix + "<interface name='" + getName() + "' />\n";
+		xml.append(prefix).append("<interface name='").append(getName()).append("' />\n");
 	}
 	else
 	{
-		xml += prefix + "<interface name='" + getName() + "'>\n";
+		xml.append(prefix).append("<interface name='").append(getName()).append("'>\n");
 
 		// Describe our methods
 		for (const DBusMethod &method : methods)
 		{
-			xml += method.generateIntrospectionXML(depth + 1);
+			method.generateIntrospectionXML(xml, depth + 1);
 		}
 
 		// Describe our properties
 		for (const GattProperty &property : getProperties())
 		{
-			xml += property.generateIntrospectionXML(depth + 1);
+			property.generateIntrospectionXML(xml, depth + 1);
 		}
 
-		xml += prefix + "</interface>\n";
+		xml.append(prefix).append("</interface>\n");
 	}
-
-	return xml;
 }
 
 }; // namespace ggk
\ No newline at end of file
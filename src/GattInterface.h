@@ -23,14 +23,21 @@
 #pragma once
 
 #include <gio/gio.h>
+#include <string.h>
 #include <string>
-#include <list>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
 
 #include "TickEvent.h"
 #include "DBusInterface.h"
 #include "GattProperty.h"
 #include "GattUuid.h"
 #include "Server.h"
+#include "DataStore.h"
+#include "Stats.h"
 #include "Utils.h"
 
 namespace ggk {
@@ -42,6 +49,28 @@ namespace ggk {
 struct GattInterface;
 struct DBusObject;
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The options that arrive with a write (see `GattCharacteristic::onWriteSpan()`)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+struct GattWriteOptions
+{
+	// Where the newly written bytes start within the value (non-zero for the later pieces of a long write)
+	uint16_t offset;
+
+	// The ATT MTU of the connection, or 0 if BlueZ didn't say
+	uint16_t mtu;
+
+	// The kind of write: "command" (without response), "request" or "reliable" (a prepared write), or "" if BlueZ didn't say
+	const char *pType;
+
+	// The object path of the device that is writing, or "" if BlueZ didn't say
+	const char *pDevice;
+
+	// True if BlueZ is only asking whether a prepared write is authorized; nothing has been written yet
+	bool bPrepareAuthorize;
+};
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Pure virtual representation of a Bluetooth GATT Interface, the base class for Services, Characteristics and Descriptors
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -49,18 +78,15 @@ struct DBusObject;
 struct GattInterface : DBusInterface
 {
 	// Standard constructor
-	GattInterface(DBusObject &owner, const std::string &name);
+	GattInterface(DBusObject &owner, const std::string &name, InterfaceKind kind);
 	virtual ~GattInterface();
 
-	// Returns a string identifying the type of interface
-	virtual const std::string getInterfaceType() const = 0;
-
 	//
 	// GATT Characteristic properties
 	//
 
 	// Returns the list of GATT properties
-	const std::list<GattProperty> &getProperties() const;
+	const std::vector<GattProperty> &getProperties() const;
 
 	// Add a `GattProperty` to the interface
 	//
@@ -139,10 +165,18 @@ struct GattInterface : DBusInterface
 	// This method is intended to be used in the server description. An example usage would be:
 	//
 	//     uint8_t batteryLevel = self.getDataValue<uint8_t>("battery/level", 0);
+	//
+	// Values stored in the server's data store (see `ggkDataStoreSet()`) are used in place of the data getter.
 	template<typename T>
 	T getDataValue(const char *pName, const T defaultValue) const
 	{
-		const void *pData = TheServer->getDataGetter()(pName);
+		T value;
+		if (DataStore::getInstance().copy(pName, &value, sizeof(T)))
+		{
+			return value;
+		}
+
+		const void *pData = getOwner().getServer().getDataGetter()(pName);
 		return nullptr == pData ? defaultValue : *static_cast<const T *>(pData);
 	}
 
@@ -153,13 +187,35 @@ struct GattInterface : DBusInterface
 	// This method is intended to be used in the server description. An example usage would be:
 	//
 	//     const char *pTextString = self.getDataPointer<const char *>("text/string", "");
+	//
+	// Values stored in the server's data store (see `ggkDataStoreSet()`) are used in place of the data getter. In that case, the
+	// pointer remains valid until the next call for the same name on this thread.
 	template<typename T>
 	T getDataPointer(const char *pName, const T defaultValue) const
 	{
-		const void *pData = TheServer->getDataGetter()(pName);
+		const void *pData = DataStore::getInstance().pin(pName);
+		if (nullptr == pData)
+		{
+			pData = getOwner().getServer().getDataGetter()(pName);
+		}
+
 		return nullptr == pData ? defaultValue : static_cast<const T>(pData);
 	}
 
+	// Return a data buffer from the server's registered data getter (GGKServerDataGetter) without copying it
+	//
+	// For names read this way, the data getter returns a pointer to a `GGKDataBuffer` (see Gobbledegook.h) describing memory
+	// owned by the application. Values stored in the server's data store are likewise returned without a copy.
+	//
+	// This method is intended to be used in the server description. An example usage would be:
+	//
+	//     GBytes *pBlob = self.getDataBytes("config/blob");
+	//     self.methodReturnBytes(pInvocation, pBlob);
+	//     g_bytes_unref(pBlob);
+	//
+	// The caller owns the returned reference. Returns nullptr if there is no value.
+	GBytes *getDataBytes(const char *pName) const;
+
 	// Sends a data value from the server back to the application through the server's registered data setter
 	// (GGKServerDataSetter)
 	//
@@ -168,10 +224,13 @@ struct GattInterface : DBusInterface
 	// This method is intended to be used in the server description. An example usage would be:
 	//
 	//     self.setDataValue("battery/level", batteryLevel);
+	//
+	// If the value is also held in the server's data store, the stored copy is updated to match.
 	template<typename T>
 	bool setDataValue(const char *pName, const T value) const
 	{
-		return TheServer->getDataSetter()(pName, static_cast<const void *>(&value)) != 0;
+		DataStore::getInstance().update(pName, &value, sizeof(T));
+		return getOwner().getServer().getDataSetter()(pName, static_cast<const void *>(&value)) != 0;
 	}
 
 	// Sends a data pointer from the server back to the application through the server's registered data setter
@@ -182,10 +241,23 @@ struct GattInterface : DBusInterface
 	// This method is intended to be used in the server description. An example usage would be:
 	//
 	//     self.setDataPointer("text/string", stringFromGVariantByteArray(pAyBuffer).c_str());
+	//
+	// We can't know the size of the data behind an arbitrary pointer, so if the value is also held in the server's data store, it
+	// is removed from the store (reads will go back to the data getter.) Strings are the exception; see the overload below.
 	template<typename T>
 	bool setDataPointer(const char *pName, const T pointer) const
 	{
-		return TheServer->getDataSetter()(pName, static_cast<const void *>(pointer)) != 0;
+		DataStore::getInstance().remove(pName);
+		return getOwner().getServer().getDataSetter()(pName, static_cast<const void *>(pointer)) != 0;
+	}
+
+	// Sends a string from the server back to the application through the server's registered data setter (GGKServerDataSetter)
+	//
+	// If the string is also held in the server's data store, the stored copy is updated to match.
+	bool setDataPointer(const char *pName, const char *pString) const
+	{
+		DataStore::getInstance().update(pName, pString, nullptr == pString ? 0 : strlen(pString) + 1);
+		return getOwner().getServer().getDataSetter()(pName, static_cast<const void *>(pString)) != 0;
 	}
 
 	// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
@@ -194,6 +266,10 @@ struct GattInterface : DBusInterface
 	//
 	// This is the generalized form that accepts a GVariant *. There is a templated helper method (`methodReturnValue()`) that accepts
 	// common types.
+	//
+	// When replying to ReadValue with a byte array, only the part of the value requested by the "offset" and "mtu" options is
+	// sent. If the value is too long for a single response, a snapshot of it is kept so the rest of the long read can be answered
+	// without calling the ReadValue callback again (see `replyFromReadSnapshot()`.)
 	void methodReturnVariant(GDBusMethodInvocation *pInvocation, GVariant *pVariant, bool wrapInTuple = false) const;
 
 	// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
@@ -209,17 +285,89 @@ struct GattInterface : DBusInterface
 		methodReturnVariant(pInvocation, pVariant, wrapInTuple);
 	}
 
+	// Responds to a method call (such as ReadValue) with the contents of `pBytes` as an array of bytes ("ay") wrapped in a tuple
+	//
+	// The bytes are sent as they are, without being copied (see `getDataBytes()`.) If `pBytes` is nullptr, an empty array is sent.
+	// The caller keeps its reference to `pBytes`.
+	void methodReturnBytes(GDBusMethodInvocation *pInvocation, GBytes *pBytes) const;
+
 	// Locates a `GattProperty` within the interface
 	//
 	// This method returns a pointer to the property or nullptr if not found
 	const GattProperty *findProperty(const std::string &name) const;
 
+	// Returns the counters for this interface (see Stats.cpp)
+	//
+	// These are only recorded while statistics are enabled (see `Stats::isEnabled()`.)
+	InterfaceStats &getStats() const { return stats; }
+
+	// Answers a ReadValue method call with a non-zero offset from the snapshot of a long value (see `methodReturnVariant()`)
+	//
+	// Returns true if the call was answered, otherwise false, in which case the ReadValue callback should be called as usual.
+	bool replyFromReadSnapshot(GVariant *pParameters, GDBusMethodInvocation *pInvocation) const;
+
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
-	virtual std::string generateIntrospectionXML(int depth) const;
+	//
+	// The XML is appended to `xml`
+	virtual void generateIntrospectionXML(std::string &xml, int depth) const;
+
+	// Internal method used to build the description of this interface used when registering our objects with D-Bus
+	//
+	// The caller owns the returned reference
+	virtual GDBusInterfaceInfo *generateInterfaceInfo() const;
 
 protected:
 
-	std::list<GattProperty> properties;
+	// A serialized value held for the duration of a long read
+	struct ReadSnapshot
+	{
+		std::shared_ptr<GBytes> bytes;
+		std::chrono::steady_clock::time_point expiry;
+	};
+
+	// Replies to a ReadValue method call with the part of `pBytes` requested by `offset` and `mtu` (0 if unknown)
+	void replyWithReadSlice(GDBusMethodInvocation *pInvocation, GBytes *pBytes, uint16_t offset, uint16_t mtu) const;
+
+	// A WriteValue method call being handed to a span write callback (see `beginWrite()`)
+	struct PendingWrite
+	{
+		GVariant *pValue;
+		GVariant *pOptions;
+		const uint8_t *pData;
+		size_t size;
+		GattWriteOptions options;
+	};
+
+	// Unpacks the value and options of a WriteValue method call for a span write callback
+	//
+	// `write.pData` and `write.size` describe the whole value as written so far. A simple write refers directly to the bytes in
+	// `pParameters`. The pieces of a long (prepared) write are put together in `writeAssembly` so the callback sees the value from
+	// its start each time. Returns false if the write was rejected, in which case an error has already been returned to the caller.
+	bool beginWrite(GVariant *pParameters, GDBusMethodInvocation *pInvocation, PendingWrite &write) const;
+
+	// Replies to the WriteValue method call with success or failure, according to `result`, and releases `write`
+	//
+	// If `pInvocation` is nullptr, `write` is only released.
+	void endWrite(GDBusMethodInvocation *pInvocation, PendingWrite &write, bool result) const;
+
+	std::vector<GattProperty> properties;
+
+	// Snapshots of long values being read, by the path of the device reading them
+	//
+	// Method calls are normally processed on the main loop's thread, but async handlers (see WorkerPool.cpp) reply from a worker,
+	// so these are guarded by `readSnapshotsMutex`.
+	mutable std::mutex readSnapshotsMutex;
+	mutable std::unordered_map<std::string, ReadSnapshot> readSnapshots;
+
+	// Our counters (see `getStats()`)
+	mutable InterfaceStats stats;
+
+	// The value of a long write being put together, and the device writing it (see `beginWrite()`)
+	//
+	// Span write callbacks always run on the main loop's thread, so these need no lock. The buffer keeps its capacity between
+	// writes, so once it has grown to the size of the largest value, reassembly doesn't allocate.
+	mutable std::vector<uint8_t> writeAssembly;
+	mutable std::string writeAssemblyDevice;
 };
 
 }; // namespace ggk
\ No newline at end of file
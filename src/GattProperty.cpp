@@ -26,6 +26,7 @@
 
 #include "Utils.h"
 #include "GattProperty.h"
+#include "StringPool.h"
 
 namespace ggk {
 
@@ -34,7 +35,7 @@ namespace ggk {
 // In general, properties should not be constructed directly as properties are typically instanticated by adding them to to an
 // interface using one of the the interface's `addProperty` methods.
 GattProperty::GattProperty(const std::string &name, GVariant *pValue, GDBusInterfaceGetPropertyFunc getter, GDBusInterfaceSetPropertyFunc setter)
-: name(name), pValue(pValue), getterFunc(getter), setterFunc(setter)
+: pName(&StringPool::intern(name)), pValue(pValue), getterFunc(getter), setterFunc(setter)
 {
 }
 
@@ -45,7 +46,7 @@ GattProperty::GattProperty(const std::string &name, GVariant *pValue, GDBusInter
 // Returns the name of the property
 const std::string &GattProperty::getName() const
 {
-	return name;
+	return *pName;
 }
 
 // Sets the name of the property
@@ -54,7 +55,7 @@ const std::string &GattProperty::getName() const
 // interface's `addProperty` methods.
 GattProperty &GattProperty::setName(const std::string &name)
 {
-	this->name = name;
+	pName = &StringPool::intern(name);
 	return *this;
 }
 
@@ -114,66 +115,76 @@ GattProperty &GattProperty::setSetterFunc(GDBusInterfaceSetPropertyFunc func)
 	return *this;
 }
 
-// Internal method used to generate introspection XML used to describe our services on D-Bus
-std::string GattProperty::generateIntrospectionXML(int depth) const
+// Internal method used to build the description of this property used when registering our objects with D-Bus
+//
+// The caller owns the returned reference
+GDBusPropertyInfo *GattProperty::generatePropertyInfo() const
 {
-	std::string prefix;
-	prefix.insert(0, depth * 2, ' ');
+	GDBusPropertyInfo *pProperty = g_new0(GDBusPropertyInfo, 1);
+	pProperty->ref_count = 1;
+	pProperty->name = g_strdup(getName().c_str());
+	pProperty->signature = g_strdup(g_variant_get_type_string(const_cast<GVariant *>(getValue())));
+	pProperty->flags = G_DBUS_PROPERTY_INFO_FLAGS_READABLE;
+	return pProperty;
+}
 
-	std::string xml = std::string();
+// Internal method used to generate introspection XML used to describe our services on D-Bus
+//
+// The XML is appended to `xml`
+void GattProperty::generateIntrospectionXML(std::string &xml, int depth) const
+{
+	const std::string prefix(depth * 2, ' ');
 
 	GVariant *pValue = const_cast<GVariant *>(getValue());
 	const gchar *pType = g_variant_get_type_string(pValue);
-	xml += prefix + "<property name='" + getName() + "' type='" + pType + "' access='read'>\n";
+	xml.append(prefix).append("<property name='").append(getName()).append("' type='").append(pType).append("' access='read'>\n");
 
 	if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_BOOLEAN))
 	{
-		xml += prefix + "  <annotation name='name' value='" + (g_variant_get_boolean(pValue) != 0 ? "true":"false") + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(g_variant_get_boolean(pValue) != 0 ? "true":"false").append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_INT16))
 	{
-		xml += prefix + "  <annotation name='name' value='" + std::to_string(g_variant_get_int16(pValue)) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(std::to_string(g_variant_get_int16(pValue))).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_UINT16))
 	{
-		xml += prefix + "  <annotation name='name' value='" + std::to_string(g_variant_get_uint16(pValue)) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(std::to_string(g_variant_get_uint16(pValue))).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_INT32))
 	{
-		xml += prefix + "  <annotation name='name' value='" + std::to_string(g_variant_get_int32(pValue)) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(std::to_string(g_variant_get_int32(pValue))).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_UINT32))
 	{
-		xml += prefix + "  <annotation name='name' value='" + std::to_string(g_variant_get_uint32(pValue)) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(std::to_string(g_variant_get_uint32(pValue))).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_INT64))
 	{
-		xml += prefix + "  <annotation name='name' value='" + std::to_string(g_variant_get_int64(pValue)) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(std::to_string(g_variant_get_int64(pValue))).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_UINT64))
 	{
-		xml += prefix + "  <annotation name='name' value='" + std::to_string(g_variant_get_uint64(pValue)) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(std::to_string(g_variant_get_uint64(pValue))).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_DOUBLE))
 	{
-		xml += prefix + "  <annotation value='" + std::to_string(g_variant_get_double(pValue)) + "' />\n";
+		xml.append(prefix).append("  <annotation value='").append(std::to_string(g_variant_get_double(pValue))).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_STRING))
 	{
-		xml += prefix + "  <annotation name='name' value='" + g_variant_get_string(pValue, nullptr) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(g_variant_get_string(pValue, nullptr)).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_OBJECT_PATH))
 	{
-		xml += prefix + "  <annotation name='name' value='" + g_variant_get_string(pValue, nullptr) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(g_variant_get_string(pValue, nullptr)).append("' />\n");
 	}
 	else if (g_variant_is_of_type(pValue, G_VARIANT_TYPE_BYTESTRING))
 	{
-		xml += prefix + "  <annotation name='name' value='" + g_variant_get_bytestring(pValue) + "' />\n";
+		xml.append(prefix).append("  <annotation name='name' value='").append(g_variant_get_bytestring(pValue)).append("' />\n");
 	}
 
-	xml += prefix + "</property>\n";
-
-	return xml;
+	xml.append(prefix).append("</property>\n");
 }
 
 }; // namespace ggk
\ No newline at end of file
@@ -87,11 +87,19 @@ struct GattProperty
 	GattProperty &setSetterFunc(GDBusInterfaceSetPropertyFunc func);
 
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
-	std::string generateIntrospectionXML(int depth) const;
+	//
+	// The XML is appended to `xml`
+	void generateIntrospectionXML(std::string &xml, int depth) const;
+
+	// Internal method used to build the description of this property used when registering our objects with D-Bus
+	//
+	// The caller owns the returned reference
+	GDBusPropertyInfo *generatePropertyInfo() const;
 
 private:
 
-	std::string name;
+	// Our name, held by the `StringPool`
+	const std::string *pName;
 	GVariant *pValue;
 	GDBusInterfaceGetPropertyFunc getterFunc;
 	GDBusInterfaceSetPropertyFunc setterFunc;
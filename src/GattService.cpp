@@ -24,6 +24,7 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <gio/gio.h>
+#include <string.h>
 #include <string>
 #include <list>
 
@@ -40,7 +41,7 @@ namespace ggk {
 
 // Standard constructor
 GattService::GattService(DBusObject &owner, const std::string &name)
-: GattInterface(owner, name)
+: GattInterface(owner, name, EGattService)
 {
 }
 
@@ -74,6 +75,8 @@ DBusObject &GattService::gattServiceEnd()
 //     "secure-read" (Server only)
 //     "secure-write" (Server only)
 //
+// Characteristics with the "notify" or "indicate" flag also keep track of their subscribers (see
+// `GattCharacteristic::enableNotify()`.)
 GattCharacteristic &GattService::gattCharacteristicBegin(const std::string &pathElement, const GattUuid &uuid, const std::vector<const char *> &flags)
 {
 	DBusObject &child = owner.addChild(DBusObjectPath(pathElement));
@@ -81,6 +84,17 @@ GattCharacteristic &GattService::gattCharacteristicBegin(const std::string &path
 	characteristic.addProperty<GattCharacteristic>("UUID", uuid);
 	characteristic.addProperty<GattCharacteristic>("Service", owner.getPath());
 	characteristic.addProperty<GattCharacteristic>("Flags", flags);
+
+	// Anything that can notify gets to know whether anybody is listening
+	for (const char *pFlag : flags)
+	{
+		if (0 == strcmp(pFlag, "notify") || 0 == strcmp(pFlag, "indicate"))
+		{
+			characteristic.enableNotify();
+			break;
+		}
+	}
+
 	return characteristic;
 }
 
@@ -49,8 +49,8 @@ struct DBusObject;
 
 struct GattService : GattInterface
 {
-	// Our interface type
-	static constexpr const char *kInterfaceType = "GattService";
+	// Our interface kind
+	static const InterfaceKind kInterfaceKind = EGattService;
 
 	// Standard constructor
 	GattService(DBusObject &owner, const std::string &name);
@@ -84,10 +84,9 @@ struct GattService : GattInterface
 	//     "secure-read" (Server only)
 	//     "secure-write" (Server only)
 	//
+	// Characteristics with the "notify" or "indicate" flag also keep track of their subscribers (see
+	// `GattCharacteristic::enableNotify()`.)
 	GattCharacteristic &gattCharacteristicBegin(const std::string &pathElement, const GattUuid &uuid, const std::vector<const char *> &flags);
-
-	// Returns a string identifying the type of interface
-	virtual const std::string getInterfaceType() const { return GattService::kInterfaceType; }
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -0,0 +1,132 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Static tables for describing GATT services at compile time
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The fluent description in Server.cpp (`gattServiceBegin()`, `gattCharacteristicBegin()`, `onReadValue()`, ...) is built up one
+// call at a time when the server is constructed. That's convenient for descriptions that depend on runtime information, but for a
+// fixed set of services it means the shape of the server, its UUIDs and its flags only exist once the constructor has run.
+//
+// A `GattTable` describes the same thing as static data. Every entry has a constexpr constructor, so a table declared `constexpr`
+// (or `static const`) at namespace scope is laid out by the compiler into read-only data, with UUIDs parsed at compile time (see
+// GattUuid.h) and flags held as `GattTableFlag` bits. The handlers are plain function pointers, so the table doubles as a static
+// dispatch table of ReadValue/WriteValue handlers. Here's the 'text' service from Server.cpp's example as a table:
+//
+//     static constexpr GattTableDescriptor kStringDescriptors[] =
+//     {
+//         { "description", "2901", EGattFlagRead, readStringDescription },
+//     };
+//
+//     static constexpr GattTableCharacteristic kTextCharacteristics[] =
+//     {
+//         { "string", "00000002-1E3C-FAD4-74E2-97A033F1BFAA", EGattFlagRead | EGattFlagWrite | EGattFlagNotify,
+//             readString, writeString, updatedString, kStringDescriptors },
+//     };
+//
+//     static constexpr GattTableService kTextServices[] =
+//     {
+//         { "text", "00000001-1E3C-FAD4-74E2-97A033F1BFAA", kTextCharacteristics },
+//     };
+//
+//     static constexpr GattTable kTextTable(kTextServices);
+//
+// Entry counts come from the arrays themselves, so they can't get out of step with the entries.
+//
+// Handlers can't be written inline with the `*_CALLBACK_LAMBDA` macros, since a lambda can't be converted to a function pointer in
+// a constant expression (before C++17). They're ordinary functions with the same signatures instead.
+//
+// A table is added to the server's root object with `DBusObject::gattTable()`, which may be mixed freely with the fluent
+// description. The D-Bus objects are still created from the table when the server is constructed, as BlueZ needs them to be real
+// objects on the bus, but no description work (UUID parsing, flag lists, handler lambdas) is left for runtime.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "GattTable.h"
+#include "GattService.h"
+#include "DBusObject.h"
+
+namespace ggk {
+
+// The BlueZ flag strings, indexed by bit number in `GattTableFlag`
+static const char *const kFlagStrings[EGattFlagCount] =
+{
+	"broadcast",
+	"read",
+	"write-without-response",
+	"write",
+	"notify",
+	"indicate",
+	"authenticated-signed-writes",
+	"reliable-write",
+	"writable-auxiliaries",
+	"encrypt-read",
+	"encrypt-write",
+	"encrypt-authenticated-read",
+	"encrypt-authenticated-write",
+	"secure-read",
+	"secure-write",
+	"authorize"
+};
+
+// Returns the BlueZ flag strings for a set of `GattTableFlag` bits
+std::vector<const char *> GattTable::flagStrings(uint32_t flags)
+{
+	std::vector<const char *> strings;
+	for (uint32_t bit = 0; bit < EGattFlagCount; ++bit)
+	{
+		if (flags & (1u << bit))
+		{
+			strings.push_back(kFlagStrings[bit]);
+		}
+	}
+
+	return strings;
+}
+
+// Adds the services described by this table to `root`
+//
+// The result is the same as describing each service with `gattServiceBegin()` and friends.
+void GattTable::build(DBusObject &root) const
+{
+	for (size_t s = 0; s < serviceCount; ++s)
+	{
+		const GattTableService &serviceEntry = pServices[s];
+		GattService &service = root.gattServiceBegin(serviceEntry.pPathElement, serviceEntry.uuid);
+
+		for (size_t c = 0; c < serviceEntry.characteristicCount; ++c)
+		{
+			const GattTableCharacteristic &characteristicEntry = serviceEntry.pCharacteristics[c];
+			GattCharacteristic &characteristic = service.gattCharacteristicBegin(characteristicEntry.pPathElement,
+				characteristicEntry.uuid, flagStrings(characteristicEntry.flags));
+
+			if (nullptr != characteristicEntry.onReadValue) { characteristic.onReadValue(characteristicEntry.onReadValue); }
+			if (nullptr != characteristicEntry.onWriteValue) { characteristic.onWriteValue(characteristicEntry.onWriteValue); }
+			if (nullptr != characteristicEntry.onUpdatedValue) { characteristic.onUpdatedValue(characteristicEntry.onUpdatedValue); }
+
+			for (size_t d = 0; d < characteristicEntry.descriptorCount; ++d)
+			{
+				const GattTableDescriptor &descriptorEntry = characteristicEntry.pDescriptors[d];
+				GattDescriptor &descriptor = characteristic.gattDescriptorBegin(descriptorEntry.pPathElement, descriptorEntry.uuid,
+					flagStrings(descriptorEntry.flags));
+
+				if (nullptr != descriptorEntry.onReadValue) { descriptor.onReadValue(descriptorEntry.onReadValue); }
+				if (nullptr != descriptorEntry.onWriteValue) { descriptor.onWriteValue(descriptorEntry.onWriteValue); }
+			}
+		}
+	}
+}
+
+}; // namespace ggk
@@ -0,0 +1,158 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Static tables for describing GATT services at compile time
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of GattTable.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "GattUuid.h"
+#include "GattCharacteristic.h"
+#include "GattDescriptor.h"
+
+namespace ggk {
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Forward declarations
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+struct DBusObject;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Characteristic and descriptor flags
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// The BlueZ flags for characteristics and descriptors, as bits that can be combined with `|` (see
+// `GattService::gattCharacteristicBegin()` for what each one means)
+enum GattTableFlag : uint32_t
+{
+	EGattFlagBroadcast                 = 1 << 0,
+	EGattFlagRead                      = 1 << 1,
+	EGattFlagWriteWithoutResponse      = 1 << 2,
+	EGattFlagWrite                     = 1 << 3,
+	EGattFlagNotify                    = 1 << 4,
+	EGattFlagIndicate                  = 1 << 5,
+	EGattFlagAuthenticatedSignedWrites = 1 << 6,
+	EGattFlagReliableWrite             = 1 << 7,
+	EGattFlagWritableAuxiliaries       = 1 << 8,
+	EGattFlagEncryptRead               = 1 << 9,
+	EGattFlagEncryptWrite              = 1 << 10,
+	EGattFlagEncryptAuthenticatedRead  = 1 << 11,
+	EGattFlagEncryptAuthenticatedWrite = 1 << 12,
+	EGattFlagSecureRead                = 1 << 13,
+	EGattFlagSecureWrite               = 1 << 14,
+	EGattFlagAuthorize                 = 1 << 15,
+
+	EGattFlagCount                     = 16
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Table entries
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// A descriptor within a `GattTableCharacteristic`
+struct GattTableDescriptor
+{
+	constexpr GattTableDescriptor(const char *pPathElement, GattUuid uuid, uint32_t flags,
+		GattDescriptor::MethodCallback onReadValue = nullptr, GattDescriptor::MethodCallback onWriteValue = nullptr)
+	: pPathElement(pPathElement), uuid(uuid), flags(flags), onReadValue(onReadValue), onWriteValue(onWriteValue)
+	{
+	}
+
+	const char *pPathElement;
+	GattUuid uuid;
+	uint32_t flags;
+	GattDescriptor::MethodCallback onReadValue;
+	GattDescriptor::MethodCallback onWriteValue;
+};
+
+// A characteristic within a `GattTableService`
+//
+// Descriptors, if any, are given as a static array following the callbacks.
+struct GattTableCharacteristic
+{
+	constexpr GattTableCharacteristic(const char *pPathElement, GattUuid uuid, uint32_t flags,
+		GattCharacteristic::MethodCallback onReadValue = nullptr, GattCharacteristic::MethodCallback onWriteValue = nullptr,
+		GattCharacteristic::UpdatedValueCallback onUpdatedValue = nullptr)
+	: pPathElement(pPathElement), uuid(uuid), flags(flags), onReadValue(onReadValue), onWriteValue(onWriteValue),
+	  onUpdatedValue(onUpdatedValue), pDescriptors(nullptr), descriptorCount(0)
+	{
+	}
+
+	template<size_t N>
+	constexpr GattTableCharacteristic(const char *pPathElement, GattUuid uuid, uint32_t flags,
+		GattCharacteristic::MethodCallback onReadValue, GattCharacteristic::MethodCallback onWriteValue,
+		GattCharacteristic::UpdatedValueCallback onUpdatedValue, const GattTableDescriptor (&descriptors)[N])
+	: pPathElement(pPathElement), uuid(uuid), flags(flags), onReadValue(onReadValue), onWriteValue(onWriteValue),
+	  onUpdatedValue(onUpdatedValue), pDescriptors(descriptors), descriptorCount(N)
+	{
+	}
+
+	const char *pPathElement;
+	GattUuid uuid;
+	uint32_t flags;
+	GattCharacteristic::MethodCallback onReadValue;
+	GattCharacteristic::MethodCallback onWriteValue;
+	GattCharacteristic::UpdatedValueCallback onUpdatedValue;
+	const GattTableDescriptor *pDescriptors;
+	size_t descriptorCount;
+};
+
+// A service and its characteristics
+struct GattTableService
+{
+	template<size_t N>
+	constexpr GattTableService(const char *pPathElement, GattUuid uuid, const GattTableCharacteristic (&characteristics)[N])
+	: pPathElement(pPathElement), uuid(uuid), pCharacteristics(characteristics), characteristicCount(N)
+	{
+	}
+
+	const char *pPathElement;
+	GattUuid uuid;
+	const GattTableCharacteristic *pCharacteristics;
+	size_t characteristicCount;
+};
+
+// A set of services, as added to a server with `DBusObject::gattTable()`
+struct GattTable
+{
+	template<size_t N>
+	constexpr GattTable(const GattTableService (&services)[N])
+	: pServices(services), serviceCount(N)
+	{
+	}
+
+	// Returns the BlueZ flag strings for a set of `GattTableFlag` bits
+	static std::vector<const char *> flagStrings(uint32_t flags);
+
+	// Adds the services described by this table to `root`
+	//
+	// The result is the same as describing each service with `gattServiceBegin()` and friends.
+	void build(DBusObject &root) const;
+
+	const GattTableService *pServices;
+	size_t serviceCount;
+};
+
+}; // namespace ggk
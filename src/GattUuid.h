@@ -42,85 +42,56 @@
 // character string will be treated as a 128-bit GATT UUID.
 //
 // When specifying your UUIDs, feel free to use the format that suits you best (with or without dashes, dots in place of dashes,
-// etc.) The string will first be sanitized, removing all non-hex characters, and then re-formatted appropriately with the dashes
-// in their standard places: "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx".
+// etc.) All non-hex characters are ignored, and the string forms (see `toString128()`) always have the dashes in their standard
+// places: "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx".
+//
+// A GattUuid holds its 128-bit value as 16 bytes (in the order they are written) rather than as a string. The string forms are
+// only built when they are asked for, which is generally once per UUID, when the server's properties are created. The
+// constructors are all `constexpr`, so a UUID built from a literal (like "2A19") can be parsed entirely at compile time:
+//
+//     constexpr GattUuid kBatteryLevel("2A19");
+//
+// Being C++11, the parsing is done with recursive single-expression functions, which is why it reads a little unusually.
 //
 // By represetng a UUID in a custom class like this, we are able to give a UUID its own type, and use type safety to ensure that we
 // don't confuse regular strings with GATT UUIDs throughout the codebase.
-// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #pragma once
 
 #include <string>
-#include <algorithm>
+#include <stddef.h>
 #include <stdint.h>
-#include <ctype.h>
-
-#include <iostream>
-#include "Logger.h"
+#include <string.h>
 
 namespace ggk {
 
 // "0000180A-0000-1000-8000-00805f9b34fb"
 struct GattUuid
 {
-	static constexpr const char *kGattStandardUuidPart1Prefix = "0000";
-	static constexpr const char *kGattStandardUuidSuffix = "-0000-1000-8000-00805f9b34fb";
+	// The number of bytes in a UUID
+	static const int kByteCount = 16;
 
 	// Construct a GattUuid from a partial or complete string UUID
 	//
-	// This constructor will do the best it can with the data it is given. It will first clean the input by removing all non-hex
-	// characters (see `clean`) and the remaining characters are processed in the following way:
-	//
-	//     4-character string is treated as a 16-bit UUID
-	//     8-character string is treated as a 32-bit UUID
-	//     32-character string is treated as a 128-bit UUID
+	// All non-hex characters are ignored, and the remaining hex digits are processed in the following way:
 	//
-	// If the input string is not one of the above lengths, the  UUID will be left uninitialized as an empty string with a bit
-	// count of 0.
+	//     4 digits are treated as a 16-bit UUID
+	//     8 digits are treated as a 32-bit UUID
+	//     32 digits are treated as a 128-bit UUID
 	//
-	// Finally, dashes are inserted into the string at the appropriate locations (see `dashify`).
-	GattUuid(const char *strUuid)
+	// If the input is not one of the above lengths, the UUID will be left uninitialized (all zeros) with a bit count of 0.
+	constexpr GattUuid(const char *strUuid)
+	: GattUuid(strUuid, hexDigitCount(strUuid))
 	{
-		*this = GattUuid(std::string(strUuid));
 	}
 
 	// Construct a GattUuid from a partial or complete string UUID
 	//
-	// This constructor will do the best it can with the data it is given. It will first clean the input by removing all non-hex
-	// characters (see `clean`) and the remaining characters are processed in the following way:
-	//
-	//     4-character string is treated as a 16-bit UUID
-	//     8-character string is treated as a 32-bit UUID
-	//     32-character string is treated as a 128-bit UUID
-	//
-	// If the input string is not one of the above lengths, the  UUID will be left uninitialized as an empty string with a bit
-	// count of 0.
-	//
-	// Finally, dashes are inserted into the string at the appropriate locations (see `dashify`).
-	GattUuid(std::string strUuid)
+	// See the `const char *` form, above.
+	GattUuid(const std::string &strUuid)
+	: GattUuid(strUuid.c_str())
 	{
-		// Clean the string
-		strUuid = clean(strUuid);
-
-		// It's hex, so each character represents 4 bits
-		bitCount = strUuid.length() * 4;
-
-		if (bitCount == 16)
-		{
-			strUuid = kGattStandardUuidPart1Prefix + strUuid + kGattStandardUuidSuffix;
-		}
-		else if (bitCount == 32)
-		{
-			strUuid += kGattStandardUuidSuffix;
-		}
-		else if (bitCount != 128)
-		{
-			bitCount = 0;
-			strUuid = "";
-		}
-
-		uuid = dashify(strUuid);
 	}
 
 	// Constructs a GattUuid from a 16-bit Uuid value
@@ -130,12 +101,9 @@ struct GattUuid
 	//     0000????-0000-1000-8000-00805f9b34fb
 	//
 	// ...where "????" is replaced by the 4-digit hex value of `part`
-	GattUuid(const uint16_t part)
+	constexpr GattUuid(const uint16_t part)
+	: bytes{0, 0, byte(part, 1), byte(part, 0), 0, 0, 0x10, 0, 0x80, 0, 0, 0x80, 0x5f, 0x9b, 0x34, 0xfb}, bitCount(16)
 	{
-		bitCount = 16;
-		char partStr[5];
-		snprintf(partStr, sizeof(partStr), "%04x", part);
-		uuid = std::string(kGattStandardUuidPart1Prefix) + partStr + kGattStandardUuidSuffix;
 	}
 
 	// Constructs a GattUuid from a 32-bit Uuid value
@@ -145,12 +113,10 @@ struct GattUuid
 	//     ????????-0000-1000-8000-00805f9b34fb
 	//
 	// ...where "????????" is replaced by the 8-digit hex value of `part`
-	GattUuid(const uint32_t part)
+	constexpr GattUuid(const uint32_t part)
+	: bytes{byte(part, 3), byte(part, 2), byte(part, 1), byte(part, 0), 0, 0, 0x10, 0, 0x80, 0, 0, 0x80, 0x5f, 0x9b, 0x34, 0xfb},
+	  bitCount(32)
 	{
-		bitCount = 32;
-		char partStr[9];
-		snprintf(partStr, sizeof(partStr), "%08x", part);
-		uuid = std::string(partStr) + kGattStandardUuidSuffix;
 	}
 
 	// Constructs a GattUuid from a 5-part set of input values
@@ -163,32 +129,37 @@ struct GattUuid
 	//
 	// Note that `part5` is a 48-bit value and will be masked such that only the lower 48-bits of `part5` are used with all other
 	// bits ignored.
-	GattUuid(const uint32_t part1, const uint16_t part2, const uint16_t part3, const uint16_t part4, const uint64_t part5)
+	constexpr GattUuid(const uint32_t part1, const uint16_t part2, const uint16_t part3, const uint16_t part4, const uint64_t part5)
+	: bytes{byte(part1, 3), byte(part1, 2), byte(part1, 1), byte(part1, 0), byte(part2, 1), byte(part2, 0), byte(part3, 1),
+	        byte(part3, 0), byte(part4, 1), byte(part4, 0), byte(part5, 5), byte(part5, 4), byte(part5, 3), byte(part5, 2),
+	        byte(part5, 1), byte(part5, 0)},
+	  bitCount(128)
 	{
-		bitCount = 128;
-		char partsStr[37];
-		uint32_t part5a = (part5 >> 4) & 0xffffffff;
-		uint32_t part5b = part5 & 0xffff;
-		snprintf(partsStr, sizeof(partsStr), "%08x-%04x-%04x-%04x-%08x%04x", part1, part2, part3, part4, part5a, part5b);
-		uuid = std::string(partsStr);
 	}
 
 	// Returns the bit count of the input when the GattUuid was constructed. Valid values are 16, 32, 128.
 	//
 	// If the GattUuid was constructed imporperly, this method will return 0.
-	int getBitCount() const
+	constexpr int getBitCount() const
 	{
 		return bitCount;
 	}
 
+	// Returns the 16 bytes of the full 128-bit UUID, in the order they are written
+	const uint8_t *getBytes() const
+	{
+		return bytes;
+	}
+
 	// Returns the 16-bit portion of the GATT UUID or an empty string if the GattUuid was not created correctly
 	//
 	// Note that a 16-bit GATT UUID is only valid for standarg GATT UUIDs (prefixed with "0000" and ending with
 	// "0000-1000-8000-00805f9b34fb").
 	std::string toString16() const
 	{
-		if (uuid.empty()) { return uuid; }
-		return uuid.substr(4, 4);
+		std::string str;
+		if (bitCount != 0) { appendHex(str, 2, 2); }
+		return str;
 	}
 
 	// Returns the 32-bit portion of the GATT UUID or an empty string if the GattUuid was not created correctly
@@ -196,14 +167,29 @@ struct GattUuid
 	// Note that a 32-bit GATT UUID is only valid for standarg GATT UUIDs (ending with "0000-1000-8000-00805f9b34fb").
 	std::string toString32() const
 	{
-		if (uuid.empty()) { return uuid; }
-		return uuid.substr(0, 8);
+		std::string str;
+		if (bitCount != 0) { appendHex(str, 0, 4); }
+		return str;
 	}
 
 	// Returns the full 128-bit GATT UUID or an empty string if the GattUuid was not created correctly
 	std::string toString128() const
 	{
-		return uuid;
+		std::string str;
+		if (bitCount != 0)
+		{
+			str.reserve(36);
+			appendHex(str, 0, 4);
+			str += '-';
+			appendHex(str, 4, 2);
+			str += '-';
+			appendHex(str, 6, 2);
+			str += '-';
+			appendHex(str, 8, 2);
+			str += '-';
+			appendHex(str, 10, 6);
+		}
+		return str;
 	}
 
 	// Returns a string form of the UUID, based on the bit count used when the UUID was created. A 16-bit UUID will return a
@@ -216,60 +202,97 @@ struct GattUuid
 		return toString128();
 	}
 
-	// Returns a new string containing the lower case contents of `strUuid` with all non-hex characters (0-9, A-F) removed
-	static std::string clean(const std::string &strUuid)
+	// Two UUIDs are equal if they have the same 128-bit value, however they were written
+	bool operator ==(const GattUuid &rhs) const
 	{
-		if (strUuid.empty()) return strUuid;
+		return memcmp(bytes, rhs.bytes, sizeof(bytes)) == 0 && (bitCount == 0) == (rhs.bitCount == 0);
+	}
 
-		// Lower case
-		std::string cleanStr = strUuid;
-		std::transform(cleanStr.begin(), cleanStr.end(), cleanStr.begin(), ::tolower);
+	bool operator !=(const GattUuid &rhs) const
+	{
+		return !(*this == rhs);
+	}
 
-		// Remove all non-hex characters
-		cleanStr.erase
-		(
-			std::remove_if
-			(
-				cleanStr.begin(), 
-				cleanStr.end(),
-				[](char c)
-				{
-					return !((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'));
-				}
-			), cleanStr.end()
-		);
+private:
 
-		return cleanStr;
+	// Builds the UUID from `strUuid`, which contains `digitCount` hex digits
+	constexpr GattUuid(const char *strUuid, size_t digitCount)
+	: bytes{parsedByte(strUuid, digitCount, 0), parsedByte(strUuid, digitCount, 1), parsedByte(strUuid, digitCount, 2),
+	        parsedByte(strUuid, digitCount, 3), parsedByte(strUuid, digitCount, 4), parsedByte(strUuid, digitCount, 5),
+	        parsedByte(strUuid, digitCount, 6), parsedByte(strUuid, digitCount, 7), parsedByte(strUuid, digitCount, 8),
+	        parsedByte(strUuid, digitCount, 9), parsedByte(strUuid, digitCount, 10), parsedByte(strUuid, digitCount, 11),
+	        parsedByte(strUuid, digitCount, 12), parsedByte(strUuid, digitCount, 13), parsedByte(strUuid, digitCount, 14),
+	        parsedByte(strUuid, digitCount, 15)},
+	  bitCount(digitCount == 4 || digitCount == 8 || digitCount == 32 ? static_cast<int>(digitCount) * 4 : 0)
+	{
 	}
 
-	// Returns a clean string (see `clean`) that has dashes ('-') inserted at the proper locations. If the string is not a full
-	// UUID, this routine will cleanup and add as many dashes as possible until it runs out of characters.
-	//
-	// Example transforms:
-	//
-	//     "0000180A-0000-1000-8000-00805f9b34fb"        -> "0000180a-0000-1000-8000-00805f9b34fb"
-	//     "0000180A00001000800000805f9b34fb"            -> "0000180a-0000-1000-8000-00805f9b34fb"
-	//     "0000180A/0000.1000_zzzzzz_8000+00805f9b34fb" -> "0000180a-0000-1000-8000-00805f9b34fb"
-	//     "0000180A"                                    -> "0000180a"
-	//     "0000180A.0000.100"                           -> "0000180a-0000-100"
-	//     "rqzp"                                        -> ""
-	//
-	static std::string dashify(const std::string &str)
+	// Returns byte `index` (0 being the least significant) of `value`
+	static constexpr uint8_t byte(uint64_t value, int index)
 	{
-		// Ensure we have a clean string to start with
-		std::string dashed = clean(str);
+		return static_cast<uint8_t>(value >> (index * 8));
+	}
 
-		// Add each dash, provided there are enough characters
-		if (dashed.length() > 8) { dashed.insert(8, 1, '-'); }
-		if (dashed.length() > 13) { dashed.insert(13, 1, '-'); }
-		if (dashed.length() > 18) { dashed.insert(18, 1, '-'); }
-		if (dashed.length() > 23) { dashed.insert(23, 1, '-'); }
-		return dashed;
+	// Returns true if `c` is a hex digit
+	static constexpr bool isHexDigit(char c)
+	{
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
 	}
 
-private:
+	// Returns the value of the hex digit `c`
+	static constexpr int hexDigitValue(char c)
+	{
+		return c <= '9' ? c - '0' : c <= 'F' ? c - 'A' + 10 : c - 'a' + 10;
+	}
+
+	// Returns the number of hex digits in `str`
+	static constexpr size_t hexDigitCount(const char *str)
+	{
+		return *str == 0 ? 0 : (isHexDigit(*str) ? 1 : 0) + hexDigitCount(str + 1);
+	}
+
+	// Returns the value of hex digit number `index` in `str`, skipping over any characters that aren't hex digits
+	static constexpr int hexDigit(const char *str, size_t index)
+	{
+		return *str == 0 ? 0 : !isHexDigit(*str) ? hexDigit(str + 1, index) : index == 0 ? hexDigitValue(*str) : hexDigit(str + 1, index - 1);
+	}
+
+	// Returns the byte made from hex digits `2 * index` and `2 * index + 1` in `str`
+	static constexpr uint8_t hexByte(const char *str, int index)
+	{
+		return static_cast<uint8_t>((hexDigit(str, index * 2) << 4) | hexDigit(str, index * 2 + 1));
+	}
+
+	// Returns byte `index` of the Bluetooth Base UUID (00000000-0000-1000-8000-00805f9b34fb)
+	static constexpr uint8_t baseByte(int index)
+	{
+		return index == 6 ? 0x10 : index == 8 ? 0x80 : index == 11 ? 0x80 : index == 12 ? 0x5f : index == 13 ? 0x9b :
+			index == 14 ? 0x34 : index == 15 ? 0xfb : 0;
+	}
+
+	// Returns byte `index` of the UUID written in `str`, which contains `digitCount` hex digits
+	//
+	// 16- and 32-bit UUIDs are placed in the Base UUID. Invalid lengths produce all zeros.
+	static constexpr uint8_t parsedByte(const char *str, size_t digitCount, int index)
+	{
+		return digitCount == 32 ? hexByte(str, index) :
+			digitCount == 8 ? (index < 4 ? hexByte(str, index) : baseByte(index)) :
+			digitCount == 4 ? (index < 2 ? 0 : index < 4 ? hexByte(str, index - 2) : baseByte(index)) :
+			0;
+	}
+
+	// Appends `count` bytes, starting at `first`, to `str` as lower case hex
+	void appendHex(std::string &str, int first, int count) const
+	{
+		static const char kDigits[] = "0123456789abcdef";
+		for (int i = first; i < first + count; ++i)
+		{
+			str += kDigits[bytes[i] >> 4];
+			str += kDigits[bytes[i] & 0xf];
+		}
+	}
 
-	std::string uuid;
+	uint8_t bytes[kByteCount];
 	int bitCount;
 };
 
@@ -38,12 +38,19 @@
 #include <string>
 #include <thread>
 #include <memory>
-#include <deque>
-#include <mutex>
+#include <vector>
+#include <chrono>
 
 #include "Init.h"
 #include "Logger.h"
 #include "Server.h"
+#include "GattCharacteristic.h"
+#include "UpdateQueue.h"
+#include "DataStore.h"
+#include "HciAdapter.h"
+#include "Mgmt.h"
+#include "Stats.h"
+#include "Trace.h"
 
 namespace ggk
 {
@@ -64,24 +71,68 @@ namespace ggk
 	static GPrintFunc printerrHandlerGLib;
 	static GLogFunc logHandlerGLib;
 
-	// Our update queue
-	typedef std::tuple<std::string, std::string> QueueEntry;
-	std::deque<QueueEntry> updateQueue;
-	std::mutex updateQueueMutex;
-
 	// Internal method to set the run state of the server
 	void setServerRunState(GGKServerRunState newState)
 	{
-		Logger::status(SSTR << "** SERVER RUN STATE CHANGED: " << ggkGetServerRunStateString(serverRunState) << " -> " << ggkGetServerRunStateString(newState));
+		GGK_LOG_STATUS(SSTR << "** SERVER RUN STATE CHANGED: " << ggkGetServerRunStateString(serverRunState) << " -> " << ggkGetServerRunStateString(newState));
 		serverRunState = newState;
 	}
 
 	// Internal method to set the health of the server
 	void setServerHealth(GGKServerHealth newHealth)
 	{
-		Logger::status(SSTR << "** SERVER HEALTH CHANGED: " << ggkGetServerHealthString(serverHealth) << " -> " << ggkGetServerHealthString(newHealth));
+		GGK_LOG_STATUS(SSTR << "** SERVER HEALTH CHANGED: " << ggkGetServerHealthString(serverHealth) << " -> " << ggkGetServerHealthString(newHealth));
 		serverHealth = newHealth;
 	}
+
+	// Internal method to add `pServer` (for another controller) to the server that is already running
+	//
+	// Blocks for up to maxAsyncInitTimeoutMS milliseconds until BlueZ has accepted the new server's GATT application. Returns
+	// non-zero on success (see `ggkStartOnController()`)
+	static int startAdditionalServer(const std::shared_ptr<Server> &pServer, int maxAsyncInitTimeoutMS)
+	{
+		// Every server needs its own controller and its own owned name
+		for (const std::shared_ptr<Server> &pExisting : *getServers())
+		{
+			if (pExisting->getControllerIndex() == pServer->getControllerIndex())
+			{
+				GGK_LOG_ERROR(SSTR << "A server is already running on hci" << pServer->getControllerIndex());
+				return 0;
+			}
+
+			if (pExisting->getServiceName() == pServer->getServiceName())
+			{
+				GGK_LOG_ERROR(SSTR << "A server named '" << pServer->getServiceName() << "' is already running");
+				return 0;
+			}
+		}
+
+		if (!addServer(pServer))
+		{
+			GGK_LOG_ERROR(SSTR << "Unable to start more than " << Server::kMaxServers << " servers");
+			return 0;
+		}
+
+		GGK_LOG_INFO(SSTR << "Starting GGK server '" << pServer->getAdvertisingName() << "' on hci" << pServer->getControllerIndex());
+		initializeAddedServers();
+
+		// Wait for BlueZ to accept the application (or for the whole server to stop)
+		int retryTimeMS = 0;
+		while (retryTimeMS < maxAsyncInitTimeoutMS && ggkGetServerRunState() <= ERunning && !pServer->isApplicationRegistered())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(kMaxAsyncInitCheckIntervalMS));
+			retryTimeMS += kMaxAsyncInitCheckIntervalMS;
+		}
+
+		if (!pServer->isApplicationRegistered())
+		{
+			GGK_LOG_ERROR(SSTR << "GGK server initialization on hci" << pServer->getControllerIndex() << " did not complete");
+			return 0;
+		}
+
+		GGK_LOG_TRACE(SSTR << "GGK server has started on hci" << pServer->getControllerIndex());
+		return 1;
+	}
 }; // namespace ggk
 
 using namespace ggk;
@@ -105,6 +156,46 @@ void ggkLogRegisterFatal(GGKLogReceiver receiver) { Logger::registerFatalReceive
 void ggkLogRegisterTrace(GGKLogReceiver receiver) { Logger::registerTraceReceiver(receiver); }
 void ggkLogRegisterAlways(GGKLogReceiver receiver) { Logger::registerAlwaysReceiver(receiver); }
 
+// Enables or disables asynchronous delivery of log messages
+//
+// Log receivers are normally called on whichever thread logs the message, including the server's own threads, so a slow
+// receiver will slow down the server. With asynchronous delivery enabled, messages are queued and a background thread calls
+// the receivers instead. Up to `capacity` messages can be waiting at once (0 selects the default of 1024); messages logged
+// while the queue is full are dropped (see `ggkLogAsyncDroppedCount`.) Queued messages longer than 1023 characters are
+// truncated.
+//
+// Disabling asynchronous delivery delivers any waiting messages before returning.
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkLogSetAsync(int enable, int capacity)
+{
+	if (capacity < 0)
+	{
+		return 0;
+	}
+
+	if (capacity == 0)
+	{
+		return Logger::setAsync(enable != 0) ? 1 : 0;
+	}
+
+	return Logger::setAsync(enable != 0, static_cast<size_t>(capacity)) ? 1 : 0;
+}
+
+// Blocks until all waiting log messages have been delivered (this does nothing unless asynchronous delivery is enabled)
+//
+// This is called automatically by `ggkShutdownAndWait()`.
+void ggkLogFlush()
+{
+	Logger::flush();
+}
+
+// Returns the number of log messages that have been dropped because the asynchronous queue was full
+int ggkLogAsyncDroppedCount()
+{
+	return static_cast<int>(Logger::getAsyncDroppedCount());
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 //  _   _           _       _                                                                                                     _
 // | | | |_ __   __| | __ _| |_ ___     __ _ _   _  ___ _   _  ___    _ __ ___   __ _ _ __   __ _  __ _  ___ _ __ ___   ___ _ __ | |_
@@ -136,13 +227,37 @@ int ggkNofifyUpdatedDescriptor(const char *pObjectPath)
 // Adds a named update to the front of the queue. Generally, this routine should not be used directly. Instead, use the
 // `ggkNofifyUpdatedCharacteristic()` instead.
 //
+// If coalescing is enabled (see `ggkUpdateQueueSetCoalescing`) and an update for the same object path and interface is already
+// waiting in the queue, the new update is merged with the existing one and the queue is left unchanged.
+//
+// This method never blocks on the server thread, whether or not coalescing is enabled. If the queue is full, the configured
+// policy is applied (see `ggkUpdateQueueConfigure`.)
+//
 // Returns non-zero value on success or 0 on failure.
 int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName)
 {
-	QueueEntry t(pObjectPath, pInterfaceName);
+	if (nullptr == pObjectPath || nullptr == pInterfaceName)
+	{
+		return 0;
+	}
+
+	if (Trace::isEnabled())
+	{
+		Trace::getInstance().record(ETraceUpdate, pObjectPath, pInterfaceName, "", nullptr);
+	}
+
+	UpdateQueue &queue = UpdateQueue::getInstance();
+	if (!queue.push(pObjectPath, pInterfaceName))
+	{
+		return 0;
+	}
+
+	// Only the first entry needs to wake the server; the rest will be drained along with it
+	if (queue.claimWakeup())
+	{
+		wakeUpdateQueue();
+	}
 
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	updateQueue.push_front(t);
 	return 1;
 }
 
@@ -158,30 +273,48 @@ int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName)
 // If `keep` is set to non-zero, the entry is not removed and will be retrieved again on the next call. Otherwise, the element
 // is removed.
 //
+// Updates for handles that no longer resolve to a characteristic (see `ggkResolveCharacteristic()`) are discarded along the way.
+//
 // Returns 1 on success, 0 if the queue is empty, -1 on error (such as the length too small to store the element)
 int ggkPopUpdateQueue(char *pElementBuffer, int elementLen, int keep)
 {
-	std::string result;
+	UpdateQueue &queue = UpdateQueue::getInstance();
 
+	// Peek at the next element; we only remove it once we know it fits
+	UpdateQueue::Entry entry;
+	std::string result;
+	for (;;)
 	{
-		std::lock_guard<std::mutex> guard(updateQueueMutex);
+		if (!queue.pop(entry, true))
+		{
+			return 0;
+		}
 
-		// Check for an empty queue
-		if (updateQueue.empty()) { return 0; }
+		if (entry.handle == 0)
+		{
+			result = entry.objectPath + "|" + entry.interfaceName;
+			break;
+		}
 
-		// Get the last element
-		QueueEntry t = updateQueue.back();
+		// Handle updates are reported in the same format
+		std::shared_ptr<const GattCharacteristic> pCharacteristic = getResolvedCharacteristic(entry.handle);
+		if (nullptr != pCharacteristic)
+		{
+			result = pCharacteristic->getPath().toString() + "|" + pCharacteristic->getName();
+			break;
+		}
 
-		// Get the result string
-		result = std::get<0>(t) + "|" + std::get<1>(t);
+		// The handle no longer resolves (its server has gone away), so there's nothing to report; discard it and move on
+		GGK_LOG_DEBUG(SSTR << "Discarding update for unresolved handle " << entry.handle);
+		queue.pop(entry, false);
+	}
 
-		// Ensure there's enough room for it
-		if (result.length() + 1 > static_cast<size_t>(elementLen)) { return -1; }
+	// Ensure there's enough room for it
+	if (result.length() + 1 > static_cast<size_t>(elementLen)) { return -1; }
 
-		if (keep == 0)
-		{
-			updateQueue.pop_back();
-		}
+	if (keep == 0)
+	{
+		queue.pop(entry, false);
 	}
 
 	// Copy the element string
@@ -193,22 +326,590 @@ int ggkPopUpdateQueue(char *pElementBuffer, int elementLen, int keep)
 // Returns 1 if the queue is empty, otherwise 0
 int ggkUpdateQueueIsEmpty()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	return updateQueue.empty() ? 1 : 0;
+	return UpdateQueue::getInstance().empty() ? 1 : 0;
 }
 
 // Returns the number of entries waiting in the queue
 int ggkUpdateQueueSize()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	return updateQueue.size();
+	return UpdateQueue::getInstance().size();
+}
+
+// Returns the largest number of entries that have been waiting in the queue at one time
+int ggkUpdateQueueHighWaterMark()
+{
+	return UpdateQueue::getInstance().getHighWaterMark();
 }
 
-// Removes all entries from the queue
+// Removes all entries from the queue (this also resets the queue's high-water mark)
 void ggkUpdateQueueClear()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	updateQueue.clear();
+	UpdateQueue::getInstance().clear();
+}
+
+// Sets the capacity of the update queue and the policy to apply when it is full
+//
+// The queue is bounded so that pushing an update never allocates queue storage or blocks. By default, the queue holds 4096
+// entries and uses `EUpdateQueueDropNewest`. The capacity is rounded up to the next power of two.
+//
+// This discards any pending updates, so it should be called before `ggkStart()`. It will fail if the server is running.
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkUpdateQueueConfigure(int capacity, enum GGKUpdateQueuePolicy policy)
+{
+	if (capacity <= 0 || (ggkGetServerRunState() != EUninitialized && ggkGetServerRunState() != EStopped))
+	{
+		return 0;
+	}
+
+	return UpdateQueue::getInstance().configure(capacity, policy) ? 1 : 0;
+}
+
+// Enables (non-zero) or disables (0) coalescing of updates
+//
+// When enabled, the queue holds at most one pending entry for any (object path, interface) pair. Additional updates for an entry
+// that is already waiting are merged into it, so a fast producer will generate at most one change notification per
+// characteristic each time the server drains the queue. Coalescing is disabled by default.
+//
+// Up to 4096 distinct (object path, interface) pairs can be coalesced; updates for pairs beyond that are queued as they come.
+void ggkUpdateQueueSetCoalescing(int enable)
+{
+	UpdateQueue::getInstance().setCoalescing(enable != 0);
+}
+
+// Returns the number of updates that have been merged into an already-pending entry since the server started
+int ggkUpdateQueueCoalescedCount()
+{
+	return UpdateQueue::getInstance().getCoalescedCount();
+}
+
+// Returns the number of updates that have been discarded because the queue was full
+int ggkUpdateQueueDroppedCount()
+{
+	return UpdateQueue::getInstance().getDroppedCount();
+}
+
+// Resolves the characteristic at the given object path to a handle for use with `ggkNotifyHandle()`
+//
+// This performs the object lookup once, so it should be called after `ggkStart()` (typically once per characteristic at
+// startup) and the handle kept for the life of the server.
+//
+// Handles are unique across servers, so the path may belong to any server that has been started.
+//
+// Returns a positive handle on success or 0 on failure (the server isn't started or the path is not a characteristic)
+int ggkResolveCharacteristic(const char *pObjectPath)
+{
+	if (nullptr == pObjectPath)
+	{
+		return 0;
+	}
+
+	// Each server's objects live under its own application path, so only one server can own the path
+	DBusObjectPath objectPath(pObjectPath);
+	for (const std::shared_ptr<Server> &pServer : *getServers())
+	{
+		if (nullptr != pServer->findInterface(objectPath, "org.bluez.GattCharacteristic1"))
+		{
+			return pServer->resolveCharacteristic(objectPath);
+		}
+	}
+
+	GGK_LOG_WARN(SSTR << "Unable to resolve characteristic at path '" << objectPath << "'");
+	return 0;
+}
+
+// Adds an update for the characteristic identified by `handle` (see `ggkResolveCharacteristic()`)
+//
+// This is equivalent to `ggkNofifyUpdatedCharacteristic()`, except the update carries only the integer handle. It does not
+// allocate memory, format strings, search the server description or take any locks (unless a trace is being recorded; see
+// `ggkTraceStart()`.)
+//
+// Returns non-zero value on success or 0 on failure (an invalid handle or the queue is full.)
+int ggkNotifyHandle(int handle)
+{
+	// Traces only know paths, so record the update the way `ggkPushUpdateQueue()` would have
+	if (Trace::isEnabled())
+	{
+		std::shared_ptr<const GattCharacteristic> pCharacteristic = getResolvedCharacteristic(handle);
+		if (nullptr != pCharacteristic)
+		{
+			Trace::getInstance().record(ETraceUpdate, pCharacteristic->getPath().toString().c_str(), pCharacteristic->getName().c_str(), "", nullptr);
+		}
+	}
+
+	UpdateQueue &queue = UpdateQueue::getInstance();
+	if (!queue.pushHandle(handle))
+	{
+		return 0;
+	}
+
+	// Only the first entry needs to wake the server; the rest will be drained along with it
+	if (queue.claimWakeup())
+	{
+		wakeUpdateQueue();
+	}
+
+	return 1;
+}
+
+// Returns 1 if anybody is subscribed to notifications from the characteristic at the given object path, otherwise 0
+//
+// Updates for a characteristic with the "notify" or "indicate" flag are dropped while nobody is subscribed, so a producer may use
+// this to skip preparing data that wouldn't be sent. Characteristics without either flag are never subscribed.
+int ggkIsCharacteristicSubscribed(const char *pObjectPath)
+{
+	if (nullptr == pObjectPath)
+	{
+		return 0;
+	}
+
+	DBusObjectPath objectPath(pObjectPath);
+	for (const std::shared_ptr<Server> &pServer : *getServers())
+	{
+		std::shared_ptr<const DBusInterface> pInterface = pServer->findInterface(objectPath, "org.bluez.GattCharacteristic1");
+		if (nullptr != pInterface)
+		{
+			return std::static_pointer_cast<const GattCharacteristic>(pInterface)->isSubscribed() ? 1 : 0;
+		}
+	}
+
+	return 0;
+}
+
+// Same as `ggkIsCharacteristicSubscribed()`, for the characteristic identified by `handle` (see `ggkResolveCharacteristic()`)
+//
+// This does not allocate memory or search the server description. It isn't strictly lock-free, though: finding the characteristic
+// copies shared pointers with `std::atomic_load`, which libstdc++ guards with a small pool of internal locks. Those are only held
+// for the copy and are never held by the server while it does other work.
+int ggkIsHandleSubscribed(int handle)
+{
+	std::shared_ptr<const GattCharacteristic> pCharacteristic = getResolvedCharacteristic(handle);
+	return nullptr != pCharacteristic && pCharacteristic->isSubscribed() ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____        _              _
+// |  _ \  __ _| |_ __ _   ___| |_ ___  _ __ ___
+// | | | |/ _` | __/ _` | / __| __/ _ \| '__/ _ )
+// | |_| | (_| | || (_| | \__ \ || (_) | | |  __/
+// |____/ \__,_|\__\__,_| |___/\__\___/|_|  \___|
+//
+// Methods for storing values that the server reads in place of calling the application's data getter
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Stores a copy of the `size` bytes at `pData` under the name `pName`, replacing any value already stored under that name
+//
+// Stored values are read back by the server with the same types they would have with the data getter. For non-pointer types
+// (see `getDataValue()` in GattInterface.h) `size` must be the size of that type. For strings, include the null terminator
+// (or use `ggkDataStoreSetString()`.)
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkDataStoreSet(const char *pName, const void *pData, int size)
+{
+	return ggkDataStoreSetKey(ggkDataStoreIntern(pName), pData, size);
+}
+
+// Stores a copy of the null-terminated string `pString` under the name `pName` (see `ggkDataStoreSet()`)
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkDataStoreSetString(const char *pName, const char *pString)
+{
+	if (nullptr == pString)
+	{
+		return 0;
+	}
+
+	return ggkDataStoreSet(pName, pString, static_cast<int>(strlen(pString) + 1));
+}
+
+// Returns the key for the name `pName`, for use with `ggkDataStoreSetKey()`
+//
+// Keys remain valid for the life of the process, so this is typically called once per name at startup. Up to 4096 names can
+// be interned.
+//
+// Returns a positive key on success or 0 on failure.
+int ggkDataStoreIntern(const char *pName)
+{
+	return DataStore::getInstance().intern(pName);
+}
+
+// Same as `ggkDataStoreSet()`, except the value is identified by a key from `ggkDataStoreIntern()`
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkDataStoreSetKey(int key, const void *pData, int size)
+{
+	if (size < 0)
+	{
+		return 0;
+	}
+
+	return DataStore::getInstance().set(key, pData, static_cast<size_t>(size)) != 0 ? 1 : 0;
+}
+
+// Removes the value stored under the name `pName`, so the server goes back to the data getter for it
+//
+// Returns non-zero value if a value was removed or 0 if there was none.
+int ggkDataStoreRemove(const char *pName)
+{
+	return DataStore::getInstance().remove(pName) ? 1 : 0;
+}
+
+// Removes all stored values
+void ggkDataStoreClear()
+{
+	DataStore::getInstance().clear();
+}
+
+// Returns the version of the value stored under the name `pName`, or 0 if there is none
+//
+// Every stored value (including values written to the store by the server on behalf of a client) gets a new version, larger
+// than any version before it. A value has changed if its version has changed.
+unsigned long long ggkDataStoreGetVersion(const char *pName)
+{
+	return DataStore::getInstance().getVersion(pName);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____  _        _   _     _   _
+// / ___|| |_ __ _| |_(_)___| |_(_) ___ ___
+// \___ \| __/ _` | __| / __| __| |/ __/ __|
+//  ___) | || (_| | |_| \__ \ |_| | (__\__ )
+// |____/ \__\__,_|\__|_|___/\__|_|\___|___/
+//
+// Methods for reporting the server's runtime counters (see Stats.cpp)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Convert a `GGKInitPhase` into a human-readable string
+const char *ggkGetInitPhaseString(GGKInitPhase phase)
+{
+	switch(phase)
+	{
+		case EInitPhaseBusAcquire: return "Bus acquire";
+		case EInitPhaseOwnedNameAcquire: return "Owned name acquire";
+		case EInitPhaseObjectManager: return "BlueZ ObjectManager";
+		case EInitPhaseFindAdapter: return "Find adapter";
+		case EInitPhaseConfigureAdapter: return "Configure adapter";
+		case EInitPhaseRegisterObjects: return "Register objects";
+		case EInitPhaseRegisterApplication: return "Register application";
+		default: return "Unknown";
+	}
+}
+
+// Enables (non-zero) or disables (0) recording of statistics
+//
+// Disabling statistics stops recording but leaves the counters as they are.
+void ggkStatsEnable(int enable)
+{
+	Stats::setEnabled(enable != 0);
+}
+
+// Copies the server-wide counters into `pStats`
+//
+// Returns non-zero value on success or 0 on failure (`pStats` is null.)
+int ggkGetStats(struct GGKStats *pStats)
+{
+	if (nullptr == pStats)
+	{
+		return 0;
+	}
+
+	Stats::getInstance().read(*pStats);
+	pStats->updateQueueHighWaterMark = UpdateQueue::getInstance().getHighWaterMark();
+	return 1;
+}
+
+// Copies the counters for the characteristic (or descriptor) at the given object path into `pStats`
+//
+// Returns non-zero value on success or 0 on failure (the server isn't started or the path is not a characteristic or
+// descriptor.)
+int ggkGetCharacteristicStats(const char *pObjectPath, struct GGKCharacteristicStats *pStats)
+{
+	if (nullptr == pObjectPath || nullptr == pStats)
+	{
+		return 0;
+	}
+
+	DBusObjectPath objectPath(pObjectPath);
+	for (const std::shared_ptr<Server> &pServer : *getServers())
+	{
+		for (const char *pInterfaceName : {"org.bluez.GattCharacteristic1", "org.bluez.GattDescriptor1"})
+		{
+			std::shared_ptr<const DBusInterface> pInterface = pServer->findInterface(objectPath, pInterfaceName);
+			if (nullptr != pInterface)
+			{
+				std::static_pointer_cast<const GattInterface>(pInterface)->getStats().read(*pStats);
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// Internal method to reset the counters of every GATT interface in `object` and its descendants
+static void resetInterfaceStats(const DBusObject &object)
+{
+	for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
+	{
+		if (pInterface->isGattInterface())
+		{
+			std::static_pointer_cast<const GattInterface>(pInterface)->getStats().reset();
+		}
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		resetInterfaceStats(child);
+	}
+}
+
+// Resets all counters (server-wide and per-characteristic) to zero
+void ggkStatsReset()
+{
+	Stats::getInstance().reset();
+
+	for (const std::shared_ptr<Server> &pServer : *getServers())
+	{
+		for (const DBusObject &object : pServer->getObjects())
+		{
+			resetInterfaceStats(object);
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   ____                            _   _
+//  / ___|___  _ __  _ __   ___  ___| |_(_) ___  _ __  ___
+// | |   / _ \| '_ \| '_ \ / _ \/ __| __| |/ _ \| '_ \/ __|
+// | |__| (_) | | | | | | |  __/ (__| |_| | (_) | | | \__ )
+//  \____\___/|_| |_|_| |_|\___|\___|\__|_|\___/|_| |_|___/
+//
+// Methods for managing the connections to each controller (see HciAdapter.cpp)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Internal method to copy a Bluetooth address from the Management API's byte order (least significant octet first) to the most
+// significant first order of the public API
+static void copyAddress(unsigned char *pPublicAddress, const uint8_t *pMgmtAddress)
+{
+	for (int octet = 0; octet < 6; ++octet)
+	{
+		pPublicAddress[octet] = pMgmtAddress[5 - octet];
+	}
+}
+
+// Sets the connection policy for the controller at `controllerIndex` (the zero-based index, as in 'hci0'), or clears it if
+// `pPolicy` is null
+//
+// The policy may be set before the controller's server is started, in which case it is applied while the controller is
+// configured, or at any time after, in which case it is applied right away. Its connection parameters are loaded for each
+// device as it connects. Clearing a policy only stops it from being applied from then on.
+//
+// Returns non-zero value on success or 0 on failure (the policy's connection parameters are invalid, or it could not be
+// applied to a running server's controller.)
+int ggkSetConnectionPolicy(int controllerIndex, const struct GGKConnectionPolicy *pPolicy)
+{
+	if (controllerIndex < 0 || controllerIndex >= HciAdapter::kNonController)
+	{
+		GGK_LOG_ERROR(SSTR << "Invalid controller index: " << controllerIndex);
+		return 0;
+	}
+
+	HciAdapter::ConnectionPolicy policy = HciAdapter::ConnectionPolicy();
+	if (nullptr != pPolicy)
+	{
+		policy.minInterval = pPolicy->minInterval;
+		policy.maxInterval = pPolicy->maxInterval;
+		policy.latency = pPolicy->latency;
+		policy.supervisionTimeout = pPolicy->supervisionTimeout;
+		policy.phys = pPolicy->phys;
+	}
+
+	if (!policy.isValid())
+	{
+		GGK_LOG_ERROR(SSTR << "Invalid connection parameters for hci" << controllerIndex << ": interval " << policy.minInterval << "-"
+			<< policy.maxInterval << ", latency " << policy.latency << ", timeout " << policy.supervisionTimeout);
+		return 0;
+	}
+
+	uint16_t index = static_cast<uint16_t>(controllerIndex);
+	HciAdapter::getInstance().setConnectionPolicy(index, policy);
+
+	// A server that's already running has had its controller configured, so apply the policy now
+	if (ggkGetServerRunState() != ERunning)
+	{
+		return 1;
+	}
+
+	for (const std::shared_ptr<Server> &pServer : *getServers())
+	{
+		if (pServer->getControllerIndex() == index)
+		{
+			Mgmt mgmt(index);
+			return mgmt.applyConnectionPolicy(policy) ? 1 : 0;
+		}
+	}
+
+	return 1;
+}
+
+// Copies what is known about up to `maxConnections` devices connected to the controller at `controllerIndex` into
+// `pConnections`
+//
+// Returns the number of connected devices, which may be more than `maxConnections`
+int ggkGetConnectionStats(int controllerIndex, struct GGKConnectionStats *pConnections, int maxConnections)
+{
+	if (controllerIndex < 0 || controllerIndex >= HciAdapter::kNonController)
+	{
+		return 0;
+	}
+
+	std::vector<HciAdapter::Connection> connections = HciAdapter::getInstance().getConnections(static_cast<uint16_t>(controllerIndex));
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	for (int i = 0; nullptr != pConnections && i < maxConnections && i < static_cast<int>(connections.size()); ++i)
+	{
+		const HciAdapter::Connection &connection = connections[i];
+		GGKConnectionStats &stats = pConnections[i];
+
+		copyAddress(stats.address, connection.address);
+		stats.addressType = connection.addressType;
+		stats.mtu = connection.mtu;
+		stats.minInterval = connection.minInterval;
+		stats.maxInterval = connection.maxInterval;
+		stats.latency = connection.latency;
+		stats.supervisionTimeout = connection.supervisionTimeout;
+		stats.selectedPhys = connection.selectedPhys;
+		stats.connectedMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - connection.connected).count();
+	}
+
+	return static_cast<int>(connections.size());
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  _____                 _
+// | ____|_   _____ _ __ | |_ ___
+// |  _| \ \ / / _ \ '_ \| __/ __|
+// | |___ \ V /  __/ | | | |_\__ )
+// |_____| \_/ \___|_| |_|\__|___/
+//
+// Methods for subscribing to adapter events (see HciAdapter::subscribe())
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Internal method to convert an HCI event into an adapter event and hand it to the application's callback
+//
+// The event's size has already been checked against its type by the HciAdapter, so its parameters can be read directly.
+static void deliverAdapterEvent(const HciAdapter::EventView &event, GGKAdapterEventCallback callback, void *pUserData)
+{
+	GGKAdapterEvent adapterEvent;
+	memset(&adapterEvent, 0, sizeof(adapterEvent));
+	adapterEvent.controllerIndex = event.controllerId;
+
+	switch(event.eventCode)
+	{
+		// Both begin with the device's address and address type; a disconnection follows them with its reason
+		case Mgmt::EDeviceConnectedEvent:
+		case Mgmt::EDeviceDisconnectedEvent:
+		{
+			bool connected = event.eventCode == Mgmt::EDeviceConnectedEvent;
+			adapterEvent.type = connected ? EAdapterEventConnected : EAdapterEventDisconnected;
+			copyAddress(adapterEvent.address, event.pParameters);
+			adapterEvent.addressType = event.pParameters[6];
+			adapterEvent.reason = connected ? 0 : event.pParameters[7];
+			break;
+		}
+		case Mgmt::ENewSettingsEvent:
+		{
+			uint32_t settings;
+			memcpy(&settings, event.pParameters, sizeof(settings));
+			adapterEvent.type = EAdapterEventSettingsChanged;
+			adapterEvent.settings = Utils::endianToHost(settings);
+			break;
+		}
+		default:
+		{
+			return;
+		}
+	}
+
+	callback(&adapterEvent, pUserData);
+}
+
+// Calls `callback` (passing `pUserData` along) for every adapter event whose type is in `eventTypes` (a combination of
+// `GGKAdapterEventType` bits)
+//
+// Subscriptions may be made before the server starts; events arrive once it has.
+//
+// Returns an id for `ggkAdapterUnsubscribe()`, or 0 on failure (`callback` is null or `eventTypes` holds no known types)
+int ggkAdapterSubscribe(unsigned int eventTypes, GGKAdapterEventCallback callback, void *pUserData)
+{
+	uint64_t eventMask = 0;
+	if ((eventTypes & EAdapterEventConnected) != 0) { eventMask |= HciAdapter::eventBit(Mgmt::EDeviceConnectedEvent); }
+	if ((eventTypes & EAdapterEventDisconnected) != 0) { eventMask |= HciAdapter::eventBit(Mgmt::EDeviceDisconnectedEvent); }
+	if ((eventTypes & EAdapterEventSettingsChanged) != 0) { eventMask |= HciAdapter::eventBit(Mgmt::ENewSettingsEvent); }
+
+	if (nullptr == callback || 0 == eventMask)
+	{
+		return 0;
+	}
+
+	return HciAdapter::getInstance().subscribe(eventMask, [callback, pUserData](const HciAdapter::EventView &event)
+	{
+		deliverAdapterEvent(event, callback, pUserData);
+	});
+}
+
+// Stops calling the callback subscribed under `subscription`
+//
+// The callback may still be running on the HCI event thread when this returns.
+void ggkAdapterUnsubscribe(int subscription)
+{
+	HciAdapter::getInstance().unsubscribe(subscription);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  _____
+// |_   _| __ __ _  ___ ___  ___
+//   | || '__/ _` |/ __/ _ \/ __|
+//   | || | | (_| | (_|  __/\__ )
+//   |_||_|  \__,_|\___\___||___/
+//
+// Methods for recording the server's D-Bus traffic for later replay (see Trace.cpp)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Starts recording D-Bus GATT traffic to a new trace file at `pFilename`
+//
+// `maxBytes` is the largest the trace file may grow, or 0 for the default (64 MiB.) Any trace already being recorded is stopped
+// first.
+//
+// Returns non-zero value on success or 0 on failure (the file could not be created.)
+int ggkTraceStart(const char *pFilename, unsigned long long maxBytes)
+{
+	if (nullptr == pFilename)
+	{
+		return 0;
+	}
+
+	return Trace::getInstance().start(pFilename, 0 == maxBytes ? Trace::kDefaultMaxBytes : static_cast<size_t>(maxBytes)) ? 1 : 0;
+}
+
+// Stops recording and closes the trace file, trimmed to the records written
+//
+// Does nothing if no trace is being recorded.
+void ggkTraceStop()
+{
+	Trace::getInstance().stop();
+}
+
+// Returns the number of records written to the current (or most recent) trace
+unsigned long long ggkTraceGetRecordCount()
+{
+	return Trace::getInstance().getRecordCount();
+}
+
+// Returns the number of records dropped from the current (or most recent) trace because the trace file was full
+unsigned long long ggkTraceGetDroppedCount()
+{
+	return Trace::getInstance().getDroppedCount();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -314,7 +1015,12 @@ int ggkShutdownAndWait()
 	}
 
 	// Block until it has shut down completely
-	return ggkWait();
+	int result = ggkWait();
+
+	// Make sure everything logged during shutdown reaches the application's receivers
+	ggkLogFlush();
+
+	return result;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -340,7 +1046,7 @@ int ggkWait()
 	{
 		if (ggkGetServerRunState() <= ERunning)
 		{
-			Logger::info("Waiting for GGK server to stop");
+			GGK_LOG_INFO("Waiting for GGK server to stop");
 		}
 
 		if (serverThread.joinable())
@@ -354,19 +1060,19 @@ int ggkWait()
 	{
 		if (ex.code() == std::errc::invalid_argument)
 		{
-			Logger::warn(SSTR << "Server thread was not joinable during ggkWait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Server thread was not joinable during ggkWait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::no_such_process)
 		{
-			Logger::warn(SSTR << "Server thread was not valid during ggkWait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Server thread was not valid during ggkWait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::resource_deadlock_would_occur)
 		{
-			Logger::warn(SSTR << "Deadlock avoided in call to ggkWait() (did the server thread try to stop itself?): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Deadlock avoided in call to ggkWait() (did the server thread try to stop itself?): " << ex.what());
 		}
 		else
 		{
-			Logger::warn(SSTR << "Unknown system_error code (" << ex.code() << ") during ggkWait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Unknown system_error code (" << ex.code() << ") during ggkWait(): " << ex.what());
 		}
 	}
 
@@ -440,9 +1146,46 @@ int ggkWait()
 //
 int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char *pAdvertisingShortName, 
 	GGKServerDataGetter getter, GGKServerDataSetter setter, int maxAsyncInitTimeoutMS)
+{
+	return ggkStartOnController(HciAdapter::kDefaultControllerIndex, pServiceName, pAdvertisingName, pAdvertisingShortName, getter,
+		setter, maxAsyncInitTimeoutMS);
+}
+
+// Same as `ggkStart()`, but the server runs on the Bluetooth controller with the given zero-based index (hci0, hci1, ...)
+//
+// `ggkStart()` is the same as calling this method with a `controllerIndex` of 0.
+//
+// To serve more than one controller from a single process, call this method once for each controller. The first call starts
+// the server just like `ggkStart()`. Each later call (made while the server is running) adds an independent server for
+// another controller and blocks for up to maxAsyncInitTimeoutMS milliseconds until BlueZ has accepted its GATT application.
+//
+// Every server needs its own controller and its own service name, and so its own D-Bus owned name (which must be allowed in
+// the D-Bus permissions.) Object paths include the service name, so updates and handles (see `ggkResolveCharacteristic()`)
+// find their way to the right server. The servers share the server thread, the update queue and the data store, and they are
+// all stopped together (see `ggkTriggerShutdown()`.)
+//
+// Returns a non-zero value on success. If a later call fails, it returns 0 without affecting the servers that are already
+// running (a server that timed out keeps retrying its initialization in the background.)
+int ggkStartOnController(int controllerIndex, const char *pServiceName, const char *pAdvertisingName,
+	const char *pAdvertisingShortName, GGKServerDataGetter getter, GGKServerDataSetter setter, int maxAsyncInitTimeoutMS)
 {
 	try
 	{
+		if (controllerIndex < 0 || controllerIndex >= HciAdapter::kNonController)
+		{
+			GGK_LOG_ERROR(SSTR << "Invalid controller index (" << controllerIndex << ") during ggkStartOnController()");
+			return 0;
+		}
+
+		// If we're already up, this is another server for another controller
+		GGKServerRunState runState = ggkGetServerRunState();
+		if (runState == EInitializing || runState == ERunning)
+		{
+			std::shared_ptr<Server> pServer = std::make_shared<Server>(pServiceName, pAdvertisingName, pAdvertisingShortName,
+				getter, setter, static_cast<uint16_t>(controllerIndex));
+			return startAdditionalServer(pServer, maxAsyncInitTimeoutMS);
+		}
+
 		//
 		// Start by capturing the GLib output
 		//
@@ -450,41 +1193,43 @@ int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char
 		// Redirect GLib output to this log method
 		printHandlerGLib = g_set_print_handler([](const gchar *string)
 		{
-			Logger::info(string);
+			GGK_LOG_INFO(string);
 		});
 		printerrHandlerGLib = g_set_printerr_handler([](const gchar *string)
 		{
-			Logger::error(string);
+			GGK_LOG_ERROR(string);
 		});
 		logHandlerGLib = g_log_set_default_handler([](const gchar *log_domain, GLogLevelFlags log_levels, const gchar *message, gpointer /*user_data*/)
 		{
 			std::string str = std::string(log_domain) + ": " + message;
 			if ((log_levels & (G_LOG_FLAG_RECURSION|G_LOG_FLAG_FATAL)) != 0)
 			{
-				Logger::fatal(str);
+				GGK_LOG_FATAL(str);
 			}
 			else if ((log_levels & (G_LOG_LEVEL_CRITICAL|G_LOG_LEVEL_ERROR)) != 0)
 			{
-				Logger::error(str);
+				GGK_LOG_ERROR(str);
 			}
 			else if ((log_levels & G_LOG_LEVEL_WARNING) != 0)
 			{
-				Logger::warn(str);
+				GGK_LOG_WARN(str);
 			}
 			else if ((log_levels & G_LOG_LEVEL_DEBUG) != 0)
 			{
-				Logger::debug(str);
+				GGK_LOG_DEBUG(str);
 			}
 			else
 			{
-				Logger::info(str);
+				GGK_LOG_INFO(str);
 			}
 		}, nullptr);
 
-		Logger::info(SSTR << "Starting GGK server '" << pAdvertisingName << "'");
+		GGK_LOG_INFO(SSTR << "Starting GGK server '" << pAdvertisingName << "'");
 
-		// Allocate our server
-		TheServer = std::make_shared<Server>(pServiceName, pAdvertisingName, pAdvertisingShortName, getter, setter);
+		// Allocate our server (this also makes it `TheServer`)
+		clearServers();
+		addServer(std::make_shared<Server>(pServiceName, pAdvertisingName, pAdvertisingShortName, getter, setter,
+			static_cast<uint16_t>(controllerIndex)));
 
 		// Start our server thread
 		try
@@ -493,7 +1238,7 @@ int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char
 		}
 		catch(std::system_error &ex)
 		{
-			Logger::error(SSTR << "Server thread was unable to start (code " << ex.code() << ") during ggkStart(): " << ex.what());
+			GGK_LOG_ERROR(SSTR << "Server thread was unable to start (code " << ex.code() << ") during ggkStart(): " << ex.what());
 
 			setServerRunState(EStopped);
 			return 0;
@@ -510,7 +1255,7 @@ int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char
 		// If something went wrong, shut down
 		if (retryTimeMS >= maxAsyncInitTimeoutMS)
 		{
-			Logger::error("GGK server initialization timed out");
+			GGK_LOG_ERROR("GGK server initialization timed out");
 
 			setServerHealth(EFailedInit);
 
@@ -522,19 +1267,19 @@ int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char
 		{
 			if (!ggkWait())
 			{
-				Logger::warn(SSTR << "Unable to stop the server after an error in ggkStart()");
+				GGK_LOG_WARN(SSTR << "Unable to stop the server after an error in ggkStart()");
 			}
 
 			return 0;
 		}
 
 		// Everything looks good
-		Logger::trace("GGK server has started");
+		GGK_LOG_TRACE("GGK server has started");
 		return 1;
 	}
 	catch(...)
 	{
-		Logger::error(SSTR << "Unknown exception during ggkStart()");
+		GGK_LOG_ERROR(SSTR << "Unknown exception during ggkStartOnController()");
 		return 0;
 	}
 }
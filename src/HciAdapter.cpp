@@ -26,6 +26,11 @@
 //
 //     https://git.kernel.org/pub/scm/bluetooth/bluez.git/tree/doc/mgmt-api.txt
 //
+// Received events are dispatched through two tables filled in by the constructor: one indexed by event code and one indexed by
+// command code, for the responses carried by Command Complete events. Each handler is given a view of the packet where it lies in
+// the receive buffer, once its size has been checked. Events that turn out to be malformed are counted (see
+// `Stats::recordHciMalformedEvent()`) and skipped. Subscribers (see `subscribe()`) are then given the same view.
+//
 // KNOWN LIMITATIONS:
 //
 // This is far from a complete implementation. I'm not even sure how reliable of an implementation this is. However, I can say with
@@ -43,6 +48,7 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <string.h>
+#include <algorithm>
 #include <chrono>
 #include <future>
 
@@ -51,12 +57,16 @@
 #include "Utils.h"
 #include "Mgmt.h"
 #include "Logger.h"
+#include "Stats.h"
 
 namespace ggk {
 
 // Our event thread listens for events coming from the adapter and deals with them appropriately
 std::thread HciAdapter::eventThread;
 
+// Serializes starting the event thread, since commands (which start it on demand) are sent from more than one thread
+std::mutex HciAdapter::eventThreadMutex;
+
 const char * const HciAdapter::kCommandCodeNames[kMaxCommandCode + 1] =
 {
 	"Invalid Command",                                   // 0x0000
@@ -130,7 +140,16 @@ const char * const HciAdapter::kCommandCodeNames[kMaxCommandCode + 1] =
 	// code for "Set Appearance Command" is 0x0042. It also says this about the previous command in the list ("Read Extended
 	// Controller Information Command".) This is likely an error, so I'm following the order of the commands as they appear in the
 	// documentation. This makes "Set Appearance Code" have a command code of 0x0043.
-	"Set Appearance Command"                             // 0x0043
+	"Set Appearance Command",                            // 0x0043
+	"Get PHY Configuration Command",                     // 0x0044
+	"Set PHY Configuration Command",                     // 0x0045
+	"Load Blocked Keys Command",                         // 0x0046
+	"Set Wideband Speech Command",                       // 0x0047
+	"Read Controller Capabilities Command",              // 0x0048
+	"Read Experimental Features Information Command",    // 0x0049
+	"Set Experimental Feature Command",                  // 0x004a
+	"Read Default System Configuration Command",         // 0x004b
+	"Set Default System Configuration Command"           // 0x004c
 };
 
 const char * const HciAdapter::kEventTypeNames[kMaxEventType + 1] =
@@ -172,7 +191,8 @@ const char * const HciAdapter::kEventTypeNames[kMaxEventType + 1] =
 	"Local Out Of Band Extended Data Updated Event",     // 0x0022
 	"Advertising Added Event",                           // 0x0023
 	"Advertising Removed Event",                         // 0x0024
-	"Extended Controller Information Changed Event"      // 0x0025
+	"Extended Controller Information Changed Event",     // 0x0025
+	"PHY Configuration Changed Event"                    // 0x0026
 };
 
 const char * const HciAdapter::kStatusCodes[kMaxStatusCode + 1] =
@@ -206,6 +226,81 @@ void runEventThread()
 	HciAdapter::getInstance().runEventThread();
 }
 
+// Returns the name of a command code, event type or status code, or "Unknown" for one out of range
+//
+// Codes read from a received packet should be named with these, since a malformed packet can hold anything.
+const char *HciAdapter::getCommandCodeName(uint16_t commandCode)
+{
+	return commandCode <= kMaxCommandCode ? kCommandCodeNames[commandCode] : "Unknown";
+}
+
+const char *HciAdapter::getEventTypeName(uint16_t eventCode)
+{
+	return eventCode <= kMaxEventType ? kEventTypeNames[eventCode] : "Unknown";
+}
+
+const char *HciAdapter::getStatusCodeName(uint8_t status)
+{
+	return status <= kMaxStatusCode ? kStatusCodes[status] : "Unknown";
+}
+
+// Private constructor for our Singleton
+//
+// This is where each event and command response we understand is given its handler. Anything without a handler is only passed
+// to subscribers (see `subscribe()`.)
+HciAdapter::HciAdapter()
+: nextCommandId(1), pSubscriptions(std::make_shared<const SubscriptionList>()), nextSubscriptionId(1)
+{
+	for (EventHandlerEntry &entry : eventHandlers)
+	{
+		entry.handler = nullptr;
+		entry.minimumSize = sizeof(HciHeader);
+	}
+
+	for (ResponseHandlerEntry &entry : responseHandlers)
+	{
+		entry.handler = nullptr;
+		entry.size = 0;
+	}
+
+	registerEventHandler(Mgmt::ECommandCompleteEvent, &HciAdapter::onCommandComplete, sizeof(CommandCompleteEvent));
+	registerEventHandler(Mgmt::ECommandStatusEvent, &HciAdapter::onCommandStatus, sizeof(CommandStatusEvent));
+	registerEventHandler(Mgmt::EIndexAddedEvent, &HciAdapter::onIndexChanged, sizeof(HciHeader));
+	registerEventHandler(Mgmt::EIndexRemovedEvent, &HciAdapter::onIndexChanged, sizeof(HciHeader));
+	registerEventHandler(Mgmt::ENewSettingsEvent, &HciAdapter::onNewSettings, sizeof(HciHeader) + sizeof(AdapterSettings));
+	registerEventHandler(Mgmt::EDeviceConnectedEvent, &HciAdapter::onDeviceConnected, sizeof(DeviceConnectedEvent));
+	registerEventHandler(Mgmt::EDeviceDisconnectedEvent, &HciAdapter::onDeviceDisconnected, sizeof(DeviceDisconnectedEvent));
+	registerEventHandler(Mgmt::ENewConnectionParameterEvent, &HciAdapter::onNewConnectionParameter, sizeof(NewConnectionParameterEvent));
+	registerEventHandler(Mgmt::EPhyConfigurationChangedEvent, &HciAdapter::onPhyConfigurationChanged, sizeof(HciHeader) + sizeof(uint32_t));
+
+	registerResponseHandler(Mgmt::EReadVersionInformationCommand, &HciAdapter::onVersionInformation, sizeof(VersionInformation));
+	registerResponseHandler(Mgmt::EReadControllerInformationCommand, &HciAdapter::onControllerInformation, sizeof(ControllerInformation));
+	registerResponseHandler(Mgmt::ESetLocalNameCommand, &HciAdapter::onLocalName, sizeof(LocalName));
+	registerResponseHandler(Mgmt::EGetPhyConfigurationCommand, &HciAdapter::onPhyConfiguration, sizeof(PhyConfiguration));
+
+	for (uint16_t commandCode :
+	{
+		Mgmt::ESetPoweredCommand, Mgmt::ESetBREDRCommand, Mgmt::ESetSecureConnectionsCommand, Mgmt::ESetBondableCommand,
+		Mgmt::ESetConnectableCommand, Mgmt::ESetDiscoverableCommand, Mgmt::ESetLowEnergyCommand, Mgmt::ESetAdvertisingCommand
+	})
+	{
+		registerResponseHandler(commandCode, &HciAdapter::onAdapterSettings, sizeof(AdapterSettings));
+	}
+}
+
+// Adds the handler for events with `eventCode` or for responses to commands with `commandCode` to the dispatch tables
+void HciAdapter::registerEventHandler(uint16_t eventCode, EventHandler handler, size_t minimumSize)
+{
+	eventHandlers[eventCode].handler = handler;
+	eventHandlers[eventCode].minimumSize = minimumSize;
+}
+
+void HciAdapter::registerResponseHandler(uint16_t commandCode, ResponseHandler handler, size_t size)
+{
+	responseHandlers[commandCode].handler = handler;
+	responseHandlers[commandCode].size = size;
+}
+
 // Event processor, responsible for receiving events from the HCI socket
 //
 // This mehtod should not be called directly. Rather, it runs continuously on a thread until the server shuts down
@@ -213,166 +308,554 @@ void runEventThread()
 // It isn't necessary to disconnect manually; the HCI socket will get disocnnected automatically at before this method returns
 void HciAdapter::runEventThread()
 {
-	Logger::trace("Entering the HciAdapter event thread");
+	GGK_LOG_TRACE("Entering the HciAdapter event thread");
+
+	// Every packet is received into this one buffer and handed to the handlers in place, so we don't allocate anything per packet
+	std::vector<uint8_t> receiveBuffer(HciSocket::kResponseMaxSize);
 
 	while (ggkGetServerRunState() <= ERunning && hciSocket.isConnected())
 	{
 		// Read the next event, waiting until one arrives
-		std::vector<uint8_t> responsePacket = std::vector<uint8_t>();
-		if (!hciSocket.read(responsePacket))
+		size_t packetSize = 0;
+		if (!hciSocket.read(receiveBuffer.data(), receiveBuffer.size(), packetSize))
 		{
 			break;
 		}
 
-		// Do we have enough to check the event code?
-		if (responsePacket.size() < 2)
+		EventView event;
+		event.eventCode = Mgmt::EInvalidEvent;
+		event.controllerId = kNonController;
+		event.pPacket = receiveBuffer.data();
+		event.packetSize = packetSize;
+		event.pParameters = nullptr;
+		event.parametersSize = 0;
+
+		// Do we have enough to read the header?
+		if (packetSize < sizeof(HciHeader))
 		{
-			Logger::error(SSTR << "Invalid command response: too short");
+			recordMalformedEvent(event, SSTR << "too short for its header");
 			continue;
 		}
 
-		// Our response, as a usable object type
-		uint16_t eventCode = Utils::endianToHost(*reinterpret_cast<uint16_t *>(responsePacket.data()));
+		HciHeader header;
+		memcpy(&header, event.pPacket, sizeof(header));
+		header.toHost();
 
-		// Ensure our event code is valid
-		if (eventCode < HciAdapter::kMinEventType || eventCode > HciAdapter::kMaxEventType)
+		event.eventCode = header.code;
+		event.controllerId = header.controllerId;
+
+		// The header says how many bytes of parameters follow it; we can't use more than were received
+		if (header.dataSize > packetSize - sizeof(HciHeader))
 		{
-			Logger::error(SSTR << "Invalid command response: event code (" << eventCode << ") out of range");
+			recordMalformedEvent(event, SSTR << "header claims " << header.dataSize << " bytes of parameters, but only "
+				<< packetSize - sizeof(HciHeader) << " were received");
 			continue;
 		}
 
-		switch(eventCode)
+		event.packetSize = sizeof(HciHeader) + header.dataSize;
+		event.pParameters = event.pPacket + sizeof(HciHeader);
+		event.parametersSize = header.dataSize;
+
+		dispatchEvent(event);
+	}
+
+	// Make sure we're disconnected before we leave
+	hciSocket.disconnect();
+
+	GGK_LOG_TRACE("Leaving the HciAdapter event thread");
+}
+
+// Validates a received event and hands it to its handler and subscribers
+//
+// Malformed events are counted and skipped (see `recordMalformedEvent()`)
+void HciAdapter::dispatchEvent(const EventView &event)
+{
+	// Ensure our event code is valid
+	if (event.eventCode < kMinEventType || event.eventCode > kMaxEventType)
+	{
+		recordMalformedEvent(event, SSTR << "invalid event code " << Utils::hex(event.eventCode));
+		return;
+	}
+
+	const EventHandlerEntry &entry = eventHandlers[event.eventCode];
+	if (event.packetSize < entry.minimumSize)
+	{
+		recordMalformedEvent(event, SSTR << event.packetSize << " bytes received, expected at least " << entry.minimumSize);
+		return;
+	}
+
+	// A handler that finds the event malformed has already recorded it
+	if (nullptr != entry.handler && !(this->*entry.handler)(event))
+	{
+		return;
+	}
+
+	if (!notifySubscribers(event.eventCode, event) && nullptr == entry.handler)
+	{
+		GGK_LOG_ERROR("Unsupported response event type: " + Utils::hex(event.eventCode) + " (" + kEventTypeNames[event.eventCode] + ")");
+	}
+}
+
+// Hands an event to the subscribers that asked for `eventCode` (which may differ from the event's own code)
+//
+// Returns true if there were any
+bool HciAdapter::notifySubscribers(uint16_t eventCode, const EventView &event)
+{
+	bool notified = false;
+
+	std::shared_ptr<const SubscriptionList> pCurrent = std::atomic_load(&pSubscriptions);
+	for (const Subscription &subscription : *pCurrent)
+	{
+		if ((subscription.eventMask & eventBit(eventCode)) != 0)
 		{
-			// Command complete event
-			case Mgmt::ECommandCompleteEvent:
-			{
-				// Extract our event
-				CommandCompleteEvent event(responsePacket);
-
-				// Point to the data following the event
-				uint8_t *data = responsePacket.data() + sizeof(CommandCompleteEvent);
-				size_t dataLen = responsePacket.size() - sizeof(CommandCompleteEvent);
-
-				switch(event.commandCode)
-				{
-					// We just log the version/revision info
-					case Mgmt::EReadVersionInformationCommand:
-					{
-						// Verify the size is what we expect
-						if (dataLen != sizeof(VersionInformation))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						versionInformation = *reinterpret_cast<VersionInformation *>(data);
-						versionInformation.toHost();
-						Logger::debug(versionInformation.debugText());
-						break;
-					}
-					case Mgmt::EReadControllerInformationCommand:
-					{
-						if (dataLen != sizeof(ControllerInformation))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						controllerInformation = *reinterpret_cast<ControllerInformation *>(data);
-						controllerInformation.toHost();
-						Logger::debug(controllerInformation.debugText());
-						break;
-					}
-					case Mgmt::ESetLocalNameCommand:
-					{
-						if (dataLen != sizeof(LocalName))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						localName = *reinterpret_cast<LocalName *>(data);
-						Logger::info(localName.debugText());
-						break;
-					}
-					case Mgmt::ESetPoweredCommand:
-					case Mgmt::ESetBREDRCommand:
-					case Mgmt::ESetSecureConnectionsCommand:
-					case Mgmt::ESetBondableCommand:
-					case Mgmt::ESetConnectableCommand:
-					case Mgmt::ESetLowEnergyCommand:
-					case Mgmt::ESetAdvertisingCommand:
-					{
-						if (dataLen != sizeof(AdapterSettings))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						adapterSettings = *reinterpret_cast<AdapterSettings *>(data);
-						adapterSettings.toHost();
-
-						Logger::debug(adapterSettings.debugText());
-						break;
-					}
-				}
-
-				// Notify anybody waiting that we received a response to their command code
-				setCommandResponse(event.commandCode);
+			subscription.subscriber(event);
+			notified = true;
+		}
+	}
 
-				break;
-			}
-			// Command status event
-			case Mgmt::ECommandStatusEvent:
-			{
-				CommandStatusEvent event(responsePacket);
+	return notified;
+}
 
-				// Notify anybody waiting that we received a response to their command code
-				setCommandResponse(event.commandCode);
-				break;
-			}
-			// Command status event
-			case Mgmt::EDeviceConnectedEvent:
+// Counts and logs a malformed event; the event is skipped
+void HciAdapter::recordMalformedEvent(const EventView &event, const std::ostream &reason)
+{
+	GGK_LOG_ERROR(SSTR << "Skipping malformed event " << Utils::hex(event.eventCode) << " (" << getEventTypeName(event.eventCode)
+		<< ") on hci" << event.controllerId << ": " << static_cast<const std::ostringstream &>(reason).str());
+	Stats::getInstance().recordHciMalformedEvent();
+}
+
+// Command complete event
+bool HciAdapter::onCommandComplete(const EventView &event)
+{
+	// Extract our event
+	CommandCompleteEvent commandComplete(event.pPacket);
+
+	// Point to the data following the event
+	const uint8_t *pData = event.pPacket + sizeof(CommandCompleteEvent);
+	size_t dataSize = event.packetSize - sizeof(CommandCompleteEvent);
+
+	// Failed commands may not return their parameters, so only the responses to successful ones are parsed
+	if (commandComplete.commandCode <= kMaxCommandCode && commandComplete.status == 0)
+	{
+		const ResponseHandlerEntry &entry = responseHandlers[commandComplete.commandCode];
+		if (nullptr != entry.handler)
+		{
+			if (dataSize != entry.size)
 			{
-				DeviceConnectedEvent event(responsePacket);
-				activeConnections += 1;
-				Logger::debug(SSTR << "  > Connection count incremented to " << activeConnections);
-				break;
+				recordMalformedEvent(event, SSTR << "response to " << kCommandCodeNames[commandComplete.commandCode] << " holds "
+					<< dataSize << " bytes, expected " << entry.size);
 			}
-			// Command status event
-			case Mgmt::EDeviceDisconnectedEvent:
+			else if (!(this->*entry.handler)(event, pData, dataSize))
 			{
-				DeviceDisconnectedEvent event(responsePacket);
-				if (activeConnections > 0)
-				{
-					activeConnections -= 1;
-					Logger::debug(SSTR << "  > Connection count decremented to " << activeConnections);
-				}
-				else
-				{
-					Logger::debug(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
-				}
-				break;
-			}
-			// Unsupported
-			default:
-			{
-				if (eventCode >= kMinEventType && eventCode <= kMaxEventType)
-				{
-					Logger::error("Unsupported response event type: " + Utils::hex(eventCode) + " (" + kEventTypeNames[eventCode] + ")");
-				}
-				else
-				{
-					Logger::error("Invalid event type response: " + Utils::hex(eventCode));					
-				}
+				recordMalformedEvent(event, SSTR << "invalid response to " << kCommandCodeNames[commandComplete.commandCode]);
 			}
 		}
 	}
 
-	// Make sure we're disconnected before we leave
-	hciSocket.disconnect();
+	// Notify anybody waiting that we received a response to their command (even one we couldn't parse, so they needn't wait for
+	// it to time out)
+	completeCommand(commandComplete.commandCode, commandComplete.header.controllerId, commandComplete.status, pData, dataSize);
+	return true;
+}
+
+// Command status event
+bool HciAdapter::onCommandStatus(const EventView &event)
+{
+	CommandStatusEvent commandStatus(event.pPacket);
+
+	// Notify anybody waiting that we received a response to their command
+	completeCommand(commandStatus.commandCode, commandStatus.header.controllerId, commandStatus.status, nullptr, 0);
+	return true;
+}
+
+// Index added/removed events
+bool HciAdapter::onIndexChanged(const EventView &event)
+{
+	bool added = event.eventCode == Mgmt::EIndexAddedEvent;
+	GGK_LOG_INFO(SSTR << "Controller hci" << event.controllerId << (added ? " added" : " removed"));
+
+	// Whatever we knew about a controller that has gone away no longer applies, even if it comes back with the same index
+	if (!added)
+	{
+		std::lock_guard<std::mutex> lock(controllersMutex);
+		controllers.erase(event.controllerId);
+	}
+
+	IndexCallback callback;
+	{
+		std::lock_guard<std::mutex> lock(indexCallbackMutex);
+		callback = indexCallback;
+	}
+
+	if (callback)
+	{
+		callback(event.controllerId, added);
+	}
+	return true;
+}
+
+// New settings event
+bool HciAdapter::onNewSettings(const EventView &event)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	Controller &controller = getController(event.controllerId);
+	memcpy(&controller.adapterSettings, event.pParameters, sizeof(AdapterSettings));
+	controller.adapterSettings.toHost();
+	controller.controllerInformation.currentSettings = controller.adapterSettings;
+
+	GGK_LOG_DEBUG(controller.adapterSettings.debugText());
+	return true;
+}
+
+// Device connected event
+bool HciAdapter::onDeviceConnected(const EventView &event)
+{
+	DeviceConnectedEvent deviceConnected(event.pPacket);
+
+	// The EIR data follows the event
+	if (deviceConnected.eirDataLength > event.packetSize - sizeof(DeviceConnectedEvent))
+	{
+		recordMalformedEvent(event, SSTR << "EIR data length of " << deviceConnected.eirDataLength << " bytes overruns the event");
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(controllersMutex);
+		Controller &controller = getController(deviceConnected.header.controllerId);
+		controller.activeConnections += 1;
+		GGK_LOG_DEBUG(SSTR << "  > Connection count on hci" << deviceConnected.header.controllerId << " incremented to " << controller.activeConnections);
+
+		Connection connection = Connection();
+		memcpy(connection.address, deviceConnected.address, sizeof(connection.address));
+		connection.addressType = deviceConnected.addressType;
+		connection.selectedPhys = controller.phyConfiguration.selectedPhys;
+		connection.connected = std::chrono::steady_clock::now();
+		controller.connections.push_back(connection);
+	}
+
+	loadConnectionParameters(deviceConnected.header.controllerId, deviceConnected.address, deviceConnected.addressType);
+	return true;
+}
+
+// Device disconnected event
+bool HciAdapter::onDeviceDisconnected(const EventView &event)
+{
+	DeviceDisconnectedEvent deviceDisconnected(event.pPacket);
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	Controller &controller = getController(deviceDisconnected.header.controllerId);
+	for (auto it = controller.connections.begin(); it != controller.connections.end(); ++it)
+	{
+		if (memcmp(it->address, deviceDisconnected.address, sizeof(it->address)) == 0 && it->addressType == deviceDisconnected.addressType)
+		{
+			controller.connections.erase(it);
+			break;
+		}
+	}
+
+	int &activeConnections = controller.activeConnections;
+	if (activeConnections > 0)
+	{
+		activeConnections -= 1;
+		GGK_LOG_DEBUG(SSTR << "  > Connection count on hci" << deviceDisconnected.header.controllerId << " decremented to " << activeConnections);
+	}
+	else
+	{
+		GGK_LOG_DEBUG(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
+	}
+	return true;
+}
+
+// New connection parameter event
+bool HciAdapter::onNewConnectionParameter(const EventView &event)
+{
+	NewConnectionParameterEvent newParameters(event.pPacket);
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	for (Connection &connection : getController(newParameters.header.controllerId).connections)
+	{
+		if (memcmp(connection.address, newParameters.address, sizeof(connection.address)) == 0 && connection.addressType == newParameters.addressType)
+		{
+			connection.minInterval = newParameters.minInterval;
+			connection.maxInterval = newParameters.maxInterval;
+			connection.latency = newParameters.latency;
+			connection.supervisionTimeout = newParameters.timeout;
+			break;
+		}
+	}
+	return true;
+}
+
+// PHY configuration changed event
+bool HciAdapter::onPhyConfigurationChanged(const EventView &event)
+{
+	uint32_t selectedPhys;
+	memcpy(&selectedPhys, event.pParameters, sizeof(selectedPhys));
+	selectedPhys = Utils::endianToHost(selectedPhys);
+	GGK_LOG_DEBUG(SSTR << "  > Selected PHYs on hci" << event.controllerId << " changed to " << Utils::hex(selectedPhys));
+
+	// The PHY selection belongs to the controller, so it applies to every connection on it
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	Controller &controller = getController(event.controllerId);
+	controller.phyConfiguration.selectedPhys = selectedPhys;
+	for (Connection &connection : controller.connections)
+	{
+		connection.selectedPhys = selectedPhys;
+	}
+	return true;
+}
+
+// We just log the version/revision info
+bool HciAdapter::onVersionInformation(const EventView &, const uint8_t *pData, size_t)
+{
+	memcpy(&versionInformation, pData, sizeof(VersionInformation));
+	versionInformation.toHost();
+	GGK_LOG_DEBUG(versionInformation.debugText());
+	return true;
+}
+
+bool HciAdapter::onControllerInformation(const EventView &event, const uint8_t *pData, size_t)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	ControllerInformation &controllerInformation = getController(event.controllerId).controllerInformation;
+	memcpy(&controllerInformation, pData, sizeof(ControllerInformation));
+	controllerInformation.toHost();
+	GGK_LOG_DEBUG(controllerInformation.debugText());
+	return true;
+}
+
+bool HciAdapter::onLocalName(const EventView &event, const uint8_t *pData, size_t)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	Controller &controller = getController(event.controllerId);
+	memcpy(&controller.localName, pData, sizeof(LocalName));
+	GGK_LOG_INFO(controller.localName.debugText());
 
-	Logger::trace("Leaving the HciAdapter event thread");
+	// Keep our cached controller information current, so configuration can be compared against it
+	memcpy(controller.controllerInformation.name, controller.localName.name, sizeof(controller.controllerInformation.name));
+	memcpy(controller.controllerInformation.shortName, controller.localName.shortName, sizeof(controller.controllerInformation.shortName));
+	return true;
+}
+
+// The responses to the commands that change a setting hold the controller's new settings
+bool HciAdapter::onAdapterSettings(const EventView &event, const uint8_t *pData, size_t dataSize)
+{
+	{
+		std::lock_guard<std::mutex> lock(controllersMutex);
+		Controller &controller = getController(event.controllerId);
+		memcpy(&controller.adapterSettings, pData, sizeof(AdapterSettings));
+		controller.adapterSettings.toHost();
+		controller.controllerInformation.currentSettings = controller.adapterSettings;
+
+		GGK_LOG_DEBUG(controller.adapterSettings.debugText());
+	}
+
+	// The kernel doesn't send a New Settings event to the socket that changed the settings, so tell those subscribers here
+	EventView settingsEvent = event;
+	settingsEvent.eventCode = Mgmt::ENewSettingsEvent;
+	settingsEvent.pParameters = pData;
+	settingsEvent.parametersSize = dataSize;
+	notifySubscribers(Mgmt::ENewSettingsEvent, settingsEvent);
+	return true;
+}
+
+bool HciAdapter::onPhyConfiguration(const EventView &event, const uint8_t *pData, size_t)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	Controller &controller = getController(event.controllerId);
+	memcpy(&controller.phyConfiguration, pData, sizeof(PhyConfiguration));
+	controller.phyConfiguration.toHost();
+	GGK_LOG_DEBUG(controller.phyConfiguration.debugText());
+
+	// The PHY selection belongs to the controller, so it applies to every connection on it
+	for (Connection &connection : controller.connections)
+	{
+		connection.selectedPhys = controller.phyConfiguration.selectedPhys;
+	}
+	return true;
+}
+
+// The adapter information below is tracked separately for each controller (by its zero-based index, as in 'hci0')
+//
+// A controller's information is only available once it has been synchronized (see `sync()`)
+HciAdapter::AdapterSettings HciAdapter::getAdapterSettings(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return getController(controllerIndex).adapterSettings;
+}
+
+HciAdapter::ControllerInformation HciAdapter::getControllerInformation(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return getController(controllerIndex).controllerInformation;
+}
+
+HciAdapter::LocalName HciAdapter::getLocalName(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return getController(controllerIndex).localName;
+}
+
+int HciAdapter::getActiveConnectionCount(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return getController(controllerIndex).activeConnections;
+}
+
+HciAdapter::PhyConfiguration HciAdapter::getPhyConfiguration(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return getController(controllerIndex).phyConfiguration;
+}
+
+// Returns the devices currently connected to a controller
+std::vector<HciAdapter::Connection> HciAdapter::getConnections(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return getController(controllerIndex).connections;
+}
+
+// Records the ATT MTU BlueZ reported for a request from the device at `address` (in Management API byte order)
+//
+// Does nothing if the device is not connected to the controller.
+void HciAdapter::setConnectionMtu(uint16_t controllerIndex, const uint8_t *pAddress, uint16_t mtu)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	for (Connection &connection : getController(controllerIndex).connections)
+	{
+		if (memcmp(connection.address, pAddress, sizeof(connection.address)) == 0)
+		{
+			connection.mtu = mtu;
+			break;
+		}
+	}
+}
+
+// Sets the connection policy for a controller (see `ConnectionPolicy`)
+//
+// The policy's connection parameters are loaded for each device as it connects to the controller. Applying the policy to the
+// controller itself (its default connection parameters and PHY selection) is done by `Mgmt::applyConnectionPolicy()`.
+void HciAdapter::setConnectionPolicy(uint16_t controllerIndex, const ConnectionPolicy &policy)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	connectionPolicies[controllerIndex] = policy;
+}
+
+HciAdapter::ConnectionPolicy HciAdapter::getConnectionPolicy(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	auto it = connectionPolicies.find(controllerIndex);
+	return it != connectionPolicies.end() ? it->second : ConnectionPolicy();
+}
+
+// Sends the connection parameters from the controller's policy (if it has any) to the kernel for a device that just connected
+//
+// This is called from the event thread, so it doesn't wait for the response.
+void HciAdapter::loadConnectionParameters(uint16_t controllerIndex, const uint8_t *pAddress, uint8_t addressType)
+{
+	// Connection parameters only apply to LE devices
+	if (addressType != 1 && addressType != 2)
+	{
+		return;
+	}
+
+	ConnectionPolicy policy = getConnectionPolicy(controllerIndex);
+	if (!policy.hasConnectionParameters())
+	{
+		return;
+	}
+
+	struct SRequest : HciAdapter::HciHeader
+	{
+		uint16_t parameterCount;
+		uint8_t address[6];
+		uint8_t addressType;
+		uint16_t minInterval;
+		uint16_t maxInterval;
+		uint16_t latency;
+		uint16_t timeout;
+	} __attribute__((packed));
+
+	SRequest request;
+	request.code = Mgmt::ELoadConnectionParametersCommand;
+	request.controllerId = controllerIndex;
+	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
+	request.parameterCount = Utils::endianToHci(static_cast<uint16_t>(1));
+	memcpy(request.address, pAddress, sizeof(request.address));
+	request.addressType = addressType;
+	request.minInterval = Utils::endianToHci(policy.minInterval);
+	request.maxInterval = Utils::endianToHci(policy.maxInterval);
+	request.latency = Utils::endianToHci(policy.latency);
+	request.timeout = Utils::endianToHci(policy.supervisionTimeout);
+
+	GGK_LOG_DEBUG(SSTR << "  > Loading connection parameters for " << Utils::bluetoothAddressString(request.address) << " on hci" << controllerIndex);
+	sendCommandAsync(request, [](uint8_t status, const uint8_t *, size_t)
+	{
+		if (status != 0)
+		{
+			GGK_LOG_WARN(SSTR << "Failed to load connection parameters (status " << Utils::hex(status) << ")");
+		}
+	});
+}
+
+// Sets the function to call when a controller is added or removed (for example, a USB dongle being plugged in) or clears it
+//
+// Index events are only received while the HCI socket is connected, which it is once any command has been sent.
+void HciAdapter::setIndexCallback(IndexCallback callback)
+{
+	std::lock_guard<std::mutex> lock(indexCallbackMutex);
+	indexCallback = callback;
+}
+
+// Calls `subscriber` for every event whose code is in `eventMask` (see `eventBit()`) until it is unsubscribed
+//
+// The kernel only reports changes made by other sockets with a New Settings event; settings changed by our own commands are
+// reported in the commands' responses. Those responses are passed to New Settings subscribers as New Settings events, with the
+// response's parameters (the new settings) as the event's parameters; `pPacket` still refers to the whole response.
+//
+// Returns an id for `unsubscribe()`, which is never 0
+int HciAdapter::subscribe(uint64_t eventMask, EventSubscriber subscriber)
+{
+	std::lock_guard<std::mutex> lock(subscriptionsMutex);
+
+	Subscription subscription;
+	subscription.id = nextSubscriptionId++;
+	subscription.eventMask = eventMask;
+	subscription.subscriber = subscriber;
+
+	std::shared_ptr<SubscriptionList> pNew = std::make_shared<SubscriptionList>(*std::atomic_load(&pSubscriptions));
+	pNew->push_back(subscription);
+	std::atomic_store(&pSubscriptions, std::shared_ptr<const SubscriptionList>(pNew));
+
+	return subscription.id;
+}
+
+// Stops calling the subscriber registered under `id`
+//
+// The subscriber may still be running on the event thread when this returns.
+void HciAdapter::unsubscribe(int id)
+{
+	std::lock_guard<std::mutex> lock(subscriptionsMutex);
+
+	std::shared_ptr<SubscriptionList> pNew = std::make_shared<SubscriptionList>(*std::atomic_load(&pSubscriptions));
+	pNew->erase(std::remove_if(pNew->begin(), pNew->end(), [id](const Subscription &subscription)
+	{
+		return subscription.id == id;
+	}), pNew->end());
+	std::atomic_store(&pSubscriptions, std::shared_ptr<const SubscriptionList>(pNew));
+}
+
+// Returns the state for the controller at `controllerIndex`, creating it if needed
+//
+// The caller must hold `controllersMutex`
+HciAdapter::Controller &HciAdapter::getController(uint16_t controllerIndex)
+{
+	auto it = controllers.find(controllerIndex);
+	if (it == controllers.end())
+	{
+		// Value-initialized, so a controller we haven't heard from yet reads as all zeros
+		it = controllers.emplace(controllerIndex, Controller()).first;
+	}
+
+	return it->second;
 }
 
 // Reads current values from the controller
@@ -381,27 +864,32 @@ void HciAdapter::runEventThread()
 // milliseconds. Therefore, it is not recommended attempt to retrieve the results from their accessors immediately.
 void HciAdapter::sync(uint16_t controllerIndex)
 {
-	Logger::debug("Synchronizing version information");
+	GGK_LOG_DEBUG("Synchronizing version information");
 
 	HciAdapter::HciHeader request;
 	request.code = Mgmt::EReadVersionInformationCommand;
 	request.controllerId = HciAdapter::kNonController;
 	request.dataSize = 0;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
-	{
-		Logger::error("Failed to get version information");
-	}
+	std::future<bool> versionResult = sendCommandAsync(request);
 
-	Logger::debug("Synchronizing controller information");
+	GGK_LOG_DEBUG("Synchronizing controller information");
 
 	request.code = Mgmt::EReadControllerInformationCommand;
 	request.controllerId = controllerIndex;
 	request.dataSize = 0;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	std::future<bool> controllerResult = sendCommandAsync(request);
+
+	// Both requests are in flight at once; wait for them together
+	if (!waitForCommand(versionResult))
+	{
+		GGK_LOG_ERROR("Failed to get version information");
+	}
+
+	if (!waitForCommand(controllerResult))
 	{
-		Logger::error("Failed to get current settings");
+		GGK_LOG_ERROR("Failed to get current settings");
 	}
 }
 
@@ -414,12 +902,31 @@ void HciAdapter::sync(uint16_t controllerIndex)
 // Returns true if the HCI socket is connected (either via a new connection or an existing one), otherwise false
 bool HciAdapter::start()
 {
+	std::lock_guard<std::mutex> lock(eventThreadMutex);
+
 	// If the thread is already running, return failure
 	if (eventThread.joinable())
 	{
 		return false;
 	}
 
+	return startEventThread();
+}
+
+// Makes sure the HCI socket is connected and the run thread is running (see `start()`)
+//
+// Unlike `start()`, this succeeds if the thread is already running. Returns true if the thread is running.
+bool HciAdapter::ensureStarted()
+{
+	std::lock_guard<std::mutex> lock(eventThreadMutex);
+	return eventThread.joinable() || startEventThread();
+}
+
+// Connects the HCI socket if needed and starts the run thread (see `start()`)
+//
+// The caller must hold `eventThreadMutex` and the thread must not already be running
+bool HciAdapter::startEventThread()
+{
 	// Already connected?
 	if (!hciSocket.isConnected())
 	{
@@ -437,7 +944,7 @@ bool HciAdapter::start()
 	}
 	catch(std::system_error &ex)
 	{
-		Logger::error(SSTR << "HciAdapter thread was unable to start (code " << ex.code() << "): " << ex.what());
+		GGK_LOG_ERROR(SSTR << "HciAdapter thread was unable to start (code " << ex.code() << "): " << ex.what());
 		return false;
 	}
 
@@ -449,7 +956,10 @@ bool HciAdapter::start()
 // This method will block until the thread joins
 void HciAdapter::stop()
 {
-	Logger::trace("HciAdapter waiting for thread termination");
+	// Wake the event thread so it notices we're shutting down
+	hciSocket.requestShutdown();
+
+	GGK_LOG_TRACE("HciAdapter waiting for thread termination");
 
 	try
 	{
@@ -457,106 +967,215 @@ void HciAdapter::stop()
 		{
 			eventThread.join();
 
-			Logger::trace("Event thread has stopped");
+			GGK_LOG_TRACE("Event thread has stopped");
 		}
 		else
 		{
-			Logger::trace(" > Event thread is not joinable");
+			GGK_LOG_TRACE(" > Event thread is not joinable");
 		}
 	}
 	catch(std::system_error &ex)
 	{
 		if (ex.code() == std::errc::invalid_argument)
 		{
-			Logger::warn(SSTR << "HciAdapter event thread was not joinable during HciAdapter::wait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "HciAdapter event thread was not joinable during HciAdapter::wait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::no_such_process)
 		{
-			Logger::warn(SSTR << "HciAdapter event was not valid during HciAdapter::wait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "HciAdapter event was not valid during HciAdapter::wait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::resource_deadlock_would_occur)
 		{
-			Logger::warn(SSTR << "Deadlock avoided in call to HciAdapter::wait() (did the event thread try to stop itself?): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Deadlock avoided in call to HciAdapter::wait() (did the event thread try to stop itself?): " << ex.what());
 		}
 		else
 		{
-			Logger::warn(SSTR << "Unknown system_error code (" << ex.code() << ") during HciAdapter::wait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Unknown system_error code (" << ex.code() << ") during HciAdapter::wait(): " << ex.what());
 		}
 	}
+
+	// Nobody is left to deliver responses, so fail anything still in flight
+	std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+	expirePendingCommands(true);
 }
 
-// Sends a command over the HCI socket
+// Sends a command over the HCI socket and waits (up to `kMaxEventWaitTimeMS`) for its response
 //
 // If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
 // a failure is returned.
 //
+// This must not be called from the event thread (for example, from a `CommandCallback`) since that thread delivers the response.
+//
 // Returns true on success, otherwise false
 bool HciAdapter::sendCommand(HciHeader &request)
 {
+	GGK_LOG_DEBUG(SSTR << "  + Waiting on command code " << request.code << " for up to " << kMaxEventWaitTimeMS << "ms");
+
+	std::future<bool> result = sendCommandAsync(request);
+	return waitForCommand(result);
+}
+
+// Sends a command over the HCI socket without waiting for its response
+//
+// Any number of commands may be in flight at once. Responses are matched to commands by command code and controller index, in
+// the order the commands were sent. When the response arrives, `callback` (if set) is called from the event thread and the
+// returned future becomes true.
+//
+// The future becomes false if the command could not be sent, if no response arrived within `kMaxEventWaitTimeMS` or if the
+// adapter was stopped first.
+std::future<bool> HciAdapter::sendCommandAsync(HciHeader &request, CommandCallback callback)
+{
+	PendingCommand pending;
+	pending.commandCode = request.code;
+	pending.controllerId = request.controllerId;
+	pending.sent = std::chrono::steady_clock::now();
+	pending.deadline = pending.sent + std::chrono::milliseconds(kMaxEventWaitTimeMS);
+	pending.callback = callback;
+	std::future<bool> fut = pending.promise.get_future();
+
 	// Auto-connect
-	if (!eventThread.joinable() && !start())
+	if (!ensureStarted())
 	{
-		Logger::error("HciAdapter failed to start");
-		return false;
+		GGK_LOG_ERROR("HciAdapter failed to start");
+		pending.promise.set_value(false);
+		return fut;
 	}
 
-	uint16_t code = request.code;
-	uint16_t dataSize = request.dataSize;
-
-	conditionalValue = -1;
-	std::future<bool> fut = std::async(std::launch::async,
-	[&]() mutable
+	// Register the command before it is sent, since the response can arrive before `write()` returns
+	uint64_t id = 0;
 	{
-		return waitForCommandResponse(code, kMaxEventWaitTimeMS);
-	});
+		std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+		expirePendingCommands(false);
+
+		id = nextCommandId++;
+		pending.id = id;
+		pendingCommands.push_back(std::move(pending));
+	}
 
 	// Prepare the request to be sent (endianness correction)
+	size_t packetSize = sizeof(request) + request.dataSize;
 	request.toNetwork();
-	uint8_t *pRequest = reinterpret_cast<uint8_t *>(&request);
 
-	std::vector<uint8_t> requestPacket = std::vector<uint8_t>(pRequest, pRequest + sizeof(request) + dataSize);
-	if (!hciSocket.write(requestPacket))
+	if (!hciSocket.write(reinterpret_cast<uint8_t *>(&request), packetSize))
 	{
-		return false;
+		cancelCommand(id);
+
+		// The promise went with the cancelled command, so give the caller a future that has already failed
+		std::promise<bool> failed;
+		failed.set_value(false);
+		return failed.get_future();
 	}
 
-	return fut.get();
+	return fut;
 }
 
-// Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
+// Waits for a command sent with `sendCommandAsync()` to complete
 //
-// Returns true if the response event was received for `commandCode` or false if the timeout expired.
+// A command is given `kMaxEventWaitTimeMS` from the time it was sent, so this never waits longer than that.
 //
-// Command responses are set via `setCommandResponse()`
-bool HciAdapter::waitForCommandResponse(uint16_t commandCode, int timeoutMS)
+// Returns the command's result (see `sendCommandAsync()`)
+bool HciAdapter::waitForCommand(std::future<bool> &result)
 {
-	Logger::debug(SSTR << "  + Waiting on command code " << commandCode << " for up to " << timeoutMS << "ms");
+	if (result.wait_for(std::chrono::milliseconds(kMaxEventWaitTimeMS)) != std::future_status::ready)
+	{
+		// The command's deadline has passed by now, so this fails it
+		std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+		expirePendingCommands(false);
+	}
+
+	return result.get();
+}
 
-	bool success = cvCommandResponse.wait_for(commandResponseLock, std::chrono::milliseconds(timeoutMS),
-		[&]
+// Removes the command registered under `id` without completing it
+//
+// Returns true if the command was still pending, otherwise false
+bool HciAdapter::cancelCommand(uint64_t id)
+{
+	std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+	for (auto it = pendingCommands.begin(); it != pendingCommands.end(); ++it)
+	{
+		if (it->id == id)
 		{
-			return conditionalValue == commandCode;
+			pendingCommands.erase(it);
+			return true;
 		}
-	);
+	}
+
+	return false;
+}
+
+// Completes the oldest pending command for `commandCode` on `controllerId` with the given response
+void HciAdapter::completeCommand(uint16_t commandCode, uint16_t controllerId, uint8_t status, const uint8_t *pData, size_t dataSize)
+{
+	PendingCommand completed;
+	bool found = false;
 
-	if (!success)
 	{
-		Logger::warn(SSTR << "  + Timed out waiting on command code " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+		std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+		expirePendingCommands(false);
+
+		for (auto it = pendingCommands.begin(); it != pendingCommands.end(); ++it)
+		{
+			if (it->commandCode == commandCode && it->controllerId == controllerId)
+			{
+				completed = std::move(*it);
+				pendingCommands.erase(it);
+				found = true;
+				break;
+			}
+		}
 	}
-	else
+
+	if (!found)
+	{
+		GGK_LOG_DEBUG(SSTR << "  + No command waiting on response for command code " << Utils::hex(commandCode));
+		return;
+	}
+
+	GGK_LOG_DEBUG(SSTR << "  + Recieved the command code we were waiting for: " << Utils::hex(commandCode) << " (" << getCommandCodeName(commandCode) << ")");
+
+	if (Stats::isEnabled())
 	{
-		Logger::debug(SSTR << "  + Recieved the command code we were waiting for: " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+		std::chrono::steady_clock::duration roundTrip = std::chrono::steady_clock::now() - completed.sent;
+		Stats::getInstance().recordHciCommand(std::chrono::duration_cast<std::chrono::microseconds>(roundTrip).count());
 	}
 
-	return success;
+	// Call out without holding the lock, so the callback is free to send more commands
+	if (completed.callback)
+	{
+		completed.callback(status, pData, dataSize);
+	}
+
+	completed.promise.set_value(true);
 }
 
-// Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-void HciAdapter::setCommandResponse(uint16_t commandCode)
+// Fails any pending commands that have passed their deadline (or all of them, if `all` is true)
+//
+// The caller must hold `pendingCommandsMutex`
+void HciAdapter::expirePendingCommands(bool all)
 {
-	std::lock_guard<std::mutex> lk(commandResponseMutex);
-	conditionalValue = commandCode;
-	cvCommandResponse.notify_one();
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	auto it = pendingCommands.begin();
+	while (it != pendingCommands.end())
+	{
+		if (all || it->deadline <= now)
+		{
+			GGK_LOG_WARN(SSTR << "  + " << (all ? "Abandoned" : "Timed out waiting on") << " command code " << Utils::hex(it->commandCode) << " (" << kCommandCodeNames[it->commandCode] << ")");
+			it->promise.set_value(false);
+			it = pendingCommands.erase(it);
+
+			// Commands abandoned when the adapter stops didn't time out
+			if (!all && Stats::isEnabled())
+			{
+				Stats::getInstance().recordHciCommandTimeout();
+			}
+		}
+		else
+		{
+			++it;
+		}
+	}
 }
 
 }; // namespace ggk
\ No newline at end of file
@@ -25,10 +25,18 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include <vector>
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <ostream>
 
 #include "HciSocket.h"
 #include "Utils.h"
@@ -50,20 +58,30 @@ public:
 	// A constant referring to a 'non-controller' (for commands that do not require a controller index)
 	static const uint16_t kNonController = 0xffff;
 
+	// The index of the first controller (hci0), used when no controller index is given
+	static const uint16_t kDefaultControllerIndex = 0;
+
 	// Command code names
 	static const int kMinCommandCode = 0x0001;
-	static const int kMaxCommandCode = 0x0043;
+	static const int kMaxCommandCode = 0x004c;
 	static const char * const kCommandCodeNames[kMaxCommandCode + 1];
 
 	// Event type names
 	static const int kMinEventType = 0x0001;
-	static const int kMaxEventType = 0x0025;
+	static const int kMaxEventType = 0x0026;
 	static const char * const kEventTypeNames[kMaxEventType + 1];
 
 	static const int kMinStatusCode = 0x00;
 	static const int kMaxStatusCode = 0x14;
 	static const char * const kStatusCodes[kMaxStatusCode + 1];
 
+	// Returns the name of a command code, event type or status code, or "Unknown" for one out of range
+	//
+	// Codes read from a received packet should be named with these, since a malformed packet can hold anything.
+	static const char *getCommandCodeName(uint16_t commandCode);
+	static const char *getEventTypeName(uint16_t eventCode);
+	static const char *getStatusCodeName(uint8_t status);
+
 	//
 	// Types
 	//
@@ -113,7 +131,7 @@ public:
 		{
 			std::string text = "";
 			text += "> Request header\n";
-			text += "  + Command code       : " + Utils::hex(code) + " (" + HciAdapter::kCommandCodeNames[code] + ")\n";
+			text += "  + Command code       : " + Utils::hex(code) + " (" + HciAdapter::getCommandCodeName(code) + ")\n";
 			text += "  + Controller Id      : " + Utils::hex(controllerId) + "\n";
 			text += "  + Data size          : " + std::to_string(dataSize) + " bytes";
 			return text;
@@ -126,13 +144,14 @@ public:
 		uint16_t commandCode;
 		uint8_t status;
 
-		CommandCompleteEvent(const std::vector<uint8_t> &data)
+		// Parse the event from a received packet, which must hold at least `sizeof(CommandCompleteEvent)` bytes
+		CommandCompleteEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const CommandCompleteEvent *>(data.data());
+			memcpy(this, pData, sizeof(CommandCompleteEvent));
 			toHost();
 
 			// Log it
-			Logger::debug(debugText());
+			GGK_LOG_DEBUG(debugText());
 		}
 
 		void toNetwork()
@@ -151,10 +170,10 @@ public:
 		{
 			std::string text = "";
 			text += "> Command complete event\n";
-			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
+			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::getEventTypeName(header.code) + ")\n";
 			text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
 			text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
-			text += "  + Command code       : " + Utils::hex(commandCode) + " (" + HciAdapter::kCommandCodeNames[commandCode] + ")\n";
+			text += "  + Command code       : " + Utils::hex(commandCode) + " (" + HciAdapter::getCommandCodeName(commandCode) + ")\n";
 			text += "  + Status             : " + Utils::hex(status);
 			return text;
 		}
@@ -166,13 +185,14 @@ public:
 		uint16_t commandCode;
 		uint8_t status;
 
-		CommandStatusEvent(const std::vector<uint8_t> &data)
+		// Parse the event from a received packet, which must hold at least `sizeof(CommandStatusEvent)` bytes
+		CommandStatusEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const CommandStatusEvent *>(data.data());
+			memcpy(this, pData, sizeof(CommandStatusEvent));
 			toHost();
 
 			// Log it
-			Logger::debug(debugText());
+			GGK_LOG_DEBUG(debugText());
 		}
 
 		void toNetwork()
@@ -191,11 +211,11 @@ public:
 		{
 			std::string text = "";
 			text += "> Command status event\n";
-			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
+			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::getEventTypeName(header.code) + ")\n";
 			text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
 			text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
-			text += "  + Command code       : " + Utils::hex(commandCode) + " (" + HciAdapter::kCommandCodeNames[commandCode] + ")\n";
-			text += "  + Status             : " + Utils::hex(status) + " (" + HciAdapter::kStatusCodes[status] + ")";
+			text += "  + Command code       : " + Utils::hex(commandCode) + " (" + HciAdapter::getCommandCodeName(commandCode) + ")\n";
+			text += "  + Status             : " + Utils::hex(status) + " (" + HciAdapter::getStatusCodeName(status) + ")";
 			return text;
 		}
 	} __attribute__((packed));
@@ -208,13 +228,14 @@ public:
 		uint32_t flags;
 		uint16_t eirDataLength;
 
-		DeviceConnectedEvent(const std::vector<uint8_t> &data)
+		// Parse the event from a received packet, which must hold at least `sizeof(DeviceConnectedEvent)` bytes
+		DeviceConnectedEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const DeviceConnectedEvent *>(data.data());
+			memcpy(this, pData, sizeof(DeviceConnectedEvent));
 			toHost();
 
 			// Log it
-			Logger::debug(debugText());
+			GGK_LOG_DEBUG(debugText());
 		}
 
 		void toNetwork()
@@ -235,7 +256,7 @@ public:
 		{
 			std::string text = "";
 			text += "> DeviceConnected event\n";
-			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
+			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::getEventTypeName(header.code) + ")\n";
 			text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
 			text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
 			text += "  + Address            : " + Utils::bluetoothAddressString(address) + "\n";
@@ -258,13 +279,14 @@ public:
 		uint8_t addressType;
 		uint8_t reason;
 
-		DeviceDisconnectedEvent(const std::vector<uint8_t> &data)
+		// Parse the event from a received packet, which must hold at least `sizeof(DeviceDisconnectedEvent)` bytes
+		DeviceDisconnectedEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const DeviceDisconnectedEvent *>(data.data());
+			memcpy(this, pData, sizeof(DeviceDisconnectedEvent));
 			toHost();
 
 			// Log it
-			Logger::debug(debugText());
+			GGK_LOG_DEBUG(debugText());
 		}
 
 		void toNetwork()
@@ -281,7 +303,7 @@ public:
 		{
 			std::string text = "";
 			text += "> DeviceDisconnected event\n";
-			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
+			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::getEventTypeName(header.code) + ")\n";
 			text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
 			text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
 			text += "  + Address            : " + Utils::bluetoothAddressString(address) + "\n";
@@ -416,6 +438,193 @@ public:
 		}
 	} __attribute__((packed));
 
+	// PHY bits, as used by the Get/Set PHY Configuration commands
+	enum HciPhys
+	{
+		EHciPhyBr1M1Slot = (1<<0),
+		EHciPhyBr1M3Slot = (1<<1),
+		EHciPhyBr1M5Slot = (1<<2),
+		EHciPhyEdr2M1Slot = (1<<3),
+		EHciPhyEdr2M3Slot = (1<<4),
+		EHciPhyEdr2M5Slot = (1<<5),
+		EHciPhyEdr3M1Slot = (1<<6),
+		EHciPhyEdr3M3Slot = (1<<7),
+		EHciPhyEdr3M5Slot = (1<<8),
+		EHciPhyLe1MTx = (1<<9),
+		EHciPhyLe1MRx = (1<<10),
+		EHciPhyLe2MTx = (1<<11),
+		EHciPhyLe2MRx = (1<<12),
+		EHciPhyLeCodedTx = (1<<13),
+		EHciPhyLeCodedRx = (1<<14)
+	};
+
+	// Response to the Get PHY Configuration command (see `HciPhys`)
+	struct PhyConfiguration
+	{
+		uint32_t supportedPhys;
+		uint32_t configurablePhys;
+		uint32_t selectedPhys;
+
+		void toHost()
+		{
+			supportedPhys = Utils::endianToHost(supportedPhys);
+			configurablePhys = Utils::endianToHost(configurablePhys);
+			selectedPhys = Utils::endianToHost(selectedPhys);
+		}
+
+		std::string debugText()
+		{
+			std::string text = "";
+			text += "> PHY configuration\n";
+			text += "  + Supported PHYs     : " + Utils::hex(supportedPhys) + "\n";
+			text += "  + Configurable PHYs  : " + Utils::hex(configurablePhys) + "\n";
+			text += "  + Selected PHYs      : " + Utils::hex(selectedPhys);
+			return text;
+		}
+	} __attribute__((packed));
+
+	struct NewConnectionParameterEvent
+	{
+		HciHeader header;
+		uint8_t address[6];
+		uint8_t addressType;
+		uint8_t storeHint;
+		uint16_t minInterval;
+		uint16_t maxInterval;
+		uint16_t latency;
+		uint16_t timeout;
+
+		// Parse the event from a received packet, which must hold at least `sizeof(NewConnectionParameterEvent)` bytes
+		NewConnectionParameterEvent(const uint8_t *pData)
+		{
+			memcpy(this, pData, sizeof(NewConnectionParameterEvent));
+			toHost();
+
+			// Log it
+			GGK_LOG_DEBUG(debugText());
+		}
+
+		void toNetwork()
+		{
+			header.toNetwork();
+			minInterval = Utils::endianToHci(minInterval);
+			maxInterval = Utils::endianToHci(maxInterval);
+			latency = Utils::endianToHci(latency);
+			timeout = Utils::endianToHci(timeout);
+		}
+
+		void toHost()
+		{
+			header.toHost();
+			minInterval = Utils::endianToHost(minInterval);
+			maxInterval = Utils::endianToHost(maxInterval);
+			latency = Utils::endianToHost(latency);
+			timeout = Utils::endianToHost(timeout);
+		}
+
+		std::string debugText()
+		{
+			std::string text = "";
+			text += "> NewConnectionParameter event\n";
+			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::getEventTypeName(header.code) + ")\n";
+			text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
+			text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
+			text += "  + Address            : " + Utils::bluetoothAddressString(address) + "\n";
+			text += "  + Address type       : " + Utils::hex(addressType) + "\n";
+			text += "  + Store hint         : " + Utils::hex(storeHint) + "\n";
+			text += "  + Min interval       : " + std::to_string(minInterval) + "\n";
+			text += "  + Max interval       : " + std::to_string(maxInterval) + "\n";
+			text += "  + Latency            : " + std::to_string(latency) + "\n";
+			text += "  + Timeout            : " + std::to_string(timeout);
+			return text;
+		}
+	} __attribute__((packed));
+
+	// The connection parameters and PHYs we would like connections on a controller to use (see `setConnectionPolicy()`)
+	//
+	// Intervals are in units of 1.25ms and the supervision timeout is in units of 10ms, as in the Bluetooth specification. An
+	// interval range of zero leaves the connection parameters to the central. `phys` holds `HciPhys` bits to add to the
+	// controller's PHY selection, or zero to leave the selection alone.
+	struct ConnectionPolicy
+	{
+		uint16_t minInterval;
+		uint16_t maxInterval;
+		uint16_t latency;
+		uint16_t supervisionTimeout;
+		uint32_t phys;
+
+		// Returns true if the policy asks for particular connection parameters
+		bool hasConnectionParameters() const
+		{
+			return minInterval != 0 || maxInterval != 0;
+		}
+
+		// Returns true if the connection parameters (if any) are ones the kernel will accept
+		//
+		// The checks match those the kernel makes: intervals from 7.5ms to 4s, a latency of less than 500 connection events and a
+		// supervision timeout (from 100ms to 32s) long enough to outlast the skipped connection events.
+		bool isValid() const
+		{
+			if (!hasConnectionParameters())
+			{
+				return true;
+			}
+
+			if (minInterval < 6 || maxInterval > 3200 || minInterval > maxInterval) { return false; }
+			if (supervisionTimeout < 10 || supervisionTimeout > 3200) { return false; }
+			if (latency > 499) { return false; }
+			return latency < supervisionTimeout * 4 / maxInterval;
+		}
+	};
+
+	// What we know about a device connected to a controller (see `getConnections()`)
+	//
+	// The address is in the byte order used by the Management API (least significant byte first.)
+	struct Connection
+	{
+		uint8_t address[6];
+		uint8_t addressType;          // 0 = BR/EDR, 1 = LE public, 2 = LE random
+		uint16_t mtu;                 // The ATT MTU BlueZ reported with the device's last request, or 0 if not yet known
+		uint16_t minInterval;         // The connection parameters last reported by the kernel, or 0 if none were reported
+		uint16_t maxInterval;
+		uint16_t latency;
+		uint16_t supervisionTimeout;
+		uint32_t selectedPhys;        // The controller's PHY selection (see `HciPhys`), or 0 if not known
+		std::chrono::steady_clock::time_point connected;
+	};
+
+	// Called from the event thread when a command's response arrives (see `sendCommandAsync()`)
+	//
+	// The `status` is the Mgmt status code (0 = success) and `pData`/`dataSize` refer to the command's return parameters, if any.
+	// The data is only valid for the duration of the call.
+	typedef std::function<void(uint8_t status, const uint8_t *pData, size_t dataSize)> CommandCallback;
+
+	// Called from the event thread when a controller is added to the system (`added` is true) or removed from it
+	typedef std::function<void(uint16_t controllerIndex, bool added)> IndexCallback;
+
+	// A received event, as seen by event handlers and subscribers
+	//
+	// The pointers refer to the event thread's receive buffer, so the event is only valid for the duration of the call it is
+	// passed to. `pParameters` points to the event's parameters, which follow its header.
+	struct EventView
+	{
+		uint16_t eventCode;
+		uint16_t controllerId;
+		const uint8_t *pPacket;
+		size_t packetSize;
+		const uint8_t *pParameters;
+		size_t parametersSize;
+	};
+
+	// Called from the event thread for each event a subscriber asked for (see `subscribe()`)
+	//
+	// Subscribers are called after the adapter has handled the event, so its accessors already reflect it. Like a
+	// `CommandCallback`, a subscriber must not call `sendCommand()`.
+	typedef std::function<void(const EventView &event)> EventSubscriber;
+
+	// Returns the bit for `eventCode` in the event mask given to `subscribe()`
+	static uint64_t eventBit(uint16_t eventCode) { return static_cast<uint64_t>(1) << eventCode; }
+
 	//
 	// Accessors
 	//
@@ -427,11 +636,49 @@ public:
 		return instance;
 	}
 
-	AdapterSettings getAdapterSettings() { return adapterSettings; }
-	ControllerInformation getControllerInformation() { return controllerInformation; }
+	// The adapter information below is tracked separately for each controller (by its zero-based index, as in 'hci0')
+	//
+	// A controller's information is only available once it has been synchronized (see `sync()`)
+	AdapterSettings getAdapterSettings(uint16_t controllerIndex = kDefaultControllerIndex);
+	ControllerInformation getControllerInformation(uint16_t controllerIndex = kDefaultControllerIndex);
 	VersionInformation getVersionInformation() { return versionInformation; }
-	LocalName getLocalName() { return localName; }
-	int getActiveConnectionCount() { return activeConnections; }
+	LocalName getLocalName(uint16_t controllerIndex = kDefaultControllerIndex);
+	int getActiveConnectionCount(uint16_t controllerIndex = kDefaultControllerIndex);
+	PhyConfiguration getPhyConfiguration(uint16_t controllerIndex = kDefaultControllerIndex);
+
+	// Returns the devices currently connected to a controller
+	std::vector<Connection> getConnections(uint16_t controllerIndex = kDefaultControllerIndex);
+
+	// Records the ATT MTU BlueZ reported for a request from the device at `address` (in Management API byte order)
+	//
+	// Does nothing if the device is not connected to the controller.
+	void setConnectionMtu(uint16_t controllerIndex, const uint8_t *pAddress, uint16_t mtu);
+
+	// Sets the connection policy for a controller (see `ConnectionPolicy`)
+	//
+	// The policy's connection parameters are loaded for each device as it connects to the controller. Applying the policy to the
+	// controller itself (its default connection parameters and PHY selection) is done by `Mgmt::applyConnectionPolicy()`.
+	void setConnectionPolicy(uint16_t controllerIndex, const ConnectionPolicy &policy);
+	ConnectionPolicy getConnectionPolicy(uint16_t controllerIndex = kDefaultControllerIndex);
+
+	// Sets the function to call when a controller is added or removed (for example, a USB dongle being plugged in) or clears it
+	//
+	// Index events are only received while the HCI socket is connected, which it is once any command has been sent.
+	void setIndexCallback(IndexCallback callback);
+
+	// Calls `subscriber` for every event whose code is in `eventMask` (see `eventBit()`) until it is unsubscribed
+	//
+	// The kernel only reports changes made by other sockets with a New Settings event; settings changed by our own commands are
+	// reported in the commands' responses. Those responses are passed to New Settings subscribers as New Settings events, with the
+	// response's parameters (the new settings) as the event's parameters; `pPacket` still refers to the whole response.
+	//
+	// Returns an id for `unsubscribe()`, which is never 0
+	int subscribe(uint64_t eventMask, EventSubscriber subscriber);
+
+	// Stops calling the subscriber registered under `id`
+	//
+	// The subscriber may still be running on the event thread when this returns.
+	void unsubscribe(int id);
 
 	//
 	// Disallow copies of our singleton (c++11)
@@ -460,52 +707,211 @@ public:
 	// This method will block until the thread joins
 	void stop();
 
-	// Sends a command over the HCI socket
+	// Sends a command over the HCI socket and waits (up to `kMaxEventWaitTimeMS`) for its response
 	//
 	// If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
 	// a failure is returned.
 	//
+	// This must not be called from the event thread (for example, from a `CommandCallback`) since that thread delivers the response.
+	//
 	// Returns true on success, otherwise false
 	bool sendCommand(HciHeader &request);
 
+	// Sends a command over the HCI socket without waiting for its response
+	//
+	// Any number of commands may be in flight at once. Responses are matched to commands by command code and controller index, in
+	// the order the commands were sent. When the response arrives, `callback` (if set) is called from the event thread and the
+	// returned future becomes true.
+	//
+	// The future becomes false if the command could not be sent, if no response arrived within `kMaxEventWaitTimeMS` or if the
+	// adapter was stopped first.
+	std::future<bool> sendCommandAsync(HciHeader &request, CommandCallback callback = CommandCallback());
+
+	// Waits for a command sent with `sendCommandAsync()` to complete
+	//
+	// A command is given `kMaxEventWaitTimeMS` from the time it was sent, so this never waits longer than that.
+	//
+	// Returns the command's result (see `sendCommandAsync()`)
+	bool waitForCommand(std::future<bool> &result);
+
 	// Event processor, responsible for receiving events from the HCI socket
 	//
 	// This mehtod should not be called directly. Rather, it runs continuously on a thread until the server shuts down
 	void runEventThread();
 
 private:
+	// Handles an event, once it has been found to be at least `minimumSize` bytes (including its header)
+	//
+	// Returns false if the event is malformed
+	typedef bool (HciAdapter::*EventHandler)(const EventView &event);
+
+	// Handles the return parameters of a successful command, once they have been found to be exactly `size` bytes
+	//
+	// Returns false if the parameters are malformed
+	typedef bool (HciAdapter::*ResponseHandler)(const EventView &event, const uint8_t *pData, size_t dataSize);
+
+	struct EventHandlerEntry
+	{
+		EventHandler handler;
+		size_t minimumSize;
+	};
+
+	struct ResponseHandlerEntry
+	{
+		ResponseHandler handler;
+		size_t size;
+	};
+
+	// An application's interest in events (see `subscribe()`)
+	struct Subscription
+	{
+		int id;
+		uint64_t eventMask;
+		EventSubscriber subscriber;
+	};
+
+	typedef std::vector<Subscription> SubscriptionList;
+
+	// Event masks only have room for 64 event codes
+	static_assert(kMaxEventType < 64, "Event codes must fit in an event mask");
+
+	// A command that has been sent, but whose response has not yet arrived
+	struct PendingCommand
+	{
+		uint64_t id;
+		uint16_t commandCode;
+		uint16_t controllerId;
+		std::chrono::steady_clock::time_point sent;
+		std::chrono::steady_clock::time_point deadline;
+		CommandCallback callback;
+		std::promise<bool> promise;
+	};
+
+	// Everything we know about a single controller
+	struct Controller
+	{
+		AdapterSettings adapterSettings;
+		ControllerInformation controllerInformation;
+		LocalName localName;
+		PhyConfiguration phyConfiguration;
+		int activeConnections;
+		std::vector<Connection> connections;
+	};
+
 	// Private constructor for our Singleton
-	HciAdapter() : commandResponseLock(commandResponseMutex), activeConnections(0) {}
+	HciAdapter();
 
-	// Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
+	// Adds the handler for events with `eventCode` or for responses to commands with `commandCode` to the dispatch tables
+	void registerEventHandler(uint16_t eventCode, EventHandler handler, size_t minimumSize);
+	void registerResponseHandler(uint16_t commandCode, ResponseHandler handler, size_t size);
+
+	// Validates a received event and hands it to its handler and subscribers
+	//
+	// Malformed events are counted and skipped (see `recordMalformedEvent()`)
+	void dispatchEvent(const EventView &event);
+
+	// Hands an event to the subscribers that asked for `eventCode` (which may differ from the event's own code)
 	//
-	// Returns true if the response event was received for `commandCode` or false if the timeout expired.
+	// Returns true if there were any
+	bool notifySubscribers(uint16_t eventCode, const EventView &event);
+
+	// Counts and logs a malformed event; the event is skipped
+	void recordMalformedEvent(const EventView &event, const std::ostream &reason);
+
+	// Event handlers (see `EventHandler`)
+	bool onCommandComplete(const EventView &event);
+	bool onCommandStatus(const EventView &event);
+	bool onIndexChanged(const EventView &event);
+	bool onNewSettings(const EventView &event);
+	bool onDeviceConnected(const EventView &event);
+	bool onDeviceDisconnected(const EventView &event);
+	bool onNewConnectionParameter(const EventView &event);
+	bool onPhyConfigurationChanged(const EventView &event);
+
+	// Command response handlers (see `ResponseHandler`)
+	bool onVersionInformation(const EventView &event, const uint8_t *pData, size_t dataSize);
+	bool onControllerInformation(const EventView &event, const uint8_t *pData, size_t dataSize);
+	bool onLocalName(const EventView &event, const uint8_t *pData, size_t dataSize);
+	bool onAdapterSettings(const EventView &event, const uint8_t *pData, size_t dataSize);
+	bool onPhyConfiguration(const EventView &event, const uint8_t *pData, size_t dataSize);
+
+	// Returns the state for the controller at `controllerIndex`, creating it if needed
 	//
-	// Command responses are set via `setCommandResponse()`
-	bool waitForCommandResponse(uint16_t commandCode, int timeoutMS);
+	// The caller must hold `controllersMutex`
+	Controller &getController(uint16_t controllerIndex);
 
-	// Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-	void setCommandResponse(uint16_t commandCode);
+	// Sends the connection parameters from the controller's policy (if it has any) to the kernel for a device that just connected
+	//
+	// This is called from the event thread, so it doesn't wait for the response.
+	void loadConnectionParameters(uint16_t controllerIndex, const uint8_t *pAddress, uint8_t addressType);
+
+	// Removes the command registered under `id` without completing it
+	//
+	// Returns true if the command was still pending, otherwise false
+	bool cancelCommand(uint64_t id);
+
+	// Completes the oldest pending command for `commandCode` on `controllerId` with the given response
+	void completeCommand(uint16_t commandCode, uint16_t controllerId, uint8_t status, const uint8_t *pData, size_t dataSize);
+
+	// Fails any pending commands that have passed their deadline (or all of them, if `all` is true)
+	//
+	// The caller must hold `pendingCommandsMutex`
+	void expirePendingCommands(bool all);
 
 	// Our HCI Socket, which allows us to talk directly to the kernel
 	HciSocket hciSocket;
 
+	// Makes sure the HCI socket is connected and the run thread is running (see `start()`)
+	//
+	// Unlike `start()`, this succeeds if the thread is already running. Returns true if the thread is running.
+	bool ensureStarted();
+
+	// Connects the HCI socket if needed and starts the run thread (see `start()`)
+	//
+	// The caller must hold `eventThreadMutex` and the thread must not already be running
+	bool startEventThread();
+
 	// Our event thread listens for events coming from the adapter and deals with them appropriately
 	static std::thread eventThread;
 
+	// Serializes starting the event thread, since commands (which start it on demand) are sent from more than one thread
+	static std::mutex eventThreadMutex;
+
 	// Our adapter information
-	AdapterSettings adapterSettings;
-	ControllerInformation controllerInformation;
+	//
+	// The version information belongs to the Management API itself; everything else is per-controller. The mgmt socket is shared
+	// by every controller, so events are sorted by the controller index in their header.
 	VersionInformation versionInformation;
-	LocalName localName;
+	std::mutex controllersMutex;
+	std::map<uint16_t, Controller> controllers;
+
+	// Connection policies by controller index (see `setConnectionPolicy()`)
+	//
+	// These are kept apart from `controllers`, since the application's policy still applies to a controller that was removed and
+	// has come back.
+	std::map<uint16_t, ConnectionPolicy> connectionPolicies;
 
-	std::condition_variable cvCommandResponse;
-	std::mutex commandResponseMutex;
-	std::unique_lock<std::mutex> commandResponseLock;
-	int conditionalValue;
+	// Commands awaiting a response, oldest first
+	std::mutex pendingCommandsMutex;
+	std::list<PendingCommand> pendingCommands;
+	uint64_t nextCommandId;
 
-	// Our active connection count
-	int activeConnections;
+	// Told about controllers coming and going (see `setIndexCallback()`)
+	std::mutex indexCallbackMutex;
+	IndexCallback indexCallback;
+
+	// Our dispatch tables, indexed by event code and command code (see `registerEventHandler()`)
+	//
+	// These are filled in by the constructor and never change after, so the event thread reads them without a lock.
+	EventHandlerEntry eventHandlers[kMaxEventType + 1];
+	ResponseHandlerEntry responseHandlers[kMaxCommandCode + 1];
+
+	// Told about events (see `subscribe()`)
+	//
+	// The list is replaced rather than changed, so the event thread can walk the one it loaded without holding a lock.
+	std::mutex subscriptionsMutex;
+	std::shared_ptr<const SubscriptionList> pSubscriptions;
+	int nextSubscriptionId;
 };
 
 }; // namespace ggk
\ No newline at end of file
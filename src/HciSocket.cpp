@@ -34,6 +34,8 @@
 #include <bluetooth/hci.h>
 #include <thread>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "HciSocket.h"
 #include "Logger.h"
@@ -41,10 +43,35 @@
 
 namespace ggk {
 
+// Storage for our constants (they are passed by reference, so they need a definition)
+const size_t HciSocket::kResponseMaxSize;
+
 // Initializes an unconnected socket
 HciSocket::HciSocket()
-: fdSocket(-1)
+: fdSocket(-1), fdEpoll(-1), fdShutdown(-1)
 {
+	fdShutdown = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fdShutdown < 0)
+	{
+		logErrno("eventfd");
+		return;
+	}
+
+	fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+	if (fdEpoll < 0)
+	{
+		logErrno("epoll_create1");
+		return;
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = fdShutdown;
+	if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdShutdown, &event) < 0)
+	{
+		logErrno("epoll_ctl(fdShutdown)");
+	}
 }
 
 // Socket destructor
@@ -53,6 +80,16 @@ HciSocket::HciSocket()
 HciSocket::~HciSocket()
 {
 	disconnect();
+
+	if (fdEpoll >= 0)
+	{
+		close(fdEpoll);
+	}
+
+	if (fdShutdown >= 0)
+	{
+		close(fdShutdown);
+	}
 }
 
 // Connects to an HCI socket using the Bluetooth Management API protocol
@@ -82,7 +119,29 @@ bool HciSocket::connect()
 		return false;
 	}
 
-	Logger::debug(SSTR << "Connected to HCI control socket (fd = " << fdSocket << ")");
+	if (fdEpoll < 0)
+	{
+		GGK_LOG_ERROR("Unable to wait on the HCI socket (no epoll instance)");
+		disconnect();
+		return false;
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = fdSocket;
+	if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdSocket, &event) < 0)
+	{
+		logErrno("Connect(epoll_ctl)");
+		disconnect();
+		return false;
+	}
+
+	// Clear out any shutdown request left over from a previous connection
+	eventfd_t value;
+	eventfd_read(fdShutdown, &value);
+
+	GGK_LOG_DEBUG(SSTR << "Connected to HCI control socket (fd = " << fdSocket << ")");
 
 	return true;
 }
@@ -98,7 +157,7 @@ void HciSocket::disconnect()
 {
 	if (isConnected())
 	{
-		Logger::debug("HciSocket disconnecting");
+		GGK_LOG_DEBUG("HciSocket disconnecting");
 
 		if (close(fdSocket) != 0)
 		{
@@ -106,7 +165,19 @@ void HciSocket::disconnect()
 		}
 
 		fdSocket = -1;
-		Logger::trace("HciSocket closed");
+		GGK_LOG_TRACE("HciSocket closed");
+	}
+}
+
+// Wakes up any thread waiting in `read()` so that it can shut down
+//
+// This is safe to call from any thread. A `read()` that starts after this call will also return immediately, until the socket
+// is connected again.
+void HciSocket::requestShutdown()
+{
+	if (fdShutdown >= 0 && eventfd_write(fdShutdown, 1) < 0)
+	{
+		logErrno("eventfd_write");
 	}
 }
 
@@ -118,8 +189,28 @@ void HciSocket::disconnect()
 // an error, as this can arise from expected conditions (such as an interrupt.)
 bool HciSocket::read(std::vector<uint8_t> &response) const
 {
-	// Fill our response with empty data
-	response.resize(kResponseMaxSize, 0);
+	response.resize(kResponseMaxSize);
+
+	size_t bytesRead = 0;
+	if (!read(response.data(), response.size(), bytesRead))
+	{
+		response.resize(0);
+		return false;
+	}
+
+	response.resize(bytesRead);
+	return true;
+}
+
+// Reads a single packet from the HCI socket into a caller-owned buffer
+//
+// The buffer is not cleared or resized, so callers can reuse one buffer (of at least `kResponseMaxSize` bytes) for every
+// packet. On success, `bytesRead` receives the size of the packet.
+//
+// Returns true if any data was read successfully, otherwise false is returned in the case of an error or a shutdown.
+bool HciSocket::read(uint8_t *pBuffer, size_t bufferSize, size_t &bytesRead) const
+{
+	bytesRead = 0;
 
 	// Wait for data or a cancellation
 	if (!waitForDataOrShutdown())
@@ -128,36 +219,37 @@ bool HciSocket::read(std::vector<uint8_t> &response) const
 	}
 
 	// Block until we receive data, a disconnect, or a signal
-	ssize_t bytesRead = ::recv(fdSocket, &response[0], kResponseMaxSize, MSG_WAITALL);
+	ssize_t result = ::recv(fdSocket, pBuffer, bufferSize, MSG_WAITALL);
 
-	// If there was an error, wipe the data and return an error condition
-	if (bytesRead < 0)
+	// If there was an error, return an error condition
+	if (result < 0)
 	{
 		if (errno == EINTR)
 		{
-			Logger::debug("HciSocket receive interrupted");
+			GGK_LOG_DEBUG("HciSocket receive interrupted");
 		}
 		else
 		{
 			logErrno("recv");
 		}
-		response.resize(0);
 		return false;
 	}
-	else if (bytesRead == 0)
+	else if (result == 0)
 	{
-		Logger::error("Peer closed the socket");
-		response.resize(0);
+		GGK_LOG_ERROR("Peer closed the socket");
 		return false;
 	}
 
 	// We have data
-	response.resize(bytesRead);
+	bytesRead = static_cast<size_t>(result);
 
-	std::string dump = "";
-	dump += "  > Read " + std::to_string(response.size()) + " bytes\n";
-	dump += Utils::hex(response.data(), response.size());
-	Logger::debug(dump);
+	if (Logger::isDebugEnabled())
+	{
+		std::string dump = "";
+		dump += "  > Read " + std::to_string(bytesRead) + " bytes\n";
+		dump += Utils::hex(pBuffer, bytesRead);
+		GGK_LOG_DEBUG(dump);
+	}
 
 	return true;
 }
@@ -175,10 +267,13 @@ bool HciSocket::write(std::vector<uint8_t> buffer) const
 // This method returns true if the bytes were written successfully, otherwise false
 bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
 {
-	std::string dump = "";
-	dump += "  > Writing " + std::to_string(count) + " bytes\n";
-	dump += Utils::hex(pBuffer, count);
-	Logger::debug(dump);
+	if (Logger::isDebugEnabled())
+	{
+		std::string dump = "";
+		dump += "  > Writing " + std::to_string(count) + " bytes\n";
+		dump += Utils::hex(pBuffer, count);
+		GGK_LOG_DEBUG(dump);
+	}
 
 	size_t len = ::write(fdSocket, pBuffer, count);
 
@@ -193,29 +288,34 @@ bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
 
 // Wait for data to arrive, or for a shutdown event
 //
+// This blocks without a timeout; a shutdown is signalled through `requestShutdown()`.
+//
 // Returns true if data is available, false if we are shutting down
 bool HciSocket::waitForDataOrShutdown() const
 {
 	while(ggkIsServerRunning())
 	{
-		fd_set rfds;
-		FD_ZERO(&rfds);
-		FD_SET(fdSocket, &rfds);
+		struct epoll_event events[2];
+		int count = epoll_wait(fdEpoll, events, 2, -1);
 
-		struct timeval tv;
-		tv.tv_sec = 0;
-		tv.tv_usec = kDataWaitTimeMS * 1000;
-
-		int retval = select(fdSocket+1, &rfds, NULL, NULL, &tv);
+		if (count < 0)
+		{
+			// Interrupted by a signal; check our run state and keep waiting
+			if (errno == EINTR) { continue; }
 
-		// Do we have data?
-		if (retval > 0) { return true; }
+			logErrno("epoll_wait");
+			return false;
+		}
 
-		// We have an error
-		if (retval < 0) { return false; }
+		// A shutdown request takes priority over any data
+		bool bDataAvailable = false;
+		for (int i = 0; i < count; ++i)
+		{
+			if (events[i].data.fd == fdShutdown) { return false; }
+			if (events[i].data.fd == fdSocket) { bDataAvailable = true; }
+		}
 
-		// No data; keep waiting
-		continue;
+		if (bDataAvailable) { return true; }
 	}
 
 	return false;
@@ -230,7 +330,7 @@ void HciSocket::logErrno(const char *pOperation) const
 		errorDetail += " or not enough permission for this operation";
 	}
 
-	Logger::error(SSTR << "Error on Bluetooth management socket during " << pOperation << " operation. Error code " << errno << ": " << errorDetail);
+	GGK_LOG_ERROR(SSTR << "Error on Bluetooth management socket during " << pOperation << " operation. Error code " << errno << ": " << errorDetail);
 }
 
 }; // namespace ggk
@@ -39,6 +39,9 @@ public:
 	// This will automatically disconnect the socket if it is currently connected
 	~HciSocket();
 
+	// The largest packet we expect to receive from the HCI socket
+	static const size_t kResponseMaxSize = 64 * 1024;
+
 	// Connects to an HCI socket using the Bluetooth Management API protocol
 	//
 	// Returns true on success, otherwise false
@@ -50,6 +53,12 @@ public:
 	// Disconnects from the HCI socket
 	void disconnect();
 
+	// Wakes up any thread waiting in `read()` so that it can shut down
+	//
+	// This is safe to call from any thread. A `read()` that starts after this call will also return immediately, until the socket
+	// is connected again.
+	void requestShutdown();
+
 	// Reads data from the HCI socket
 	//
 	// Raw data is read until no more data is available. If no data is available when this method initially starts to read, it will
@@ -58,6 +67,14 @@ public:
 	// Returns true if any data was read successfully, otherwise false is returned in the case of an error or a timeout.
 	bool read(std::vector<uint8_t> &response) const;
 
+	// Reads a single packet from the HCI socket into a caller-owned buffer
+	//
+	// The buffer is not cleared or resized, so callers can reuse one buffer (of at least `kResponseMaxSize` bytes) for every
+	// packet. On success, `bytesRead` receives the size of the packet.
+	//
+	// Returns true if any data was read successfully, otherwise false is returned in the case of an error or a shutdown.
+	bool read(uint8_t *pBuffer, size_t bufferSize, size_t &bytesRead) const;
+
 	// Writes the array of bytes of a given count
 	//
 	// This method returns true if the bytes were written successfully, otherwise false
@@ -80,8 +97,14 @@ private:
 
 	int	fdSocket;
 
-	const size_t kResponseMaxSize = 64 * 1024;
-	const int kDataWaitTimeMS = 10;
+	// An epoll instance that watches `fdSocket` and `fdShutdown`
+	int fdEpoll;
+
+	// An eventfd that is signalled by `requestShutdown()`
+	//
+	// This lives as long as the HciSocket itself, so that `requestShutdown()` never races with a disconnect.
+	int fdShutdown;
+
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -33,11 +33,17 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <gio/gio.h>
+#include <glib-unix.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
 #include <string>
 #include <vector>
+#include <list>
 #include <atomic>
 #include <chrono>
 #include <thread>
+#include <algorithm>
 
 #include "Server.h"
 #include "Globals.h"
@@ -49,6 +55,11 @@
 #include "GattProperty.h"
 #include "Logger.h"
 #include "Init.h"
+#include "UpdateQueue.h"
+#include "TickScheduler.h"
+#include "WorkerPool.h"
+#include "Stats.h"
+#include "Trace.h"
 
 namespace ggk {
 
@@ -56,36 +67,159 @@ namespace ggk {
 // Constants
 //
 
-static const int kPeriodicTimerFrequencySeconds = 1;
-static const int kRetryDelaySeconds = 2;
 static const int kIdleFrequencyMS = 10;
 
+// Failed initialization steps are retried after a delay that starts at kMinRetryDelayMS and doubles with each consecutive failure,
+// up to kMaxRetryDelayMS (see `setRetry()`)
+static const int kMinRetryDelayMS = 250;
+static const int kMaxRetryDelayMS = 2000;
+
+// When true, the update queue is serviced by a GSource that watches an eventfd, which is signalled by `ggkPushUpdateQueue`. The
+// main loop sleeps until there is work to do. When false, we fall back to the original idle-poll (see kIdleFrequencyMS.)
+static const bool kEventDrivenUpdates = true;
+
+// The maximum number of queued updates we'll process in a single main loop dispatch. Anything beyond this is left for the next
+// dispatch so that a burst of updates can't starve D-Bus method calls and property requests.
+static const size_t kMaxUpdateBatchSize = 64;
+
 //
 // Retries
 //
 
-static time_t retryTimeStart = 0;
+// The one-shot timer for a pending retry (or 0), along with its delay and the delay to use for the next one
+static guint retryTimeoutId = 0;
+static int retryPendingDelayMS = 0;
+static int retryDelayMS = kMinRetryDelayMS;
+
+//
+// Startup timing
+//
+
+// When the server thread started initializing, for the total startup time (see `GGKStats::initMicroseconds`)
+static uint64_t initStartMicroseconds = 0;
 
 //
 // Adapter configuration
 //
+// The bus connection, main loop and BlueZ ObjectManager are shared. Everything that belongs to a single controller lives in that
+// server's `ServerState`.
+//
+
+// Everything we track while bringing up (and running) a single server on its controller
+struct ServerState
+{
+	std::shared_ptr<Server> pServer;
+	guint ownedNameId = 0;
+	std::vector<guint> registeredObjectIds;
+	GDBusObject *pBluezAdapterObject = nullptr;
+	GDBusProxy *pBluezGattManagerProxy = nullptr;
+	GDBusProxy *pBluezAdapterInterfaceProxy = nullptr;
+	GDBusProxy *pBluezAdapterPropertiesInterfaceProxy = nullptr;
+	bool bOwnedNameAcquired = false;
+	bool bAdapterConfigured = false;
+	bool bObjectsRegistered = false;
+	bool bApplicationRegistered = false;
+	std::string bluezGattManagerInterfaceName = "";
+
+	// Set while the matching asynchronous step is in flight, so it isn't started twice
+	bool bOwnedNamePending = false;
+	bool bAdapterConfigPending = false;
+	bool bRegisterApplicationPending = false;
+
+	// When each of this server's initialization phases was last started (see `completePhase()`)
+	uint64_t phaseStartMicroseconds[EInitPhaseCount] = {};
+
+	// The thread configuring this server's controller (see `configureAdapter()`)
+	std::thread configureThread;
+};
 
 GDBusConnection *pBusConnection = nullptr;
-static guint ownedNameId = 0;
-static guint periodicTimeoutId = 0;
-static std::vector<guint> registeredObjectIds;
 static std::atomic<GMainLoop *> pMainLoop(nullptr);
 static GDBusObjectManager *pBluezObjectManager = nullptr;
-static GDBusObject *pBluezAdapterObject = nullptr;
-static GDBusObject *pBluezDeviceObject = nullptr;
-static GDBusProxy *pBluezGattManagerProxy = nullptr;
-static GDBusProxy *pBluezAdapterInterfaceProxy = nullptr;
-static GDBusProxy *pBluezDeviceInterfaceProxy = nullptr;
-static GDBusProxy *pBluezAdapterPropertiesInterfaceProxy = nullptr;
-static bool bOwnedNameAcquired = false;
-static bool bAdapterConfigured = false;
-static bool bApplicationRegistered = false;
-static std::string bluezGattManagerInterfaceName = "";
+
+// Set while the shared asynchronous steps are in flight, along with when they were started
+static bool bBusPending = false;
+static bool bObjectManagerPending = false;
+static uint64_t busPhaseStartMicroseconds = 0;
+static uint64_t objectManagerPhaseStartMicroseconds = 0;
+
+// Set once any server has held its owned name (see `doOwnedNameAcquire()`)
+static bool bOwnedNameEverAcquired = false;
+
+// Our watch on BlueZ's name on the bus (see `watchBluez()`)
+static guint bluezWatchId = 0;
+
+// One entry for each server in `getServers()`, in the same order (see `syncServerStates()`)
+//
+// This is only touched from the main loop's thread. A list, so the states don't move while async calls hold pointers to them.
+static std::list<ServerState> serverStates;
+
+// Returns the user data for async calls made on behalf of `state` (see `findServerState()`)
+//
+// We pass the server's index rather than a pointer, so a call that completes after its state is gone finds nothing.
+static gpointer serverStateUserData(const ServerState &state)
+{
+	return GINT_TO_POINTER(state.pServer->getServerIndex() + 1);
+}
+
+// Returns the state identified by user data from `serverStateUserData()`, or nullptr if there is no such state
+static ServerState *findServerState(gpointer pUserData)
+{
+	int serverIndex = GPOINTER_TO_INT(pUserData) - 1;
+	for (ServerState &state : serverStates)
+	{
+		if (state.pServer->getServerIndex() == serverIndex)
+		{
+			return &state;
+		}
+	}
+
+	return nullptr;
+}
+
+// Adds a state for each server in `getServers()` that we haven't seen yet
+//
+// Servers are only ever appended to that list while we're running, so the new ones are always at the end.
+static void syncServerStates()
+{
+	std::shared_ptr<const ServerList> pServers = getServers();
+	for (size_t i = serverStates.size(); i < pServers->size(); ++i)
+	{
+		serverStates.push_back(ServerState());
+		serverStates.back().pServer = (*pServers)[i];
+	}
+}
+
+// Records the time taken by an initialization phase started at `startMicroseconds`, and logs it
+//
+// `subject` names what the phase was for (a server's controller, for example) or is empty for the shared phases.
+static void completePhase(GGKInitPhase phase, uint64_t startMicroseconds, const std::string &subject)
+{
+	uint64_t elapsed = Stats::nowMicroseconds() - startMicroseconds;
+	Stats::getInstance().recordInitPhase(phase, elapsed);
+	GGK_LOG_INFO(SSTR << "Startup phase '" << ggkGetInitPhaseString(phase) << "'" << (subject.empty() ? "" : " for ") << subject << " took " << elapsed / 1000.0 << "ms");
+}
+
+// Returns the path of the BlueZ adapter object for the server in `state`
+//
+// BlueZ names its adapters after their controllers (/org/bluez/hci0, /org/bluez/hci1, ...)
+static std::string bluezAdapterPath(const ServerState &state)
+{
+	return "/org/bluez/hci" + std::to_string(state.pServer->getControllerIndex());
+}
+
+// Returns a description of the server in `state` for log entries
+static std::string describeServer(const ServerState &state)
+{
+	return "'" + state.pServer->getServiceName() + "' (hci" + std::to_string(state.pServer->getControllerIndex()) + ")";
+}
+
+//
+// Update queue wakeup
+//
+
+static std::atomic<int> updateEventFd(-1);
+static guint updateEventSourceId = 0;
 
 //
 // Externs
@@ -108,72 +242,161 @@ static void initializationStateProcessor();
 // |___\__,_|_|\___| /_/     \__,_|\__,_|\__\__,_|  | .__/|_|  \___/ \___\___||___/___/_|_| |_|\__, |
 //                                                  |_|                                        |___/
 //
-// Our idle funciton is what processes data updates. We handle this in a simple way. We update the data directly in our global
-// `TheServer` object, then call `ggkPushUpdateQueue` to trigger that data to be updated (in whatever way the service responsible
+// Our idle funciton is what processes data updates. We handle this in a simple way. We update the data directly in our servers
+// (see `getServers()`), then call `ggkPushUpdateQueue` to trigger that data to be updated (in whatever way the service responsible
 // for that data() sees fit.
 //
 // This is done using the `ggkPushUpdateQueue` / `ggkPopUpdateQueue` methods to manage the queue of pending update messages. Each
 // entry represents an interface that needs to be updated. The idleFunc calls the interface's `onUpdatedValue` method for each
-// update.
+// update. Updates for characteristics that nobody is subscribed to are dropped (see `GattCharacteristic::isUnobserved()`.)
 //
-// The idle processor will perform one update per idle tick, however, it will notify that there is more data so the idle ticks
-// do not lag behind.
+// Updates are processed in batches of up to kMaxUpdateBatchSize entries per dispatch. The batch is taken from the queue under a
+// single lock, then dispatched without holding the lock. If there is more data waiting, we'll get back to it on the next pass of
+// the main loop so the rest of the system gets a chance to run.
+//
+// By default (see kEventDrivenUpdates) we don't actually idle at all. Instead, `ggkPushUpdateQueue` signals an eventfd when the
+// queue goes from empty to non-empty, and a GSource watching that eventfd drains the queue on the main loop. This gives us
+// immediate notifications without waking the main loop when there is nothing to do.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// Process a single update for the interface `interfaceName` at `objectPath`
+//
+// Returns true if the update was delivered to an interface, otherwise false
+static bool processUpdate(const DBusObjectPath &objectPath, const std::string &interfaceName, void *pUserData)
+{
+	// We have an update - call the onUpdatedValue method on the interface
+	//
+	// Each server's objects live under its own application path, so at most one server will have it
+	std::shared_ptr<const DBusInterface> pInterface;
+	for (const std::shared_ptr<Server> &pServer : *getServers())
+	{
+		pInterface = pServer->findInterface(objectPath, interfaceName);
+		if (nullptr != pInterface) { break; }
+	}
+
+	if (nullptr == pInterface)
+	{
+		GGK_LOG_WARN(SSTR << "Unable to find interface for update: path[" << objectPath << "], name[" << interfaceName << "]");
+	}
+	else
+	{
+		// Is it a characteristic?
+		if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
+		{
+			// Nobody is listening, so there's no point reading the value to tell them about it
+			if (pCharacteristic->isUnobserved())
+			{
+				return false;
+			}
+
+			GGK_LOG_DEBUG(SSTR << "Processing updated value for interface '" << interfaceName << "' at path '" << objectPath << "'");
+			pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 // Our idle function
 //
 // This method is used to process data on the same thread as our main loop. This allows us to communicate with our service from
 // the outside.
 //
+// Each call will process up to kMaxUpdateBatchSize updates.
+//
 // IMPORTANT: This method must return 'true' if any work was performed, otherwise it must return 'false'. Returning 'true' will
 // cause the idle loop to continue to call this method to process data at the maximum rate (which can peg the CPU at 100%.) By
 // returning false when there is no work to do, we are nicer to the system.
 bool idleFunc(void *pUserData)
 {
-
 	// Don't do anything unless we're running
 	if (ggkGetServerRunState() != ERunning)
 	{
 		return false;
 	}
 
-	// Try to get an update
-	const int kQueueEntryLen = 1024;
-	char queueEntry[kQueueEntryLen];
-	if (ggkPopUpdateQueue(queueEntry, kQueueEntryLen, 0) != 1)
+	// Grab the next batch of updates
+	//
+	// This is only ever called from the main loop's thread, so we keep the batch storage around between calls
+	static std::vector<UpdateQueue::Entry> batch;
+	if (UpdateQueue::getInstance().popBatch(batch, kMaxUpdateBatchSize) == 0)
 	{
 		return false;
 	}
 
-	std::string entryString = queueEntry;
-	auto token = entryString.find('|');
-	if (token == std::string::npos)
+	// Any change notifications sent for this batch go out together once it's done
+	DBusSignalBatch signals;
+	for (const UpdateQueue::Entry &entry : batch)
 	{
-		Logger::error("Queue entry was not formatted properly - could not find separating token");
-		return false;
+		// Handle updates were resolved up-front, so there's no lookup to do
+		if (entry.handle != 0)
+		{
+			std::shared_ptr<const GattCharacteristic> pCharacteristic = getResolvedCharacteristic(entry.handle);
+			if (nullptr == pCharacteristic)
+			{
+				GGK_LOG_WARN(SSTR << "Unable to find characteristic for update handle " << entry.handle);
+				continue;
+			}
+
+			if (!pCharacteristic->isUnobserved())
+			{
+				pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
+			}
+		}
+		else
+		{
+			processUpdate(DBusObjectPath(entry.objectPath), entry.interfaceName, pUserData);
+		}
 	}
 
-	DBusObjectPath objectPath = DBusObjectPath(entryString.substr(0, token));
-	std::string interfaceName = entryString.substr(token+1);
+	return true;
+}
 
-	// We have an update - call the onUpdatedValue method on the interface
-	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(objectPath, interfaceName);
-	if (nullptr == pInterface)
+// Wake the main loop so it can process the update queue
+//
+// This is called (from any thread) by whoever claims the queue's wakeup after pushing an update (see
+// `UpdateQueue::claimWakeup`). If the server's main loop isn't up yet (or we're running in idle-poll mode) this does nothing; the
+// queue will be serviced once we're running.
+void wakeUpdateQueue()
+{
+	int fd = updateEventFd;
+	if (fd < 0)
 	{
-		Logger::warn(SSTR << "Unable to find interface for update: path[" << objectPath << "], name[" << interfaceName << "]");
+		return;
 	}
-	else
+
+	uint64_t one = 1;
+	if (write(fd, &one, sizeof(one)) != sizeof(one))
 	{
-		// Is it a characteristic?
-		if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
-		{
-			Logger::debug(SSTR << "Processing updated value for interface '" << interfaceName << "' at path '" << objectPath << "'");
-			pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
-			return true;
-		}
+		GGK_LOG_WARN(SSTR << "Unable to signal the update queue eventfd");
+	}
+}
+
+// Main loop handler for the update queue eventfd
+//
+// We reset the eventfd counter and the queue's wakeup claim first, then process a single batch from the queue. If there's anything
+// left over, we re-signal the eventfd ourselves so we get called again on the next main loop iteration, after any other pending
+// sources have had a chance to run. Any update pushed while we're processing will either be picked up by this pass, be left over
+// (and therefore covered by our own re-signal) or will claim the wakeup and re-signal the eventfd itself.
+static gboolean onUpdateQueueEvent(gint fd, GIOCondition /*condition*/, gpointer pUserData)
+{
+	uint64_t count = 0;
+	if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+	{
+		GGK_LOG_WARN(SSTR << "Unable to read the update queue eventfd");
 	}
 
-	return false;
+	UpdateQueue &queue = UpdateQueue::getInstance();
+	queue.resetWakeup();
+
+	if (idleFunc(pUserData) && !queue.empty() && queue.claimWakeup())
+	{
+		wakeUpdateQueue();
+	}
+
+	// Always return TRUE so our source remains in tact
+	return TRUE;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -186,47 +409,84 @@ bool idleFunc(void *pUserData)
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Perform final cleanup of various resources that were allocated while the server was initialized and/or running
-void uninit()
+// Release the BlueZ adapter objects found for `state` (see `findAdapterInterface()`)
+static void releaseAdapter(ServerState &state)
 {
-  	// We've left our main loop - nullify its pointer so we know we're no longer running
-  	pMainLoop = nullptr;
-
-	if (nullptr != pBluezAdapterObject)
+	if (nullptr != state.pBluezAdapterObject)
 	{
-		g_object_unref(pBluezAdapterObject);
-		pBluezAdapterObject = nullptr;
+		g_object_unref(state.pBluezAdapterObject);
+		state.pBluezAdapterObject = nullptr;
 	}
 
-	if (nullptr != pBluezDeviceObject)
+	if (nullptr != state.pBluezAdapterInterfaceProxy)
 	{
-		g_object_unref(pBluezDeviceObject);
-		pBluezDeviceObject = nullptr;
+		g_object_unref(state.pBluezAdapterInterfaceProxy);
+		state.pBluezAdapterInterfaceProxy = nullptr;
 	}
 
-	if (nullptr != pBluezAdapterInterfaceProxy)
+	if (nullptr != state.pBluezAdapterPropertiesInterfaceProxy)
 	{
-		g_object_unref(pBluezAdapterInterfaceProxy);
-		pBluezAdapterInterfaceProxy = nullptr;
+		g_object_unref(state.pBluezAdapterPropertiesInterfaceProxy);
+		state.pBluezAdapterPropertiesInterfaceProxy = nullptr;
 	}
 
-	if (nullptr != pBluezDeviceInterfaceProxy)
+	if (nullptr != state.pBluezGattManagerProxy)
 	{
-		g_object_unref(pBluezDeviceInterfaceProxy);
-		pBluezDeviceInterfaceProxy = nullptr;
+		g_object_unref(state.pBluezGattManagerProxy);
+		state.pBluezGattManagerProxy = nullptr;
 	}
 
-	if (nullptr != pBluezAdapterPropertiesInterfaceProxy)
+	state.bluezGattManagerInterfaceName.clear();
+}
+
+// Perform final cleanup of various resources that were allocated while the server was initialized and/or running
+void uninit()
+{
+  	// We've left our main loop - nullify its pointer so we know we're no longer running
+  	pMainLoop = nullptr;
+
+	// Let any handlers still running on a worker reply before we tear down the objects and connection they use
+	WorkerPool::getInstance().stop();
+
+	// No more traffic will reach us, so finish any trace being recorded
+	Trace::getInstance().stop();
+
+	// We no longer care about controllers or BlueZ coming and going
+	HciAdapter::getInstance().setIndexCallback(HciAdapter::IndexCallback());
+	if (0 != bluezWatchId)
 	{
-		g_object_unref(pBluezAdapterPropertiesInterfaceProxy);
-		pBluezAdapterPropertiesInterfaceProxy = nullptr;
+		g_bus_unwatch_name(bluezWatchId);
+		bluezWatchId = 0;
 	}
 
-	if (nullptr != pBluezGattManagerProxy)
+	for (ServerState &state : serverStates)
 	{
-		g_object_unref(pBluezGattManagerProxy);
-		pBluezGattManagerProxy = nullptr;
+		// Each Mgmt command gives up after `HciAdapter::kMaxEventWaitTimeMS`, so this won't be long
+		if (state.configureThread.joinable())
+		{
+			state.configureThread.join();
+		}
+
+		releaseAdapter(state);
+
+		for (guint id : state.registeredObjectIds)
+		{
+			g_dbus_connection_unregister_object(pBusConnection, id);
+		}
+		state.registeredObjectIds.clear();
+
+		if (state.ownedNameId > 0)
+		{
+			g_bus_unown_name(state.ownedNameId);
+			state.ownedNameId = 0;
+		}
+
+		state.pServer->setApplicationRegistered(false);
 	}
+	serverStates.clear();
+	bBusPending = false;
+	bObjectManagerPending = false;
+	bOwnedNameEverAcquired = false;
 
 	if (nullptr != pBluezObjectManager)
 	{
@@ -234,24 +494,25 @@ void uninit()
 		pBluezObjectManager = nullptr;
 	}
 
-	if (!registeredObjectIds.empty())
+	if (0 != retryTimeoutId)
 	{
-		for (guint id : registeredObjectIds)
-		{
-			g_dbus_connection_unregister_object(pBusConnection, id);
-		}
-		registeredObjectIds.clear();
+		g_source_remove(retryTimeoutId);
+		retryTimeoutId = 0;
 	}
+	retryDelayMS = kMinRetryDelayMS;
+
+	TickScheduler::getInstance().stop();
 
-	if (0 != periodicTimeoutId)
+	if (0 != updateEventSourceId)
 	{
-		g_source_remove(periodicTimeoutId);
-		periodicTimeoutId = 0;
+		g_source_remove(updateEventSourceId);
+		updateEventSourceId = 0;
 	}
 
-  	if (ownedNameId > 0)
-  	{
-		g_bus_unown_name(ownedNameId);
+	int fd = updateEventFd.exchange(-1);
+	if (fd >= 0)
+	{
+		close(fd);
 	}
 
 	if (nullptr != pBusConnection)
@@ -284,7 +545,7 @@ void shutdown()
 {
 	if (ggkGetServerRunState() > ERunning)
 	{
-		Logger::warn("Ignoring call to shutdown (we are already shutting down)");
+		GGK_LOG_WARN("Ignoring call to shutdown (we are already shutting down)");
 		return;
 	}
 
@@ -302,57 +563,32 @@ void shutdown()
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
-//  ____           _           _ _        _   _
-// |  _ \ ___ _ __(_) ___   __| (_) ___  | |_(_)_ __ ___   ___ _ __
-// | |_) / _ \ '__| |/ _ \ / _` | |/ __| | __| | '_ ` _ \ / _ \ '__|
-// |  __/  __/ |  | | (_) | (_| | | (__  | |_| | | | | | |  __/ |
-// |_|   \___|_|  |_|\___/ \__,_|_|\___|  \__|_|_| |_| |_|\___|_|
+//  ____      _                _   _
+// |  _ \ ___| |_ _ __ _   _  | |_(_)_ __ ___   ___ _ __
+// | |_) / _ \ __| '__| | | | | __| | '_ ` _ \ / _ \ '__|
+// |  _ <  __/ |_| |  | |_| | | |_| | | | | | |  __/ |
+// |_| \_\___|\__|_|   \__, |  \__|_|_| |_| |_|\___|_|
+//                     |___/
 //
+// Failed initialization steps are retried from a one-shot timer (see `setRetry()`.) Events in the server description (see
+// `onEvent()`) have their own scheduler (see TickScheduler.cpp)
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Periodic timer handler
+// Retry timer handler
 //
-// A periodic timer is a timer fires every so often (see kPeriodicTimerFrequencySeconds.) This is used for our initialization
-// failure retries, but custom code can also be added to a server description (see `onEvent()`)
-gboolean onPeriodicTimer(gpointer pUserData)
+// Picks initialization back up from wherever it left off
+static gboolean onRetryTimer(gpointer /*pUserData*/)
 {
-	// If we're shutting down, don't do anything and stop the periodic timer
-	if (ggkGetServerRunState() > ERunning)
-	{
-		return FALSE;
-	}
+	retryTimeoutId = 0;
 
-	// Deal with retry timers
-	if (0 != retryTimeStart)
+	// If we're shutting down, don't do anything
+	if (ggkGetServerRunState() <= ERunning)
 	{
-		Logger::debug(SSTR << "Ticking retry timer");
-
-		// Has the retry time expired?
-		int secondsRemaining = time(nullptr) - retryTimeStart - kRetryDelaySeconds;
-		if (secondsRemaining >= 0)
-		{
-			retryTimeStart = 0;
-			initializationStateProcessor();
-		}
+		GGK_LOG_DEBUG(SSTR << "Retrying initialization");
+		initializationStateProcessor();
 	}
 
-	// If we're registered, then go ahead and emit signals
-	if (bApplicationRegistered)
-	{
-		// Tick the object hierarchy
-		//
-		// The real goal here is to have the objects tick their interfaces (see `onEvent()` method when adding interfaces inside
-		// 'Server::Server()'
-		for (const DBusObject &object : TheServer->getObjects())
-		{
-			if (object.isPublished())
-			{
-				object.tickEvents(pBusConnection, pUserData);
-			}
-		}
-	}
-
-	return TRUE;
+	return FALSE;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -364,8 +600,59 @@ gboolean onPeriodicTimer(gpointer pUserData)
 //
 // Our event handlers. These are generic, as they parcel out the work to the appropriate server objects (see 'Server::Server()' for
 // the code that manages event handlers.)
+//
+// Each object is registered with the server it belongs to as its user data (see `registerObjectHierarchy()`), which is how we
+// know which server to hand the work to. The server's callbacks are given a null user data pointer, just as they were before
+// there was more than one server.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// Returns the counters for the GATT interface at `objectPath`, or nullptr if statistics are disabled or there is no such interface
+static InterfaceStats *findInterfaceStats(const Server &server, const DBusObjectPath &objectPath, const gchar *pInterfaceName)
+{
+	if (!Stats::isEnabled())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<const DBusInterface> pInterface = server.findInterface(objectPath, pInterfaceName);
+	if (nullptr == pInterface || !pInterface->isGattInterface())
+	{
+		return nullptr;
+	}
+
+	return &std::static_pointer_cast<const GattInterface>(pInterface)->getStats();
+}
+
+// Records the MTU of the connection a GATT request arrived on (see `HciAdapter::getConnections()`)
+//
+// BlueZ passes the requesting device and the connection's MTU in the options dictionary that ends the parameters of ReadValue,
+// WriteValue and friends. Requests without them (including those from older versions of BlueZ, which don't send the MTU) are
+// ignored.
+static void recordConnectionMtu(GVariant *pParameters)
+{
+	gsize childCount = g_variant_n_children(pParameters);
+	if (childCount == 0)
+	{
+		return;
+	}
+
+	GVariant *pOptions = g_variant_get_child_value(pParameters, childCount - 1);
+	if (g_variant_is_of_type(pOptions, G_VARIANT_TYPE_VARDICT))
+	{
+		const gchar *pDevicePath = nullptr;
+		guint16 mtu = 0;
+		uint16_t controllerIndex;
+		uint8_t address[6];
+		if (g_variant_lookup(pOptions, "device", "&o", &pDevicePath) && g_variant_lookup(pOptions, "mtu", "q", &mtu) &&
+			Utils::bluetoothAddressFromDevicePath(pDevicePath, controllerIndex, address))
+		{
+			HciAdapter::getInstance().setConnectionMtu(controllerIndex, address, mtu);
+		}
+	}
+
+	g_variant_unref(pOptions);
+}
+
 // Handle D-Bus method calls
 void onMethodCall
 (
@@ -381,14 +668,33 @@ void onMethodCall
 {
 	// Convert our input path into our custom type for path management
 	DBusObjectPath objectPath(pObjectPath);
+	const Server &server = *static_cast<const Server *>(pUserData);
+
+	if (Trace::isEnabled())
+	{
+		Trace::getInstance().record(ETraceMethodCall, pObjectPath, pInterfaceName, pMethodName, pParameters);
+	}
+
+	InterfaceStats *pStats = findInterfaceStats(server, objectPath, pInterfaceName);
+	uint64_t startMicroseconds = nullptr != pStats ? Stats::nowMicroseconds() : 0;
+
+	if (Stats::isEnabled())
+	{
+		recordConnectionMtu(pParameters);
+	}
 
-	if (!TheServer->callMethod(objectPath, pInterfaceName, pMethodName, pConnection, pParameters, pInvocation, pUserData))
+	if (!server.callMethod(objectPath, pInterfaceName, pMethodName, pConnection, pParameters, pInvocation, nullptr))
 	{
-		Logger::error(SSTR << " + Method not found: [" << pSender << "]:[" << objectPath << "]:[" << pInterfaceName << "]:[" << pMethodName << "]");
+		GGK_LOG_ERROR(SSTR << " + Method not found: [" << pSender << "]:[" << objectPath << "]:[" << pInterfaceName << "]:[" << pMethodName << "]");
 		g_dbus_method_invocation_return_dbus_error(pInvocation, kErrorNotImplemented.c_str(), "This method is not implemented");
 		return;
 	}
 
+	if (nullptr != pStats)
+	{
+		pStats->recordMethodCall(Stats::nowMicroseconds() - startMicroseconds);
+	}
+
 	return;
 }
 
@@ -406,30 +712,43 @@ GVariant *onGetProperty
 {
 	// Convert our input path into our custom type for path management
 	DBusObjectPath objectPath(pObjectPath);
+	const Server &server = *static_cast<const Server *>(pUserData);
 
-	const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
+	if (Trace::isEnabled())
+	{
+		Trace::getInstance().record(ETraceGetProperty, pObjectPath, pInterfaceName, pPropertyName, nullptr);
+	}
 
-	std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+	const GattProperty *pProperty = server.findProperty(objectPath, pInterfaceName, pPropertyName);
+
+	// Only built when needed for an error or a log entry
+	auto propertyPath = [&]() { return std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]"; };
 	if (!pProperty)
 	{
-		Logger::error(SSTR << "Property(get) not found: " << propertyPath);
-	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) not found: " + propertyPath).c_str(), pSender);
+		GGK_LOG_ERROR(SSTR << "Property(get) not found: " << propertyPath());
+	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) not found: " + propertyPath()).c_str(), pSender);
 		return nullptr;
 	}
 
 	if (!pProperty->getGetterFunc())
 	{
-		Logger::error(SSTR << "Property(get) func not found: " << propertyPath);
-	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) func not found: " + propertyPath).c_str(), pSender);
+		GGK_LOG_ERROR(SSTR << "Property(get) func not found: " << propertyPath());
+	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) func not found: " + propertyPath()).c_str(), pSender);
 		return nullptr;
 	}
 
-	Logger::info(SSTR << "Calling property getter: " << propertyPath);
-	GVariant *pResult = pProperty->getGetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, ppError, pUserData);
+	InterfaceStats *pStats = findInterfaceStats(server, objectPath, pInterfaceName);
+	if (nullptr != pStats)
+	{
+		pStats->recordGetProperty();
+	}
+
+	GGK_LOG_INFO(SSTR << "Calling property getter: " << propertyPath());
+	GVariant *pResult = pProperty->getGetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, ppError, nullptr);
 
 	if (nullptr == pResult)
 	{
-	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) failed: " + propertyPath).c_str(), pSender);
+	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) failed: " + propertyPath()).c_str(), pSender);
 	    return nullptr;
 	}
 
@@ -451,28 +770,41 @@ gboolean onSetProperty
 {
 	// Convert our input path into our custom type for path management
 	DBusObjectPath objectPath(pObjectPath);
+	const Server &server = *static_cast<const Server *>(pUserData);
+
+	if (Trace::isEnabled())
+	{
+		Trace::getInstance().record(ETraceSetProperty, pObjectPath, pInterfaceName, pPropertyName, pValue);
+	}
 
-	const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
+	const GattProperty *pProperty = server.findProperty(objectPath, pInterfaceName, pPropertyName);
 
-	std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+	// Only built when needed for an error or a log entry
+	auto propertyPath = [&]() { return std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]"; };
 	if (!pProperty)
 	{
-		Logger::error(SSTR << "Property(set) not found: " << propertyPath);
-	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) not found: " + propertyPath).c_str(), pSender);
+		GGK_LOG_ERROR(SSTR << "Property(set) not found: " << propertyPath());
+	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) not found: " + propertyPath()).c_str(), pSender);
 		return false;
 	}
 
 	if (!pProperty->getSetterFunc())
 	{
-		Logger::error(SSTR << "Property(set) func not found: " << propertyPath);
-	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) func not found: " + propertyPath).c_str(), pSender);
+		GGK_LOG_ERROR(SSTR << "Property(set) func not found: " << propertyPath());
+	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) func not found: " + propertyPath()).c_str(), pSender);
 		return false;
 	}
 
-	Logger::info(SSTR << "Calling property getter: " << propertyPath);
-	if (!pProperty->getSetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, pValue, ppError, pUserData))
+	InterfaceStats *pStats = findInterfaceStats(server, objectPath, pInterfaceName);
+	if (nullptr != pStats)
+	{
+		pStats->recordSetProperty();
+	}
+
+	GGK_LOG_INFO(SSTR << "Calling property getter: " << propertyPath());
+	if (!pProperty->getSetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, pValue, ppError, nullptr))
 	{
-	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) failed: " + propertyPath).c_str(), pSender);
+	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) failed: " + propertyPath()).c_str(), pSender);
 	    return false;
 	}
 
@@ -490,9 +822,25 @@ gboolean onSetProperty
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 // Convenience method for setting a retry timer so that operations can be continuously retried until we eventually succeed
+//
+// The state processor does nothing until the timer fires, though steps that are already in flight still complete. The delay
+// doubles with each retry (up to kMaxRetryDelayMS) and goes back to kMinRetryDelayMS once we're running. A failure while a retry
+// is already pending is picked up by that retry.
 void setRetry()
 {
-	retryTimeStart = time(nullptr);
+	if (Stats::isEnabled())
+	{
+		Stats::getInstance().recordRetry();
+	}
+
+	if (0 != retryTimeoutId)
+	{
+		return;
+	}
+
+	retryPendingDelayMS = retryDelayMS;
+	retryDelayMS = std::min(retryDelayMS * 2, kMaxRetryDelayMS);
+	retryTimeoutId = g_timeout_add(retryPendingDelayMS, onRetryTimer, nullptr);
 }
 
 // Convenience method for setting a retry timer so that failures (related to initialization) can be continuously retried until we
@@ -500,7 +848,7 @@ void setRetry()
 void setRetryFailure()
 {
 	setRetry();
-	Logger::warn(SSTR << "  + Will retry the failed operation in about " << kRetryDelaySeconds << " seconds");
+	GGK_LOG_WARN(SSTR << "  + Will retry the failed operation in about " << retryPendingDelayMS << "ms");
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -513,16 +861,20 @@ void setRetryFailure()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Use the BlueZ GATT Manager proxy to register our GATT application with BlueZ
-void doRegisterApplication()
+// Use the BlueZ GATT Manager proxy (for the server's adapter) to register a server's GATT application with BlueZ
+//
+// The application is registered at the server's application path, where its ObjectManager lives
+void doRegisterApplication(ServerState &state)
 {
 	g_auto(GVariantBuilder) builder;
 	g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
-	GVariant *pParams = g_variant_new("(oa{sv})", "/", &builder);
+	GVariant *pParams = g_variant_new("(oa{sv})", state.pServer->getApplicationPath().c_str(), &builder);
 
+	state.bRegisterApplicationPending = true;
+	state.phaseStartMicroseconds[EInitPhaseRegisterApplication] = Stats::nowMicroseconds();
 	g_dbus_proxy_call
 	(
-		pBluezGattManagerProxy,         // GDBusProxy *proxy
+		state.pBluezGattManagerProxy,   // GDBusProxy *proxy
 		"RegisterApplication",          // const gchar *method_name   (ex: "GetManagedObjects")
 		pParams,                        // GVariant *parameters
 		G_DBUS_CALL_FLAGS_NONE,         // GDBusCallFlags flags
@@ -530,27 +882,42 @@ void doRegisterApplication()
 		nullptr,                        // GCancellable *cancellable
 
 		// GAsyncReadyCallback callback
-		[] (GObject * /*pSourceObject*/, GAsyncResult *pAsyncResult, gpointer /*pUserData*/)
+		[] (GObject *pSourceObject, GAsyncResult *pAsyncResult, gpointer pUserData)
 		{
 			GError *pError = nullptr;
-			GVariant *pVariant = g_dbus_proxy_call_finish(pBluezGattManagerProxy, pAsyncResult, &pError);
+			GVariant *pVariant = g_dbus_proxy_call_finish(G_DBUS_PROXY(pSourceObject), pAsyncResult, &pError);
+			ServerState *pState = findServerState(pUserData);
+			if (nullptr == pState)
+			{
+				if (nullptr != pVariant) { g_variant_unref(pVariant); }
+				return;
+			}
+
+			ServerState &state = *pState;
+			state.bRegisterApplicationPending = false;
 			if (nullptr == pVariant)
 			{
-				Logger::error(SSTR << "Failed to register application: " << (nullptr == pError ? "Unknown" : pError->message));
+				GGK_LOG_ERROR(SSTR << "Failed to register application '" << state.pServer->getApplicationPath() << "': " << (nullptr == pError ? "Unknown" : pError->message));
 				setRetryFailure();
 			}
 			else
 			{
 				g_variant_unref(pVariant);
-				Logger::debug(SSTR << "GATT application registered with BlueZ");
-				bApplicationRegistered = true;
+				GGK_LOG_DEBUG(SSTR << "GATT application '" << state.pServer->getApplicationPath() << "' registered with BlueZ");
+				completePhase(EInitPhaseRegisterApplication, state.phaseStartMicroseconds[EInitPhaseRegisterApplication], describeServer(state));
+				state.bApplicationRegistered = true;
+				state.pServer->setApplicationRegistered(true);
+
+				// Now that we're registered, start firing the events in our server description (see `onEvent()` method when
+				// adding interfaces inside 'Server::Server()')
+				TickScheduler::getInstance().addServer(*state.pServer, pBusConnection, pBusConnection);
 			}
 
 			// Keep going...
 			initializationStateProcessor();
 		},
 
-		nullptr                         // gpointer user_data
+		serverStateUserData(state)      // gpointer user_data
 	);
 }
 
@@ -562,11 +929,15 @@ void doRegisterApplication()
 //  \___/|_.__// |\___|\___|\__| |_|  \___|\__, |_|___/\__|_|  \__,_|\__|_|\___/|_| |_|
 //           |__/                          |___/
 //
-// Before we can register our service(s) with BlueZ, we must first register ourselves with D-Bus. The easiest way to do this is to
-// use an XML description of our D-Bus objects.
+// Before we can register our service(s) with BlueZ, we must first register ourselves with D-Bus. We describe each of our interfaces
+// to D-Bus directly from the server description (see `DBusInterface::generateInterfaceInfo`.) The introspection XML is only
+// generated for debugging.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath = DBusObjectPath(), int depth = 1)
+// Registers every interface of `object` (and all of its descendants) with D-Bus, on behalf of the server in `state`
+//
+// On failure, any objects registered so far are unregistered and this method returns false
+bool registerObjectHierarchy(ServerState &state, const DBusObject &object, int depth = 1)
 {
 	std::string prefix;
 	prefix.insert(0, depth * 2, ' ');
@@ -576,79 +947,83 @@ void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath
 	interfaceVtable.get_property = onGetProperty;
 	interfaceVtable.set_property = onSetProperty;
 
-	GDBusInterfaceInfo **ppInterface = pNode->interfaces;
-
-	Logger::debug(SSTR << prefix << "+ " << pNode->path);
+	GGK_LOG_DEBUG(SSTR << prefix << "+ " << object.getPathNode());
 
-	while(nullptr != *ppInterface)
+	for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
 	{
 		GError *pError = nullptr;
-		Logger::debug(SSTR << prefix << "    (iface: " << (*ppInterface)->name << ")");
+		GGK_LOG_DEBUG(SSTR << prefix << "    (iface: " << pInterface->getName() << ")");
+
+		// D-Bus takes its own reference to the interface info
+		GDBusInterfaceInfo *pInterfaceInfo = pInterface->generateInterfaceInfo();
 		guint registeredObjectId = g_dbus_connection_register_object
 		(
 			pBusConnection,             // GDBusConnection *connection
-			basePath.c_str(),           // const gchar *object_path
-			*ppInterface,               // GDBusInterfaceInfo *interface_info
+			object.getPath().c_str(),   // const gchar *object_path
+			pInterfaceInfo,             // GDBusInterfaceInfo *interface_info
 			&interfaceVtable,           // const GDBusInterfaceVTable *vtable
-			nullptr,                    // gpointer user_data
+			state.pServer.get(),        // gpointer user_data
 			nullptr,                    // GDestroyNotify user_data_free_func
 			&pError                     // GError **error
 		);
+		g_dbus_interface_info_unref(pInterfaceInfo);
 
 		if (0 == registeredObjectId)
 		{
-			Logger::error(SSTR << "Failed to register object: " << (nullptr == pError ? "Unknown" : pError->message));
+			GGK_LOG_ERROR(SSTR << "Failed to register object: " << (nullptr == pError ? "Unknown" : pError->message));
 
 			// Cleanup and pretend like we were never here
-			g_dbus_node_info_unref(pNode);
-			registeredObjectIds.clear();
-
-			// Try again later
-			setRetryFailure();
-			return;
+			for (guint id : state.registeredObjectIds)
+			{
+				g_dbus_connection_unregister_object(pBusConnection, id);
+			}
+			state.registeredObjectIds.clear();
+			return false;
 		}
 
 		// Save the registered object Id so we can clean it up later
-		registeredObjectIds.push_back(registeredObjectId);
-
-		++ppInterface;
+		state.registeredObjectIds.push_back(registeredObjectId);
 	}
 
-	GDBusNodeInfo **ppChild = pNode->nodes;
-	while(nullptr != *ppChild)
+	for (const DBusObject &child : object.getChildren())
 	{
-		registerNodeHierarchy(*ppChild, basePath + (*ppChild)->path, depth + 1);
-
-		++ppChild;
+		if (!registerObjectHierarchy(state, child, depth + 1))
+		{
+			return false;
+		}
 	}
+
+	return true;
 }
 
-void registerObjects()
+// Register the object hierarchy of the server in `state` with D-Bus
+//
+// Returns true on success. On failure, a retry has been scheduled.
+bool registerObjects(ServerState &state)
 {
-	// Parse each object into an XML interface tree
-	for (const DBusObject &object : TheServer->getObjects())
+	uint64_t startMicroseconds = Stats::nowMicroseconds();
+	for (const DBusObject &object : state.pServer->getObjects())
 	{
-		GError *pError = nullptr;
-		std::string xmlString = object.generateIntrospectionXML();
-		GDBusNodeInfo *pNode = g_dbus_node_info_new_for_xml(xmlString.c_str(), &pError);
-		if (nullptr == pNode)
+		// We don't need the XML to register, but it's handy to see when debugging (this logs it)
+		if (Logger::isDebugEnabled())
 		{
-			Logger::error(SSTR << "Failed to introspect XML: " << (nullptr == pError ? "Unknown" : pError->message));
-			setRetryFailure();
-			return;
+			object.generateIntrospectionXML();
 		}
 
-		Logger::debug(SSTR << "Registering object hierarchy with D-Bus hierarchy");
-
-		// Register the node hierarchy
-		registerNodeHierarchy(pNode, DBusObjectPath(pNode->path));
+		GGK_LOG_DEBUG(SSTR << "Registering object hierarchy with D-Bus hierarchy");
 
-		// Cleanup the node
-		g_dbus_node_info_unref(pNode);
+		// Register the object hierarchy
+		if (!registerObjectHierarchy(state, object))
+		{
+			// Try again later
+			setRetryFailure();
+			return false;
+		}
 	}
 
-	// Keep going
-	initializationStateProcessor();
+	completePhase(EInitPhaseRegisterObjects, startMicroseconds, describeServer(state));
+	state.bObjectsRegistered = true;
+	return true;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -661,114 +1036,213 @@ void registerObjects()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Configure an adapter to ensure it is setup the way we need. We turn things on that we need and turn everything else off
-// (to maximize security.)
+// Configure a server's controller to ensure it is setup the way we need. We turn things on that we need and turn everything else
+// off (to maximize security.)
+//
+// Each server configures its own controller (see `Server::getControllerIndex()`), using its own settings.
 //
-// Note that this only works for the first adapter (index 0). Search for kControllerIndex for information.
+// This only talks to the kernel (through HciAdapter) and blocks while it waits for responses, so it is run on a thread of its
+// own (see `configureAdapter()`.) It must not touch anything that belongs to the main loop.
+//
+// Returns true if the controller is configured, otherwise false.
 //
 // See also: https://git.kernel.org/pub/scm/bluetooth/bluez.git/tree/doc/mgmt-api.txt
-void configureAdapter()
+static bool configureController(const Server &server)
 {
-	Mgmt mgmt;
+	Mgmt mgmt(server.getControllerIndex());
 
 	// Get our properly truncated advertising names
-	std::string advertisingName = Mgmt::truncateName(TheServer->getAdvertisingName());
-	std::string advertisingShortName = Mgmt::truncateShortName(TheServer->getAdvertisingShortName());
+	std::string advertisingName = Mgmt::truncateName(server.getAdvertisingName());
+	std::string advertisingShortName = Mgmt::truncateShortName(server.getAdvertisingShortName());
 
 	// Find out what our current settings are
-	HciAdapter::ControllerInformation info = HciAdapter::getInstance().getControllerInformation();
+	HciAdapter::ControllerInformation info = HciAdapter::getInstance().getControllerInformation(server.getControllerIndex());
 
 	// Are all of our settings the way we want them?
 	bool pwFlag = info.currentSettings.isSet(HciAdapter::EHciPowered) == true;
 	bool leFlag = info.currentSettings.isSet(HciAdapter::EHciLowEnergy) == true;
-	bool brFlag = info.currentSettings.isSet(HciAdapter::EHciBasicRate_EnhancedDataRate) == TheServer->getEnableBREDR();
-	bool scFlag = info.currentSettings.isSet(HciAdapter::EHciSecureConnections) == TheServer->getEnableSecureConnection();
-	bool bnFlag = info.currentSettings.isSet(HciAdapter::EHciBondable) == TheServer->getEnableBondable();
-	bool cnFlag = info.currentSettings.isSet(HciAdapter::EHciConnectable) == TheServer->getEnableConnectable();
-	bool diFlag = info.currentSettings.isSet(HciAdapter::EHciDiscoverable) == TheServer->getEnableDiscoverable();
-	bool adFlag = info.currentSettings.isSet(HciAdapter::EHciAdvertising) == TheServer->getEnableAdvertising();
+	bool brFlag = info.currentSettings.isSet(HciAdapter::EHciBasicRate_EnhancedDataRate) == server.getEnableBREDR();
+	bool scFlag = info.currentSettings.isSet(HciAdapter::EHciSecureConnections) == server.getEnableSecureConnection();
+	bool bnFlag = info.currentSettings.isSet(HciAdapter::EHciBondable) == server.getEnableBondable();
+	bool cnFlag = info.currentSettings.isSet(HciAdapter::EHciConnectable) == server.getEnableConnectable();
+	bool diFlag = info.currentSettings.isSet(HciAdapter::EHciDiscoverable) == server.getEnableDiscoverable();
+	bool adFlag = info.currentSettings.isSet(HciAdapter::EHciAdvertising) == server.getEnableAdvertising();
 	bool anFlag = (advertisingName.length() == 0 || advertisingName == info.name) && (advertisingShortName.length() == 0 || advertisingShortName == info.shortName);
 
+	// LE, BR/EDR and Secure Connections can only be changed reliably while the adapter is powered off. Everything else can be
+	// changed while it's powered, so we only power-cycle the adapter (which drops any connected centrals) when we must.
+	bool powerCycle = !leFlag || !brFlag || !scFlag;
+
 	// If everything is setup already, we're done
 	if (!pwFlag || !leFlag || !brFlag || !scFlag || !bnFlag || !cnFlag || !diFlag || !adFlag || !anFlag)
 	{
-		// We need it off to start with
-		if (pwFlag)
+		// We need it off to change the settings that require it
+		bool powered = pwFlag;
+		if (powered && powerCycle)
 		{
-			Logger::debug("Powering off");
-			if (!mgmt.setPowered(false)) { setRetry(); return; }
+			GGK_LOG_DEBUG("Powering off");
+			if (!mgmt.setPowered(false)) { return false; }
+			powered = false;
 		}
 
+		// None of the following commands depends on the outcome of the others, so we send them all at once and collect the results
+		// together below. Only the settings that differ from the adapter's current settings are sent.
+		mgmt.beginPipeline();
+
 		// Enable the LE state (we always set this state if it's not set)
 		if (!leFlag)
 		{
-			Logger::debug("Enabling LE");
-			if (!mgmt.setLE(true)) { setRetry(); return; }
+			GGK_LOG_DEBUG("Enabling LE");
+			if (!mgmt.setLE(true)) { return false; }
 		}
 
 		// Change the Br/Edr state?
 		//
-		// Note that enabling this requries LE to already be enabled or this command will receive a 'rejected' result
+		// Note that enabling this requries LE to already be enabled or this command will receive a 'rejected' result. The kernel
+		// processes our commands in order, so the LE command above will have taken effect first.
 		if (!brFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableBREDR() ? "Enabling":"Disabling") << " BR/EDR");
-			if (!mgmt.setBredr(TheServer->getEnableBREDR())) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (server.getEnableBREDR() ? "Enabling":"Disabling") << " BR/EDR");
+			if (!mgmt.setBredr(server.getEnableBREDR())) { return false; }
 		}
 
 		// Change the Secure Connectinos state?
 		if (!scFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableSecureConnection() ? "Enabling":"Disabling") << " Secure Connections");
-			if (!mgmt.setSecureConnections(TheServer->getEnableSecureConnection() ? 1 : 0)) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (server.getEnableSecureConnection() ? "Enabling":"Disabling") << " Secure Connections");
+			if (!mgmt.setSecureConnections(server.getEnableSecureConnection() ? 1 : 0)) { return false; }
 		}
 
 		// Change the Bondable state?
 		if (!bnFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableBondable() ? "Enabling":"Disabling") << " Bondable");
-			if (!mgmt.setBondable(TheServer->getEnableBondable())) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (server.getEnableBondable() ? "Enabling":"Disabling") << " Bondable");
+			if (!mgmt.setBondable(server.getEnableBondable())) { return false; }
 		}
 
 		// Change the Connectable state?
 		if (!cnFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableConnectable() ? "Enabling":"Disabling") << " Connectable");
-			if (!mgmt.setConnectable(TheServer->getEnableConnectable())) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (server.getEnableConnectable() ? "Enabling":"Disabling") << " Connectable");
+			if (!mgmt.setConnectable(server.getEnableConnectable())) { return false; }
 		}
 
 		// Change the Discoverable state?
 		if (!diFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableDiscoverable() ? "Enabling":"Disabling") << " Discoverable");
-			if (!mgmt.setDiscoverable(TheServer->getEnableDiscoverable() ? 1 : 0, 0)) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (server.getEnableDiscoverable() ? "Enabling":"Disabling") << " Discoverable");
+			if (!mgmt.setDiscoverable(server.getEnableDiscoverable() ? 1 : 0, 0)) { return false; }
 		}
 
 		// Change the Advertising state?
 		if (!adFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableAdvertising() ? "Enabling":"Disabling") << " Advertising");
-			if (!mgmt.setAdvertising(TheServer->getEnableAdvertising() ? 1 : 0)) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (server.getEnableAdvertising() ? "Enabling":"Disabling") << " Advertising");
+			if (!mgmt.setAdvertising(server.getEnableAdvertising() ? 1 : 0)) { return false; }
 		}
 
 		// Set the name?
 		if (!anFlag)
 		{
-			Logger::info(SSTR << "Setting advertising name to '" << advertisingName << "' (with short name: '" << advertisingShortName << "')");
-			if (!mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str())) { setRetry(); return; }
+			GGK_LOG_INFO(SSTR << "Setting advertising name to '" << advertisingName << "' (with short name: '" << advertisingShortName << "')");
+			if (!mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str())) { return false; }
 		}
 
-		// Turn it back on
-		Logger::debug("Powering on");
-		if (!mgmt.setPowered(true)) { setRetry(); return; }
+		if (!mgmt.endPipeline()) { return false; }
+
+		// Turn it (back) on
+		if (!powered)
+		{
+			GGK_LOG_DEBUG("Powering on");
+			if (!mgmt.setPowered(true)) { return false; }
+		}
+	}
+
+	// Ask for the connection parameters and PHYs in the controller's connection policy (see `ggkSetConnectionPolicy()`). Kernels
+	// that predate these commands reject them, which isn't reason enough to keep the server from starting.
+	HciAdapter::ConnectionPolicy policy = HciAdapter::getInstance().getConnectionPolicy(server.getControllerIndex());
+	if (!mgmt.applyConnectionPolicy(policy))
+	{
+		GGK_LOG_WARN(SSTR << "Unable to apply the connection policy to hci" << server.getControllerIndex());
+	}
+
+	GGK_LOG_INFO(SSTR << "The Bluetooth adapter (hci" << server.getControllerIndex() << ") is fully configured");
+	return true;
+}
+
+// Completes the configuration of a server's controller, started by `configureAdapter()`, on the main loop's thread
+static void finishAdapterConfiguration(gpointer pUserData, bool configured)
+{
+	// The server may have gone (or been replaced) while its controller was being configured
+	ServerState *pState = findServerState(pUserData);
+	if (nullptr == pState || !pState->bAdapterConfigPending)
+	{
+		return;
+	}
+
+	ServerState &state = *pState;
+	state.bAdapterConfigPending = false;
+
+	if (!configured)
+	{
+		setRetry();
+		return;
 	}
 
-	Logger::info("The Bluetooth adapter is fully configured");
+	completePhase(EInitPhaseConfigureAdapter, state.phaseStartMicroseconds[EInitPhaseConfigureAdapter], describeServer(state));
+	state.bAdapterConfigured = true;
 
-	// We're all set, nothing to do!
-	bAdapterConfigured = true;
+	// Keep going
 	initializationStateProcessor();
 }
 
+// Idle handlers that deliver the result of a controller's configuration from its thread to the main loop's thread
+static gboolean onAdapterConfigured(gpointer pUserData)
+{
+	finishAdapterConfiguration(pUserData, true);
+	return FALSE;
+}
+
+static gboolean onAdapterConfigurationFailed(gpointer pUserData)
+{
+	finishAdapterConfiguration(pUserData, false);
+	return FALSE;
+}
+
+// Configure the controller of the server in `state` (see `configureController()`)
+//
+// Configuring the controller doesn't involve D-Bus, so it runs on a thread of its own while the state processor carries on with
+// the bus connection, owned name and BlueZ's ObjectManager. The result is handed back to the main loop's thread.
+//
+// Each Mgmt command blocks for its response, so this deliberately stays off the worker pool (see WorkerPool.cpp), where it would
+// hold up the application's async method handlers.
+void configureAdapter(ServerState &state)
+{
+	state.bAdapterConfigPending = true;
+	state.phaseStartMicroseconds[EInitPhaseConfigureAdapter] = Stats::nowMicroseconds();
+
+	// A previous configuration has already delivered its result (we wouldn't be here otherwise), so this doesn't wait
+	if (state.configureThread.joinable())
+	{
+		state.configureThread.join();
+	}
+
+	std::shared_ptr<Server> pServer = state.pServer;
+	gpointer pUserData = serverStateUserData(state);
+	try
+	{
+		state.configureThread = std::thread([pServer, pUserData]()
+		{
+			g_idle_add(configureController(*pServer) ? onAdapterConfigured : onAdapterConfigurationFailed, pUserData);
+		});
+	}
+	catch(std::system_error &ex)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to start the controller configuration thread (code " << ex.code() << "): " << ex.what());
+		finishAdapterConfiguration(pUserData, false);
+	}
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 //     _       _             _
 //    / \   __| | __ _ _ __ | |_ ___ _ __
@@ -779,84 +1253,274 @@ void configureAdapter()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Find the BlueZ's GATT Manager interface for the *first* Bluetooth adapter provided by BlueZ. We'll need this to register our
-// GATT server with BlueZ.
-void findAdapterInterface()
+// Find the BlueZ's GATT Manager interface for the server's Bluetooth adapter. We'll need this to register our GATT server with
+// BlueZ.
+//
+// We look up the adapter object for the server's controller directly (see `bluezAdapterPath()`), rather than taking the first one
+// that has a GATT manager.
+//
+// Returns true on success. If the adapter (or its GATT manager) doesn't exist yet, we wait for BlueZ to tell us it has arrived
+// (see `onBluezObjectAdded()`) rather than polling for it. For any other failure, a retry has been scheduled.
+bool findAdapterInterface(ServerState &state)
 {
-	// Get a list of the BlueZ's D-Bus objects
-	GList *pObjects = g_dbus_object_manager_get_objects(pBluezObjectManager);
-	if (nullptr == pObjects)
+	uint64_t startMicroseconds = Stats::nowMicroseconds();
+	std::string adapterPath = bluezAdapterPath(state);
+
+	// Find the adapter object (we own the returned reference)
+	state.pBluezAdapterObject = g_dbus_object_manager_get_object(pBluezObjectManager, adapterPath.c_str());
+	if (nullptr == state.pBluezAdapterObject)
 	{
-		Logger::error(SSTR << "Unable to get ObjectManager objects");
-		setRetryFailure();
-		return;
+		GGK_LOG_WARN(SSTR << "The adapter '" << adapterPath << "' is not available yet, waiting for it to appear");
+		return false;
 	}
 
-	// Scan the list of objects we find one with a GATT manager interface
-	//
-	// Note that if there are multiple interfaces, we will only find the first
-	for (guint i = 0; i < g_list_length(pObjects) && bluezGattManagerInterfaceName.empty(); ++i)
+	// See if it has a GATT manager interface
+	state.pBluezGattManagerProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(state.pBluezAdapterObject, "org.bluez.GattManager1"));
+
+	// Get the interface proxy for this adapter - this will come in handy later
+	state.pBluezAdapterInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(state.pBluezAdapterObject, "org.bluez.Adapter1"));
+
+	// Get the interface proxy for this adapter's properties - this will come in handy later
+	state.pBluezAdapterPropertiesInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(state.pBluezAdapterObject, "org.freedesktop.DBus.Properties"));
+
+	if (nullptr == state.pBluezGattManagerProxy)
+	{
+		GGK_LOG_WARN(SSTR << "The adapter '" << adapterPath << "' has no 'org.bluez.GattManager1' interface yet, waiting for it to appear");
+		releaseAdapter(state);
+		return false;
+	}
+	else if (nullptr == state.pBluezAdapterInterfaceProxy)
 	{
-		// Current object in question
-		pBluezAdapterObject = static_cast<GDBusObject *>(g_list_nth_data(pObjects, i));
-		if (nullptr == pBluezAdapterObject) { continue; }
+		GGK_LOG_ERROR(SSTR << "Failed to get adapter proxy for interface 'org.bluez.Adapter1' on '" << adapterPath << "'");
+	}
+	else if (nullptr == state.pBluezAdapterPropertiesInterfaceProxy)
+	{
+		GGK_LOG_ERROR(SSTR << "Failed to get adapter properties proxy for interface 'org.freedesktop.DBus.Properties' on '" << adapterPath << "'");
+	}
+	else
+	{
+		// Finally, save off the interface name, we're done!
+		state.bluezGattManagerInterfaceName = g_dbus_proxy_get_object_path(state.pBluezGattManagerProxy);
+		completePhase(EInitPhaseFindAdapter, startMicroseconds, describeServer(state));
+		return true;
+	}
 
-		// See if it has a GATT manager interface
-		pBluezGattManagerProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.bluez.GattManager1"));
-		if (nullptr == pBluezGattManagerProxy) { continue; }
+	// Reset things and we'll try again later
+	releaseAdapter(state);
+	setRetryFailure();
+	return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____
+// |  _ \ ___  ___ _____   _____ _ __ _   _
+// | |_) / _ \/ __/ _ \ \ / / _ \ '__| | | |
+// |  _ <  __/ (_| (_) \ V /  __/ |  | |_| |
+// |_| \_\___|\___\___/ \_/ \___|_|   \__, |
+//                                   |___/
+//
+// BlueZ (bluetoothd) can restart and controllers can be plugged in or removed while we're running. Rather than polling for these,
+// we listen for them:
+//
+//     * BlueZ's name on the bus appearing or vanishing (see `watchBluez()`)
+//     * Adapter objects and their GATT managers being added or removed by BlueZ (see `getBluezObjectManager()`)
+//     * Controllers being added or removed in the kernel (see `HciAdapter::setIndexCallback()`)
+//
+// Each of these only resets the initialization steps for the servers it affects. When something we were waiting on arrives, we
+// pick up right away instead of waiting out any pending retry. The retry timer (and its backoff) is only used when an attempt
+// actually fails.
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-		// Get the interface proxy for this adapter - this will come in handy later
-		pBluezAdapterInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.bluez.Adapter1"));
-		if (nullptr == pBluezAdapterInterfaceProxy)
+// Forgets the subscriptions to every characteristic in `object` and its descendants
+//
+// BlueZ won't be calling StopNotify for subscriptions made to an application it has forgotten about.
+static void resetSubscriptions(const DBusObject &object)
+{
+	for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
+	{
+		if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
 		{
-			Logger::warn(SSTR << "Failed to get adapter proxy for interface 'org.bluez.Adapter1'");
-			continue;
+			pCharacteristic->resetSubscriptions();
 		}
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		resetSubscriptions(child);
+	}
+}
+
+// Forgets what we know about the BlueZ adapter for `state`, so those steps run again once it's back
+//
+// BlueZ forgets our application (and its subscriptions) along with the adapter, so we'll need to register it again. If
+// `reconfigure` is true, the controller's settings may have been lost as well (a restarted BlueZ or a controller that was removed)
+// so we configure it again.
+static void resetAdapterState(ServerState &state, bool reconfigure)
+{
+	releaseAdapter(state);
+
+	if (reconfigure)
+	{
+		state.bAdapterConfigured = false;
+	}
+
+	if (state.bApplicationRegistered)
+	{
+		GGK_LOG_WARN(SSTR << "GATT application '" << state.pServer->getApplicationPath() << "' is no longer registered with BlueZ");
+		state.bApplicationRegistered = false;
+		state.pServer->setApplicationRegistered(false);
 
-		// Get the interface proxy for this adapter's properties - this will come in handy later
-		pBluezAdapterPropertiesInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.freedesktop.DBus.Properties"));
-		if (nullptr == pBluezAdapterPropertiesInterfaceProxy)
+		for (const DBusObject &object : state.pServer->getObjects())
 		{
-			Logger::warn(SSTR << "Failed to get adapter properties proxy for interface 'org.freedesktop.DBus.Properties'");
-			continue;
+			resetSubscriptions(object);
 		}
 
-		// Finally, save off the interface name, we're done!
-		bluezGattManagerInterfaceName = g_dbus_proxy_get_object_path(pBluezGattManagerProxy);
-		break;
+		// Stop the server's tick events until it is registered again
+		TickScheduler::getInstance().removeServer(*state.pServer);
 	}
+}
 
-	// Get a fresh copy of our objects so we can release the entire list
-	pBluezAdapterObject = g_dbus_object_manager_get_object(pBluezObjectManager, g_dbus_object_get_object_path(pBluezAdapterObject));
+// Continues initialization right away, rather than waiting for a pending retry
+//
+// Called when something we were waiting on has arrived. Whatever failed before may well have been waiting for it too, so the
+// retry delay starts over.
+static void resumeInitialization()
+{
+	if (0 != retryTimeoutId)
+	{
+		g_source_remove(retryTimeoutId);
+		retryTimeoutId = 0;
+	}
 
-	// We'll need access to the device object so we can set properties on it
-	pBluezDeviceObject = g_dbus_object_manager_get_object(pBluezObjectManager, g_dbus_object_get_object_path(pBluezAdapterObject));
+	retryDelayMS = kMinRetryDelayMS;
+	initializationStateProcessor();
+}
 
-	// Cleanup the list
-	for (guint i = 0; i < g_list_length(pObjects) && bluezGattManagerInterfaceName.empty(); ++i)
+// Returns the state of the server whose BlueZ adapter lives at `pObject`, or nullptr if it isn't one of ours
+static ServerState *findServerStateForAdapter(GDBusObject *pObject)
+{
+	std::string path = g_dbus_object_get_object_path(pObject);
+	for (ServerState &state : serverStates)
 	{
-		g_object_unref(g_list_nth_data(pObjects, i));
+		if (bluezAdapterPath(state) == path)
+		{
+			return &state;
+		}
 	}
 
-	g_list_free(pObjects);
+	return nullptr;
+}
 
-	// If we didn't find the adapter object, reset things and we'll try again later
-	if (nullptr == pBluezAdapterObject || nullptr == pBluezDeviceObject)
+// Called when BlueZ adds an object, such as an adapter for a controller that was just plugged in
+static void onBluezObjectAdded(GDBusObjectManager * /*pManager*/, GDBusObject *pObject, gpointer /*pUserData*/)
+{
+	ServerState *pState = findServerStateForAdapter(pObject);
+	if (nullptr != pState && pState->bluezGattManagerInterfaceName.empty())
 	{
-		Logger::warn(SSTR << "Unable to find BlueZ objects outside of object list");
-		bluezGattManagerInterfaceName.clear();
+		GGK_LOG_INFO(SSTR << "BlueZ adapter '" << bluezAdapterPath(*pState) << "' has appeared");
+		resumeInitialization();
 	}
+}
 
-	// If we never ended up with an interface name, bail now
-	if (bluezGattManagerInterfaceName.empty())
+// Called when BlueZ removes an object, such as an adapter whose controller went away (or all of them, when BlueZ exits)
+static void onBluezObjectRemoved(GDBusObjectManager * /*pManager*/, GDBusObject *pObject, gpointer /*pUserData*/)
+{
+	ServerState *pState = findServerStateForAdapter(pObject);
+	if (nullptr != pState && nullptr != pState->pBluezAdapterObject)
 	{
-		Logger::error(SSTR << "Unable to find the adapter");
-		setRetryFailure();
-		return;
+		GGK_LOG_WARN(SSTR << "BlueZ adapter '" << bluezAdapterPath(*pState) << "' has gone away");
+		resetAdapterState(*pState, false);
 	}
+}
 
-	// Keep going
-	initializationStateProcessor();
+// Called when BlueZ adds an interface to an existing object (an adapter's GATT manager may arrive after the adapter itself)
+static void onBluezInterfaceAdded(GDBusObjectManager *pManager, GDBusObject *pObject, GDBusInterface *pInterface, gpointer pUserData)
+{
+	if (std::string("org.bluez.GattManager1") == g_dbus_proxy_get_interface_name(reinterpret_cast<GDBusProxy *>(pInterface)))
+	{
+		onBluezObjectAdded(pManager, pObject, pUserData);
+	}
+}
+
+// Called when BlueZ removes an interface from an existing object
+static void onBluezInterfaceRemoved(GDBusObjectManager *pManager, GDBusObject *pObject, GDBusInterface *pInterface, gpointer pUserData)
+{
+	if (std::string("org.bluez.GattManager1") == g_dbus_proxy_get_interface_name(reinterpret_cast<GDBusProxy *>(pInterface)))
+	{
+		onBluezObjectRemoved(pManager, pObject, pUserData);
+	}
+}
+
+// Watches for BlueZ's name (org.bluez) to appear on and vanish from the bus, as it does when bluetoothd restarts
+//
+// The vanished handler is also called right away if BlueZ isn't running when we start watching.
+static void watchBluez()
+{
+	bluezWatchId = g_bus_watch_name_on_connection
+	(
+		pBusConnection,                     // GDBusConnection *connection
+		"org.bluez",                        // const gchar *name
+		G_BUS_NAME_WATCHER_FLAGS_NONE,      // GBusNameWatcherFlags flags
+
+		// GBusNameAppearedCallback name_appeared_handler
+		[](GDBusConnection *, const gchar *pName, const gchar *pNameOwner, gpointer)
+		{
+			GGK_LOG_INFO(SSTR << "BlueZ (" << pName << ") is on the bus as " << pNameOwner);
+			resumeInitialization();
+		},
+
+		// GBusNameVanishedCallback name_vanished_handler
+		[](GDBusConnection *, const gchar *pName, gpointer)
+		{
+			GGK_LOG_WARN(SSTR << "BlueZ (" << pName << ") is not on the bus");
+
+			// A restarted BlueZ knows nothing about our applications and may have applied its own controller settings
+			for (ServerState &state : serverStates)
+			{
+				resetAdapterState(state, true);
+			}
+		},
+
+		nullptr,                            // gpointer user_data
+		nullptr                             // GDestroyNotify user_data_free_func
+	);
+}
+
+// Called on the main loop's thread when a controller is added to the system
+static gboolean onControllerAdded(gpointer pUserData)
+{
+	int controllerIndex = GPOINTER_TO_INT(pUserData) - 1;
+	for (ServerState &state : serverStates)
+	{
+		if (state.pServer->getControllerIndex() == controllerIndex && !state.bAdapterConfigured)
+		{
+			resumeInitialization();
+			break;
+		}
+	}
+
+	return FALSE;
+}
+
+// Called on the main loop's thread when a controller is removed from the system
+static gboolean onControllerRemoved(gpointer pUserData)
+{
+	int controllerIndex = GPOINTER_TO_INT(pUserData) - 1;
+	for (ServerState &state : serverStates)
+	{
+		if (state.pServer->getControllerIndex() == controllerIndex)
+		{
+			resetAdapterState(state, true);
+		}
+	}
+
+	return FALSE;
+}
+
+// Passes controller index events from the HciAdapter's event thread over to the main loop's thread
+static void onControllerIndexEvent(uint16_t controllerIndex, bool added)
+{
+	g_idle_add(added ? onControllerAdded : onControllerRemoved, GINT_TO_POINTER(controllerIndex + 1));
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -875,6 +1539,8 @@ void findAdapterInterface()
 // use this to interrogate BlueZ's objects to find an adapter we can use, among other things.
 void getBluezObjectManager()
 {
+	bObjectManagerPending = true;
+	objectManagerPhaseStartMicroseconds = Stats::nowMicroseconds();
 	g_dbus_object_manager_client_new
 	(
 		pBusConnection,                             // GDBusConnection
@@ -889,17 +1555,27 @@ void getBluezObjectManager()
 		// GAsyncReadyCallback callback
 		[] (GObject * /*pSourceObject*/, GAsyncResult *pAsyncResult, gpointer /*pUserData*/)
 		{
+			bObjectManagerPending = false;
+
 			// Store BlueZ's ObjectManager
 			GError *pError = nullptr;
 			pBluezObjectManager = g_dbus_object_manager_client_new_finish(pAsyncResult, &pError);
 
 			if (nullptr == pBluezObjectManager)
 			{
-				Logger::error(SSTR << "Failed to get an ObjectManager client: " << (nullptr == pError ? "Unknown" : pError->message));
+				GGK_LOG_ERROR(SSTR << "Failed to get an ObjectManager client: " << (nullptr == pError ? "Unknown" : pError->message));
 				setRetryFailure();
 				return;
 			}
 
+			completePhase(EInitPhaseObjectManager, objectManagerPhaseStartMicroseconds, "");
+
+			// The client follows BlueZ across restarts, telling us as its objects come and go
+			g_signal_connect(pBluezObjectManager, "object-added", G_CALLBACK(onBluezObjectAdded), nullptr);
+			g_signal_connect(pBluezObjectManager, "object-removed", G_CALLBACK(onBluezObjectRemoved), nullptr);
+			g_signal_connect(pBluezObjectManager, "interface-added", G_CALLBACK(onBluezInterfaceAdded), nullptr);
+			g_signal_connect(pBluezObjectManager, "interface-removed", G_CALLBACK(onBluezInterfaceRemoved), nullptr);
+
 			// Keep going
 			initializationStateProcessor();
 		},
@@ -917,57 +1593,67 @@ void getBluezObjectManager()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Acquire an "owned name" with D-Bus. This name represents our server as a whole, identifying us on D-Bus and allowing others
+// Acquire an "owned name" with D-Bus. This name represents a server as a whole, identifying it on D-Bus and allowing others
 // (BlueZ) to communicate back to us. All of the D-Bus objects (which represent our BlueZ services, characteristics, etc.) will all
-// reside under this owned name.
+// reside under this owned name. Each server has its own owned name (see `Server::getOwnedName()`.)
 //
 // Note about error management: We don't yet hwave a timeout callback running for retries; errors are considered fatal
-void doOwnedNameAcquire()
+void doOwnedNameAcquire(ServerState &state)
 {
 	// Our name is not presently lost
-	bOwnedNameAcquired = false;
+	state.bOwnedNameAcquired = false;
+
+	// Let go of any earlier attempt (for example, a name we've since lost)
+	if (state.ownedNameId > 0)
+	{
+		g_bus_unown_name(state.ownedNameId);
+		state.ownedNameId = 0;
+	}
 
-	ownedNameId = g_bus_own_name_on_connection
+	state.bOwnedNamePending = true;
+	state.phaseStartMicroseconds[EInitPhaseOwnedNameAcquire] = Stats::nowMicroseconds();
+	state.ownedNameId = g_bus_own_name_on_connection
 	(
-		pBusConnection,                    // GDBusConnection *connection
-		TheServer->getOwnedName().c_str(), // const gchar *name
-		G_BUS_NAME_OWNER_FLAGS_NONE,       // GBusNameOwnerFlags flags
+		pBusConnection,                           // GDBusConnection *connection
+		state.pServer->getOwnedName().c_str(),    // const gchar *name
+		G_BUS_NAME_OWNER_FLAGS_NONE,              // GBusNameOwnerFlags flags
 
 		// GBusNameAcquiredCallback name_acquired_handler
-		[](GDBusConnection *, const gchar *, gpointer)
+		[](GDBusConnection *, const gchar *, gpointer pUserData)
 		{
-			// Handy way to get periodic activity
-			periodicTimeoutId = g_timeout_add_seconds(kPeriodicTimerFrequencySeconds, onPeriodicTimer, pBusConnection);
-			if (periodicTimeoutId <= 0)
-			{
-				Logger::fatal(SSTR << "Failed to add a periodic timer");
-				setServerHealth(EFailedInit);
-				shutdown();
-			}
+			ServerState *pState = findServerState(pUserData);
+			if (nullptr == pState) { return; }
 
 			// Bus name acquired
-			bOwnedNameAcquired = true;
+			pState->bOwnedNamePending = false;
+			pState->bOwnedNameAcquired = true;
+			bOwnedNameEverAcquired = true;
+			completePhase(EInitPhaseOwnedNameAcquire, pState->phaseStartMicroseconds[EInitPhaseOwnedNameAcquire], describeServer(*pState));
 
 			// Keep going...
 			initializationStateProcessor();
 		},
 
 		// GBusNameLostCallback name_lost_handler
-		[](GDBusConnection *, const gchar *, gpointer)
+		[](GDBusConnection *, const gchar *, gpointer pUserData)
 		{
+			ServerState *pState = findServerState(pUserData);
+			if (nullptr == pState) { return; }
+
 			// Bus name lost
-			bOwnedNameAcquired = false;
+			pState->bOwnedNamePending = false;
+			pState->bOwnedNameAcquired = false;
 
-			// If we don't have a periodicTimeout (which we use for error recovery) then we're sunk
-			if (0 == periodicTimeoutId)
+			// If we've never been able to hold a name, we probably aren't allowed to (see the D-Bus permissions) so we're sunk
+			if (!bOwnedNameEverAcquired)
 			{
-				Logger::fatal(SSTR << "Unable to acquire an owned name ('" << TheServer->getOwnedName() << "') on the bus");
+				GGK_LOG_FATAL(SSTR << "Unable to acquire an owned name ('" << pState->pServer->getOwnedName() << "') on the bus");
 				setServerHealth(EFailedInit);
 				shutdown();
 			}
 			else
 			{
-				Logger::warn(SSTR << "Owned name ('" << TheServer->getOwnedName() << "') lost");
+				GGK_LOG_WARN(SSTR << "Owned name ('" << pState->pServer->getOwnedName() << "') lost");
 				setRetryFailure();
 				return;
 			}
@@ -976,8 +1662,8 @@ void doOwnedNameAcquire()
 			initializationStateProcessor();
 		},
 
-		nullptr,                          // gpointer user_data
-		nullptr                           // GDestroyNotify user_data_free_func
+		serverStateUserData(state),              // gpointer user_data
+		nullptr                                  // GDestroyNotify user_data_free_func
 	);
 }
 
@@ -996,6 +1682,8 @@ void doOwnedNameAcquire()
 void doBusAcquire()
 {
 	// Acquire a connection to the SYSTEM bus
+	bBusPending = true;
+	busPhaseStartMicroseconds = Stats::nowMicroseconds();
 	g_bus_get
 	(
 		G_BUS_TYPE_SYSTEM,      // GBusType bus_type
@@ -1004,15 +1692,21 @@ void doBusAcquire()
 		// GAsyncReadyCallback callback
 		[] (GObject */*pSourceObject*/, GAsyncResult *pAsyncResult, gpointer /*pUserData*/)
 		{
+			bBusPending = false;
+
 			GError *pError = nullptr;
 			pBusConnection = g_bus_get_finish(pAsyncResult, &pError);
 
 			if (nullptr == pBusConnection)
 			{
-				Logger::fatal(SSTR << "Failed to get bus connection: " << (nullptr == pError ? "Unknown" : pError->message));
+				GGK_LOG_FATAL(SSTR << "Failed to get bus connection: " << (nullptr == pError ? "Unknown" : pError->message));
 				setServerHealth(EFailedInit);
 				shutdown();
 			}
+			else
+			{
+				completePhase(EInitPhaseBusAcquire, busPhaseStartMicroseconds, "");
+			}
 
 			// Continue
 			initializationStateProcessor();
@@ -1035,80 +1729,126 @@ void doBusAcquire()
 // Poor-man's state machine, which effectively ensures everything is initialized in order by verifying actual initialization state
 // rather than stepping through a set of numeric states. This way, if something fails in an out-of-order sort of way, we can still
 // handle it and recover nicely.
+//
+// Steps that don't depend on each other are started together rather than one after another. Configuring each adapter (over the
+// management API, on its own thread) only needs the server, so it starts right away. Owned names, object registration and the
+// ObjectManager only need the bus. Finding the adapter needs the ObjectManager, and registering the application needs all of the
+// above. Each asynchronous step sets a pending flag so that we don't start it twice when we come back through here as the other
+// steps complete.
 void initializationStateProcessor()
 {
 	// If we're in our end-of-life or waiting for a retry, don't process states
-	if (ggkGetServerRunState() > ERunning || 0 != retryTimeStart)
+	if (ggkGetServerRunState() > ERunning || 0 != retryTimeoutId)
 	{
 		return;
 	}
 
+	// Pick up any servers that have been started since we last looked
+	syncServerStates();
+
 	//
-	// Get a bus connection
+	// Configure each adapter
 	//
-	if (nullptr == pBusConnection)
+	for (ServerState &state : serverStates)
 	{
-		Logger::debug(SSTR << "Acquiring bus connection");
-		doBusAcquire();
-		return;
+		if (!state.bAdapterConfigured && !state.bAdapterConfigPending)
+		{
+			GGK_LOG_DEBUG(SSTR << "Configuring adapter hci" << state.pServer->getControllerIndex());
+			configureAdapter(state);
+		}
 	}
 
 	//
-	// Acquire an owned name on the bus
+	// Get a bus connection
 	//
-	if (!bOwnedNameAcquired)
+	if (nullptr == pBusConnection)
 	{
-		Logger::debug(SSTR << "Acquiring owned name: '" << TheServer->getOwnedName() << "'");
-		doOwnedNameAcquire();
+		if (!bBusPending)
+		{
+			GGK_LOG_DEBUG(SSTR << "Acquiring bus connection");
+			doBusAcquire();
+		}
 		return;
 	}
 
 	//
-	// Get BlueZ's ObjectManager
+	// Keep an eye on BlueZ
 	//
-	if (nullptr == pBluezObjectManager)
+	if (0 == bluezWatchId)
 	{
-		Logger::debug(SSTR << "Getting BlueZ ObjectManager");
-		getBluezObjectManager();
-		return;
+		watchBluez();
 	}
 
-	//
-	// Find the adapter interface
-	//
-	if (bluezGattManagerInterfaceName.empty())
+	for (ServerState &state : serverStates)
 	{
-		Logger::debug(SSTR << "Finding BlueZ GattManager1 interface");
-		findAdapterInterface();
-		return;
+		//
+		// Acquire an owned name on the bus for each server
+		//
+		if (!state.bOwnedNameAcquired && !state.bOwnedNamePending)
+		{
+			GGK_LOG_DEBUG(SSTR << "Acquiring owned name: '" << state.pServer->getOwnedName() << "'");
+			doOwnedNameAcquire(state);
+		}
+
+		//
+		// Register our objects with D-bus
+		//
+		if (!state.bObjectsRegistered)
+		{
+			GGK_LOG_DEBUG(SSTR << "Registering '" << state.pServer->getServiceName() << "' with D-Bus");
+			if (!registerObjects(state))
+			{
+				return;
+			}
+		}
 	}
 
 	//
-	// Find the adapter interface
+	// Get BlueZ's ObjectManager
 	//
-	if (!bAdapterConfigured)
+	if (nullptr == pBluezObjectManager)
 	{
-		Logger::debug(SSTR << "Configuring BlueZ adapter '" << bluezGattManagerInterfaceName << "'");
-		configureAdapter();
+		if (!bObjectManagerPending)
+		{
+			GGK_LOG_DEBUG(SSTR << "Getting BlueZ ObjectManager");
+			getBluezObjectManager();
+		}
 		return;
 	}
 
-	//
-	// Register our object with D-bus
-	//
-	if (registeredObjectIds.empty())
+	// Bring up each server on its own adapter
+	bool bAllRegistered = true;
+	for (ServerState &state : serverStates)
 	{
-		Logger::debug(SSTR << "Registering with D-Bus");
-		registerObjects();
-		return;
+		if (state.bApplicationRegistered)
+		{
+			continue;
+		}
+		bAllRegistered = false;
+
+		//
+		// Find the adapter interface
+		//
+		if (state.bluezGattManagerInterfaceName.empty())
+		{
+			GGK_LOG_DEBUG(SSTR << "Finding BlueZ GattManager1 interface for hci" << state.pServer->getControllerIndex());
+			if (!findAdapterInterface(state))
+			{
+				continue;
+			}
+		}
+
+		// Register our appliation with the BlueZ GATT manager once everything it depends on is in place
+		if (state.bOwnedNameAcquired && state.bAdapterConfigured && state.bObjectsRegistered && !state.bRegisterApplicationPending)
+		{
+			GGK_LOG_DEBUG(SSTR << "Registering application '" << state.pServer->getApplicationPath() << "' with BlueZ GATT manager");
+			doRegisterApplication(state);
+		}
 	}
 
-	// Register our appliation with the BlueZ GATT manager
-	if (!bApplicationRegistered)
+	// Wait for the remaining steps to complete; each of them comes back through here when it does
+	if (!bAllRegistered)
 	{
-		Logger::debug(SSTR << "Registering application with BlueZ GATT manager");
-
-		doRegisterApplication();
 		return;
 	}
 
@@ -1122,7 +1862,36 @@ void initializationStateProcessor()
 	}
 
 	// Successful initialization - switch to running state
-	setServerRunState(ERunning);
+	//
+	// We'll come through here again for each server that is started while we're running; we're already running by then
+	if (ggkGetServerRunState() != ERunning)
+	{
+		uint64_t initMicroseconds = Stats::nowMicroseconds() - initStartMicroseconds;
+		Stats::getInstance().recordInit(initMicroseconds);
+		GGK_LOG_STATUS(SSTR << "Server initialized in " << (initMicroseconds / 1000) << "ms");
+
+		retryDelayMS = kMinRetryDelayMS;
+		setServerRunState(ERunning);
+	}
+
+	// Anything queued during initialization was ignored; make sure it gets processed now
+	UpdateQueue &queue = UpdateQueue::getInstance();
+	if (!queue.empty() && queue.claimWakeup())
+	{
+		wakeUpdateQueue();
+	}
+}
+
+// Start initializing any servers that were added (see `addServer()`) to a server that is already running
+//
+// This is safe to call from any thread. The work is done on the main loop's thread.
+void initializeAddedServers()
+{
+	g_idle_add([](gpointer) -> gboolean
+	{
+		initializationStateProcessor();
+		return FALSE;
+	}, nullptr);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -1141,8 +1910,12 @@ void initializationStateProcessor()
 void runServerThread()
 {
 	// Set the initialization state
+	initStartMicroseconds = Stats::nowMicroseconds();
 	setServerRunState(EInitializing);
 
+	// Find out about controllers coming and going (see `onControllerIndexEvent()`)
+	HciAdapter::getInstance().setIndexCallback(onControllerIndexEvent);
+
 	// Start our state processor, which is really just a simplified state machine that steps us through an asynchronous
 	// initialization process.
 	//
@@ -1155,40 +1928,75 @@ void runServerThread()
 	// There are alternatives, but using async methods is the recommended way.
 	initializationStateProcessor();
 
-	Logger::debug(SSTR << "Creating GLib main loop");
+	GGK_LOG_DEBUG(SSTR << "Creating GLib main loop");
 	pMainLoop = g_main_loop_new(NULL, FALSE);
 
-	// Add the idle function
-	//
-	// Note that we actually run the idle function from a lambda. This allows us to manage the inter-idle sleep so we don't
-	// soak up 100% of our CPU.
-	guint res = g_idle_add
-	(
-		[](gpointer pUserData) -> gboolean
+	if (kEventDrivenUpdates)
+	{
+		// Add the update queue event source
+		//
+		// The eventfd is non-blocking so that a spurious wakeup never stalls the main loop in `onUpdateQueueEvent`.
+		int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fd < 0)
 		{
-			// Try to process some data and if no data is processed, sleep for the requested frequency
-			if (!idleFunc(pUserData))
+			GGK_LOG_ERROR(SSTR << "Unable to create update queue eventfd");
+		}
+		else
+		{
+			updateEventSourceId = g_unix_fd_add(fd, G_IO_IN, onUpdateQueueEvent, nullptr);
+			if (updateEventSourceId == 0)
 			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(kIdleFrequencyMS));
+				GGK_LOG_ERROR(SSTR << "Unable to add update queue event source to main loop");
+				close(fd);
 			}
-
-			// Always return TRUE so our idle remains in tact
-			return TRUE;
-		},
-		nullptr
-	);
-
-	if (res == 0)
+			else
+			{
+				updateEventFd = fd;
+
+				// Pick up anything that was queued before our eventfd existed (any earlier wakeup claims went nowhere)
+				UpdateQueue &queue = UpdateQueue::getInstance();
+				queue.resetWakeup();
+				if (!queue.empty() && queue.claimWakeup())
+				{
+					wakeUpdateQueue();
+				}
+			}
+		}
+	}
+	else
 	{
-		Logger::error(SSTR << "Unable to add idle to main loop");
+		// Add the idle function
+		//
+		// Note that we actually run the idle function from a lambda. This allows us to manage the inter-idle sleep so we don't
+		// soak up 100% of our CPU.
+		guint res = g_idle_add
+		(
+			[](gpointer pUserData) -> gboolean
+			{
+				// Try to process some data and if no data is processed, sleep for the requested frequency
+				if (!idleFunc(pUserData))
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(kIdleFrequencyMS));
+				}
+
+				// Always return TRUE so our idle remains in tact
+				return TRUE;
+			},
+			nullptr
+		);
+
+		if (res == 0)
+		{
+			GGK_LOG_ERROR(SSTR << "Unable to add idle to main loop");
+		}
 	}
 
-	Logger::trace(SSTR << "Starting GLib main loop");
+	GGK_LOG_TRACE(SSTR << "Starting GLib main loop");
 	g_main_loop_run(pMainLoop);
 
 	// We have stopped
 	setServerRunState(EStopped);
-	Logger::info("GGK server stopped");
+	GGK_LOG_INFO("GGK server stopped");
 
 	// Cleanup
 	uninit();
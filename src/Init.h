@@ -34,4 +34,20 @@ void shutdown();
 // This method should not be called directly, instead, direct your attention over to `ggkStart()`
 void runServerThread();
 
+// Start initializing any servers that were added (see `addServer()`) to a server that is already running
+//
+// This is safe to call from any thread. The work is done on the main loop's thread.
+void initializeAddedServers();
+
+// Our idle function, which processes the next batch of updates from the update queue
+//
+// This is normally only called from the server's main loop. Returns true if any work was performed, otherwise false.
+bool idleFunc(void *pUserData);
+
+// Wake the main loop so it can process the update queue
+//
+// This is called (from any thread) by whoever claims the queue's wakeup after pushing an update (see
+// `UpdateQueue::claimWakeup`)
+void wakeUpdateQueue();
+
 }; // namespace ggk
\ No newline at end of file
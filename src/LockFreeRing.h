@@ -0,0 +1,161 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A bounded, lock-free ring buffer for passing data between threads
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// This is a bounded queue based on the well-known design by Dmitry Vyukov. Each cell in the ring carries a sequence number that
+// tells producers and consumers whether the cell is ready to be written or read. Producers claim a cell by advancing the enqueue
+// position with a compare-and-swap and consumers do the same with the dequeue position. Nobody ever waits on anybody else; a push
+// into a full ring (or a pop from an empty one) simply fails.
+//
+// Although we primarily use this as a multi-producer/single-consumer queue, pops are safe from multiple threads as well. We rely
+// on that to implement an "overwrite oldest" policy, where a producer that finds the ring full makes room by popping the oldest
+// entry itself.
+//
+// The capacity is rounded up to the next power of two. All storage is allocated up-front in the constructor; pushing and popping
+// never allocate (although the element type itself might, of course.)
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ggk {
+
+template <typename T>
+struct LockFreeRing
+{
+	// Construct a ring that can hold at least `minCapacity` entries (rounded up to a power of two)
+	explicit LockFreeRing(size_t minCapacity)
+	: enqueuePos(0), dequeuePos(0)
+	{
+		size_t capacity = 2;
+		while (capacity < minCapacity) { capacity <<= 1; }
+
+		mask = capacity - 1;
+		cells.reset(new Cell[capacity]);
+		for (size_t i = 0; i < capacity; ++i)
+		{
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Returns the number of entries the ring can hold
+	size_t capacity() const { return mask + 1; }
+
+	// Returns the number of entries in the ring
+	//
+	// This is only a snapshot, since other threads may be pushing or popping at the same time
+	size_t size() const
+	{
+		size_t tail = dequeuePos.load(std::memory_order_acquire);
+		size_t head = enqueuePos.load(std::memory_order_acquire);
+		return head >= tail ? head - tail : 0;
+	}
+
+	// Returns true if the ring is empty (see `size()`)
+	bool empty() const { return size() == 0; }
+
+	// Push `value` onto the ring
+	//
+	// Returns true on success, or false if the ring is full (in which case `value` is left untouched)
+	bool tryPush(T &value)
+	{
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell &cell = cells[pos & mask];
+			size_t seq = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (diff == 0)
+			{
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				// Full
+				return false;
+			}
+			else
+			{
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Pop the oldest entry from the ring into `value`
+	//
+	// Returns true on success, or false if the ring is empty
+	bool tryPop(T &value)
+	{
+		size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell &cell = cells[pos & mask];
+			size_t seq = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+			if (diff == 0)
+			{
+				if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					value = std::move(cell.value);
+					cell.sequence.store(pos + mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				// Empty
+				return false;
+			}
+			else
+			{
+				pos = dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+
+	// Don't allow copying
+	LockFreeRing(const LockFreeRing &) = delete;
+	LockFreeRing &operator =(const LockFreeRing &) = delete;
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+
+	// Producers and consumers hammer on these from different threads, so keep them on separate cache lines
+	std::atomic<size_t> enqueuePos;
+	char cacheLinePadding[64];
+	std::atomic<size_t> dequeuePos;
+};
+
+}; // namespace ggk
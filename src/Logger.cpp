@@ -45,12 +45,153 @@
 // There is an additional macro (SSTR) which can simplify sending dynamic data to the logger via a string stream:
 //
 //    Logger::info(SSTR << "There were " << count << " entries in the list");
+//
+// Calling the Logger directly like this builds the message before the Logger ever gets to check if anybody is listening. Within
+// the server, use the GGK_LOG_* macros instead. They check for a receiver first, so the message is never built if no receiver is
+// registered for that category:
+//
+//    GGK_LOG_INFO(SSTR << "There were " << count << " entries in the list");
+//
+// The macros can also be compiled out entirely by defining GGK_LOG_MIN_LEVEL (see Logger.h). For example, building with
+// `-DGGK_LOG_MIN_LEVEL=2` removes all Debug and Info logging. Always and Trace are never compiled out.
+//
+// Receivers are normally called on whichever thread is doing the logging. That includes the server's main loop and the HCI event
+// thread, so a slow receiver (one that writes to a remote syslog, for example) stalls the server along with it. To avoid that,
+// applications may enable asynchronous delivery (see `ggkLogSetAsync`.) In this mode, messages are copied into a preallocated
+// lock-free ring (see LockFreeRing.h) and a background thread delivers them to the receivers. If the ring is full, the message is
+// dropped and counted, because blocking the logging thread is exactly what we're trying to avoid.
+//
+// Each slot in the ring holds the message text itself (up to `kAsyncMaxMessageLength` characters; longer messages are truncated)
+// so queueing a message never allocates.
+//
+// The delivery thread sleeps on a condition variable when the ring is empty, with no timeout. It marks itself idle before making
+// its last check of the queued count, and producers check the idle flag after bumping that count, so one side always sees the
+// other. A producer that finds the thread idle takes the lock to wake it, which means the lock is only ever touched when the
+// thread actually needs waking. Each time the thread runs out of messages it also wakes anybody waiting in `Logger::flush`.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <string.h>
+
 #include "Logger.h"
+#include "LockFreeRing.h"
 
 namespace ggk {
 
+//
+// Asynchronous delivery state
+//
+
+// The longest message that fits in an asynchronous queue slot; longer messages are truncated
+static const size_t kAsyncMaxMessageLength = 1023;
+
+// A log message waiting for delivery
+//
+// The text is stored in the record itself so that queueing a message doesn't allocate. Assignment (which is how the ring moves
+// records in and out of its slots) only copies the part of the text that is in use.
+struct AsyncLogRecord
+{
+	AsyncLogRecord() { text[0] = 0; }
+
+	AsyncLogRecord &operator =(const AsyncLogRecord &other)
+	{
+		receiver = other.receiver;
+		length = other.length;
+		memcpy(text, other.text, length + 1);
+		return *this;
+	}
+
+	// Store `pText` (truncated if necessary) into this record
+	void setText(const char *pText)
+	{
+		length = strnlen(pText, kAsyncMaxMessageLength);
+		memcpy(text, pText, length);
+		text[length] = 0;
+	}
+
+	GGKLogReceiver receiver = nullptr;
+	size_t length = 0;
+	char text[kAsyncMaxMessageLength + 1];
+};
+
+// Everything needed for asynchronous delivery, wrapped up so that the delivery thread is stopped when the process exits
+struct AsyncLogState
+{
+	~AsyncLogState()
+	{
+		Logger::setAsync(false);
+	}
+
+	// Serializes calls to `Logger::setAsync`
+	std::mutex controlMutex;
+
+	std::unique_ptr<LockFreeRing<AsyncLogRecord>> pRing;
+	std::thread thread;
+
+	std::atomic<bool> bEnabled{false};
+	std::atomic<bool> bStopRequested{false};
+
+	// The number of threads currently inside `Logger::deliver`, so we know when it's safe to stop
+	std::atomic<int> producerCount{0};
+
+	// Delivery thread sleep management (`idleCondition` wakes the delivery thread, `drainedCondition` wakes `Logger::flush`)
+	std::mutex idleMutex;
+	std::condition_variable idleCondition;
+	std::condition_variable drainedCondition;
+	std::atomic<bool> bIdle{false};
+
+	// Counters
+	std::atomic<size_t> queuedCount{0};
+	std::atomic<size_t> deliveredCount{0};
+	std::atomic<size_t> droppedCount{0};
+};
+
+static AsyncLogState asyncLog;
+
+// Set on the delivery thread, since receivers running there must not wait on it
+static thread_local bool bOnAsyncDeliveryThread = false;
+
+// The delivery thread for asynchronous mode
+//
+// This runs until a stop is requested and the ring is empty
+static void runAsyncDelivery()
+{
+	bOnAsyncDeliveryThread = true;
+
+	AsyncLogRecord record;
+	for (;;)
+	{
+		if (asyncLog.pRing->tryPop(record))
+		{
+			record.receiver(record.text);
+			asyncLog.deliveredCount += 1;
+			continue;
+		}
+
+		if (asyncLog.bStopRequested)
+		{
+			break;
+		}
+
+		std::unique_lock<std::mutex> lock(asyncLog.idleMutex);
+		asyncLog.bIdle = true;
+		asyncLog.drainedCondition.notify_all();
+		asyncLog.idleCondition.wait(lock, []()
+		{
+			return asyncLog.queuedCount != asyncLog.deliveredCount || asyncLog.bStopRequested;
+		});
+		asyncLog.bIdle = false;
+	}
+
+	std::lock_guard<std::mutex> lock(asyncLog.idleMutex);
+	asyncLog.drainedCondition.notify_all();
+}
+
 //
 // Log receiver delegates
 //
@@ -120,7 +261,7 @@ void Logger::registerTraceReceiver(GGKLogReceiver receiver) { Logger::logReceive
 //
 
 // Log a DEBUG entry with a C string
-void Logger::debug(const char *pText) { if (nullptr != Logger::logReceiverDebug) { Logger::logReceiverDebug(pText); } }
+void Logger::debug(const char *pText) { if (nullptr != Logger::logReceiverDebug) { deliver(Logger::logReceiverDebug, pText); } }
 
 // Log a DEBUG entry with a string
 void Logger::debug(const std::string &text) { if (nullptr != Logger::logReceiverDebug) { debug(text.c_str()); } }
@@ -129,7 +270,7 @@ void Logger::debug(const std::string &text) { if (nullptr != Logger::logReceiver
 void Logger::debug(const std::ostream &text) { if (nullptr != Logger::logReceiverDebug) { debug(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a INFO entry with a C string
-void Logger::info(const char *pText) { if (nullptr != Logger::logReceiverInfo) { Logger::logReceiverInfo(pText); } }
+void Logger::info(const char *pText) { if (nullptr != Logger::logReceiverInfo) { deliver(Logger::logReceiverInfo, pText); } }
 
 // Log a INFO entry with a string
 void Logger::info(const std::string &text) { if (nullptr != Logger::logReceiverInfo) { info(text.c_str()); } }
@@ -138,7 +279,7 @@ void Logger::info(const std::string &text) { if (nullptr != Logger::logReceiverI
 void Logger::info(const std::ostream &text) { if (nullptr != Logger::logReceiverInfo) { info(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a STATUS entry with a C string
-void Logger::status(const char *pText) { if (nullptr != Logger::logReceiverStatus) { Logger::logReceiverStatus(pText); } }
+void Logger::status(const char *pText) { if (nullptr != Logger::logReceiverStatus) { deliver(Logger::logReceiverStatus, pText); } }
 
 // Log a STATUS entry with a string
 void Logger::status(const std::string &text) { if (nullptr != Logger::logReceiverStatus) { status(text.c_str()); } }
@@ -147,7 +288,7 @@ void Logger::status(const std::string &text) { if (nullptr != Logger::logReceive
 void Logger::status(const std::ostream &text) { if (nullptr != Logger::logReceiverStatus) { status(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a WARN entry with a C string
-void Logger::warn(const char *pText) { if (nullptr != Logger::logReceiverWarn) { Logger::logReceiverWarn(pText); } }
+void Logger::warn(const char *pText) { if (nullptr != Logger::logReceiverWarn) { deliver(Logger::logReceiverWarn, pText); } }
 
 // Log a WARN entry with a string
 void Logger::warn(const std::string &text) { if (nullptr != Logger::logReceiverWarn) { warn(text.c_str()); } }
@@ -156,7 +297,7 @@ void Logger::warn(const std::string &text) { if (nullptr != Logger::logReceiverW
 void Logger::warn(const std::ostream &text) { if (nullptr != Logger::logReceiverWarn) { warn(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a ERROR entry with a C string
-void Logger::error(const char *pText) { if (nullptr != Logger::logReceiverError) { Logger::logReceiverError(pText); } }
+void Logger::error(const char *pText) { if (nullptr != Logger::logReceiverError) { deliver(Logger::logReceiverError, pText); } }
 
 // Log a ERROR entry with a string
 void Logger::error(const std::string &text) { if (nullptr != Logger::logReceiverError) { error(text.c_str()); } }
@@ -165,7 +306,7 @@ void Logger::error(const std::string &text) { if (nullptr != Logger::logReceiver
 void Logger::error(const std::ostream &text) { if (nullptr != Logger::logReceiverError) { error(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a FATAL entry with a C string
-void Logger::fatal(const char *pText) { if (nullptr != Logger::logReceiverFatal) { Logger::logReceiverFatal(pText); } }
+void Logger::fatal(const char *pText) { if (nullptr != Logger::logReceiverFatal) { deliver(Logger::logReceiverFatal, pText); } }
 
 // Log a FATAL entry with a string
 void Logger::fatal(const std::string &text) { if (nullptr != Logger::logReceiverFatal) { fatal(text.c_str()); } }
@@ -174,7 +315,7 @@ void Logger::fatal(const std::string &text) { if (nullptr != Logger::logReceiver
 void Logger::fatal(const std::ostream &text) { if (nullptr != Logger::logReceiverFatal) { fatal(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a ALWAYS entry with a C string
-void Logger::always(const char *pText) { if (nullptr != Logger::logReceiverAlways) { Logger::logReceiverAlways(pText); } }
+void Logger::always(const char *pText) { if (nullptr != Logger::logReceiverAlways) { deliver(Logger::logReceiverAlways, pText); } }
 
 // Log a ALWAYS entry with a string
 void Logger::always(const std::string &text) { if (nullptr != Logger::logReceiverAlways) { always(text.c_str()); } }
@@ -183,7 +324,7 @@ void Logger::always(const std::string &text) { if (nullptr != Logger::logReceive
 void Logger::always(const std::ostream &text) { if (nullptr != Logger::logReceiverAlways) { always(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a TRACE entry with a C string
-void Logger::trace(const char *pText) { if (nullptr != Logger::logReceiverTrace) { Logger::logReceiverTrace(pText); } }
+void Logger::trace(const char *pText) { if (nullptr != Logger::logReceiverTrace) { deliver(Logger::logReceiverTrace, pText); } }
 
 // Log a TRACE entry with a string
 void Logger::trace(const std::string &text) { if (nullptr != Logger::logReceiverTrace) { trace(text.c_str()); } }
@@ -191,4 +332,121 @@ void Logger::trace(const std::string &text) { if (nullptr != Logger::logReceiver
 // Log a TRACE entry using a stream
 void Logger::trace(const std::ostream &text) { if (nullptr != Logger::logReceiverTrace) { trace(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
-}; // namespace ggk
\ No newline at end of file
+//
+// Asynchronous delivery
+//
+
+// Hands `pText` to `receiver`, either directly or through the asynchronous queue
+void Logger::deliver(GGKLogReceiver receiver, const char *pText)
+{
+	asyncLog.producerCount += 1;
+	if (asyncLog.bEnabled)
+	{
+		AsyncLogRecord record;
+		record.receiver = receiver;
+		record.setText(pText);
+		if (asyncLog.pRing->tryPush(record))
+		{
+			// The delivery thread sets `bIdle` before checking this count, so bumping it first means we can't miss a sleeper
+			asyncLog.queuedCount += 1;
+			if (asyncLog.bIdle)
+			{
+				std::lock_guard<std::mutex> lock(asyncLog.idleMutex);
+				asyncLog.idleCondition.notify_one();
+			}
+		}
+		else
+		{
+			asyncLog.droppedCount += 1;
+		}
+
+		asyncLog.producerCount -= 1;
+		return;
+	}
+	asyncLog.producerCount -= 1;
+
+	receiver(pText);
+}
+
+// Enables or disables asynchronous delivery of log messages (see the discussion at the top of Logger.cpp)
+//
+// When enabling, `capacity` is the number of messages that can be waiting for delivery. Each waiting message holds its text in a
+// fixed-size slot, so messages longer than 1023 characters are truncated. Disabling delivers any waiting messages before
+// returning.
+//
+// Returns true on success, or false if the capacity is invalid
+bool Logger::setAsync(bool enable, size_t capacity)
+{
+	std::lock_guard<std::mutex> guard(asyncLog.controlMutex);
+
+	if (enable)
+	{
+		if (capacity == 0)
+		{
+			return false;
+		}
+
+		if (asyncLog.bEnabled)
+		{
+			return true;
+		}
+
+		asyncLog.pRing.reset(new LockFreeRing<AsyncLogRecord>(capacity));
+		asyncLog.bStopRequested = false;
+		asyncLog.thread = std::thread(runAsyncDelivery);
+		asyncLog.bEnabled = true;
+		return true;
+	}
+
+	if (!asyncLog.bEnabled)
+	{
+		return true;
+	}
+
+	// Stop accepting new messages, then wait for anybody still in the middle of queueing one
+	asyncLog.bEnabled = false;
+	while (asyncLog.producerCount > 0)
+	{
+		std::this_thread::yield();
+	}
+
+	// The delivery thread drains the ring before it exits
+	{
+		std::lock_guard<std::mutex> lock(asyncLog.idleMutex);
+		asyncLog.bStopRequested = true;
+		asyncLog.idleCondition.notify_one();
+	}
+	if (asyncLog.thread.joinable())
+	{
+		asyncLog.thread.join();
+	}
+
+	return true;
+}
+
+// Blocks until all messages queued so far in asynchronous mode have been delivered to their receivers
+//
+// This does nothing if asynchronous mode is not enabled
+void Logger::flush()
+{
+	// A receiver that flushes would be waiting on itself
+	if (!asyncLog.bEnabled || bOnAsyncDeliveryThread)
+	{
+		return;
+	}
+
+	size_t target = asyncLog.queuedCount;
+	std::unique_lock<std::mutex> lock(asyncLog.idleMutex);
+	asyncLog.drainedCondition.wait(lock, [target]()
+	{
+		return !asyncLog.bEnabled || asyncLog.deliveredCount >= target;
+	});
+}
+
+// Returns the number of messages that were discarded because the asynchronous queue was full
+size_t Logger::getAsyncDroppedCount()
+{
+	return asyncLog.droppedCount;
+}
+
+}; // namespace ggk
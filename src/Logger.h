@@ -32,6 +32,30 @@ namespace ggk {
 // Our handy stringstream macro
 #define SSTR std::ostringstream().flush()
 
+// The minimum logging level that is compiled in (see the discussion at the top of Logger.cpp)
+//
+//     0 = Debug, 1 = Info, 2 = Status, 3 = Warn, 4 = Error, 5 = Fatal
+//
+// Always and Trace logs are never compiled out.
+#ifndef GGK_LOG_MIN_LEVEL
+#define GGK_LOG_MIN_LEVEL 0
+#endif
+
+// Internal macro that only evaluates `text` if the level is compiled in and a receiver is registered for it
+#define GGK_LOG(level, isEnabled, func, text) do { if ((level) >= GGK_LOG_MIN_LEVEL && ggk::Logger::isEnabled()) { ggk::Logger::func(text); } } while(0)
+
+// Logging macros
+//
+// Use these rather than calling the `Logger` methods directly, so messages are only formatted when somebody will receive them
+#define GGK_LOG_DEBUG(text)  GGK_LOG(0, isDebugEnabled, debug, text)
+#define GGK_LOG_INFO(text)   GGK_LOG(1, isInfoEnabled, info, text)
+#define GGK_LOG_STATUS(text) GGK_LOG(2, isStatusEnabled, status, text)
+#define GGK_LOG_WARN(text)   GGK_LOG(3, isWarnEnabled, warn, text)
+#define GGK_LOG_ERROR(text)  GGK_LOG(4, isErrorEnabled, error, text)
+#define GGK_LOG_FATAL(text)  GGK_LOG(5, isFatalEnabled, fatal, text)
+#define GGK_LOG_ALWAYS(text) GGK_LOG(GGK_LOG_MIN_LEVEL, isAlwaysEnabled, always, text)
+#define GGK_LOG_TRACE(text)  GGK_LOG(GGK_LOG_MIN_LEVEL, isTraceEnabled, trace, text)
+
 class Logger
 {
 public:
@@ -72,6 +96,57 @@ public:
 	// appropriate logging action. To unregister, call with `nullptr`
 	static void registerTraceReceiver(GGKLogReceiver receiver);
 
+	//
+	// Receiver state
+	//
+
+	// Returns true if a receiver is registered for DEBUG logging
+	static bool isDebugEnabled() { return nullptr != logReceiverDebug; }
+
+	// Returns true if a receiver is registered for INFO logging
+	static bool isInfoEnabled() { return nullptr != logReceiverInfo; }
+
+	// Returns true if a receiver is registered for STATUS logging
+	static bool isStatusEnabled() { return nullptr != logReceiverStatus; }
+
+	// Returns true if a receiver is registered for WARN logging
+	static bool isWarnEnabled() { return nullptr != logReceiverWarn; }
+
+	// Returns true if a receiver is registered for ERROR logging
+	static bool isErrorEnabled() { return nullptr != logReceiverError; }
+
+	// Returns true if a receiver is registered for FATAL logging
+	static bool isFatalEnabled() { return nullptr != logReceiverFatal; }
+
+	// Returns true if a receiver is registered for ALWAYS logging
+	static bool isAlwaysEnabled() { return nullptr != logReceiverAlways; }
+
+	// Returns true if a receiver is registered for TRACE logging
+	static bool isTraceEnabled() { return nullptr != logReceiverTrace; }
+
+	//
+	// Asynchronous delivery
+	//
+
+	// The default number of log messages that can be waiting for delivery in asynchronous mode
+	static const size_t kDefaultAsyncCapacity = 1024;
+
+	// Enables or disables asynchronous delivery of log messages (see the discussion at the top of Logger.cpp)
+	//
+	// When enabling, `capacity` is the number of messages that can be waiting for delivery. Each waiting message holds its text in a
+	// fixed-size slot, so messages longer than 1023 characters are truncated. Disabling delivers any waiting messages before
+	// returning.
+	//
+	// Returns true on success, or false if the capacity is invalid
+	static bool setAsync(bool enable, size_t capacity = kDefaultAsyncCapacity);
+
+	// Blocks until all messages queued so far in asynchronous mode have been delivered to their receivers
+	//
+	// This does nothing if asynchronous mode is not enabled
+	static void flush();
+
+	// Returns the number of messages that were discarded because the asynchronous queue was full
+	static size_t getAsyncDroppedCount();
 
 	//
 	// Logging actions
@@ -151,6 +226,9 @@ public:
 
 private:
 
+	// Hands `pText` to `receiver`, either directly or through the asynchronous queue
+	static void deliver(GGKLogReceiver receiver, const char *pText);
+
 	// The registered log receiver for DEBUG logs - a nullptr will cause the logging for that receiver to be ignored
 	static GGKLogReceiver logReceiverDebug;
 
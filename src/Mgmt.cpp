@@ -36,11 +36,55 @@ namespace ggk {
 // Set `controllerIndex` to the zero-based index of the device as recognized by the OS. If this parameter is omitted, the index
 // of the first device (0) will be used.
 Mgmt::Mgmt(uint16_t controllerIndex)
-: controllerIndex(controllerIndex)
+: controllerIndex(controllerIndex), bPipelining(false)
 {
 	HciAdapter::getInstance().sync(controllerIndex);
 }
 
+// Start queuing commands rather than waiting for the response to each one
+//
+// While pipelining, the `set...()` methods return true as soon as their command is sent. Call `endPipeline()` to wait for (and
+// collect the results of) all of them at once. Commands are processed by the kernel in the order they are sent, so this is only
+// suitable for commands that don't depend on the outcome of the commands before them.
+void Mgmt::beginPipeline()
+{
+	bPipelining = true;
+}
+
+// Stop queuing commands and wait for every command sent since `beginPipeline()`
+//
+// Returns true if all of them succeeded, otherwise false
+bool Mgmt::endPipeline()
+{
+	bPipelining = false;
+
+	bool success = true;
+	for (std::future<bool> &result : pipeline)
+	{
+		if (!HciAdapter::getInstance().waitForCommand(result))
+		{
+			success = false;
+		}
+	}
+
+	pipeline.clear();
+	return success;
+}
+
+// Sends `request`, either waiting for its response or (while pipelining) queuing it for `endPipeline()`
+//
+// Returns true on success, otherwise false
+bool Mgmt::send(HciAdapter::HciHeader &request)
+{
+	if (!bPipelining)
+	{
+		return HciAdapter::getInstance().sendCommand(request);
+	}
+
+	pipeline.push_back(HciAdapter::getInstance().sendCommandAsync(request));
+	return true;
+}
+
 // Set the adapter name and short name
 //
 // The inputs `name` and `shortName` may be truncated prior to setting them on the adapter. To ensure that `name` and
@@ -71,9 +115,9 @@ bool Mgmt::setName(std::string name, std::string shortName)
 	memset(request.shortName, 0, sizeof(request.shortName));
 	snprintf(request.shortName, sizeof(request.shortName), "%s", shortName.c_str());
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	if (!send(request))
 	{
-		Logger::warn(SSTR << "  + Failed to set name");
+		GGK_LOG_WARN(SSTR << "  + Failed to set name");
 		return false;
 	}
 
@@ -100,9 +144,9 @@ bool Mgmt::setDiscoverable(uint8_t disc, uint16_t timeout)
 	request.disc = disc;
 	request.timeout = timeout;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	if (!send(request))
 	{
-		Logger::warn(SSTR << "  + Failed to set discoverable");
+		GGK_LOG_WARN(SSTR << "  + Failed to set discoverable");
 		return false;
 	}
 
@@ -127,9 +171,9 @@ bool Mgmt::setState(uint16_t commandCode, uint16_t controllerId, uint8_t newStat
 	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
 	request.state = newState;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	if (!send(request))
 	{
-		Logger::warn(SSTR << "  + Failed to set " << HciAdapter::kCommandCodeNames[commandCode] << " state to: " << static_cast<int>(newState));
+		GGK_LOG_WARN(SSTR << "  + Failed to set " << HciAdapter::kCommandCodeNames[commandCode] << " state to: " << static_cast<int>(newState));
 		return false;
 	}
 
@@ -193,6 +237,139 @@ bool Mgmt::setAdvertising(uint8_t newState)
 	return setState(Mgmt::ESetAdvertisingCommand, controllerIndex, newState);
 }
 
+// Reads the controller's PHY configuration (see `HciAdapter::getPhyConfiguration()`)
+//
+// Returns true on success, otherwise false
+bool Mgmt::readPhyConfiguration()
+{
+	HciAdapter::HciHeader request;
+	request.code = Mgmt::EGetPhyConfigurationCommand;
+	request.controllerId = controllerIndex;
+	request.dataSize = 0;
+
+	if (!send(request))
+	{
+		GGK_LOG_WARN(SSTR << "  + Failed to read PHY configuration");
+		return false;
+	}
+
+	return true;
+}
+
+// Selects the PHYs the controller may use (`selectedPhys` holds `HciAdapter::HciPhys` bits)
+//
+// The selection must include every PHY the controller supports but can't configure.
+//
+// Returns true on success, otherwise false
+bool Mgmt::setPhyConfiguration(uint32_t selectedPhys)
+{
+	struct SRequest : HciAdapter::HciHeader
+	{
+		uint32_t selectedPhys;
+	} __attribute__((packed));
+
+	SRequest request;
+	request.code = Mgmt::ESetPhyConfigurationCommand;
+	request.controllerId = controllerIndex;
+	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
+	request.selectedPhys = Utils::endianToHci(selectedPhys);
+
+	if (!send(request))
+	{
+		GGK_LOG_WARN(SSTR << "  + Failed to set PHY configuration to " << Utils::hex(selectedPhys));
+		return false;
+	}
+
+	return true;
+}
+
+// Sets the LE connection parameters the kernel asks for on new connections
+//
+// When a central connects with an interval outside of `minInterval` to `maxInterval`, the kernel asks it to update the
+// connection. Intervals are in units of 1.25ms and `supervisionTimeout` is in units of 10ms.
+//
+// Returns true on success, otherwise false
+bool Mgmt::setDefaultConnectionParameters(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t supervisionTimeout)
+{
+	// The default system configuration is a list of type/length/value entries
+	struct SParameter
+	{
+		uint16_t type;
+		uint8_t length;
+		uint16_t value;
+	} __attribute__((packed));
+
+	struct SRequest : HciAdapter::HciHeader
+	{
+		SParameter parameters[4];
+	} __attribute__((packed));
+
+	const uint16_t types[4] = { 0x0017, 0x0018, 0x0019, 0x001a };
+	const uint16_t values[4] = { minInterval, maxInterval, latency, supervisionTimeout };
+
+	SRequest request;
+	request.code = Mgmt::ESetDefaultSystemConfigurationCommand;
+	request.controllerId = controllerIndex;
+	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
+	for (int i = 0; i < 4; ++i)
+	{
+		request.parameters[i].type = Utils::endianToHci(types[i]);
+		request.parameters[i].length = sizeof(uint16_t);
+		request.parameters[i].value = Utils::endianToHci(values[i]);
+	}
+
+	if (!send(request))
+	{
+		GGK_LOG_WARN(SSTR << "  + Failed to set default connection parameters");
+		return false;
+	}
+
+	return true;
+}
+
+// Applies the controller-wide parts of a connection policy: its default connection parameters and PHY selection
+//
+// The PHYs in the policy are added to the controller's current selection, less any it can't configure. Nothing is sent for the
+// parts of the policy that are unset or already in effect.
+//
+// Returns true on success, otherwise false
+bool Mgmt::applyConnectionPolicy(const HciAdapter::ConnectionPolicy &policy)
+{
+	bool success = true;
+
+	if (policy.hasConnectionParameters())
+	{
+		GGK_LOG_DEBUG(SSTR << "Setting connection interval range to " << policy.minInterval << "-" << policy.maxInterval << " (latency "
+			<< policy.latency << ", timeout " << policy.supervisionTimeout << ")");
+		if (!setDefaultConnectionParameters(policy.minInterval, policy.maxInterval, policy.latency, policy.supervisionTimeout))
+		{
+			success = false;
+		}
+	}
+
+	if (policy.phys != 0)
+	{
+		// Kernels without PHY configuration leave this all zeros, so there's nothing configurable and nothing is sent
+		readPhyConfiguration();
+		HciAdapter::PhyConfiguration phyConfiguration = HciAdapter::getInstance().getPhyConfiguration(controllerIndex);
+
+		uint32_t selectedPhys = phyConfiguration.selectedPhys | (policy.phys & phyConfiguration.configurablePhys);
+		if (selectedPhys != phyConfiguration.selectedPhys)
+		{
+			GGK_LOG_DEBUG(SSTR << "Selecting PHYs " << Utils::hex(selectedPhys));
+			if (!setPhyConfiguration(selectedPhys))
+			{
+				success = false;
+			}
+
+			// The kernel doesn't send the PHY Configuration Changed event to the socket that made the change, so read it back
+			readPhyConfiguration();
+		}
+	}
+
+	return success;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Utilitarian
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -27,6 +27,8 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
+#include <future>
 
 #include "HciAdapter.h"
 #include "Utils.h"
@@ -89,7 +91,8 @@ struct Mgmt
 		ELocalOutOfBandExtendedDataUpdatedEvent               = 0x0022,
 		EAdvertisingAddedEvent                                = 0x0023,
 		EAdvertisingRemovedEvent                              = 0x0024,
-		EExtendedControllerInformationChangedEvent            = 0x0025
+		EExtendedControllerInformationChangedEvent            = 0x0025,
+		EPhyConfigurationChangedEvent                         = 0x0026
 	};
 
 	// These indices should match those in HciAdapter::kCommandCodeNames
@@ -162,7 +165,16 @@ struct Mgmt
 		EGetAdvertisingSizeInformationCommand                 = 0x0040,
 		EStartLimitedDiscoveryCommand                         = 0x0041,
 		EReadExtendedControllerInformationCommand             = 0x0042,
-		ESetAppearanceCommand                                 = 0x0043
+		ESetAppearanceCommand                                 = 0x0043,
+		EGetPhyConfigurationCommand                           = 0x0044,
+		ESetPhyConfigurationCommand                           = 0x0045,
+		ELoadBlockedKeysCommand                               = 0x0046,
+		ESetWidebandSpeechCommand                             = 0x0047,
+		EReadControllerCapabilitiesCommand                    = 0x0048,
+		EReadExperimentalFeaturesInformationCommand           = 0x0049,
+		ESetExperimentalFeatureCommand                        = 0x004a,
+		EReadDefaultSystemConfigurationCommand                = 0x004b,
+		ESetDefaultSystemConfigurationCommand                 = 0x004c
 	};
 
 	// Construct the Mgmt device
@@ -171,6 +183,18 @@ struct Mgmt
 	// of the first device (0) will be used.
 	Mgmt(uint16_t controllerIndex = kDefaultControllerIndex);
 
+	// Start queuing commands rather than waiting for the response to each one
+	//
+	// While pipelining, the `set...()` methods return true as soon as their command is sent. Call `endPipeline()` to wait for (and
+	// collect the results of) all of them at once. Commands are processed by the kernel in the order they are sent, so this is only
+	// suitable for commands that don't depend on the outcome of the commands before them.
+	void beginPipeline();
+
+	// Stop queuing commands and wait for every command sent since `beginPipeline()`
+	//
+	// Returns true if all of them succeeded, otherwise false
+	bool endPipeline();
+
 	// Set the adapter name and short name
 	//
 	// The inputs `name` and `shortName` may be truncated prior to setting them on the adapter. To ensure that `name` and
@@ -230,6 +254,34 @@ struct Mgmt
 	// Returns true on success, otherwise false
 	bool setAdvertising(uint8_t newState);
 
+	// Reads the controller's PHY configuration (see `HciAdapter::getPhyConfiguration()`)
+	//
+	// Returns true on success, otherwise false
+	bool readPhyConfiguration();
+
+	// Selects the PHYs the controller may use (`selectedPhys` holds `HciAdapter::HciPhys` bits)
+	//
+	// The selection must include every PHY the controller supports but can't configure.
+	//
+	// Returns true on success, otherwise false
+	bool setPhyConfiguration(uint32_t selectedPhys);
+
+	// Sets the LE connection parameters the kernel asks for on new connections
+	//
+	// When a central connects with an interval outside of `minInterval` to `maxInterval`, the kernel asks it to update the
+	// connection. Intervals are in units of 1.25ms and `supervisionTimeout` is in units of 10ms.
+	//
+	// Returns true on success, otherwise false
+	bool setDefaultConnectionParameters(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t supervisionTimeout);
+
+	// Applies the controller-wide parts of a connection policy: its default connection parameters and PHY selection
+	//
+	// The PHYs in the policy are added to the controller's current selection, less any it can't configure. Nothing is sent for the
+	// parts of the policy that are unset or already in effect.
+	//
+	// Returns true on success, otherwise false
+	bool applyConnectionPolicy(const HciAdapter::ConnectionPolicy &policy);
+
 	//
 	// Utilitarian
 	//
@@ -244,6 +296,11 @@ struct Mgmt
 
 private:
 
+	// Sends `request`, either waiting for its response or (while pipelining) queuing it for `endPipeline()`
+	//
+	// Returns true on success, otherwise false
+	bool send(HciAdapter::HciHeader &request);
+
 	//
 	// Data members
 	//
@@ -251,8 +308,12 @@ private:
 	// The default controller index (the first device)
 	uint16_t controllerIndex;
 
+	// Commands sent since `beginPipeline()` (see `endPipeline()`)
+	bool bPipelining;
+	std::vector<std::future<bool>> pipeline;
+
 	// Default controller index
-	static const uint16_t kDefaultControllerIndex = 0;
+	static const uint16_t kDefaultControllerIndex = HciAdapter::kDefaultControllerIndex;
 };
 
 }; // namespace ggk
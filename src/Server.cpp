@@ -161,6 +161,7 @@
 #include "GattUuid.h"
 #include "GattCharacteristic.h"
 #include "GattDescriptor.h"
+#include "GattTable.h"
 #include "Logger.h"
 
 namespace ggk {
@@ -179,9 +180,114 @@ namespace ggk {
 // Globals
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Our one and only server. It's global.
+// Our first (and usually only) server. It's global.
 std::shared_ptr<Server> TheServer = nullptr;
 
+// Every server that has been started, in order (see `getServers()`)
+//
+// The list itself is never modified once published. Writers build a new list and swap it in (serialized by `serversMutex`), so
+// readers on any thread can take a snapshot without locking.
+static std::shared_ptr<const ServerList> pServers = std::make_shared<const ServerList>();
+static std::mutex serversMutex;
+
+// Returns every server that has been started (see `ggkStartOnController()`). `TheServer` is the first.
+//
+// This is safe to call from any thread. The list that is returned never changes; servers added later appear in a new list.
+std::shared_ptr<const ServerList> getServers()
+{
+	return std::atomic_load(&pServers);
+}
+
+// Adds `pServer` to the list returned by `getServers()` (the first server also becomes `TheServer`)
+//
+// Returns false if the list is full (see Server::kMaxServers)
+bool addServer(const std::shared_ptr<Server> &pServer)
+{
+	std::lock_guard<std::mutex> lock(serversMutex);
+
+	std::shared_ptr<const ServerList> pCurrent = std::atomic_load(&pServers);
+	if (pCurrent->size() >= static_cast<size_t>(Server::kMaxServers))
+	{
+		return false;
+	}
+
+	std::shared_ptr<ServerList> pNew = std::make_shared<ServerList>(*pCurrent);
+	pServer->setServerIndex(static_cast<int>(pNew->size()));
+	pNew->push_back(pServer);
+
+	if (pCurrent->empty())
+	{
+		TheServer = pServer;
+	}
+
+	std::atomic_store(&pServers, std::shared_ptr<const ServerList>(pNew));
+	return true;
+}
+
+// Empties the list returned by `getServers()`, ready for a new set of servers to be started
+void clearServers()
+{
+	std::lock_guard<std::mutex> lock(serversMutex);
+	std::atomic_store(&pServers, std::make_shared<const ServerList>());
+	TheServer = nullptr;
+}
+
+// Returns the characteristic for a handle returned from `resolveCharacteristic` on any server, or nullptr if the handle is not
+// valid
+//
+// This is safe to call from any thread and does not allocate.
+std::shared_ptr<const GattCharacteristic> getResolvedCharacteristic(int handle)
+{
+	if (handle <= 0 || handle > Server::kMaxHandles)
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<const ServerList> pList = getServers();
+	size_t index = static_cast<size_t>((handle - 1) / Server::kMaxResolvedCharacteristics);
+	return index < pList->size() ? (*pList)[index]->getResolvedCharacteristic(handle) : nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Static service tables
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Characteristic: Manufacturer Name String (0x2A29) "ReadValue" method call
+static void readManufacturerName(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &methodName,
+	GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData)
+{
+	self.methodReturnValue(pInvocation, "Acme Inc.", true);
+}
+
+// Characteristic: Model Number String (0x2A24) "ReadValue" method call
+static void readModelNumber(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &methodName,
+	GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData)
+{
+	self.methodReturnValue(pInvocation, "Marvin-PA", true);
+}
+
+// Service: Device Information (0x180A)
+//
+// The device information never changes, so it's described as a static table (see GattTable.cpp) rather than through the fluent
+// description in the constructor.
+//
+// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.service.device_information.xml
+static constexpr GattTableCharacteristic kDeviceInformationCharacteristics[] =
+{
+	// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.manufacturer_name_string.xml
+	{ "mfgr_name", "2A29", EGattFlagRead, readManufacturerName },
+
+	// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.model_number_string.xml
+	{ "model_num", "2A24", EGattFlagRead, readModelNumber },
+};
+
+static constexpr GattTableService kDeviceInformationServices[] =
+{
+	{ "device", "180A", kDeviceInformationCharacteristics },
+};
+
+static constexpr GattTable kDeviceInformationTable(kDeviceInformationServices);
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Object implementation
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -216,9 +322,18 @@ std::shared_ptr<Server> TheServer = nullptr;
 //
 //     Retrieve this value using the `getAdvertisingShortName()` method.
 //
+// controllerIndex: The zero-based index of the Bluetooth controller to configure and register with (as in 'hci0')
+//
+//     Retrieve this value using the `getControllerIndex()` method.
+//
 Server::Server(const std::string &serviceName, const std::string &advertisingName, const std::string &advertisingShortName, 
-	GGKServerDataGetter getter, GGKServerDataSetter setter)
+	GGKServerDataGetter getter, GGKServerDataSetter setter, uint16_t controllerIndex)
+: resolvedCharacteristicCount(0), pManagedObjects(nullptr), controllerIndex(controllerIndex), serverIndex(0),
+  bApplicationRegistered(false)
 {
+	// Reserve our handle table so it never reallocates (see `getResolvedCharacteristic`)
+	resolvedCharacteristics.reserve(kMaxResolvedCharacteristics);
+
 	// Save our names
 	this->serviceName = serviceName;
 	std::transform(this->serviceName.begin(), this->serviceName.end(), this->serviceName.begin(), ::tolower);
@@ -242,44 +357,14 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	//
 
 	// Create the root D-Bus object and push it into the list
-	objects.push_back(DBusObject(DBusObjectPath() + "com" + getServiceName()));
+	objects.push_back(DBusObject(getApplicationPath(), true, this));
 
 	// We're going to build off of this object, so we need to get a reference to the instance of the object as it resides in the
 	// list (and not the object that would be added to the list.)
 	objects.back()
 
-	// Service: Device Information (0x180A)
-	//
-	// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.service.device_information.xml
-	.gattServiceBegin("device", "180A")
-
-		// Characteristic: Manufacturer Name String (0x2A29)
-		//
-		// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.manufacturer_name_string.xml
-		.gattCharacteristicBegin("mfgr_name", "2A29", {"read"})
-
-			// Standard characteristic "ReadValue" method call
-			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
-			{
-				self.methodReturnValue(pInvocation, "Acme Inc.", true);
-			})
-
-		.gattCharacteristicEnd()
-
-		// Characteristic: Model Number String (0x2A24)
-		//
-		// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.model_number_string.xml
-		.gattCharacteristicBegin("model_num", "2A24", {"read"})
-
-			// Standard characteristic "ReadValue" method call
-			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
-			{
-				self.methodReturnValue(pInvocation, "Marvin-PA", true);
-			})
-
-		.gattCharacteristicEnd()
-
-	.gattServiceEnd()
+	// Service: Device Information (0x180A), from its static table
+	.gattTable(kDeviceInformationTable)
 
 	// Battery Service (0x180F)
 	//
@@ -560,13 +645,56 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	// which is used in the code below.
 	//  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -
 
+	addObjectManager();
+
+	// Our server description is complete, index it for fast lookups
+	buildInterfaceIndex();
+}
+
+// Construct a server whose GATT objects are defined by `defineObjects` rather than by the description above
+//
+// This is used to build synthetic servers (for example, by the `bench` program), so nothing here talks to BlueZ. The adapter
+// configuration flags are left at their defaults and `defineObjects` is given the root object (at /com/<serviceName>) to build
+// its services from.
+Server::Server(const std::string &serviceName, const std::function<void(DBusObject &root)> &defineObjects)
+: resolvedCharacteristicCount(0), pManagedObjects(nullptr), controllerIndex(0), serverIndex(0),
+  bApplicationRegistered(false), enableBREDR(false), enableSecureConnection(false), enableConnectable(true),
+  enableDiscoverable(true), enableAdvertising(true), enableBondable(false), dataGetter(nullptr), dataSetter(nullptr)
+{
+	resolvedCharacteristics.reserve(kMaxResolvedCharacteristics);
+
+	this->serviceName = serviceName;
+	std::transform(this->serviceName.begin(), this->serviceName.end(), this->serviceName.begin(), ::tolower);
+
+	objects.push_back(DBusObject(getApplicationPath(), true, this));
+	defineObjects(objects.back());
+
+	// See the main constructor for details on the object manager
+	addObjectManager();
+	buildInterfaceIndex();
+}
+
+// Releases our cached `GetManagedObjects` response
+Server::~Server()
+{
+	invalidateManagedObjects();
+}
+
+// Adds the (non-published) object that carries the standard 'org.freedesktop.DBus.ObjectManager' interface
+//
+// See the discussion at the end of the constructor above
+void Server::addObjectManager()
+{
 	// Create the root object and push it into the list. We're going to build off of this object, so we need to get a reference
 	// to the instance of the object as it resides in the list (and not the object that would be added to the list.)
 	//
 	// This is a non-published object (as specified by the 'false' parameter in the DBusObject constructor.) This way, we can
 	// include this within our server hieararchy (i.e., within the `objects` list) but it won't be exposed by BlueZ as a Bluetooth
 	// service to clietns.
-	objects.push_back(DBusObject(DBusObjectPath(), false));
+	//
+	// The object manager lives at our application path (the root of our object tree) rather than at '/', so that every server
+	// can have one of its own.
+	objects.push_back(DBusObject(getApplicationPath(), false, this));
 
 	// Get a reference to the new object as it resides in the list
 	DBusObject &objectManager = objects.back();
@@ -585,7 +713,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	const char *pOutArgs = "a{oa{sa{sv}}}";
 	omInterface->addMethod("GetManagedObjects", pInArgs, pOutArgs, INTERFACE_METHOD_CALLBACK_LAMBDA
 	{
-		ServerUtils::getManagedObjects(pInvocation);
+		ServerUtils::getManagedObjects(self.getOwner().getServer(), pInvocation);
 	});
 }
 
@@ -598,10 +726,15 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 // If the interface was found, it is returned, otherwise nullptr is returned
 std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath &objectPath, const std::string &interfaceName) const
 {
-	for (const DBusObject &object : objects)
+	auto it = interfaceIndex.find(objectPath.toString());
+	if (it == interfaceIndex.end())
 	{
-		std::shared_ptr<const DBusInterface> pInterface = object.findInterface(objectPath, interfaceName);
-		if (pInterface != nullptr)
+		return nullptr;
+	}
+
+	for (const std::shared_ptr<const DBusInterface> &pInterface : it->second)
+	{
+		if (interfaceName == pInterface->getName())
 		{
 			return pInterface;
 		}
@@ -615,9 +748,15 @@ std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath
 // If the method was called, this method returns true, otherwise false. There is no result from the method call itself.
 bool Server::callMethod(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-	for (const DBusObject &object : objects)
+	auto it = interfaceIndex.find(objectPath.toString());
+	if (it == interfaceIndex.end())
 	{
-		if (object.callMethod(objectPath, interfaceName, methodName, pConnection, pParameters, pInvocation, pUserData))
+		return false;
+	}
+
+	for (const std::shared_ptr<const DBusInterface> &pInterface : it->second)
+	{
+		if (interfaceName == pInterface->getName() && pInterface->callMethod(methodName, pConnection, pParameters, pInvocation, pUserData))
 		{
 			return true;
 		}
@@ -633,21 +772,125 @@ const GattProperty *Server::findProperty(const DBusObjectPath &objectPath, const
 {
 	std::shared_ptr<const DBusInterface> pInterface = findInterface(objectPath, interfaceName);
 
-	// Try each of the GattInterface types that support properties?
-	if (std::shared_ptr<const GattInterface> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattInterface))
+	// Only GATT interfaces (services, characteristics and descriptors) have properties
+	if (nullptr == pInterface || !pInterface->isGattInterface())
+	{
+		return nullptr;
+	}
+
+	return std::static_pointer_cast<const GattInterface>(pInterface)->findProperty(propertyName);
+}
+
+// Internal method to add `object` (and all of its descendants) to `index`
+static void indexObject(const DBusObject &object, Server::InterfaceIndex &index)
+{
+	if (!object.getInterfaces().empty())
 	{
-		return pGattInterface->findProperty(propertyName);
+		Server::InterfaceTable &table = index[object.getPath().toString()];
+		for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
+		{
+			table.push_back(pInterface);
+		}
 	}
-	else if (std::shared_ptr<const GattService> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
+
+	for (const DBusObject &child : object.getChildren())
 	{
-		return pGattInterface->findProperty(propertyName);
+		indexObject(child, index);
 	}
-	else if (std::shared_ptr<const GattCharacteristic> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
+}
+
+// Build `interfaceIndex` from the server description
+//
+// This is called once the server description is complete (at the end of the constructor.) The description must not change
+// after this point.
+void Server::buildInterfaceIndex()
+{
+	interfaceIndex.clear();
+	for (const DBusObject &object : objects)
 	{
-		return pGattInterface->findProperty(propertyName);
+		indexObject(object, interfaceIndex);
 	}
 
-	return nullptr;
+	GGK_LOG_DEBUG(SSTR << "Indexed " << interfaceIndex.size() << " object paths");
+}
+
+// Resolve the GATT characteristic at the given object path to an update handle
+//
+// Handles are small positive integers, unique across servers: the first server's handles are 1..kMaxResolvedCharacteristics,
+// the next server's follow on from there, and so on (see `getServerIndex()`.) Resolving the same path more than once returns
+// the same handle.
+//
+// Returns the handle on success, or 0 if the path does not refer to a characteristic (or the handle table is full)
+int Server::resolveCharacteristic(const DBusObjectPath &objectPath)
+{
+	std::shared_ptr<const DBusInterface> pInterface = findInterface(objectPath, "org.bluez.GattCharacteristic1");
+	std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+	if (nullptr == pCharacteristic)
+	{
+		GGK_LOG_WARN(SSTR << "Unable to resolve characteristic at path '" << objectPath << "'");
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> guard(resolveMutex);
+
+	// Have we already resolved this one?
+	int handleBase = serverIndex * kMaxResolvedCharacteristics;
+	int count = resolvedCharacteristicCount;
+	for (int i = 0; i < count; ++i)
+	{
+		if (resolvedCharacteristics[i] == pCharacteristic)
+		{
+			return handleBase + i + 1;
+		}
+	}
+
+	if (count >= kMaxResolvedCharacteristics)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to resolve characteristic at path '" << objectPath << "' (handle table is full)");
+		return 0;
+	}
+
+	resolvedCharacteristics.push_back(pCharacteristic);
+	resolvedCharacteristicCount = count + 1;
+	return handleBase + count + 1;
+}
+
+// Returns the characteristic for a handle returned from `resolveCharacteristic`, or nullptr if the handle is not valid
+//
+// This is safe to call from any thread and does not allocate.
+std::shared_ptr<const GattCharacteristic> Server::getResolvedCharacteristic(int handle) const
+{
+	int index = handle - serverIndex * kMaxResolvedCharacteristics - 1;
+	if (index < 0 || index >= resolvedCharacteristicCount)
+	{
+		return nullptr;
+	}
+
+	return resolvedCharacteristics[index];
+}
+
+// Returns the response to the method call `GetManagedObjects` (see `ServerUtils::buildManagedObjects`)
+//
+// The response is built on the first call and reused after that. The returned variant is owned by the server; take a reference
+// if you need to keep it. This must only be called from the main loop's thread.
+GVariant *Server::getManagedObjects() const
+{
+	if (nullptr == pManagedObjects)
+	{
+		pManagedObjects = ServerUtils::buildManagedObjects(*this);
+	}
+
+	return pManagedObjects;
+}
+
+// Discards the cached response to `GetManagedObjects`, so it will be rebuilt on the next call
+void Server::invalidateManagedObjects() const
+{
+	if (nullptr != pManagedObjects)
+	{
+		g_variant_unref(pManagedObjects);
+		pManagedObjects = nullptr;
+	}
 }
 
 }; // namespace ggk
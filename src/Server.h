@@ -11,9 +11,9 @@
 // >>>  INSIDE THIS FILE
 // >>
 //
-// This is the top-level interface for the server. There is only one of these stored in the global `TheServer`. Use this object
-// to configure your server's settings (there are surprisingly few of them.) It also contains the full server description and
-// implementation.
+// This is the top-level interface for the server. There is one of these for each Bluetooth controller we serve (see
+// `getServers()`); the first is also stored in the global `TheServer`. Use this object to configure your server's settings (there
+// are surprisingly few of them.) It also contains the full server description and implementation.
 //
 // >>
 // >>>  DISCUSSION
@@ -30,6 +30,10 @@
 #include <vector>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <functional>
 
 #include "../include/Gobbledegook.h"
 #include "DBusObject.h"
@@ -58,6 +62,25 @@ struct Server
 	// Our server is a collection of D-Bus objects
 	typedef std::list<DBusObject> Objects;
 
+	// The interfaces found at a single object path
+	typedef std::vector<std::shared_ptr<const DBusInterface>> InterfaceTable;
+
+	// Maps a full object path to the interfaces at that path (see `buildInterfaceIndex`)
+	typedef std::unordered_map<std::string, InterfaceTable> InterfaceIndex;
+
+	//
+	// Constants
+	//
+
+	// The maximum number of characteristics that can be resolved to handles (see `resolveCharacteristic`)
+	static const int kMaxResolvedCharacteristics = 1024;
+
+	// The maximum number of servers (one per controller) that can run at once
+	static const int kMaxServers = 8;
+
+	// The handles of every server share a single range, with each server getting its own block of kMaxResolvedCharacteristics
+	static const int kMaxHandles = kMaxServers * kMaxResolvedCharacteristics;
+
 	//
 	// Accessors
 	//
@@ -89,6 +112,15 @@ struct Server
 	// Returns our registered data setter
 	GGKServerDataSetter getDataSetter() const { return dataSetter; }
 
+	// Returns the zero-based index of the Bluetooth controller this server runs on (as in 'hci0')
+	uint16_t getControllerIndex() const { return controllerIndex; }
+
+	// Returns the position of this server in the list returned by `getServers()`
+	int getServerIndex() const { return serverIndex; }
+
+	// Returns true once BlueZ has accepted this server's GATT application (see Init.cpp)
+	bool isApplicationRegistered() const { return bApplicationRegistered; }
+
 	// advertisingName: The name for this controller, as advertised over LE
 	//
 	// This is set from the constructor.
@@ -124,6 +156,12 @@ struct Server
 	// server name to keep things simple.
 	std::string getOwnedName() const { return std::string("com.") + getServiceName(); }
 
+	// Our application path
+	//
+	// This is the root of our object tree (/com/<serviceName>) and is where our 'org.freedesktop.DBus.ObjectManager' lives. It is
+	// the path we register with BlueZ. Each server has its own, so several servers can share a bus connection.
+	DBusObjectPath getApplicationPath() const { return DBusObjectPath() + "com" + getServiceName(); }
+
 	//
 	// Initialization
 	//
@@ -158,21 +196,37 @@ struct Server
 	//
 	//     Retrieve this value using the `getAdvertisingShortName()` method.
 	//
+	// controllerIndex: The zero-based index of the Bluetooth controller to configure and register with (as in 'hci0')
+	//
+	//     Retrieve this value using the `getControllerIndex()` method.
+	//
 	Server(const std::string &serviceName, const std::string &advertisingName, const std::string &advertisingShortName, 
-		GGKServerDataGetter getter, GGKServerDataSetter setter);
+		GGKServerDataGetter getter, GGKServerDataSetter setter, uint16_t controllerIndex = 0);
+
+	// Construct a server whose GATT objects are defined by `defineObjects` rather than by the built-in server description
+	//
+	// This is used to build synthetic servers (for example, by the `bench` program), so nothing here talks to BlueZ. The adapter
+	// configuration flags are left at their defaults and `defineObjects` is given the root object (at /com/<serviceName>) to build
+	// its services from.
+	Server(const std::string &serviceName, const std::function<void(DBusObject &root)> &defineObjects);
+
+	// Releases our cached `GetManagedObjects` response
+	~Server();
 
 	//
 	// Utilitarian
 	//
 
-	// Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
+	// Find a D-Bus interface within the given D-Bus object
 	//
-	// If the method was called, this method returns true, otherwise false.  There is no result from the method call itself.
+	// This is a hashed lookup on the object path (see `buildInterfaceIndex`), followed by a search of the interfaces at that path.
+	//
+	// If the interface was found, it is returned, otherwise nullptr is returned
 	std::shared_ptr<const DBusInterface> findInterface(const DBusObjectPath &objectPath, const std::string &interfaceName) const;
 
-	// Find a D-Bus method within the given D-Bus object on the given D-Bus interface
+	// Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
 	//
-	// If the method was found, it is returned, otherwise nullptr is returned
+	// If the method was called, this method returns true, otherwise false.  There is no result from the method call itself.
 	bool callMethod(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
 
 	// Find a GATT Property within the given D-Bus object on the given D-Bus interface
@@ -180,8 +234,73 @@ struct Server
 	// If the property was found, it is returned, otherwise nullptr is returned
 	const GattProperty *findProperty(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &propertyName) const;
 
+	// Resolve the GATT characteristic at the given object path to an update handle
+	//
+	// Handles are small positive integers, unique across servers: the first server's handles are 1..kMaxResolvedCharacteristics,
+	// the next server's follow on from there, and so on (see `getServerIndex()`.) Resolving the same path more than once returns
+	// the same handle.
+	//
+	// Returns the handle on success, or 0 if the path does not refer to a characteristic (or the handle table is full)
+	int resolveCharacteristic(const DBusObjectPath &objectPath);
+
+	// Returns the characteristic for a handle returned from `resolveCharacteristic`, or nullptr if the handle is not valid
+	//
+	// This is safe to call from any thread and does not allocate.
+	std::shared_ptr<const GattCharacteristic> getResolvedCharacteristic(int handle) const;
+
+	// Returns the response to the method call `GetManagedObjects` (see `ServerUtils::buildManagedObjects`)
+	//
+	// The response is built on the first call and reused after that. The returned variant is owned by the server; take a reference
+	// if you need to keep it. This must only be called from the main loop's thread.
+	GVariant *getManagedObjects() const;
+
+	// Discards the cached response to `GetManagedObjects`, so it will be rebuilt on the next call
+	void invalidateManagedObjects() const;
+
+	//
+	// Internal
+	//
+
+	// Sets our position in the list returned by `getServers()` (see `addServer()`)
+	void setServerIndex(int index) { serverIndex = index; }
+
+	// Records whether BlueZ has accepted our GATT application (see Init.cpp)
+	void setApplicationRegistered(bool registered) { bApplicationRegistered = registered; }
+
 private:
 
+	// Adds the (non-published) object that carries the standard 'org.freedesktop.DBus.ObjectManager' interface
+	void addObjectManager();
+
+	// Build `interfaceIndex` from the server description
+	//
+	// This is called once the server description is complete (at the end of the constructor.) The description must not change
+	// after this point.
+	void buildInterfaceIndex();
+
+	// Maps full object paths to their interfaces, so lookups don't need to walk the object tree
+	InterfaceIndex interfaceIndex;
+
+	// Characteristics resolved to handles, indexed by (handle - 1)
+	//
+	// The storage is reserved up-front and never reallocated, so readers only need to check the handle against
+	// `resolvedCharacteristicCount`. Writers serialize on `resolveMutex`.
+	std::vector<std::shared_ptr<const GattCharacteristic>> resolvedCharacteristics;
+	std::atomic<int> resolvedCharacteristicCount;
+	std::mutex resolveMutex;
+
+	// Our cached `GetManagedObjects` response
+	//
+	// We hold a full (non-floating) reference to this, so handing it to `g_dbus_method_invocation_return_value` doesn't consume it.
+	mutable GVariant *pManagedObjects;
+
+	// The controller we run on and our position in the server list
+	uint16_t controllerIndex;
+	int serverIndex;
+
+	// Set once BlueZ has accepted our GATT application
+	std::atomic<bool> bApplicationRegistered;
+
 	// Our server's objects
 	Objects objects;
 
@@ -239,7 +358,29 @@ private:
 	std::string serviceName;
 };
 
-// Our one and only server. It's a global.
+// Our first (and usually only) server. It's a global.
 extern std::shared_ptr<Server> TheServer;
 
+// The list of servers, one per controller, in the order they were started
+typedef std::vector<std::shared_ptr<Server>> ServerList;
+
+// Returns every server that has been started (see `ggkStartOnController()`). `TheServer` is the first.
+//
+// This is safe to call from any thread. The list that is returned never changes; servers added later appear in a new list.
+std::shared_ptr<const ServerList> getServers();
+
+// Adds `pServer` to the list returned by `getServers()` (the first server also becomes `TheServer`)
+//
+// Returns false if the list is full (see Server::kMaxServers)
+bool addServer(const std::shared_ptr<Server> &pServer);
+
+// Empties the list returned by `getServers()`, ready for a new set of servers to be started
+void clearServers();
+
+// Returns the characteristic for a handle returned from `resolveCharacteristic` on any server, or nullptr if the handle is not
+// valid
+//
+// This is safe to call from any thread and does not allocate.
+std::shared_ptr<const GattCharacteristic> getResolvedCharacteristic(int handle);
+
 }; // namespace ggk
@@ -66,23 +66,23 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 	if (!object.getInterfaces().empty())
 	{
 		DBusObjectPath path = basePath + object.getPathNode();
-		Logger::debug(SSTR << "  Object: " << path);
+		GGK_LOG_DEBUG(SSTR << "  Object: " << path);
 
 		GVariantBuilder *pInterfaceArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 		for (std::shared_ptr<const DBusInterface> pInterface : object.getInterfaces())
 		{
-			Logger::debug(SSTR << "  + Interface (type: " << pInterface->getInterfaceType() << ")");
+			GGK_LOG_DEBUG(SSTR << "  + Interface (type: " << pInterface->getInterfaceType() << ")");
 
 			if (std::shared_ptr<const GattService> pService = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
 			{
 				if (!pService->getProperties().empty())
 				{
-					Logger::debug(SSTR << "    GATT Service interface: " << pService->getName());
+					GGK_LOG_DEBUG(SSTR << "    GATT Service interface: " << pService->getName());
 
 					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 					for (const GattProperty &property : pService->getProperties())
 					{
-						Logger::debug(SSTR << "      Property " << property.getName());
+						GGK_LOG_DEBUG(SSTR << "      Property " << property.getName());
 						g_variant_builder_add
 						(
 							pPropertyArray,
@@ -105,12 +105,12 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 			{
 				if (!pCharacteristic->getProperties().empty())
 				{
-					Logger::debug(SSTR << "    GATT Characteristic interface: " << pCharacteristic->getName());
+					GGK_LOG_DEBUG(SSTR << "    GATT Characteristic interface: " << pCharacteristic->getName());
 
 					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 					for (const GattProperty &property : pCharacteristic->getProperties())
 					{
-						Logger::debug(SSTR << "      Property " << property.getName());
+						GGK_LOG_DEBUG(SSTR << "      Property " << property.getName());
 						g_variant_builder_add
 						(
 							pPropertyArray,
@@ -133,12 +133,12 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 			{
 				if (!pDescriptor->getProperties().empty())
 				{
-					Logger::debug(SSTR << "    GATT Descriptor interface: " << pDescriptor->getName());
+					GGK_LOG_DEBUG(SSTR << "    GATT Descriptor interface: " << pDescriptor->getName());
 
 					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 					for (const GattProperty &property : pDescriptor->getProperties())
 					{
-						Logger::debug(SSTR << "      Property " << property.getName());
+						GGK_LOG_DEBUG(SSTR << "      Property " << property.getName());
 						g_variant_builder_add
 						(
 							pPropertyArray,
@@ -159,7 +159,7 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 			}
 			else
 			{
-				Logger::error(SSTR << "    Unknown interface type");
+				GGK_LOG_ERROR(SSTR << "    Unknown interface type");
 				return;
 			}
 		}
@@ -179,19 +179,32 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 	}
 }
 
-// Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
-void ServerUtils::getManagedObjects(GDBusMethodInvocation *pInvocation)
+// Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager` for
+// the objects of `server`
+//
+// The caller owns the returned (non-floating) reference. Servers cache this response (see `Server::getManagedObjects`.)
+GVariant *ServerUtils::buildManagedObjects(const Server &server)
 {
-	Logger::debug(SSTR << "Reporting managed objects");
-
 	GVariantBuilder *pObjectArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-	for (const DBusObject &object : TheServer->getObjects())
+	for (const DBusObject &object : server.getObjects())
 	{
 		addManagedObjectsNode(object, DBusObjectPath(""), pObjectArray);
 	}
 
-	GVariant *pParams = g_variant_new("(a{oa{sa{sv}}})", pObjectArray);
-	g_dbus_method_invocation_return_value(pInvocation, pParams);
+	GVariant *pResult = g_variant_ref_sink(g_variant_new("(a{oa{sa{sv}}})", pObjectArray));
+	g_variant_builder_unref(pObjectArray);
+	return pResult;
+}
+
+// Responds to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager` with the
+// objects of `server`
+//
+// The response is built on the first call and reused after that (see `Server::getManagedObjects`)
+void ServerUtils::getManagedObjects(const Server &server, GDBusMethodInvocation *pInvocation)
+{
+	GGK_LOG_DEBUG(SSTR << "Reporting managed objects for '" << server.getServiceName() << "'");
+
+	g_dbus_method_invocation_return_value(pInvocation, server.getManagedObjects());
 }
 
 // WARNING: Hacky code - don't count on this working properly on all systems
@@ -29,10 +29,21 @@
 
 namespace ggk {
 
+struct Server;
+
 struct ServerUtils
 {
-	// Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
-	static void getManagedObjects(GDBusMethodInvocation *pInvocation);
+	// Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager` for
+	// the objects of `server`
+	//
+	// The caller owns the returned (non-floating) reference. Servers cache this response (see `Server::getManagedObjects`.)
+	static GVariant *buildManagedObjects(const Server &server);
+
+	// Responds to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager` with the
+	// objects of `server`
+	//
+	// The response is built on the first call and reused after that (see `Server::getManagedObjects`)
+	static void getManagedObjects(const Server &server, GDBusMethodInvocation *pInvocation);
 
 	// WARNING: Hacky code - don't count on this working properly on all systems
 	//
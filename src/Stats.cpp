@@ -0,0 +1,168 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Optional runtime counters and latency histograms, reported through `ggkGetStats()`
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Statistics are disabled by default (see `ggkStatsEnable()`). Each place that records a counter first checks
+// `Stats::isEnabled()`, which is a single relaxed atomic load, so a server that never enables statistics doesn't pay for them.
+// In particular, no timestamps are taken on the request paths while statistics are disabled. (Startup timings are the exception;
+// they are taken once per initialization phase regardless, see Init.cpp.)
+//
+// Counters come in two flavors:
+//
+//     * Server-wide counters (`Stats`) for the update queue, HCI commands, initialization retries and startup timings
+//     * Per-interface counters (`InterfaceStats`, held by each `GattInterface`) for method calls, property requests and
+//       notifications
+//
+// All counters are relaxed atomics, so they can be recorded from any thread without locks. A reader may see a set of counters
+// that is slightly out of step with itself (a method call counted before its latency is recorded, for example) but never a torn
+// value.
+//
+// Latencies are kept as histograms with log2-spaced buckets of microseconds, which is enough resolution to see percentiles
+// without having to keep individual samples.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "Stats.h"
+
+namespace ggk {
+
+// Statistics are disabled until the application asks for them
+std::atomic<bool> Stats::bEnabled(false);
+
+//
+// LatencyHistogram
+//
+
+// Records a single duration
+void LatencyHistogram::record(uint64_t microseconds)
+{
+	// The bucket is the number of significant bits in the duration
+	int bucket = 0;
+	while (microseconds >> bucket != 0 && bucket < kBucketCount - 1)
+	{
+		bucket += 1;
+	}
+
+	count.fetch_add(1, std::memory_order_relaxed);
+	totalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Copies the histogram into `histogram`
+void LatencyHistogram::read(GGKStatsHistogram &histogram) const
+{
+	histogram.count = count.load(std::memory_order_relaxed);
+	histogram.totalMicroseconds = totalMicroseconds.load(std::memory_order_relaxed);
+	for (int i = 0; i < kBucketCount; ++i)
+	{
+		histogram.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+	}
+}
+
+// Clears the histogram
+void LatencyHistogram::reset()
+{
+	count = 0;
+	totalMicroseconds = 0;
+	for (std::atomic<uint64_t> &bucket : buckets)
+	{
+		bucket = 0;
+	}
+}
+
+//
+// InterfaceStats
+//
+
+// Records a method call that took `microseconds` to dispatch
+void InterfaceStats::recordMethodCall(uint64_t microseconds)
+{
+	methodCalls.fetch_add(1, std::memory_order_relaxed);
+	methodLatency.record(microseconds);
+}
+
+// Copies the counters into `stats`
+void InterfaceStats::read(GGKCharacteristicStats &stats) const
+{
+	stats.methodCalls = methodCalls.load(std::memory_order_relaxed);
+	stats.getPropertyCalls = getPropertyCalls.load(std::memory_order_relaxed);
+	stats.setPropertyCalls = setPropertyCalls.load(std::memory_order_relaxed);
+	stats.notifications = notifications.load(std::memory_order_relaxed);
+	methodLatency.read(stats.methodLatency);
+}
+
+// Clears the counters
+void InterfaceStats::reset()
+{
+	methodCalls = 0;
+	getPropertyCalls = 0;
+	setPropertyCalls = 0;
+	notifications = 0;
+	methodLatency.reset();
+}
+
+//
+// Stats
+//
+
+// Records an HCI command whose response arrived `microseconds` after it was sent
+void Stats::recordHciCommand(uint64_t microseconds)
+{
+	hciCommands.fetch_add(1, std::memory_order_relaxed);
+	hciCommandLatency.record(microseconds);
+}
+
+// Copies the counters into `stats`
+//
+// The update queue's high-water mark is not kept here; the caller fills it in.
+void Stats::read(GGKStats &stats) const
+{
+	stats.updateQueuePushes = updateQueuePushes.load(std::memory_order_relaxed);
+	stats.updateQueuePops = updateQueuePops.load(std::memory_order_relaxed);
+	stats.updateQueueHighWaterMark = 0;
+	stats.hciCommands = hciCommands.load(std::memory_order_relaxed);
+	stats.hciCommandTimeouts = hciCommandTimeouts.load(std::memory_order_relaxed);
+	hciCommandLatency.read(stats.hciCommandLatency);
+	stats.hciMalformedEvents = hciMalformedEvents.load(std::memory_order_relaxed);
+	stats.retries = retries.load(std::memory_order_relaxed);
+
+	for (int i = 0; i < EInitPhaseCount; ++i)
+	{
+		stats.initPhaseMicroseconds[i] = initPhaseMicroseconds[i].load(std::memory_order_relaxed);
+	}
+	stats.initMicroseconds = initMicroseconds.load(std::memory_order_relaxed);
+}
+
+// Clears the counters
+void Stats::reset()
+{
+	updateQueuePushes = 0;
+	updateQueuePops = 0;
+	hciCommands = 0;
+	hciCommandTimeouts = 0;
+	hciMalformedEvents = 0;
+	retries = 0;
+	hciCommandLatency.reset();
+
+	for (std::atomic<uint64_t> &phase : initPhaseMicroseconds)
+	{
+		phase = 0;
+	}
+	initMicroseconds = 0;
+}
+
+}; // namespace ggk
@@ -0,0 +1,178 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Optional runtime counters and latency histograms, reported through `ggkGetStats()`
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of Stats.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+#include "../include/Gobbledegook.h"
+
+namespace ggk {
+
+// A histogram of durations in log2-spaced buckets of microseconds
+//
+// Bucket 0 counts durations under 1us and bucket `i` counts durations of [2^(i-1), 2^i) microseconds. The last bucket also
+// counts everything longer. Recording is lock-free and may be done from any thread.
+struct LatencyHistogram
+{
+	static const int kBucketCount = GGK_STATS_HISTOGRAM_BUCKETS;
+
+	LatencyHistogram() { reset(); }
+
+	// Records a single duration
+	void record(uint64_t microseconds);
+
+	// Copies the histogram into `histogram`
+	void read(GGKStatsHistogram &histogram) const;
+
+	// Clears the histogram
+	void reset();
+
+private:
+
+	// Don't allow copying
+	LatencyHistogram(const LatencyHistogram &) = delete;
+	LatencyHistogram &operator =(const LatencyHistogram &) = delete;
+
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> totalMicroseconds;
+	std::atomic<uint64_t> buckets[kBucketCount];
+};
+
+// Counters kept for each GATT interface (see `GattInterface::getStats()`)
+struct InterfaceStats
+{
+	InterfaceStats() { reset(); }
+
+	// Records a method call that took `microseconds` to dispatch
+	void recordMethodCall(uint64_t microseconds);
+
+	// Counts a property request
+	void recordGetProperty() { getPropertyCalls.fetch_add(1, std::memory_order_relaxed); }
+	void recordSetProperty() { setPropertyCalls.fetch_add(1, std::memory_order_relaxed); }
+
+	// Counts a change notification sent to subscribers
+	void recordNotification() { notifications.fetch_add(1, std::memory_order_relaxed); }
+
+	// Copies the counters into `stats`
+	void read(GGKCharacteristicStats &stats) const;
+
+	// Clears the counters
+	void reset();
+
+private:
+
+	// Don't allow copying
+	InterfaceStats(const InterfaceStats &) = delete;
+	InterfaceStats &operator =(const InterfaceStats &) = delete;
+
+	std::atomic<uint64_t> methodCalls;
+	std::atomic<uint64_t> getPropertyCalls;
+	std::atomic<uint64_t> setPropertyCalls;
+	std::atomic<uint64_t> notifications;
+	LatencyHistogram methodLatency;
+};
+
+// Counters kept for the server as a whole
+struct Stats
+{
+	// Returns the one and only instance of the server's counters
+	static Stats &getInstance()
+	{
+		static Stats instance;
+		return instance;
+	}
+
+	// Returns true if counters are being recorded
+	//
+	// Everything that records a counter checks this first, so the cost of statistics while they are disabled (the default) is a
+	// single relaxed load.
+	static bool isEnabled() { return bEnabled.load(std::memory_order_relaxed); }
+
+	// Enables or disables recording of counters (the counters themselves are left as they are)
+	static void setEnabled(bool enable) { bEnabled.store(enable, std::memory_order_relaxed); }
+
+	// Returns a monotonic timestamp in microseconds, for measuring durations to record
+	static uint64_t nowMicroseconds()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// Counts an entry pushed onto or popped from the update queue
+	void recordUpdateQueuePush() { updateQueuePushes.fetch_add(1, std::memory_order_relaxed); }
+	void recordUpdateQueuePops(uint64_t count) { updateQueuePops.fetch_add(count, std::memory_order_relaxed); }
+
+	// Records an HCI command whose response arrived `microseconds` after it was sent
+	void recordHciCommand(uint64_t microseconds);
+
+	// Counts an HCI command whose response never arrived
+	void recordHciCommandTimeout() { hciCommandTimeouts.fetch_add(1, std::memory_order_relaxed); }
+
+	// Counts a malformed HCI event, which was skipped
+	//
+	// Like the startup timings, these are counted even if statistics are disabled; they should never happen.
+	void recordHciMalformedEvent() { hciMalformedEvents.fetch_add(1, std::memory_order_relaxed); }
+
+	// Counts an initialization step that failed and will be retried
+	void recordRetry() { retries.fetch_add(1, std::memory_order_relaxed); }
+
+	// Records the time an initialization phase took
+	//
+	// Unlike the other counters, startup timings are recorded even if statistics are disabled.
+	void recordInitPhase(GGKInitPhase phase, uint64_t microseconds) { initPhaseMicroseconds[phase] = microseconds; }
+
+	// Records the time it took for the server to reach the running state
+	void recordInit(uint64_t microseconds) { initMicroseconds = microseconds; }
+
+	// Copies the counters into `stats`
+	//
+	// The update queue's high-water mark is not kept here; the caller fills it in.
+	void read(GGKStats &stats) const;
+
+	// Clears the counters
+	void reset();
+
+private:
+
+	Stats() { reset(); }
+
+	// Don't allow copying
+	Stats(const Stats &) = delete;
+	Stats &operator =(const Stats &) = delete;
+
+	static std::atomic<bool> bEnabled;
+
+	std::atomic<uint64_t> updateQueuePushes;
+	std::atomic<uint64_t> updateQueuePops;
+	std::atomic<uint64_t> hciCommands;
+	std::atomic<uint64_t> hciCommandTimeouts;
+	std::atomic<uint64_t> hciMalformedEvents;
+	std::atomic<uint64_t> retries;
+	LatencyHistogram hciCommandLatency;
+	std::atomic<uint64_t> initPhaseMicroseconds[EInitPhaseCount];
+	std::atomic<uint64_t> initMicroseconds;
+};
+
+}; // namespace ggk
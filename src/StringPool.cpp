@@ -0,0 +1,44 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A pool of interned strings, shared by every server description
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// A server description repeats the same handful of names over and over: every characteristic's interface is named
+// "org.bluez.GattCharacteristic1", and has properties named "UUID", "Service", "Flags" and methods named "ReadValue" and
+// "WriteValue". Rather than each interface, property and method keeping its own copy, they hold a pointer to a single shared copy
+// from this pool.
+//
+// Strings are only added (while server descriptions are built) and never removed. The pool is a node-based set, so the strings it
+// holds never move as it grows. Adding is guarded by a mutex since servers can be added while others are running.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "StringPool.h"
+
+namespace ggk {
+
+// Returns the pooled copy of `str`, adding it to the pool if needed
+//
+// The returned string lives as long as the program does, so it's safe to hold on to a pointer to it. Equal strings always
+// return the same copy.
+const std::string &StringPool::intern(const std::string &str)
+{
+	StringPool &pool = getInstance();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	return *pool.strings.insert(str).first;
+}
+
+}; // namespace ggk
@@ -0,0 +1,58 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A pool of interned strings, shared by every server description
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of StringPool.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <mutex>
+
+namespace ggk {
+
+struct StringPool
+{
+	// Returns the pooled copy of `str`, adding it to the pool if needed
+	//
+	// The returned string lives as long as the program does, so it's safe to hold on to a pointer to it. Equal strings always
+	// return the same copy.
+	static const std::string &intern(const std::string &str);
+
+private:
+
+	// Returns the one and only pool
+	static StringPool &getInstance()
+	{
+		static StringPool instance;
+		return instance;
+	}
+
+	StringPool() {}
+
+	// Don't allow copying
+	StringPool(const StringPool &) = delete;
+	StringPool &operator =(const StringPool &) = delete;
+
+	std::mutex mutex;
+	std::unordered_set<std::string> strings;
+};
+
+}; // namespace ggk
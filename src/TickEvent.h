@@ -21,14 +21,11 @@
 // regular basis or performing other periodic tasks. One example usage might be checking the battery level every 60 seconds and if
 // it has changed since the last update, send out a notification to subscribers.
 //
-// The frequency at which events fire is dependent upon two values: the driving timer's tick frequency multiplied by the tick
-// freuency of the TickEvent itself.
+// Each TickEvent has a period, which is set when the event is added to the server description. Use `onEvent()` to specify the
+// period in ticks (one tick is `kTickPeriodMS` milliseconds, or one second) or `onEventMS()` to specify it in milliseconds.
 //
-// The tick event's frequency is set when a tick event is added via the `onEvent()` method to the server description.
-//
-// The driving timer's frequency is a one-second-resolution low-frequency timer with a default of one second. To modify this, see
-// `kPeriodicTimerFrequencySeconds` at the top of Init.cpp. Note that the periodic timer (which drives tick events) is intentionally
-// a low-frequency timer. Higher frequency timers would lend themselves to using more battery on both, the server and client.
+// Events are scheduled by the TickScheduler (see TickScheduler.cpp), which only visits events that are due and sleeps until the
+// next one is. Interfaces without events cost nothing.
 //
 // When using a TickEvent, be careful not to demand too much of your client. Notifiations that are too frequent may place undue
 // stress on their battery to receive and process the updates.
@@ -63,12 +60,16 @@ struct TickEvent
 	// A tick event callback, which is called whenever the TickEvent fires
 	typedef void (*Callback)(const DBusInterface &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 
-	// Construct a TickEvent that will fire after a specified 'tickFrequency' number of ticks of the periodic timer.
 	//
-	// Note that the actual time between a callback's execution is the event's 'tickFrequency' multiplied by the time between each
-	// periodic timer tick.
-	TickEvent(const DBusInterface *pOwner, int tickFrequency, Callback callback, void *pUserData)
-	: pOwner(pOwner), elapsedTicks(0), tickFrequency(tickFrequency), callback(callback), pUserData(pUserData)
+	// Constants
+	//
+
+	// The length of a single tick, for events that specify their period in ticks (see `onEvent()`)
+	static const int kTickPeriodMS = 1000;
+
+	// Construct a TickEvent that will fire every `periodMS` milliseconds
+	TickEvent(const DBusInterface *pOwner, int periodMS, Callback callback, void *pUserData)
+	: pOwner(pOwner), periodMS(periodMS), callback(callback), pUserData(pUserData)
 	{
 	}
 
@@ -76,17 +77,22 @@ struct TickEvent
 	// Accessors
 	//
 
-	// Returns the elapsed ticks since the last event firing
-	int getElapsedTicks() const { return elapsedTicks; }
+	// Returns the interface that owns this TickEvent
+	const DBusInterface *getOwner() const { return pOwner; }
 
-	// Sets the elapsed ticks since the last event firing
-	void setElapsedTicks(int elapsed) { elapsedTicks = elapsed; }
+	// Returns the time between firings of this event, in milliseconds
+	int getPeriodMS() const { return periodMS; }
 
-	// Returns the tick frequency between schedule tick events
-	int getTickFrequency() const { return tickFrequency; }
+	// Sets the time between firings of this event, in milliseconds
+	//
+	// Changes take effect the next time the event fires
+	void setPeriodMS(int period) { periodMS = period; }
+
+	// Returns the tick frequency between schedule tick events (the period in units of `kTickPeriodMS`)
+	int getTickFrequency() const { return periodMS / kTickPeriodMS; }
 
-	// Sets the tick frequency between schedule tick events
-	void setTickFrequency(int frequency) { tickFrequency = frequency; }
+	// Sets the tick frequency between schedule tick events (the period in units of `kTickPeriodMS`)
+	void setTickFrequency(int frequency) { periodMS = frequency * kTickPeriodMS; }
 
 	// Returns the user data pointer associated to this TickEvent
 	void *getUserData() { return pUserData; }
@@ -101,29 +107,20 @@ struct TickEvent
 	void setCallback(Callback callback) { this->callback = callback; }
 
 	//
-	// Tick management
+	// Firing
 	//
 
-	// Perform a single tick of a TickEvent
+	// Fire the TickEvent, calling its `callback`
 	//
-	// A TickEvent is ticked each time the periodic timer fires. The TickEvent only fires after `tickFrequency` ticks. As a result,
-	// the `callback` is only called after a period of time equal to the time between firings of the periodic timer, multiplied by
-	// `tickFrequency`.
-	//
-	// Returns true if event fires, false otherwise
+	// This is called by the TickScheduler when the event is due. The owner is passed to the callback as type `T`, which must be the
+	// owner's actual type (the callbacks are declared in terms of their owner's type; see `GattCharacteristic::onEvent`.)
 	template<typename T>
-	void tick(const DBusObjectPath &path, GDBusConnection *pConnection, void *pUserData) const
+	void fire(const DBusObjectPath &path, GDBusConnection *pConnection, void *pUserData) const
 	{
-		elapsedTicks += 1;
-		if (elapsedTicks >= tickFrequency)
+		if (nullptr != callback)
 		{
-			if (nullptr != callback)
-			{
-				Logger::debug(SSTR << "Ticking at path '" << path << "'");
-				callback(*static_cast<const T *>(pOwner), *this, pConnection, pUserData);
-			}
-
-			elapsedTicks = 0;
+			GGK_LOG_DEBUG(SSTR << "Ticking at path '" << path << "'");
+			callback(*static_cast<const T *>(pOwner), *this, pConnection, pUserData);
 		}
 	}
 
@@ -134,8 +131,7 @@ private:
 	//
 
 	const DBusInterface *pOwner;
-	mutable int elapsedTicks;
-	int tickFrequency;
+	int periodMS;
 	Callback callback;
 	void *pUserData;
 };
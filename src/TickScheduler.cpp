@@ -0,0 +1,238 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The scheduler that fires the TickEvents in the server description
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// When a server's application is registered, we walk its published objects once and push every TickEvent onto a min-heap, ordered
+// by the time at which each event is next due. A single GLib timeout is armed for the earliest deadline. When it fires, we pop and
+// fire every due event, push each one back with its next deadline, and re-arm the timeout for whatever is at the top of the heap.
+// Interfaces without events never appear in the heap, and the main loop sleeps until something is actually due.
+//
+// Each entry remembers its server, so servers come and go (see `addServer()` and `removeServer()`) without disturbing the phase of
+// each other's events.
+//
+// Deadlines advance by the event's period from the previous deadline (not from when it actually fired), so events don't drift. If
+// we fall so far behind that the next deadline has already passed, we skip ahead rather than firing a burst of catch-up events.
+//
+// Callbacks are declared in terms of their owner's type (see `GattCharacteristic::onEvent`), so we use the owner's interface kind
+// to hand it to the callback with the correct type.
+//
+// Events on a characteristic that nobody is subscribed to (see `GattCharacteristic::isUnobserved()`) stay in the heap and keep
+// their schedule, but aren't fired.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <algorithm>
+
+#include "TickScheduler.h"
+#include "TickEvent.h"
+#include "Server.h"
+#include "DBusObject.h"
+#include "DBusInterface.h"
+#include "GattService.h"
+#include "GattCharacteristic.h"
+#include "GattDescriptor.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Internal method to add the events of `object` (and all of its descendants) in `server`'s description to `schedule`
+static void scheduleObject(const Server &server, const DBusObject &object, gint64 nowMS, std::vector<TickScheduler::Entry> &schedule);
+
+// Returns the current monotonic time in milliseconds
+gint64 TickScheduler::nowMS()
+{
+	return g_get_monotonic_time() / 1000;
+}
+
+// Schedule every event in the published objects of `server`'s description and start firing them
+//
+// The events fire on the thread running the GLib main loop. `pConnection` and `pUserData` are handed to each event's callback.
+//
+// This is called each time a server's application is registered. Events of other servers keep their schedule.
+void TickScheduler::addServer(const Server &server, GDBusConnection *pConnection, void *pUserData)
+{
+	// A server that registers again starts over
+	removeServer(server);
+
+	this->pConnection = pConnection;
+	this->pUserData = pUserData;
+
+	size_t previousSize = schedule.size();
+	gint64 now = nowMS();
+	for (const DBusObject &object : server.getObjects())
+	{
+		if (object.isPublished())
+		{
+			scheduleObject(server, object, now, schedule);
+		}
+	}
+
+	for (size_t i = previousSize + 1; i <= schedule.size(); ++i)
+	{
+		std::push_heap(schedule.begin(), schedule.begin() + i);
+	}
+
+	GGK_LOG_DEBUG(SSTR << "Scheduled " << schedule.size() - previousSize << " tick events (" << schedule.size() << " in total)");
+
+	// The new events may well be due before the timer we have
+	if (0 != timeoutId)
+	{
+		g_source_remove(timeoutId);
+		timeoutId = 0;
+	}
+
+	bRunning = true;
+	arm();
+}
+
+// Stop firing the events of `server` (for example, because its application is no longer registered)
+//
+// Events of other servers keep their schedule.
+void TickScheduler::removeServer(const Server &server)
+{
+	auto end = std::remove_if(schedule.begin(), schedule.end(), [&server](const Entry &entry)
+	{
+		return entry.pServer == &server;
+	});
+
+	if (end == schedule.end())
+	{
+		return;
+	}
+
+	schedule.erase(end, schedule.end());
+	std::make_heap(schedule.begin(), schedule.end());
+
+	// The timer may have been set for one of the events we removed; it's harmless, but there's no need to wake up for it
+	if (schedule.empty() && 0 != timeoutId)
+	{
+		g_source_remove(timeoutId);
+		timeoutId = 0;
+	}
+}
+
+// Stop firing events and discard the schedule
+void TickScheduler::stop()
+{
+	if (0 != timeoutId)
+	{
+		g_source_remove(timeoutId);
+		timeoutId = 0;
+	}
+
+	schedule.clear();
+	bRunning = false;
+}
+
+// GLib timeout handler that fires all due events and re-arms the timer
+gboolean TickScheduler::onTimer(gpointer pUserData)
+{
+	TickScheduler &scheduler = *static_cast<TickScheduler *>(pUserData);
+
+	// This timeout is a one-shot; `arm()` will add a new one if needed
+	scheduler.timeoutId = 0;
+
+	// If we're shutting down, stop firing events
+	if (ggkGetServerRunState() > ERunning)
+	{
+		scheduler.stop();
+		return FALSE;
+	}
+
+	scheduler.fireDueEvents();
+	scheduler.arm();
+	return FALSE;
+}
+
+// Fire every event that is due, rescheduling each for its next period
+void TickScheduler::fireDueEvents()
+{
+	// Events that come due together often notify together; send their signals in one go
+	DBusSignalBatch signals;
+
+	gint64 now = nowMS();
+	while (!schedule.empty() && schedule.front().deadlineMS <= now)
+	{
+		std::pop_heap(schedule.begin(), schedule.end());
+		Entry &entry = schedule.back();
+		const TickEvent &event = *entry.pEvent;
+		const DBusInterface &owner = *event.getOwner();
+
+		switch(owner.getInterfaceKind())
+		{
+			case DBusInterface::EGattCharacteristic:
+				// A characteristic's events are there to notify its subscribers, so skip them while it has none
+				if (!static_cast<const GattCharacteristic &>(owner).isUnobserved())
+				{
+					event.fire<GattCharacteristic>(owner.getPath(), pConnection, pUserData);
+				}
+				break;
+			case DBusInterface::EGattDescriptor:
+				event.fire<GattDescriptor>(owner.getPath(), pConnection, pUserData);
+				break;
+			case DBusInterface::EGattService:
+				event.fire<GattService>(owner.getPath(), pConnection, pUserData);
+				break;
+			default:
+				event.fire<DBusInterface>(owner.getPath(), pConnection, pUserData);
+				break;
+		}
+
+		// Schedule the next firing (the period may have been changed by the callback)
+		entry.deadlineMS += std::max(1, event.getPeriodMS());
+		if (entry.deadlineMS <= now)
+		{
+			entry.deadlineMS = now + std::max(1, event.getPeriodMS());
+		}
+		std::push_heap(schedule.begin(), schedule.end());
+	}
+}
+
+// Set the timer to fire at the earliest deadline
+void TickScheduler::arm()
+{
+	if (!bRunning || schedule.empty() || 0 != timeoutId)
+	{
+		return;
+	}
+
+	gint64 delayMS = std::max(static_cast<gint64>(0), schedule.front().deadlineMS - nowMS());
+	timeoutId = g_timeout_add(static_cast<guint>(delayMS), onTimer, this);
+}
+
+// Internal method to add the events of `object` (and all of its descendants) in `server`'s description to `schedule`
+static void scheduleObject(const Server &server, const DBusObject &object, gint64 nowMS, std::vector<TickScheduler::Entry> &schedule)
+{
+	for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
+	{
+		for (const TickEvent &event : pInterface->getEvents())
+		{
+			TickScheduler::Entry entry;
+			entry.deadlineMS = nowMS + std::max(1, event.getPeriodMS());
+			entry.pEvent = &event;
+			entry.pServer = &server;
+			schedule.push_back(entry);
+		}
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		scheduleObject(server, child, nowMS, schedule);
+	}
+}
+
+}; // namespace ggk
@@ -0,0 +1,103 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The scheduler that fires the TickEvents in the server description
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of TickScheduler.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <gio/gio.h>
+#include <vector>
+
+namespace ggk {
+
+struct TickEvent;
+struct Server;
+
+struct TickScheduler
+{
+	// A scheduled event
+	struct Entry
+	{
+		// The monotonic time (in milliseconds) at which the event is next due
+		gint64 deadlineMS;
+		const TickEvent *pEvent;
+
+		// The server whose description the event belongs to
+		const Server *pServer;
+
+		// Orders entries so that the earliest deadline is at the top of the heap
+		bool operator <(const Entry &rhs) const { return deadlineMS > rhs.deadlineMS; }
+	};
+
+	// Returns the one and only instance of the scheduler
+	static TickScheduler &getInstance()
+	{
+		static TickScheduler instance;
+		return instance;
+	}
+
+	// Schedule every event in the published objects of `server`'s description and start firing them
+	//
+	// The events fire on the thread running the GLib main loop. `pConnection` and `pUserData` are handed to each event's callback.
+	//
+	// This is called each time a server's application is registered. Events of other servers keep their schedule.
+	void addServer(const Server &server, GDBusConnection *pConnection, void *pUserData);
+
+	// Stop firing the events of `server` (for example, because its application is no longer registered)
+	//
+	// Events of other servers keep their schedule.
+	void removeServer(const Server &server);
+
+	// Stop firing events and discard the schedule
+	void stop();
+
+	// Returns true if the scheduler is running
+	bool isRunning() const { return bRunning; }
+
+private:
+
+	TickScheduler() : bRunning(false), timeoutId(0), pConnection(nullptr), pUserData(nullptr) {}
+
+	// Don't allow copying
+	TickScheduler(const TickScheduler &) = delete;
+	TickScheduler &operator =(const TickScheduler &) = delete;
+
+	// Returns the current monotonic time in milliseconds
+	static gint64 nowMS();
+
+	// GLib timeout handler that fires all due events and re-arms the timer
+	static gboolean onTimer(gpointer pUserData);
+
+	// Fire every event that is due, rescheduling each for its next period
+	void fireDueEvents();
+
+	// Set the timer to fire at the earliest deadline
+	void arm();
+
+	bool bRunning;
+	guint timeoutId;
+	GDBusConnection *pConnection;
+	void *pUserData;
+
+	// Scheduled events, as a min-heap on `deadlineMS`
+	std::vector<Entry> schedule;
+};
+
+}; // namespace ggk
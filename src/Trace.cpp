@@ -0,0 +1,232 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Recording of D-Bus GATT traffic to a memory-mapped trace file, for replay with the `replay` program
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// A trace holds the requests that reached the server: method calls, property gets and sets (see `onMethodCall()` and friends in
+// Init.cpp) and updates pushed with `ggkPushUpdateQueue()`. Each record holds a timestamp, the object path, interface, method or
+// property name and the serialized arguments (see `TraceRecord` in Trace.h.) The `replay` program (see replay.cpp) feeds a trace
+// back into a server, either at its original pace or as fast as possible, so a load profile captured in the field can be
+// reproduced and benchmarked elsewhere.
+//
+// Tracing is stopped by default (see `ggkTraceStart()`), in which case each of those paths pays for a single relaxed load.
+//
+// While tracing, nothing on the recording path makes a system call or takes a lock. The trace file is created at its maximum
+// size and mapped into memory up front (with its pages populated, so the first write to each doesn't fault), then each record
+// claims its space with a compare-and-swap on the write offset and is copied straight into the mapping. The kernel writes the
+// pages back to the file in its own time. Records come from the server thread and the application's threads (updates) alike.
+//
+// Once the file is full, further records are dropped and counted rather than waiting for room. Stopping the trace waits for
+// records in progress to be copied, then trims the file to the records written. If the process dies before then, the file keeps
+// its full size; a record's size is written last, so the trace ends at the first record with a size of zero.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <thread>
+
+#include "Trace.h"
+#include "Stats.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Tracing is stopped until the application starts it
+std::atomic<bool> Trace::bEnabled(false);
+
+constexpr const char *TraceFileHeader::kMagic;
+
+// Starts recording to a new trace file at `path` that may grow to at most `maxBytes` bytes
+//
+// Any trace already being recorded is stopped first. Returns false if the file could not be created and mapped.
+bool Trace::start(const std::string &path, size_t maxBytes)
+{
+	std::lock_guard<std::mutex> lock(controlMutex);
+	stopLocked();
+
+	if (maxBytes < sizeof(TraceFileHeader) + sizeof(TraceRecord))
+	{
+		GGK_LOG_ERROR(SSTR << "Trace file size is too small: " << maxBytes << " bytes");
+		return false;
+	}
+
+	fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to create trace file '" << path << "': " << strerror(errno));
+		return false;
+	}
+
+	if (ftruncate(fd, static_cast<off_t>(maxBytes)) != 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to size trace file '" << path << "': " << strerror(errno));
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	void *pAddress = mmap(nullptr, maxBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (MAP_FAILED == pAddress)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to map trace file '" << path << "': " << strerror(errno));
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	pMapping = static_cast<uint8_t *>(pAddress);
+	mappingSize = maxBytes;
+
+	TraceFileHeader header;
+	memcpy(header.magic, TraceFileHeader::kMagic, sizeof(header.magic));
+	header.version = TraceFileHeader::kVersion;
+	header.headerSize = sizeof(TraceFileHeader);
+	memcpy(pMapping, &header, sizeof(header));
+
+	writeOffset = sizeof(TraceFileHeader);
+	recordCount = 0;
+	droppedCount = 0;
+	startMicroseconds = Stats::nowMicroseconds();
+	bEnabled = true;
+
+	GGK_LOG_INFO(SSTR << "Recording trace to '" << path << "' (up to " << maxBytes << " bytes)");
+	return true;
+}
+
+// Stops recording, trims the trace file to the records written and closes it
+//
+// Records being written by other threads are allowed to finish first. Does nothing if no trace is being recorded.
+void Trace::stop()
+{
+	std::lock_guard<std::mutex> lock(controlMutex);
+	stopLocked();
+}
+
+// Stops recording; the caller must hold `controlMutex`
+void Trace::stopLocked()
+{
+	if (nullptr == pMapping)
+	{
+		return;
+	}
+
+	// Once the flag is clear, no new writer will touch the mapping; wait for those already inside `record()`
+	bEnabled = false;
+	while (activeWriters.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+
+	size_t usedSize = writeOffset.load();
+	munmap(pMapping, mappingSize);
+	if (ftruncate(fd, static_cast<off_t>(usedSize)) != 0)
+	{
+		GGK_LOG_WARN(SSTR << "Unable to trim trace file: " << strerror(errno));
+	}
+	close(fd);
+
+	fd = -1;
+	pMapping = nullptr;
+	mappingSize = 0;
+
+	GGK_LOG_INFO(SSTR << "Trace stopped with " << recordCount.load() << " records (" << droppedCount.load() << " dropped)");
+}
+
+// Records a unit of traffic
+//
+// `pArguments` may be nullptr. This may be called from any thread. It never blocks; if the trace file is full, the record is
+// dropped and counted (see `getDroppedCount()`.)
+void Trace::record(TraceRecordKind kind, const char *pPath, const char *pInterface, const char *pMember, GVariant *pArguments)
+{
+	// Announce ourselves before checking the flag, so `stopLocked()` either sees us or we see it cleared
+	activeWriters.fetch_add(1);
+	if (!bEnabled.load())
+	{
+		activeWriters.fetch_sub(1);
+		return;
+	}
+
+	const char *pType = nullptr != pArguments ? g_variant_get_type_string(pArguments) : "";
+	size_t argumentsLength = nullptr != pArguments ? g_variant_get_size(pArguments) : 0;
+	size_t pathLength = strlen(pPath);
+	size_t interfaceLength = strlen(pInterface);
+	size_t memberLength = strlen(pMember);
+	size_t typeLength = strlen(pType);
+
+	size_t stringsLength = pathLength + interfaceLength + memberLength + typeLength + 4;
+	size_t size = (sizeof(TraceRecord) + argumentsLength + stringsLength + 7) & ~static_cast<size_t>(7);
+
+	// Claim space for the record, unless it won't fit (there's no room left, or a string is too long for its length field)
+	bool bFits = pathLength <= UINT16_MAX && interfaceLength <= UINT16_MAX && memberLength <= UINT16_MAX && typeLength <= UINT16_MAX &&
+		size <= UINT32_MAX;
+	size_t offset = writeOffset.load(std::memory_order_relaxed);
+	while (bFits)
+	{
+		if (offset + size > mappingSize)
+		{
+			bFits = false;
+		}
+		else if (writeOffset.compare_exchange_weak(offset, offset + size, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	if (!bFits)
+	{
+		droppedCount.fetch_add(1, std::memory_order_relaxed);
+		activeWriters.fetch_sub(1);
+		return;
+	}
+
+	TraceRecord *pRecord = reinterpret_cast<TraceRecord *>(pMapping + offset);
+	pRecord->kind = kind;
+	pRecord->reserved = 0;
+	pRecord->pathLength = static_cast<uint16_t>(pathLength);
+	pRecord->interfaceLength = static_cast<uint16_t>(interfaceLength);
+	pRecord->memberLength = static_cast<uint16_t>(memberLength);
+	pRecord->typeLength = static_cast<uint16_t>(typeLength);
+	pRecord->reserved2 = 0;
+	pRecord->argumentsLength = static_cast<uint32_t>(argumentsLength);
+	pRecord->timestampMicroseconds = Stats::nowMicroseconds() - startMicroseconds;
+
+	uint8_t *pData = pMapping + offset + sizeof(TraceRecord);
+	if (nullptr != pArguments)
+	{
+		g_variant_store(pArguments, pData);
+		pData += argumentsLength;
+	}
+
+	for (const char *pString : { pPath, pInterface, pMember, pType })
+	{
+		size_t length = strlen(pString) + 1;
+		memcpy(pData, pString, length);
+		pData += length;
+	}
+
+	// The size goes in last, so a reader of an interrupted trace never sees a record that wasn't finished
+	std::atomic_thread_fence(std::memory_order_release);
+	pRecord->size = static_cast<uint32_t>(size);
+
+	recordCount.fetch_add(1, std::memory_order_relaxed);
+	activeWriters.fetch_sub(1);
+}
+
+}; // namespace ggk
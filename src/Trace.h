@@ -0,0 +1,168 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Recording of D-Bus GATT traffic to a memory-mapped trace file, for replay with the `replay` program
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of Trace.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace ggk {
+
+// The kinds of traffic recorded in a trace
+enum TraceRecordKind : uint8_t
+{
+	ETraceMethodCall = 1,
+	ETraceGetProperty = 2,
+	ETraceSetProperty = 3,
+	ETraceUpdate = 4
+};
+
+// The start of a trace file
+struct TraceFileHeader
+{
+	// The magic value at the start of every trace file
+	static constexpr const char *kMagic = "GGKTRACE";
+
+	// The version of the trace format described here
+	static const uint32_t kVersion = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+};
+
+// The start of each record in a trace file
+//
+// A record is followed by its argument bytes (the serialized GVariant), then its path, interface, member and GVariant type
+// strings, each with a null terminator. Records are padded to a multiple of 8 bytes, so the argument bytes are always aligned
+// for deserialization. A record with a size of zero marks the end of the trace.
+struct TraceRecord
+{
+	// The size of the record in bytes, including this header, the data that follows it and any padding
+	uint32_t size;
+
+	// The kind of traffic (see `TraceRecordKind`)
+	uint8_t kind;
+	uint8_t reserved;
+
+	// The lengths of the strings that follow the argument bytes, not including their null terminators
+	//
+	// The member is the method or property name (it's empty for updates.) The type is the GVariant type string of the
+	// arguments (it's empty if there are none.)
+	uint16_t pathLength;
+	uint16_t interfaceLength;
+	uint16_t memberLength;
+	uint16_t typeLength;
+	uint16_t reserved2;
+
+	// The number of argument bytes that follow this header
+	uint32_t argumentsLength;
+
+	// Microseconds from the start of the trace
+	uint64_t timestampMicroseconds;
+
+	// Accessors for the data following the header
+	const uint8_t *getArguments() const { return reinterpret_cast<const uint8_t *>(this + 1); }
+	const char *getPath() const { return reinterpret_cast<const char *>(getArguments() + argumentsLength); }
+	const char *getInterface() const { return getPath() + pathLength + 1; }
+	const char *getMember() const { return getInterface() + interfaceLength + 1; }
+	const char *getType() const { return getMember() + memberLength + 1; }
+};
+
+// The recorder of D-Bus GATT traffic
+struct Trace
+{
+	// The size of a trace file if none is given to `start()`
+	static const size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+
+	// Returns the one and only trace recorder
+	static Trace &getInstance()
+	{
+		static Trace instance;
+		return instance;
+	}
+
+	// Returns true if traffic is being recorded
+	//
+	// Everything that records traffic checks this first, so the cost of tracing while it's stopped (the default) is a single
+	// relaxed load.
+	static bool isEnabled() { return bEnabled.load(std::memory_order_relaxed); }
+
+	// Starts recording to a new trace file at `path` that may grow to at most `maxBytes` bytes
+	//
+	// Any trace already being recorded is stopped first. Returns false if the file could not be created and mapped.
+	bool start(const std::string &path, size_t maxBytes);
+
+	// Stops recording, trims the trace file to the records written and closes it
+	//
+	// Records being written by other threads are allowed to finish first. Does nothing if no trace is being recorded.
+	void stop();
+
+	// Records a unit of traffic
+	//
+	// `pArguments` may be nullptr. This may be called from any thread. It never blocks; if the trace file is full, the record is
+	// dropped and counted (see `getDroppedCount()`.)
+	void record(TraceRecordKind kind, const char *pPath, const char *pInterface, const char *pMember, GVariant *pArguments);
+
+	// Returns the number of records written to (or dropped from) the current or most recent trace
+	uint64_t getRecordCount() const { return recordCount.load(std::memory_order_relaxed); }
+	uint64_t getDroppedCount() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+
+	Trace() {}
+
+	// Don't allow copying
+	Trace(const Trace &) = delete;
+	Trace &operator =(const Trace &) = delete;
+
+	// Stops recording; the caller must hold `controlMutex`
+	void stopLocked();
+
+	static std::atomic<bool> bEnabled;
+
+	// Serializes `start()` and `stop()`
+	std::mutex controlMutex;
+
+	// The trace file and its mapping
+	int fd = -1;
+	uint8_t *pMapping = nullptr;
+	size_t mappingSize = 0;
+
+	// The offset of the next record in the mapping
+	std::atomic<size_t> writeOffset{0};
+
+	// The number of threads inside `record()`, so `stop()` can wait for them before unmapping the file
+	std::atomic<int> activeWriters{0};
+
+	// The time the trace started (see `Stats::nowMicroseconds()`)
+	uint64_t startMicroseconds = 0;
+
+	std::atomic<uint64_t> recordCount{0};
+	std::atomic<uint64_t> droppedCount{0};
+};
+
+}; // namespace ggk
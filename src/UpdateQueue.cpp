@@ -0,0 +1,349 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The queue of pending data updates, which is how the application tells the server that data has changed
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The application pushes updates from its own threads (see `ggkNofifyUpdatedCharacteristic` and `ggkNotifyHandle`) and the
+// server drains them on its main loop thread. Application threads are frequently time sensitive (sensor threads, for example) so
+// a push must never block on a lock held by the server thread. To that end, the queue is a bounded lock-free ring (see
+// LockFreeRing.h.)
+//
+// Being bounded, the queue can fill up. What happens then is up to the configured policy:
+//
+//     EUpdateQueueDropNewest      - the new update is discarded and the push fails
+//     EUpdateQueueOverwriteOldest - the oldest update is discarded to make room for the new one
+//
+// Either way, the discarded update is counted (see `getDroppedCount`.)
+//
+// Coalescing (if enabled) merges an update into an identical update that is already waiting. The registration for an entry is
+// released as soon as the consumer pops it, but before the consumer processes it. That way, any update merged into an entry is
+// guaranteed to be seen when that entry is processed. Registrations are atomic flags (one per handle, and one per interned
+// object path and interface pair), so coalescing doesn't take a lock either.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "UpdateQueue.h"
+#include "Server.h"
+#include "Stats.h"
+
+namespace ggk {
+
+// Construct an empty queue with the default capacity and policy
+UpdateQueue::UpdateQueue()
+: pRing(new LockFreeRing<Entry>(kDefaultCapacity)),
+  policy(EUpdateQueueDropNewest),
+  bCoalescing(false),
+  pHandlePending(new std::atomic<bool>[Server::kMaxHandles + 1]),
+  pPendingKeys(new std::atomic<const std::string *>[kMaxPendingKeys]),
+  pPendingKeyFlags(new std::atomic<bool>[kMaxPendingKeys]),
+  highWaterMark(0),
+  coalescedCount(0),
+  droppedCount(0),
+  bWakePending(false),
+  bHasPeekedEntry(false)
+{
+	for (int i = 0; i <= Server::kMaxHandles; ++i)
+	{
+		pHandlePending[i] = false;
+	}
+
+	for (int i = 0; i < kMaxPendingKeys; ++i)
+	{
+		pPendingKeys[i] = nullptr;
+		pPendingKeyFlags[i] = false;
+	}
+}
+
+// Free the interned pending keys
+UpdateQueue::~UpdateQueue()
+{
+	for (int i = 0; i < kMaxPendingKeys; ++i)
+	{
+		delete pPendingKeys[i].load();
+	}
+}
+
+// Replace the queue with an empty one of (at least) `capacity` entries, using `policy` when the queue is full
+//
+// This must not be called while other threads are using the queue.
+//
+// Returns true on success, or false if the capacity is invalid
+bool UpdateQueue::configure(size_t capacity, GGKUpdateQueuePolicy policy)
+{
+	if (capacity == 0)
+	{
+		return false;
+	}
+
+	clear();
+	pRing.reset(new LockFreeRing<Entry>(capacity));
+	this->policy = policy;
+	return true;
+}
+
+// Push an update for the given object path and interface name
+//
+// Returns true if the update was queued (or coalesced), or false if it was dropped
+bool UpdateQueue::push(const char *pObjectPath, const char *pInterfaceName)
+{
+	if (Stats::isEnabled())
+	{
+		Stats::getInstance().recordUpdateQueuePush();
+	}
+
+	Entry entry;
+	entry.objectPath = pObjectPath;
+	entry.interfaceName = pInterfaceName;
+
+	if (bCoalescing)
+	{
+		int pendingKey = claimPendingKey(entry.objectPath + "|" + entry.interfaceName);
+		if (pendingKey >= 0)
+		{
+			if (pPendingKeyFlags[pendingKey].exchange(true))
+			{
+				coalescedCount += 1;
+				return true;
+			}
+
+			entry.bCoalesced = true;
+			entry.pendingKey = pendingKey;
+		}
+	}
+
+	return pushEntry(entry);
+}
+
+// Push an update for a resolved characteristic handle
+//
+// Returns true if the update was queued (or coalesced), or false if it was dropped
+bool UpdateQueue::pushHandle(int handle)
+{
+	if (handle <= 0 || handle > Server::kMaxHandles)
+	{
+		return false;
+	}
+
+	if (Stats::isEnabled())
+	{
+		Stats::getInstance().recordUpdateQueuePush();
+	}
+
+	Entry entry;
+	entry.handle = handle;
+
+	if (bCoalescing)
+	{
+		if (pHandlePending[handle].exchange(true))
+		{
+			coalescedCount += 1;
+			return true;
+		}
+
+		entry.bCoalesced = true;
+	}
+
+	return pushEntry(entry);
+}
+
+// Push a prepared entry into the ring, applying the full-queue policy
+bool UpdateQueue::pushEntry(Entry &entry)
+{
+	while (!pRing->tryPush(entry))
+	{
+		if (policy != EUpdateQueueOverwriteOldest)
+		{
+			droppedCount += 1;
+			release(entry);
+			return false;
+		}
+
+		// Make room by discarding the oldest entry
+		Entry oldest;
+		if (pRing->tryPop(oldest))
+		{
+			droppedCount += 1;
+			release(oldest);
+		}
+	}
+
+	updateHighWaterMark();
+	return true;
+}
+
+// Release the coalescing registration for an entry that has been removed from the queue
+void UpdateQueue::release(const Entry &entry)
+{
+	if (!entry.bCoalesced)
+	{
+		return;
+	}
+
+	if (entry.handle != 0)
+	{
+		pHandlePending[entry.handle] = false;
+	}
+	else
+	{
+		pPendingKeyFlags[entry.pendingKey] = false;
+	}
+}
+
+// Returns the slot in the pending key table for `key`, adding it if it isn't there yet
+//
+// Keys are never removed, so once a key has a slot, finding it again only reads. Returns -1 if the table is full, in which case
+// the update simply isn't coalesced.
+int UpdateQueue::claimPendingKey(const std::string &key)
+{
+	// Open addressing, starting from the key's hash. A slot's key never changes once set, so a slot that doesn't hold our key can
+	// be passed over for good.
+	size_t start = std::hash<std::string>()(key) % kMaxPendingKeys;
+	std::string *pNewKey = nullptr;
+	for (int probe = 0; probe < kMaxPendingKeys; ++probe)
+	{
+		int slot = static_cast<int>((start + probe) % kMaxPendingKeys);
+		const std::string *pKey = pPendingKeys[slot].load(std::memory_order_acquire);
+		if (nullptr == pKey)
+		{
+			if (nullptr == pNewKey)
+			{
+				pNewKey = new std::string(key);
+			}
+
+			if (pPendingKeys[slot].compare_exchange_strong(pKey, pNewKey, std::memory_order_acq_rel))
+			{
+				return slot;
+			}
+
+			// Another producer took the slot first; `pKey` now holds its key, which may be ours
+		}
+
+		if (*pKey == key)
+		{
+			delete pNewKey;
+			return slot;
+		}
+	}
+
+	delete pNewKey;
+	return -1;
+}
+
+// Track the high-water mark after a successful push
+void UpdateQueue::updateHighWaterMark()
+{
+	size_t depth = size();
+	size_t mark = highWaterMark;
+	while (depth > mark && !highWaterMark.compare_exchange_weak(mark, depth)) {}
+}
+
+// Pop the oldest update into `entry`
+//
+// If `keep` is true, the entry is not removed and will be retrieved again on the next call.
+//
+// Returns true if an entry was retrieved, or false if the queue is empty
+bool UpdateQueue::pop(Entry &entry, bool keep)
+{
+	std::lock_guard<std::mutex> guard(consumerMutex);
+
+	if (!bHasPeekedEntry)
+	{
+		if (!pRing->tryPop(peekedEntry))
+		{
+			return false;
+		}
+
+		bHasPeekedEntry = true;
+	}
+
+	entry = peekedEntry;
+	if (!keep)
+	{
+		bHasPeekedEntry = false;
+		release(peekedEntry);
+
+		if (Stats::isEnabled())
+		{
+			Stats::getInstance().recordUpdateQueuePops(1);
+		}
+	}
+
+	return true;
+}
+
+// Pop up to `maxEntries` updates (oldest first) into `entries`
+//
+// The `entries` vector is cleared first, but its storage is reused, so callers can hold onto it between calls to avoid
+// reallocation.
+//
+// Returns the number of entries retrieved
+size_t UpdateQueue::popBatch(std::vector<Entry> &entries, size_t maxEntries)
+{
+	entries.clear();
+
+	std::lock_guard<std::mutex> guard(consumerMutex);
+
+	if (bHasPeekedEntry && maxEntries > 0)
+	{
+		bHasPeekedEntry = false;
+		release(peekedEntry);
+		entries.push_back(std::move(peekedEntry));
+	}
+
+	Entry entry;
+	while (entries.size() < maxEntries && pRing->tryPop(entry))
+	{
+		release(entry);
+		entries.push_back(std::move(entry));
+	}
+
+	if (Stats::isEnabled() && !entries.empty())
+	{
+		Stats::getInstance().recordUpdateQueuePops(entries.size());
+	}
+
+	return entries.size();
+}
+
+// Removes all entries from the queue (this also resets the queue's high-water mark)
+void UpdateQueue::clear()
+{
+	std::lock_guard<std::mutex> guard(consumerMutex);
+
+	if (bHasPeekedEntry)
+	{
+		bHasPeekedEntry = false;
+		release(peekedEntry);
+	}
+
+	Entry entry;
+	while (pRing->tryPop(entry))
+	{
+		release(entry);
+	}
+
+	highWaterMark = 0;
+}
+
+// Returns the number of entries waiting in the queue
+//
+// This does not take any locks, so it is safe to poll from any thread
+size_t UpdateQueue::size() const
+{
+	return pRing->size() + (bHasPeekedEntry ? 1 : 0);
+}
+
+}; // namespace ggk
@@ -0,0 +1,218 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The queue of pending data updates, which is how the application tells the server that data has changed
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of UpdateQueue.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+#include "../include/Gobbledegook.h"
+#include "LockFreeRing.h"
+
+namespace ggk {
+
+struct UpdateQueue
+{
+	//
+	// Types
+	//
+
+	// A single pending update
+	//
+	// An update refers to either a resolved characteristic handle (see `Server::resolveCharacteristic`) or an object path and
+	// interface name pair. Handle entries leave the strings empty, so they never allocate.
+	struct Entry
+	{
+		// The resolved characteristic handle, or 0 if this entry uses `objectPath` and `interfaceName`
+		int handle = 0;
+
+		// True if this entry was registered for coalescing when it was pushed
+		bool bCoalesced = false;
+
+		// For a path entry registered for coalescing, its slot in the pending key table (see `claimPendingKey`)
+		int pendingKey = -1;
+
+		std::string objectPath;
+		std::string interfaceName;
+	};
+
+	//
+	// Constants
+	//
+
+	// The default capacity of the queue (see `configure`)
+	static const size_t kDefaultCapacity = 4096;
+
+	// The number of distinct object path and interface pairs that can be coalesced (see `claimPendingKey`)
+	static const int kMaxPendingKeys = 4096;
+
+	//
+	// Singleton
+	//
+
+	// Returns the one and only instance of the update queue
+	static UpdateQueue &getInstance()
+	{
+		static UpdateQueue instance;
+		return instance;
+	}
+
+	//
+	// Configuration
+	//
+
+	// Replace the queue with an empty one of (at least) `capacity` entries, using `policy` when the queue is full
+	//
+	// This must not be called while other threads are using the queue.
+	//
+	// Returns true on success, or false if the capacity is invalid
+	bool configure(size_t capacity, GGKUpdateQueuePolicy policy);
+
+	// Enables or disables coalescing of updates (see `ggkUpdateQueueSetCoalescing`)
+	void setCoalescing(bool enable) { bCoalescing = enable; }
+
+	//
+	// Producers (any thread)
+	//
+
+	// Push an update for the given object path and interface name
+	//
+	// Returns true if the update was queued (or coalesced), or false if it was dropped
+	bool push(const char *pObjectPath, const char *pInterfaceName);
+
+	// Push an update for a resolved characteristic handle
+	//
+	// Returns true if the update was queued (or coalesced), or false if it was dropped
+	bool pushHandle(int handle);
+
+	// Called by a producer after a successful push to determine if it should wake the consumer
+	//
+	// Exactly one producer will receive `true` between calls to `resetWakeup()`, so the consumer is only woken once for any
+	// number of pushes.
+	bool claimWakeup() { return !bWakePending.exchange(true); }
+
+	//
+	// Consumers
+	//
+
+	// Called by the consumer before it starts processing the queue, so that any updates pushed from this point on will wake it
+	// again (see `claimWakeup`)
+	void resetWakeup() { bWakePending = false; }
+
+	// Pop the oldest update into `entry`
+	//
+	// If `keep` is true, the entry is not removed and will be retrieved again on the next call.
+	//
+	// Returns true if an entry was retrieved, or false if the queue is empty
+	bool pop(Entry &entry, bool keep);
+
+	// Pop up to `maxEntries` updates (oldest first) into `entries`
+	//
+	// The `entries` vector is cleared first, but its storage is reused, so callers can hold onto it between calls to avoid
+	// reallocation.
+	//
+	// Returns the number of entries retrieved
+	size_t popBatch(std::vector<Entry> &entries, size_t maxEntries);
+
+	// Removes all entries from the queue (this also resets the queue's high-water mark)
+	void clear();
+
+	//
+	// State
+	//
+
+	// Returns the number of entries waiting in the queue
+	//
+	// This does not take any locks, so it is safe to poll from any thread
+	size_t size() const;
+
+	// Returns true if the queue is empty
+	bool empty() const { return size() == 0; }
+
+	// Returns the largest number of entries that have been waiting in the queue at one time
+	size_t getHighWaterMark() const { return highWaterMark; }
+
+	// Returns the number of updates that were merged into an already-pending entry
+	size_t getCoalescedCount() const { return coalescedCount; }
+
+	// Returns the number of updates that were discarded because the queue was full
+	size_t getDroppedCount() const { return droppedCount; }
+
+private:
+
+	UpdateQueue();
+	~UpdateQueue();
+
+	// Don't allow copying
+	UpdateQueue(const UpdateQueue &) = delete;
+	UpdateQueue &operator =(const UpdateQueue &) = delete;
+
+	// Push a prepared entry into the ring, applying the full-queue policy
+	bool pushEntry(Entry &entry);
+
+	// Release the coalescing registration for an entry that has been removed from the queue
+	void release(const Entry &entry);
+
+	// Returns the slot in the pending key table for `key`, adding it if it isn't there yet
+	//
+	// Keys are never removed, so once a key has a slot, finding it again only reads. Returns -1 if the table is full, in which case
+	// the update simply isn't coalesced.
+	int claimPendingKey(const std::string &key);
+
+	// Track the high-water mark after a successful push
+	void updateHighWaterMark();
+
+	std::unique_ptr<LockFreeRing<Entry>> pRing;
+	std::atomic<int> policy;
+
+	// Coalescing
+	//
+	// Handle entries are coalesced through `pHandlePending`, indexed by handle. Path entries are coalesced through a fixed table of
+	// interned keys ("path|interface"), each with its own pending flag. A key is added by swapping its string into an empty slot
+	// and is never removed, so neither kind of entry takes a lock to push or release.
+	std::atomic<bool> bCoalescing;
+	std::unique_ptr<std::atomic<bool>[]> pHandlePending;
+	std::unique_ptr<std::atomic<const std::string *>[]> pPendingKeys;
+	std::unique_ptr<std::atomic<bool>[]> pPendingKeyFlags;
+
+	// Counters
+	std::atomic<size_t> highWaterMark;
+	std::atomic<size_t> coalescedCount;
+	std::atomic<size_t> droppedCount;
+
+	// Wakeup management (see `claimWakeup`)
+	std::atomic<bool> bWakePending;
+
+	// Consumer-side state for `pop(entry, true)`
+	//
+	// Producers never touch this (other than reading `bHasPeekedEntry` for `size()`), so it's safe for the consumer to guard it
+	// with a mutex.
+	std::mutex consumerMutex;
+	std::atomic<bool> bHasPeekedEntry;
+	Entry peekedEntry;
+};
+
+}; // namespace ggk
@@ -203,6 +203,32 @@ std::string Utils::bluetoothAddressString(uint8_t *pAddress)
 	return hex;
 }
 
+// Parses a BlueZ device object path (such as /org/bluez/hci0/dev_12_34_56_78_9A_BC) into its controller index and address
+//
+// The six octets of the address are stored at `pAddress` least significant first, the order used by the Bluetooth Management
+// API (so the example above is stored as BC 9A 78 56 34 12.)
+//
+// Returns true on success, otherwise false
+bool Utils::bluetoothAddressFromDevicePath(const char *pPath, uint16_t &controllerIndex, uint8_t *pAddress)
+{
+	unsigned int index;
+	unsigned int octets[6];
+	int length = 0;
+	if (sscanf(pPath, "/org/bluez/hci%u/dev_%2x_%2x_%2x_%2x_%2x_%2x%n", &index, &octets[0], &octets[1], &octets[2], &octets[3],
+		&octets[4], &octets[5], &length) != 7 || pPath[length] != 0 || index > 0xffff)
+	{
+		return false;
+	}
+
+	controllerIndex = static_cast<uint16_t>(index);
+	for (int i = 0; i < 6; ++i)
+	{
+		pAddress[i] = static_cast<uint8_t>(octets[5 - i]);
+	}
+
+	return true;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // GVariant helper functions
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -360,10 +386,36 @@ GVariant *Utils::gvariantFromByteArray(const guint8 *pBytes, int count)
 }
 
 // Returns an array of bytes ("ay") with the contents of the input array of unsigned 8-bit values
-GVariant *Utils::gvariantFromByteArray(const std::vector<guint8> bytes)
+GVariant *Utils::gvariantFromByteArray(const std::vector<guint8> &bytes)
 {
 	GBytes *pGbytes = g_bytes_new(bytes.data(), bytes.size());
-	GVariant *pGVariant = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pGbytes, bytes.size());
+	GVariant *pGVariant = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pGbytes, true);
+	g_bytes_unref(pGbytes);
+	return pGVariant;
+}
+
+// Returns an array of bytes ("ay") that refers to the contents of `pBytes` rather than copying them
+//
+// If `pBytes` is nullptr, the array is empty. The caller keeps its reference to `pBytes`.
+GVariant *Utils::gvariantFromBytes(GBytes *pBytes)
+{
+	if (nullptr == pBytes)
+	{
+		return gvariantFromBuffer(nullptr, 0);
+	}
+
+	// A byte array has no alignment requirements, so GLib uses the bytes as they are
+	return g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pBytes, true);
+}
+
+// Returns an array of bytes ("ay") that refers to the `size` bytes at `pData` rather than copying them
+//
+// The data must remain valid and unchanged until GLib is done with it, at which point `releaseFunc(pReleaseData)` is called.
+// If `releaseFunc` is nullptr, the data must remain valid for the life of the server.
+GVariant *Utils::gvariantFromBuffer(const void *pData, size_t size, GDestroyNotify releaseFunc, gpointer pReleaseData)
+{
+	GBytes *pGbytes = nullptr == releaseFunc ? g_bytes_new_static(pData, size) : g_bytes_new_with_free_func(pData, size, releaseFunc, pReleaseData);
+	GVariant *pGVariant = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pGbytes, true);
 	g_bytes_unref(pGbytes);
 	return pGVariant;
 }
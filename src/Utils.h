@@ -89,6 +89,14 @@ struct Utils
 	// This method returns a set of six zero-padded 8-bit hex values 8-bit in the format: 12:34:56:78:9A:BC
 	static std::string bluetoothAddressString(uint8_t *pAddress);
 
+	// Parses a BlueZ device object path (such as /org/bluez/hci0/dev_12_34_56_78_9A_BC) into its controller index and address
+	//
+	// The six octets of the address are stored at `pAddress` least significant first, the order used by the Bluetooth Management
+	// API (so the example above is stored as BC 9A 78 56 34 12.)
+	//
+	// Returns true on success, otherwise false
+	static bool bluetoothAddressFromDevicePath(const char *pPath, uint16_t &controllerIndex, uint8_t *pAddress);
+
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// A small collection of helper functions for generating various types of GVariants, which are needed when responding to BlueZ
 	// method/property messages. Real services will likley need more of these to support various types of data passed to/from BlueZ,
@@ -141,7 +149,18 @@ struct Utils
 	static GVariant *gvariantFromByteArray(const guint8 *pBytes, int count);
 
 	// Returns an array of bytes ("ay") with the contents of the input array of unsigned 8-bit values
-	static GVariant *gvariantFromByteArray(const std::vector<guint8> bytes);
+	static GVariant *gvariantFromByteArray(const std::vector<guint8> &bytes);
+
+	// Returns an array of bytes ("ay") that refers to the contents of `pBytes` rather than copying them
+	//
+	// If `pBytes` is nullptr, the array is empty. The caller keeps its reference to `pBytes`.
+	static GVariant *gvariantFromBytes(GBytes *pBytes);
+
+	// Returns an array of bytes ("ay") that refers to the `size` bytes at `pData` rather than copying them
+	//
+	// The data must remain valid and unchanged until GLib is done with it, at which point `releaseFunc(pReleaseData)` is called.
+	// If `releaseFunc` is nullptr, the data must remain valid for the life of the server.
+	static GVariant *gvariantFromBuffer(const void *pData, size_t size, GDestroyNotify releaseFunc = nullptr, gpointer pReleaseData = nullptr);
 
 	// Returns an array of bytes ("ay") containing a single unsigned 8-bit value
 	static GVariant *gvariantFromByteArray(const guint8 data);
@@ -0,0 +1,122 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A small, bounded pool of worker threads that run slow method handlers off of the main loop's thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Method calls arrive on the thread running the GLib main loop, and are normally handled right there. That's fine for handlers
+// that reply from memory, but a handler that talks to hardware (reading a sensor over I2C can take 5-20ms) holds up every other
+// central's requests, tick events and the update queue for as long as it runs.
+//
+// Handlers registered with `GattCharacteristic::onReadValueAsync()` or `onWriteValueAsync()` are instead queued here and run on
+// one of a handful of worker threads. The handler replies to its `GDBusMethodInvocation` from the worker, which GLib allows from
+// any thread, so the main loop carries on while several slow handlers run at once.
+//
+// The pool is bounded in both threads and queued jobs. If the queue is full, the method call is answered with an error rather
+// than piling up work that BlueZ will have given up on by the time we get to it.
+//
+// The worker threads are started on the first submitted job, so servers that don't use async handlers never create them. Nothing
+// else should be submitted here (blocking controller setup, for example, runs on its own thread; see `configureAdapter()`), since
+// it would compete with those handlers for the pool's few threads.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "WorkerPool.h"
+
+namespace ggk {
+
+// Queues `job` to be run on one of the worker threads, starting the workers if needed
+//
+// Returns false if the pool is stopping or its queue is full, in which case `job` is not run.
+bool WorkerPool::submit(Job job)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (bStopping || jobs.size() >= kMaxPendingJobs)
+	{
+		return false;
+	}
+
+	if (threads.empty())
+	{
+		for (int i = 0; i < kThreadCount; ++i)
+		{
+			threads.push_back(std::thread(&WorkerPool::run, this));
+		}
+	}
+
+	jobs.push_back(std::move(job));
+	jobReady.notify_one();
+	return true;
+}
+
+// Runs the remaining queued jobs, then stops and joins the worker threads
+//
+// The pool starts again on the next call to `submit()`.
+void WorkerPool::stop()
+{
+	std::vector<std::thread> stopping;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (bStopping || threads.empty())
+		{
+			return;
+		}
+
+		bStopping = true;
+		stopping.swap(threads);
+	}
+
+	jobReady.notify_all();
+	for (std::thread &thread : stopping)
+	{
+		// A job that stops the pool can't wait for its own thread to finish
+		if (thread.get_id() == std::this_thread::get_id())
+		{
+			thread.detach();
+		}
+		else
+		{
+			thread.join();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	bStopping = false;
+}
+
+// The body of each worker thread
+//
+// Workers only exit once the queue is empty, so every job that was accepted gets to reply to its method call.
+void WorkerPool::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		jobReady.wait(lock, [this] { return bStopping || !jobs.empty(); });
+		if (jobs.empty())
+		{
+			return;
+		}
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+
+		lock.unlock();
+		job();
+		lock.lock();
+	}
+}
+
+}; // namespace ggk
@@ -0,0 +1,82 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A small, bounded pool of worker threads that run slow method handlers off of the main loop's thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of WorkerPool.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stddef.h>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace ggk {
+
+struct WorkerPool
+{
+	// A unit of work
+	typedef std::function<void()> Job;
+
+	// The number of worker threads
+	static const int kThreadCount = 4;
+
+	// The maximum number of jobs that may be waiting for a worker
+	static const size_t kMaxPendingJobs = 32;
+
+	// Returns the one and only instance of the pool
+	static WorkerPool &getInstance()
+	{
+		static WorkerPool instance;
+		return instance;
+	}
+
+	// Queues `job` to be run on one of the worker threads, starting the workers if needed
+	//
+	// Returns false if the pool is stopping or its queue is full, in which case `job` is not run.
+	bool submit(Job job);
+
+	// Runs the remaining queued jobs, then stops and joins the worker threads
+	//
+	// The pool starts again on the next call to `submit()`.
+	void stop();
+
+private:
+
+	WorkerPool() : bStopping(false) {}
+	~WorkerPool() { stop(); }
+
+	// Don't allow copying
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator =(const WorkerPool &) = delete;
+
+	// The body of each worker thread
+	void run();
+
+	std::mutex mutex;
+	std::condition_variable jobReady;
+	std::deque<Job> jobs;
+	std::vector<std::thread> threads;
+	bool bStopping;
+};
+
+}; // namespace ggk
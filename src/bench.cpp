@@ -0,0 +1,365 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Micro-benchmarks for the server's request and notification paths
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// This program builds synthetic servers (see the `Server` constructor that accepts a `defineObjects` function) of various sizes
+// and times the paths that run for every request or update:
+//
+//     findInterface         - `Server::findInterface()` for a random characteristic
+//     findProperty          - `Server::findProperty()` for a characteristic's UUID property
+//     Server::callMethod    - `Server::callMethod()` dispatching a ReadValue
+//     DBusObject::callMethod - `DBusObject::callMethod()` dispatching a ReadValue by walking the object tree
+//     push+idleFunc         - `ggkPushUpdateQueue()` followed by draining the queue with `idleFunc()`
+//     getManagedObjects     - Building the `GetManagedObjects` response from scratch
+//     getManagedObjects(c)  - Returning the cached `GetManagedObjects` response
+//     introspectionXML      - `DBusObject::generateIntrospectionXML()` for the whole tree
+//
+// Nothing here talks to D-Bus or BlueZ. The synthetic methods don't reply to their (null) invocations, so the numbers cover our
+// own dispatch and bookkeeping, not the cost of the bus.
+//
+// Each benchmark is run repeatedly for at least the configured time and reports the average time and the average number of
+// C++ heap allocations per operation. Allocations made directly through GLib (g_malloc and friends) are not counted.
+//
+// Usage: bench [-t <milliseconds>] [characteristic count ...]
+//
+// The default sizes are 10, 100, 1000 and 10000 characteristics, with ten characteristics per service.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/Gobbledegook.h"
+#include "Server.h"
+#include "DBusObject.h"
+#include "DBusObjectPath.h"
+#include "GattService.h"
+#include "GattCharacteristic.h"
+#include "GattDescriptor.h"
+#include "Init.h"
+
+namespace ggk {
+
+// Internal method to set the run state of the server (see Gobbledegook.cpp)
+extern void setServerRunState(enum GGKServerRunState newState);
+
+}; // namespace ggk
+
+using namespace ggk;
+
+//
+// Allocation counting
+//
+// We replace the global allocation functions so every C++ heap allocation in this program (including those made by the library)
+// is counted.
+//
+
+static std::atomic<size_t> allocationCount(0);
+
+void *operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(size == 0 ? 1 : size);
+	if (nullptr == p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
+
+//
+// Constants
+//
+
+// The number of characteristics in each synthetic service
+static const int kCharacteristicsPerService = 10;
+
+// The GATT characteristic interface name
+static const char *kCharacteristicInterface = "org.bluez.GattCharacteristic1";
+
+//
+// Synthetic server
+//
+
+// The number of ReadValue calls that reached a characteristic (this keeps the calls from being optimized away)
+static volatile size_t readCount = 0;
+
+// The number of updates that reached a characteristic
+static volatile size_t updateCount = 0;
+
+// Results we hold onto so the work that produced them can't be optimized away
+static const GattProperty * volatile propertySink = nullptr;
+static volatile size_t xmlLength = 0;
+
+// There's a good chance there will be a bunch of unused parameters from the lambda macros
+#if defined(__GNUC__) && defined(__clang__)
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wunused-parameter"
+#endif
+#if defined(__GNUC__) && !defined(__clang__)
+	#pragma GCC diagnostic push
+	#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+// Defines `characteristicCount` characteristics (each with a descriptor) under `root`, recording their paths in `paths`
+static void defineSyntheticObjects(DBusObject &root, int characteristicCount, std::vector<DBusObjectPath> &paths)
+{
+	int serviceCount = (characteristicCount + kCharacteristicsPerService - 1) / kCharacteristicsPerService;
+	for (int serviceIndex = 0; serviceIndex < serviceCount; ++serviceIndex)
+	{
+		GattService &service = root.gattServiceBegin("service" + std::to_string(serviceIndex), GattUuid(static_cast<uint32_t>(0x10000 + serviceIndex)));
+
+		for (int i = 0; i < kCharacteristicsPerService; ++i)
+		{
+			int characteristicIndex = serviceIndex * kCharacteristicsPerService + i;
+			if (characteristicIndex >= characteristicCount)
+			{
+				break;
+			}
+
+			GattCharacteristic &characteristic = service.gattCharacteristicBegin("char" + std::to_string(i), GattUuid(static_cast<uint32_t>(0x100000 + characteristicIndex)), {"read", "write", "notify"});
+
+			characteristic.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+			{
+				readCount = readCount + 1;
+			});
+
+			characteristic.onUpdatedValue(CHARACTERISTIC_UPDATED_VALUE_CALLBACK_LAMBDA
+			{
+				updateCount = updateCount + 1;
+				return true;
+			});
+
+			characteristic.gattDescriptorBegin("description", "2901", {"read"})
+				.onReadValue(DESCRIPTOR_METHOD_CALLBACK_LAMBDA
+				{
+					readCount = readCount + 1;
+				})
+			.gattDescriptorEnd();
+
+			paths.push_back(characteristic.getPath());
+			characteristic.gattCharacteristicEnd();
+		}
+
+		service.gattServiceEnd();
+	}
+}
+
+#if defined(__GNUC__) && defined(__clang__)
+	#pragma clang diagnostic pop
+#endif
+#if defined(__GNUC__) && !defined(__clang__)
+	#pragma GCC diagnostic pop
+#endif
+
+//
+// Benchmarking
+//
+
+// Runs `op` repeatedly for at least `minTimeMS` milliseconds and prints the average time and allocations per operation
+//
+// `op` is given the iteration number and returns the number of operations it performed.
+static void runBenchmark(const char *pName, int minTimeMS, const std::function<size_t(size_t iteration)> &op)
+{
+	// Warm up (this also fills any caches the first call builds)
+	op(0);
+
+	size_t operations = 0;
+	size_t iteration = 1;
+	size_t allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point end = start + std::chrono::milliseconds(minTimeMS);
+	std::chrono::steady_clock::time_point now = start;
+
+	while (now < end)
+	{
+		// Check the clock every so often, rather than after every operation
+		for (int i = 0; i < 16; ++i)
+		{
+			operations += op(iteration++);
+		}
+
+		now = std::chrono::steady_clock::now();
+	}
+
+	size_t allocations = allocationCount.load() - allocationsBefore;
+	double elapsedNS = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+
+	printf("  %-24s %12.1f ns/op %10.2f allocs/op %12zu ops\n", pName, elapsedNS / operations,
+		static_cast<double>(allocations) / operations, operations);
+}
+
+// Builds a synthetic server with `characteristicCount` characteristics and runs every benchmark against it
+static void benchmarkServer(int characteristicCount, int minTimeMS)
+{
+	std::vector<DBusObjectPath> paths;
+	addServer(std::make_shared<Server>("bench", [&](DBusObject &root)
+	{
+		defineSyntheticObjects(root, characteristicCount, paths);
+	}));
+
+	printf("%d characteristics\n", characteristicCount);
+
+	// Pre-compute a random sequence of characteristics to visit, so the lookups don't all hit the same entry
+	std::vector<size_t> order(4096);
+	std::mt19937 rng(characteristicCount);
+	for (size_t &index : order)
+	{
+		index = rng() % paths.size();
+	}
+
+	const std::string interfaceName = kCharacteristicInterface;
+	const std::string methodName = "ReadValue";
+	const std::string propertyName = "UUID";
+	const DBusObject &root = TheServer->getObjects().front();
+
+	runBenchmark("findInterface", minTimeMS, [&](size_t iteration) -> size_t
+	{
+		TheServer->findInterface(paths[order[iteration % order.size()]], interfaceName);
+		return 1;
+	});
+
+	runBenchmark("findProperty", minTimeMS, [&](size_t iteration) -> size_t
+	{
+		propertySink = TheServer->findProperty(paths[order[iteration % order.size()]], interfaceName, propertyName);
+		return 1;
+	});
+
+	runBenchmark("Server::callMethod", minTimeMS, [&](size_t iteration) -> size_t
+	{
+		TheServer->callMethod(paths[order[iteration % order.size()]], interfaceName, methodName, nullptr, nullptr, nullptr, nullptr);
+		return 1;
+	});
+
+	runBenchmark("DBusObject::callMethod", minTimeMS, [&](size_t iteration) -> size_t
+	{
+		root.callMethod(paths[order[iteration % order.size()]], interfaceName, methodName, nullptr, nullptr, nullptr, nullptr);
+		return 1;
+	});
+
+	// Each iteration pushes a batch of updates and then drains the queue, just as the server's main loop would
+	std::vector<std::string> pathStrings;
+	for (const DBusObjectPath &path : paths)
+	{
+		pathStrings.push_back(path.toString());
+	}
+
+	const size_t kUpdateBatch = 64;
+	runBenchmark("push+idleFunc", minTimeMS, [&](size_t iteration) -> size_t
+	{
+		for (size_t i = 0; i < kUpdateBatch; ++i)
+		{
+			ggkPushUpdateQueue(pathStrings[order[(iteration * kUpdateBatch + i) % order.size()]].c_str(), kCharacteristicInterface);
+		}
+
+		while (idleFunc(nullptr)) {}
+		return kUpdateBatch;
+	});
+
+	runBenchmark("getManagedObjects", minTimeMS, [&](size_t) -> size_t
+	{
+		TheServer->invalidateManagedObjects();
+		TheServer->getManagedObjects();
+		return 1;
+	});
+
+	runBenchmark("getManagedObjects(c)", minTimeMS, [&](size_t) -> size_t
+	{
+		TheServer->getManagedObjects();
+		return 1;
+	});
+
+	runBenchmark("introspectionXML", minTimeMS, [&](size_t) -> size_t
+	{
+		xmlLength = root.generateIntrospectionXML().length();
+		return 1;
+	});
+
+	printf("\n");
+
+	clearServers();
+}
+
+int main(int argc, char **ppArgv)
+{
+	int minTimeMS = 250;
+	std::vector<int> sizes;
+
+	// A basic command-line parser
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = ppArgv[i];
+		if (arg == "-t" && i + 1 < argc)
+		{
+			minTimeMS = atoi(ppArgv[++i]);
+		}
+		else if (atoi(arg.c_str()) > 0)
+		{
+			sizes.push_back(atoi(arg.c_str()));
+		}
+		else
+		{
+			fprintf(stderr, "Unknown parameter: '%s'\n\n", arg.c_str());
+			fprintf(stderr, "Usage: bench [-t <milliseconds>] [characteristic count ...]\n");
+			return -1;
+		}
+	}
+
+	if (sizes.empty())
+	{
+		sizes = { 10, 100, 1000, 10000 };
+	}
+
+	// The idleFunc only does work while the server is running
+	setServerRunState(ERunning);
+
+	for (int characteristicCount : sizes)
+	{
+		benchmarkServer(characteristicCount, minTimeMS);
+	}
+
+	setServerRunState(EStopped);
+	return 0;
+}
@@ -0,0 +1,574 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// An end-to-end load generator that drives a running server over D-Bus
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The micro-benchmarks (see bench.cpp) time our own dispatch with no bus involved. This program measures the whole path that a
+// request takes in production, short of the radio: it connects to the D-Bus system bus just as BlueZ does, finds the server's
+// characteristics through the server's `GetManagedObjects` method and then calls them:
+//
+//     read  - `ReadValue` on every characteristic with the "read" flag
+//     write - `WriteValue` on every characteristic with the "write" flag (this changes the server's data, so it's off by default)
+//     get   - `org.freedesktop.DBus.Properties.Get` of every characteristic's `UUID` property
+//
+// A fixed number of calls are kept in flight at once (-c) and the total rate of calls may be capped (-r). Calls take turns
+// between the enabled operations and, within each operation, between the characteristics that support it.
+//
+// We also subscribe to the server's `PropertiesChanged` signals and call `StartNotify` on every characteristic with the "notify"
+// or "indicate" flag (as BlueZ does when a client subscribes) so the server's change notifications are sent, and counted here.
+// `StopNotify` is called again on the way out.
+//
+// Once the run is over (or interrupted with Ctrl-C) we report the throughput of each operation along with its p50, p99 and p999
+// latencies, measured from sending each call to receiving its reply, and the rate at which notifications arrived.
+//
+// The server must already be running (see standalone.cpp), but it doesn't need a Bluetooth adapter or to have registered with
+// BlueZ. The system bus's default policy only allows root to talk to the server, so this will generally need to run as root.
+//
+// Usage: loadgen [-n <service name>] [-c <concurrency>] [-r <calls per second>] [-d <seconds>] [-o <read,write,get>]
+//                [-w <write size>] [-t <timeout ms>] [--session]
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <signal.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The interfaces we talk to
+static const char *kCharacteristicInterface = "org.bluez.GattCharacteristic1";
+static const char *kPropertiesInterface = "org.freedesktop.DBus.Properties";
+static const char *kObjectManagerInterface = "org.freedesktop.DBus.ObjectManager";
+
+// The operations we can perform
+enum Operation
+{
+	EOperationRead,
+	EOperationWrite,
+	EOperationGet,
+
+	EOperationCount
+};
+
+static const char *kOperationNames[EOperationCount] = { "read", "write", "get" };
+
+// The results of one operation
+struct OperationResults
+{
+	std::vector<uint64_t> latenciesUS;
+	size_t errorCount;
+};
+
+// Each slot keeps a single call in flight
+struct Slot
+{
+	Operation operation;
+	std::chrono::steady_clock::time_point start;
+};
+
+//
+// Settings
+//
+
+static std::string serviceName = "gobbledegook";
+static int concurrency = 8;
+static double callsPerSecond = 0.0;
+static int durationS = 10;
+static int writeSize = 20;
+static int timeoutMS = 5000;
+static bool bUseSessionBus = false;
+static bool bOperationEnabled[EOperationCount] = { true, false, true };
+
+//
+// State
+//
+// Everything here is only touched from the main loop's thread
+//
+
+static GDBusConnection *pConnection = nullptr;
+static GMainLoop *pMainLoop = nullptr;
+static std::string busName;
+
+// The object paths that support each operation, and the characteristics we subscribe to
+static std::vector<std::string> operationPaths[EOperationCount];
+static std::vector<std::string> notifyPaths;
+
+// The order in which calls take turns between operations, and where each operation is in its list of paths
+static std::vector<Operation> operationCycle;
+static size_t cycleIndex = 0;
+static size_t pathIndex[EOperationCount] = { 0 };
+
+// The run's timing, and the number of calls started (or scheduled to start) so far
+static std::chrono::steady_clock::time_point startTime;
+static std::chrono::steady_clock::time_point endTime;
+static size_t scheduledCount = 0;
+static int inFlightCount = 0;
+
+// Our results
+static OperationResults results[EOperationCount];
+static size_t notificationCount = 0;
+
+// The arguments shared by every call of a kind, built once
+static GVariant *pReadOptions = nullptr;
+static GVariant *pWriteValue = nullptr;
+static GVariant *pWriteOptions = nullptr;
+
+static void startNextCall(Slot &slot);
+
+//
+// Discovery
+//
+
+// Finds the server's characteristics and sorts them by the operations they support
+//
+// Returns false if the server couldn't be reached
+static bool discoverCharacteristics()
+{
+	std::string objectManagerPath = "/com/" + serviceName;
+
+	GError *pError = nullptr;
+	GVariant *pReply = g_dbus_connection_call_sync(pConnection, busName.c_str(), objectManagerPath.c_str(), kObjectManagerInterface,
+		"GetManagedObjects", nullptr, G_VARIANT_TYPE("(a{oa{sa{sv}}})"), G_DBUS_CALL_FLAGS_NONE, timeoutMS, nullptr, &pError);
+
+	if (nullptr == pReply)
+	{
+		fprintf(stderr, "Unable to get the managed objects of '%s' at '%s': %s\n", busName.c_str(), objectManagerPath.c_str(),
+			nullptr == pError ? "Unknown" : pError->message);
+		g_clear_error(&pError);
+		return false;
+	}
+
+	GVariantIter *pObjects = nullptr;
+	g_variant_get(pReply, "(a{oa{sa{sv}}})", &pObjects);
+
+	const gchar *pPath = nullptr;
+	GVariant *pInterfaces = nullptr;
+	while (g_variant_iter_next(pObjects, "{&o@a{sa{sv}}}", &pPath, &pInterfaces))
+	{
+		GVariant *pProperties = g_variant_lookup_value(pInterfaces, kCharacteristicInterface, G_VARIANT_TYPE("a{sv}"));
+		if (nullptr != pProperties)
+		{
+			operationPaths[EOperationGet].push_back(pPath);
+
+			const gchar **ppFlags = nullptr;
+			if (g_variant_lookup(pProperties, "Flags", "^a&s", &ppFlags))
+			{
+				bool bRead = false;
+				bool bWrite = false;
+				bool bNotify = false;
+				for (const gchar **ppFlag = ppFlags; nullptr != *ppFlag; ++ppFlag)
+				{
+					std::string flag = *ppFlag;
+					bRead = bRead || flag == "read";
+					bWrite = bWrite || flag == "write";
+					bNotify = bNotify || flag == "notify" || flag == "indicate";
+				}
+				g_free(ppFlags);
+
+				if (bRead) { operationPaths[EOperationRead].push_back(pPath); }
+				if (bWrite) { operationPaths[EOperationWrite].push_back(pPath); }
+				if (bNotify) { notifyPaths.push_back(pPath); }
+			}
+
+			g_variant_unref(pProperties);
+		}
+
+		g_variant_unref(pInterfaces);
+	}
+
+	g_variant_iter_free(pObjects);
+	g_variant_unref(pReply);
+	return true;
+}
+
+//
+// Notifications
+//
+
+// Counts each change notification from the server
+static void onPropertiesChanged(GDBusConnection *, const gchar *, const gchar *, const gchar *, const gchar *, GVariant *, gpointer)
+{
+	notificationCount += 1;
+}
+
+// Calls `methodName` (StartNotify or StopNotify) on every characteristic that can notify
+//
+// Returns the number of calls that succeeded
+static size_t callNotifyMethod(const char *pMethodName)
+{
+	size_t successCount = 0;
+	for (const std::string &path : notifyPaths)
+	{
+		GError *pError = nullptr;
+		GVariant *pReply = g_dbus_connection_call_sync(pConnection, busName.c_str(), path.c_str(), kCharacteristicInterface,
+			pMethodName, nullptr, nullptr, G_DBUS_CALL_FLAGS_NONE, timeoutMS, nullptr, &pError);
+
+		if (nullptr == pReply)
+		{
+			fprintf(stderr, "%s failed for '%s': %s\n", pMethodName, path.c_str(), nullptr == pError ? "Unknown" : pError->message);
+			g_clear_error(&pError);
+			continue;
+		}
+
+		g_variant_unref(pReply);
+		successCount += 1;
+	}
+
+	return successCount;
+}
+
+//
+// Calls
+//
+
+// Returns the number of microseconds from `start` to `end`
+static uint64_t elapsedUS(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+}
+
+// Called when a call's reply (or error) arrives
+static void onCallComplete(GObject *, GAsyncResult *pResult, gpointer pUserData)
+{
+	Slot &slot = *static_cast<Slot *>(pUserData);
+	uint64_t latencyUS = elapsedUS(slot.start, std::chrono::steady_clock::now());
+	OperationResults &operationResults = results[slot.operation];
+
+	GError *pError = nullptr;
+	GVariant *pReply = g_dbus_connection_call_finish(pConnection, pResult, &pError);
+	if (nullptr == pReply)
+	{
+		// Only the first failure of each operation is worth showing; the rest are counted
+		if (operationResults.errorCount == 0)
+		{
+			fprintf(stderr, "A %s call failed: %s\n", kOperationNames[slot.operation], nullptr == pError ? "Unknown" : pError->message);
+		}
+		operationResults.errorCount += 1;
+		g_clear_error(&pError);
+	}
+	else
+	{
+		operationResults.latenciesUS.push_back(latencyUS);
+		g_variant_unref(pReply);
+	}
+
+	inFlightCount -= 1;
+	startNextCall(slot);
+}
+
+// Sends the next call in the cycle from `slot`
+static void sendCall(Slot &slot)
+{
+	Operation operation = operationCycle[cycleIndex++ % operationCycle.size()];
+	const std::vector<std::string> &paths = operationPaths[operation];
+	const std::string &path = paths[pathIndex[operation]++ % paths.size()];
+
+	const char *pInterfaceName = kCharacteristicInterface;
+	const char *pMethodName = nullptr;
+	GVariant *pParameters = nullptr;
+	switch(operation)
+	{
+		case EOperationRead:
+			pMethodName = "ReadValue";
+			pParameters = g_variant_new("(@a{sv})", pReadOptions);
+			break;
+		case EOperationWrite:
+			pMethodName = "WriteValue";
+			pParameters = g_variant_new("(@ay@a{sv})", pWriteValue, pWriteOptions);
+			break;
+		default:
+			pInterfaceName = kPropertiesInterface;
+			pMethodName = "Get";
+			pParameters = g_variant_new("(ss)", kCharacteristicInterface, "UUID");
+			break;
+	}
+
+	slot.operation = operation;
+	slot.start = std::chrono::steady_clock::now();
+	inFlightCount += 1;
+
+	g_dbus_connection_call(pConnection, busName.c_str(), path.c_str(), pInterfaceName, pMethodName, pParameters, nullptr,
+		G_DBUS_CALL_FLAGS_NONE, timeoutMS, nullptr, onCallComplete, &slot);
+}
+
+// Sends a slot's call once the rate limit allows it
+static gboolean onSlotTimer(gpointer pUserData)
+{
+	Slot &slot = *static_cast<Slot *>(pUserData);
+	if (std::chrono::steady_clock::now() >= endTime)
+	{
+		startNextCall(slot);
+	}
+	else
+	{
+		sendCall(slot);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+// Starts the slot's next call, either right away or when the rate limit allows it
+//
+// Once the run is over, no more calls are started and the main loop is stopped when the last call is answered.
+static void startNextCall(Slot &slot)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now >= endTime)
+	{
+		if (inFlightCount == 0)
+		{
+			g_main_loop_quit(pMainLoop);
+		}
+		return;
+	}
+
+	// Each call gets its own time to start, so slots that become free together don't all send at once
+	size_t callIndex = scheduledCount++;
+	if (callsPerSecond > 0.0)
+	{
+		std::chrono::steady_clock::time_point due = startTime + std::chrono::microseconds(static_cast<int64_t>(callIndex * 1000000.0 / callsPerSecond));
+		if (due > now)
+		{
+			guint delayMS = static_cast<guint>((elapsedUS(now, due) + 999) / 1000);
+			g_timeout_add(delayMS, onSlotTimer, &slot);
+			return;
+		}
+	}
+
+	sendCall(slot);
+}
+
+// Ends the run early on Ctrl-C (the calls in flight are still answered and counted)
+static gboolean onInterrupt(gpointer)
+{
+	endTime = std::chrono::steady_clock::now();
+	if (inFlightCount == 0)
+	{
+		g_main_loop_quit(pMainLoop);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+//
+// Reporting
+//
+
+// Returns the value at fraction `p` of the way through `sorted`
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+
+	size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+	return sorted[index];
+}
+
+// Prints a line of the report for a set of latencies
+static void printResults(const char *pName, std::vector<uint64_t> &latenciesUS, size_t errorCount, double elapsedS)
+{
+	std::sort(latenciesUS.begin(), latenciesUS.end());
+	printf("  %-8s %10zu %8zu %12.1f %10llu %10llu %10llu %10llu\n", pName, latenciesUS.size(), errorCount,
+		static_cast<double>(latenciesUS.size()) / elapsedS,
+		static_cast<unsigned long long>(percentile(latenciesUS, 0.50)),
+		static_cast<unsigned long long>(percentile(latenciesUS, 0.99)),
+		static_cast<unsigned long long>(percentile(latenciesUS, 0.999)),
+		static_cast<unsigned long long>(latenciesUS.empty() ? 0 : latenciesUS.back()));
+}
+
+// Prints the results of the run
+static void printReport(double elapsedS)
+{
+	printf("\n%.1f seconds, %d in flight%s\n\n", elapsedS, concurrency, callsPerSecond > 0.0 ? "" : ", unlimited rate");
+	printf("  %-8s %10s %8s %12s %10s %10s %10s %10s\n", "", "calls", "errors", "calls/s", "p50 us", "p99 us", "p999 us", "max us");
+
+	std::vector<uint64_t> allLatenciesUS;
+	size_t allErrorCount = 0;
+	for (int operation = 0; operation < EOperationCount; ++operation)
+	{
+		OperationResults &operationResults = results[operation];
+		if (!bOperationEnabled[operation] || operationPaths[operation].empty())
+		{
+			continue;
+		}
+
+		allLatenciesUS.insert(allLatenciesUS.end(), operationResults.latenciesUS.begin(), operationResults.latenciesUS.end());
+		allErrorCount += operationResults.errorCount;
+		printResults(kOperationNames[operation], operationResults.latenciesUS, operationResults.errorCount, elapsedS);
+	}
+
+	printResults("total", allLatenciesUS, allErrorCount, elapsedS);
+	printf("\n  %zu notifications (%.1f/s)\n", notificationCount, static_cast<double>(notificationCount) / elapsedS);
+}
+
+//
+// Entry point
+//
+
+static void printUsage()
+{
+	fprintf(stderr, "Usage: loadgen [-n <service name>] [-c <concurrency>] [-r <calls per second>] [-d <seconds>] [-o <read,write,get>]\n");
+	fprintf(stderr, "               [-w <write size>] [-t <timeout ms>] [--session]\n");
+}
+
+int main(int argc, char **ppArgv)
+{
+	// A basic command-line parser
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = ppArgv[i];
+		bool bHasValue = i + 1 < argc;
+		if (arg == "-n" && bHasValue)
+		{
+			serviceName = ppArgv[++i];
+		}
+		else if (arg == "-c" && bHasValue)
+		{
+			concurrency = std::max(1, atoi(ppArgv[++i]));
+		}
+		else if (arg == "-r" && bHasValue)
+		{
+			callsPerSecond = atof(ppArgv[++i]);
+		}
+		else if (arg == "-d" && bHasValue)
+		{
+			durationS = std::max(1, atoi(ppArgv[++i]));
+		}
+		else if (arg == "-w" && bHasValue)
+		{
+			writeSize = std::max(0, atoi(ppArgv[++i]));
+		}
+		else if (arg == "-t" && bHasValue)
+		{
+			timeoutMS = std::max(1, atoi(ppArgv[++i]));
+		}
+		else if (arg == "-o" && bHasValue)
+		{
+			std::fill(bOperationEnabled, bOperationEnabled + EOperationCount, false);
+
+			std::istringstream operations(ppArgv[++i]);
+			std::string name;
+			while (std::getline(operations, name, ','))
+			{
+				const char **ppName = std::find(kOperationNames, kOperationNames + EOperationCount, name);
+				if (ppName == kOperationNames + EOperationCount)
+				{
+					fprintf(stderr, "Unknown operation: '%s'\n\n", name.c_str());
+					printUsage();
+					return -1;
+				}
+				bOperationEnabled[ppName - kOperationNames] = true;
+			}
+		}
+		else if (arg == "--session")
+		{
+			bUseSessionBus = true;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown parameter: '%s'\n\n", arg.c_str());
+			printUsage();
+			return -1;
+		}
+	}
+
+	// The server owns a bus name derived from its service name (see `Server::getOwnedName()`)
+	busName = "com." + serviceName;
+
+	GError *pError = nullptr;
+	pConnection = g_bus_get_sync(bUseSessionBus ? G_BUS_TYPE_SESSION : G_BUS_TYPE_SYSTEM, nullptr, &pError);
+	if (nullptr == pConnection)
+	{
+		fprintf(stderr, "Unable to connect to the bus: %s\n", nullptr == pError ? "Unknown" : pError->message);
+		g_clear_error(&pError);
+		return -1;
+	}
+
+	if (!discoverCharacteristics())
+	{
+		g_object_unref(pConnection);
+		return -1;
+	}
+
+	for (int operation = 0; operation < EOperationCount; ++operation)
+	{
+		if (bOperationEnabled[operation] && !operationPaths[operation].empty())
+		{
+			operationCycle.push_back(static_cast<Operation>(operation));
+		}
+		printf("%zu characteristics support %s%s\n", operationPaths[operation].size(), kOperationNames[operation],
+			bOperationEnabled[operation] ? "" : " (not enabled)");
+	}
+
+	if (operationCycle.empty())
+	{
+		fprintf(stderr, "None of the server's characteristics support the enabled operations\n");
+		g_object_unref(pConnection);
+		return -1;
+	}
+
+	// Build the arguments that every call shares
+	pReadOptions = g_variant_ref_sink(g_variant_new_parsed("@a{sv} {}"));
+	pWriteOptions = g_variant_ref_sink(g_variant_new_parsed("{'type': <'request'>}"));
+	std::vector<uint8_t> payload(static_cast<size_t>(writeSize));
+	for (size_t i = 0; i < payload.size(); ++i)
+	{
+		payload[i] = static_cast<uint8_t>('a' + i % 26);
+	}
+	pWriteValue = g_variant_ref_sink(g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, payload.data(), payload.size(), 1));
+
+	// Listen for notifications, then subscribe to them
+	guint subscriptionId = g_dbus_connection_signal_subscribe(pConnection, busName.c_str(), kPropertiesInterface,
+		"PropertiesChanged", nullptr, kCharacteristicInterface, G_DBUS_SIGNAL_FLAGS_NONE, onPropertiesChanged, nullptr, nullptr);
+	size_t subscribedCount = callNotifyMethod("StartNotify");
+	printf("Subscribed to %zu of %zu characteristics that notify\n", subscribedCount, notifyPaths.size());
+
+	// Start every slot and run until the time is up
+	pMainLoop = g_main_loop_new(nullptr, FALSE);
+	g_unix_signal_add(SIGINT, onInterrupt, nullptr);
+
+	std::vector<Slot> slots(static_cast<size_t>(concurrency));
+	startTime = std::chrono::steady_clock::now();
+	endTime = startTime + std::chrono::seconds(durationS);
+	for (Slot &slot : slots)
+	{
+		startNextCall(slot);
+	}
+
+	g_main_loop_run(pMainLoop);
+	double elapsedS = static_cast<double>(elapsedUS(startTime, std::chrono::steady_clock::now())) / 1000000.0;
+
+	// Unsubscribe before reporting, so the server isn't left notifying nobody
+	callNotifyMethod("StopNotify");
+	g_dbus_connection_signal_unsubscribe(pConnection, subscriptionId);
+
+	printReport(elapsedS);
+
+	g_variant_unref(pReadOptions);
+	g_variant_unref(pWriteOptions);
+	g_variant_unref(pWriteValue);
+	g_main_loop_unref(pMainLoop);
+	g_object_unref(pConnection);
+	return 0;
+}
@@ -0,0 +1,364 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Replays a trace of D-Bus GATT traffic (see `ggkTraceStart()`) into a server and reports how long it took
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// A trace recorded by a server in the field (see Trace.cpp) holds every method call, property get and set and update it saw.
+// This program builds the server described in Server.cpp and feeds the trace back into it:
+//
+//     method calls    - `Server::callMethod()` with the recorded arguments
+//     property gets   - the property's getter, found with `Server::findProperty()`
+//     property sets   - the property's setter, with the recorded value
+//     updates         - `ggkPushUpdateQueue()`, followed by draining the queue with `idleFunc()`
+//
+// By default, records are replayed at the pace they were recorded. With -f they're replayed one after another as fast as
+// possible, which makes the total time a benchmark of the server's handling of that load profile.
+//
+// As with the micro-benchmarks (see bench.cpp), nothing here talks to D-Bus or BlueZ. The replayed calls have no invocation, so
+// their replies are discarded, and updates have no bus to be sent on. GLib complains (with a critical message) about calls on
+// a null invocation or connection in the few places that make them directly; those complaints are counted rather than printed.
+// The server's data comes from a simple in-memory getter and setter, like the one in standalone.cpp.
+//
+// For each kind of record, we report the number replayed and the mean, p50, p99 and maximum time each took to handle.
+//
+// Usage: replay [-f] [-n <service name>] <trace file>
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/Gobbledegook.h"
+#include "Server.h"
+#include "DBusObjectPath.h"
+#include "GattProperty.h"
+#include "Init.h"
+#include "Trace.h"
+
+namespace ggk {
+
+// Internal method to set the run state of the server (see Gobbledegook.cpp)
+extern void setServerRunState(enum GGKServerRunState newState);
+
+}; // namespace ggk
+
+using namespace ggk;
+
+//
+// Server data
+//
+
+static uint8_t serverDataBatteryLevel = 78;
+static std::string serverDataTextString = "Hello, world!";
+
+// Returns the server's data for `pName`, or nullptr if there is no such data
+static const void *dataGetter(const char *pName)
+{
+	std::string name = nullptr != pName ? pName : "";
+	if (name == "battery/level")
+	{
+		return &serverDataBatteryLevel;
+	}
+	else if (name == "text/string")
+	{
+		return serverDataTextString.c_str();
+	}
+
+	return nullptr;
+}
+
+// Stores the server's data for `pName`, returning 0 if there is no such data
+static int dataSetter(const char *pName, const void *pData)
+{
+	std::string name = nullptr != pName ? pName : "";
+	if (nullptr == pData)
+	{
+		return 0;
+	}
+	else if (name == "battery/level")
+	{
+		serverDataBatteryLevel = *static_cast<const uint8_t *>(pData);
+		return 1;
+	}
+	else if (name == "text/string")
+	{
+		serverDataTextString = static_cast<const char *>(pData);
+		return 1;
+	}
+
+	return 0;
+}
+
+//
+// GLib messages
+//
+
+// The number of critical messages and warnings from GLib while replaying
+static size_t glibComplaintCount = 0;
+
+// Counts (rather than prints) GLib's complaints about our null invocations and connections
+static void onGLibComplaint(const gchar *, GLogLevelFlags, const gchar *, gpointer)
+{
+	glibComplaintCount += 1;
+}
+
+//
+// Replaying
+//
+
+// The kinds of records, indexed by `TraceRecordKind`
+static const int kKindCount = ETraceUpdate + 1;
+static const char *kKindNames[kKindCount] = { "unknown", "method", "get", "set", "update" };
+
+// Returns the recorded arguments of `record` as a GVariant (with a reference owned by the caller), or nullptr if there are none
+//
+// The GVariant refers to the trace's bytes rather than copying them.
+static GVariant *getArguments(const TraceRecord &record)
+{
+	if (0 == record.typeLength || !g_variant_type_string_is_valid(record.getType()))
+	{
+		return nullptr;
+	}
+
+	return g_variant_ref_sink(g_variant_new_from_data(G_VARIANT_TYPE(record.getType()), record.getArguments(), record.argumentsLength,
+		FALSE, nullptr, nullptr));
+}
+
+// Hands a single record to the server
+//
+// Returns false if the server didn't know what to do with it (no such object, interface, method or property.)
+static bool replayRecord(const TraceRecord &record)
+{
+	DBusObjectPath path(record.getPath());
+	GVariant *pArguments = getArguments(record);
+	bool bHandled = false;
+
+	switch(record.kind)
+	{
+		case ETraceMethodCall:
+		{
+			bHandled = TheServer->callMethod(path, record.getInterface(), record.getMember(), nullptr, pArguments, nullptr, nullptr);
+			break;
+		}
+		case ETraceGetProperty:
+		{
+			const GattProperty *pProperty = TheServer->findProperty(path, record.getInterface(), record.getMember());
+			if (nullptr != pProperty && pProperty->getGetterFunc())
+			{
+				GError *pError = nullptr;
+				GVariant *pResult = pProperty->getGetterFunc()(nullptr, "", record.getPath(), record.getInterface(), record.getMember(),
+					&pError, nullptr);
+				if (nullptr != pResult)
+				{
+					g_variant_unref(g_variant_ref_sink(pResult));
+				}
+				g_clear_error(&pError);
+				bHandled = true;
+			}
+			break;
+		}
+		case ETraceSetProperty:
+		{
+			const GattProperty *pProperty = TheServer->findProperty(path, record.getInterface(), record.getMember());
+			if (nullptr != pProperty && pProperty->getSetterFunc() && nullptr != pArguments)
+			{
+				GError *pError = nullptr;
+				pProperty->getSetterFunc()(nullptr, "", record.getPath(), record.getInterface(), record.getMember(), pArguments,
+					&pError, nullptr);
+				g_clear_error(&pError);
+				bHandled = true;
+			}
+			break;
+		}
+		case ETraceUpdate:
+		{
+			bHandled = ggkPushUpdateQueue(record.getPath(), record.getInterface()) != 0;
+			while (idleFunc(nullptr)) {}
+			break;
+		}
+		default:
+			break;
+	}
+
+	if (nullptr != pArguments)
+	{
+		g_variant_unref(pArguments);
+	}
+
+	return bHandled;
+}
+
+// Returns the value at fraction `p` of the way through `sorted`
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+
+	size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+	return sorted[index];
+}
+
+int main(int argc, char **ppArgv)
+{
+	bool bFast = false;
+	std::string serviceName = "gobbledegook";
+	std::string traceFilename;
+
+	// A basic command-line parser
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = ppArgv[i];
+		if (arg == "-f")
+		{
+			bFast = true;
+		}
+		else if (arg == "-n" && i + 1 < argc)
+		{
+			serviceName = ppArgv[++i];
+		}
+		else if (traceFilename.empty() && !arg.empty() && arg[0] != '-')
+		{
+			traceFilename = arg;
+		}
+		else
+		{
+			traceFilename.clear();
+			break;
+		}
+	}
+
+	if (traceFilename.empty())
+	{
+		fprintf(stderr, "Usage: replay [-f] [-n <service name>] <trace file>\n");
+		return -1;
+	}
+
+	// Map the trace
+	int fd = open(traceFilename.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0)
+	{
+		fprintf(stderr, "Unable to open trace file '%s': %s\n", traceFilename.c_str(), strerror(errno));
+		return -1;
+	}
+
+	size_t traceSize = static_cast<size_t>(status.st_size);
+	void *pAddress = traceSize >= sizeof(TraceFileHeader) ? mmap(nullptr, traceSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	const TraceFileHeader *pHeader = static_cast<const TraceFileHeader *>(pAddress);
+	if (MAP_FAILED == pAddress || memcmp(pHeader->magic, TraceFileHeader::kMagic, sizeof(pHeader->magic)) != 0 ||
+		pHeader->version != TraceFileHeader::kVersion || pHeader->headerSize > traceSize)
+	{
+		fprintf(stderr, "'%s' is not a trace file (or is from a different version of the server)\n", traceFilename.c_str());
+		return -1;
+	}
+
+	// Build the server the traffic was recorded from
+	g_log_set_handler("GLib-GIO", static_cast<GLogLevelFlags>(G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING), onGLibComplaint, nullptr);
+	g_log_set_handler("GLib", static_cast<GLogLevelFlags>(G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING), onGLibComplaint, nullptr);
+
+	addServer(std::make_shared<Server>(serviceName, "Gobbledegook", "Gobbledegook", dataGetter, dataSetter));
+
+	// The idleFunc only does work while the server is running
+	setServerRunState(ERunning);
+
+	std::vector<uint64_t> latenciesUS[kKindCount];
+	size_t unhandledCount = 0;
+	uint64_t recordedMicroseconds = 0;
+
+	const uint8_t *pTrace = static_cast<const uint8_t *>(pAddress);
+	size_t offset = pHeader->headerSize;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (offset + sizeof(TraceRecord) <= traceSize)
+	{
+		const TraceRecord &record = *reinterpret_cast<const TraceRecord *>(pTrace + offset);
+
+		// A record with no size ends a trace that wasn't stopped cleanly; one that runs off the end of the file is damaged
+		size_t stringsLength = record.pathLength + record.interfaceLength + record.memberLength + record.typeLength + 4;
+		if (0 == record.size || offset + record.size > traceSize ||
+			sizeof(TraceRecord) + record.argumentsLength + stringsLength > record.size)
+		{
+			break;
+		}
+
+		if (!bFast)
+		{
+			std::this_thread::sleep_until(start + std::chrono::microseconds(record.timestampMicroseconds));
+		}
+
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		bool bHandled = replayRecord(record);
+		uint64_t elapsedUS = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - callStart).count());
+
+		latenciesUS[record.kind < kKindCount ? record.kind : 0].push_back(elapsedUS);
+		unhandledCount += bHandled ? 0 : 1;
+		recordedMicroseconds = record.timestampMicroseconds;
+		offset += record.size;
+	}
+
+	double elapsedS = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count()) / 1000000.0;
+
+	setServerRunState(EStopped);
+	clearServers();
+	munmap(pAddress, traceSize);
+
+	// Report
+	size_t totalCount = 0;
+	printf("%-8s %10s %10s %10s %10s %10s\n", "", "records", "mean us", "p50 us", "p99 us", "max us");
+	for (int kind = 0; kind < kKindCount; ++kind)
+	{
+		std::vector<uint64_t> &latencies = latenciesUS[kind];
+		if (latencies.empty())
+		{
+			continue;
+		}
+
+		uint64_t totalUS = 0;
+		for (uint64_t latency : latencies)
+		{
+			totalUS += latency;
+		}
+
+		std::sort(latencies.begin(), latencies.end());
+		printf("%-8s %10zu %10.1f %10llu %10llu %10llu\n", kKindNames[kind], latencies.size(),
+			static_cast<double>(totalUS) / static_cast<double>(latencies.size()),
+			static_cast<unsigned long long>(percentile(latencies, 0.50)),
+			static_cast<unsigned long long>(percentile(latencies, 0.99)),
+			static_cast<unsigned long long>(latencies.back()));
+		totalCount += latencies.size();
+	}
+
+	printf("\n%zu records replayed in %.3f seconds (%.1f records/s); recorded over %.3f seconds\n", totalCount, elapsedS,
+		elapsedS > 0.0 ? static_cast<double>(totalCount) / elapsedS : 0.0, static_cast<double>(recordedMicroseconds) / 1000000.0);
+	printf("%zu records not handled by the server, %zu GLib complaints\n", unhandledCount, glibComplaintCount);
+	return 0;
+}